@@ -0,0 +1,862 @@
+/* vm.h - v0.2 - public domain data structures - nickscha 2025
+
+A C89 standard compliant, single header, nostdlib (no C Standard Library) vector linear algebra implementation.
+
+This Benchmark compares the by-value API against the pointer based "_p" API on the
+transformation and culling paths. All calls go through volatile function pointers
+so that the compiler cannot inline them away, which mirrors what happens to 64 byte
+m4x4 and 96 byte frustum arguments in non-inlined call sites and debug builds.
+
+Build (x86, uses the time stamp counter):
+
+  cc -O2 -std=c89 -pedantic -Wall -Wextra -Werror -o vm_bench tests/vm_bench.c
+  ./vm_bench
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+*/
+#define VM_USE_SSE
+#include "../vm.h"
+
+#include "../deps/test.h" /* Simple Testing framework (used for printing) */
+
+#if defined(_MSC_VER)
+typedef unsigned __int64 vm_bench_u64;
+#elif defined(__GNUC__) || defined(__clang__)
+__extension__ typedef unsigned long long vm_bench_u64; /* C89 has no 64 bit integer type */
+#else
+typedef unsigned long vm_bench_u64;
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static vm_bench_u64 vm_bench_cycles(void)
+{
+  return (__rdtsc());
+}
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+static vm_bench_u64 vm_bench_cycles(void)
+{
+  unsigned int lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (((vm_bench_u64)hi << 32) | lo);
+}
+#else
+/* No cycle counter available, the benchmark still runs but reports zero */
+static vm_bench_u64 vm_bench_cycles(void)
+{
+  return (0);
+}
+#endif
+
+#define VM_BENCH_ITERATIONS 200000
+#define VM_BENCH_OBJECTS 1024
+#define VM_BENCH_MATRICES 64
+
+static volatile float vm_bench_sink;
+
+/* #############################################################################
+ * # By-value and pointer wrappers (called through volatile function pointers)
+ * #############################################################################
+ */
+typedef m4x4 (*vm_bench_mul_fn)(m4x4 a, m4x4 b);
+typedef void (*vm_bench_mul_p_fn)(m4x4 *VM_RESTRICT out, const m4x4 *a, const m4x4 *b);
+typedef void (*vm_bench_m3x4_mul_p_fn)(m3x4 *VM_RESTRICT out, const m3x4 *a, const m3x4 *b);
+typedef void (*vm_bench_mul_array_fn)(const m4x4 *a, const m4x4 *b, m4x4 *out, int n);
+typedef m4x4 (*vm_bench_inverse_fn)(m4x4 m);
+typedef void (*vm_bench_inverse_p_fn)(m4x4 *VM_RESTRICT out, const m4x4 *m);
+typedef m4x4 (*vm_bench_transformation_fn)(transformation *t);
+typedef void (*vm_bench_transformation_p_fn)(m4x4 *VM_RESTRICT out, const transformation *t);
+typedef void (*vm_bench_from_trs_array_fn)(const transformation *in, m4x4 *out, int n);
+typedef void (*vm_bench_aabb_transform_array_fn)(const m4x4 *worlds, const aabb *in, aabb *out, int n);
+typedef void (*vm_bench_graph_update_fn)(transformation_graph *g);
+typedef int (*vm_bench_cube_fn)(frustum f, v3 center, v3 dimensions, float epsilon);
+typedef int (*vm_bench_cube_p_fn)(const frustum *f, v3 center, v3 dimensions, float epsilon);
+typedef int (*vm_bench_sphere_fn)(frustum f, v3 center, float radius);
+typedef int (*vm_bench_sphere_p_fn)(const frustum *f, v3 center, float radius);
+typedef int (*vm_bench_obb_p_fn)(const frustum *f, v3 center, v3 half_extents, quat rotation);
+typedef void (*vm_bench_cull_obbs_mask_fn)(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, const v3_soa *axes, unsigned char *visible);
+typedef void (*vm_bench_cull_spheres_mask_fn)(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible);
+typedef void (*vm_bench_cull_aabbs_mask_fn)(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible);
+typedef int (*vm_bench_bvh4_cull_fn)(const bvh4 *bvh, const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, frustum_cull_list *list);
+typedef void (*vm_bench_cull_aabbs_multi_fn)(const frustum_simd *frusta, int frustum_count, const v3_soa *centers, const v3_soa *extents, unsigned int *visible);
+typedef int (*vm_bench_cull_aabbs_fn)(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, frustum_cull_list *list);
+
+static void vm_bench_report(char *name, vm_bench_u64 cycles, int calls)
+{
+  test_print_string("[vm_bench] ");
+  test_print_string(name);
+  test_print_string(": ");
+  test_print_int((int)(cycles / (vm_bench_u64)calls));
+  test_print_string(" cycles/call\n");
+}
+
+static frustum vm_bench_frustum(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  return (vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+}
+
+static void vm_bench_m4x4(void)
+{
+  volatile vm_bench_mul_fn mul = vm_m4x4_mul;
+  volatile vm_bench_mul_p_fn mul_p = vm_m4x4_mul_p;
+  volatile vm_bench_m3x4_mul_p_fn mul3_p = vm_m3x4_mul_p;
+  volatile vm_bench_inverse_fn inverse = vm_m4x4_inverse;
+  volatile vm_bench_inverse_p_fn inverse_p = vm_m4x4_inverse_p;
+  volatile vm_bench_inverse_p_fn inverse_affine_p = vm_m4x4_inverse_affine_p;
+  volatile vm_bench_inverse_p_fn inverse_rigid_p = vm_m4x4_inverse_rigid_p;
+
+  m4x4 a = vm_m4x4_translate(vm_m4x4_identity, vm_v3(1.0f, 2.0f, 3.0f));
+  m4x4 b = vm_m4x4_rotate(vm_m4x4_identity, vm_radf(1.0f), vm_v3(0.0f, 1.0f, 0.0f));
+  m4x4 c, d;
+  m3x4 a3, b3, d3;
+  m4x4 matrices[VM_BENCH_MATRICES];
+  vm_bench_u64 start;
+  int i;
+
+  /* Chained product: the result feeds the next call like a transformation hierarchy walk */
+  c = a;
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    c = mul(c, b);
+  }
+  vm_bench_report("vm_m4x4_mul               ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+  vm_bench_sink += c.e[0];
+
+  c = a;
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    mul_p(&d, &c, &b);
+    c = d;
+  }
+  vm_bench_report("vm_m4x4_mul_p             ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+  vm_bench_sink += c.e[0];
+
+  /* Same product with the compact affine type */
+  a3 = vm_m3x4_from_m4x4(a);
+  b3 = vm_m3x4_from_m4x4(b);
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    mul3_p(&d3, &a3, &b3);
+    a3 = d3;
+  }
+  vm_bench_report("vm_m3x4_mul_p             ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+  vm_bench_sink += a3.e[0];
+
+  for (i = 0; i < VM_BENCH_MATRICES; ++i)
+  {
+    matrices[i] = vm_m4x4_translate(vm_m4x4_rotate(vm_m4x4_identity, (float)i * 0.1f, vm_v3(1.0f, 2.0f, 3.0f)), vm_v3((float)i, 1.0f, 2.0f));
+  }
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    c = inverse(matrices[i % VM_BENCH_MATRICES]);
+    vm_bench_sink += c.e[12];
+  }
+  vm_bench_report("vm_m4x4_inverse           ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    inverse_p(&c, &matrices[i % VM_BENCH_MATRICES]);
+    vm_bench_sink += c.e[12];
+  }
+  vm_bench_report("vm_m4x4_inverse_p         ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+
+  /* Affine and rigid fast paths on the same (rigid) matrices */
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    inverse_affine_p(&c, &matrices[i % VM_BENCH_MATRICES]);
+    vm_bench_sink += c.e[12];
+  }
+  vm_bench_report("vm_m4x4_inverse_affine_p  ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    inverse_rigid_p(&c, &matrices[i % VM_BENCH_MATRICES]);
+    vm_bench_sink += c.e[12];
+  }
+  vm_bench_report("vm_m4x4_inverse_rigid_p   ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+}
+
+/* Large enough to exceed the caches and use non-temporal stores */
+#define VM_BENCH_BATCH 65536
+static m4x4 vm_bench_batch_a[VM_BENCH_BATCH];
+static m4x4 vm_bench_batch_b[VM_BENCH_BATCH];
+VM_ALIGN_16 static m4x4 vm_bench_batch_out[VM_BENCH_BATCH];
+
+static void vm_bench_m4x4_batch(void)
+{
+  volatile vm_bench_mul_p_fn mul_p = vm_m4x4_mul_p;
+  volatile vm_bench_mul_array_fn mul_array = vm_m4x4_mul_array;
+  volatile vm_bench_mul_array_fn mul_array_shared = vm_m4x4_mul_array_shared;
+
+  m4x4 *a = vm_bench_batch_a;
+  m4x4 *b = vm_bench_batch_b;
+  m4x4 *out = vm_bench_batch_out;
+  vm_bench_u64 start;
+  int i;
+
+  for (i = 0; i < VM_BENCH_BATCH; ++i)
+  {
+    a[i] = vm_m4x4_translate(vm_m4x4_identity, vm_v3((float)i, 1.0f, 2.0f));
+    b[i] = vm_m4x4_rotate(vm_m4x4_identity, (float)i * 0.01f, vm_v3(0.0f, 1.0f, 0.0f));
+    out[i] = vm_m4x4_zero; /* touch the pages before timing */
+  }
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_BATCH; ++i)
+  {
+    mul_p(&out[i], &a[i], &b[i]);
+  }
+  vm_bench_report("vm_m4x4_mul_p (loop)      ", vm_bench_cycles() - start, VM_BENCH_BATCH);
+  vm_bench_sink += out[VM_BENCH_BATCH - 1].e[12];
+
+  start = vm_bench_cycles();
+  mul_array(a, b, out, VM_BENCH_BATCH);
+  vm_bench_report("vm_m4x4_mul_array         ", vm_bench_cycles() - start, VM_BENCH_BATCH);
+  vm_bench_sink += out[VM_BENCH_BATCH - 1].e[12];
+
+  start = vm_bench_cycles();
+  mul_array_shared(a, b, out, VM_BENCH_BATCH);
+  vm_bench_report("vm_m4x4_mul_array_shared  ", vm_bench_cycles() - start, VM_BENCH_BATCH);
+  vm_bench_sink += out[VM_BENCH_BATCH - 1].e[12];
+}
+
+static aabb vm_bench_aabb_in[VM_BENCH_BATCH];
+static aabb vm_bench_aabb_out[VM_BENCH_BATCH];
+
+/* World AABBs the way they were computed before vm_aabb_transform: 8 transformed corners */
+static void vm_bench_aabb_corners(const m4x4 *worlds, const aabb *in, aabb *out, int n)
+{
+  int i, j;
+
+  for (i = 0; i < n; ++i)
+  {
+    aabb result = vm_aabb_empty();
+
+    for (j = 0; j < 8; ++j)
+    {
+      v3 corner = vm_v3((j & 1) ? in[i].max.x : in[i].min.x, (j & 2) ? in[i].max.y : in[i].min.y, (j & 4) ? in[i].max.z : in[i].min.z);
+      result = vm_aabb_expand(result, vm_m4x4_transform_point(&worlds[i], corner));
+    }
+
+    out[i] = result;
+  }
+}
+
+static void vm_bench_aabb(void)
+{
+  volatile vm_bench_aabb_transform_array_fn corners = vm_bench_aabb_corners;
+  volatile vm_bench_aabb_transform_array_fn transform_array = vm_aabb_transform_array;
+
+  m4x4 *worlds = vm_bench_batch_b; /* rotations from vm_bench_m4x4_batch */
+  vm_bench_u64 start;
+  int i;
+
+  for (i = 0; i < VM_BENCH_BATCH; ++i)
+  {
+    vm_bench_aabb_in[i] = vm_aabb(vm_v3(-1.0f, -2.0f, -0.5f), vm_v3(1.0f, 2.0f, (float)(i & 7)));
+    vm_bench_aabb_out[i] = vm_aabb_empty(); /* touch the pages before timing */
+  }
+
+  start = vm_bench_cycles();
+  corners(worlds, vm_bench_aabb_in, vm_bench_aabb_out, VM_BENCH_BATCH);
+  vm_bench_report("aabb: 8 corners           ", vm_bench_cycles() - start, VM_BENCH_BATCH);
+  vm_bench_sink += vm_bench_aabb_out[VM_BENCH_BATCH - 1].max.x;
+
+  start = vm_bench_cycles();
+  transform_array(worlds, vm_bench_aabb_in, vm_bench_aabb_out, VM_BENCH_BATCH);
+  vm_bench_report("vm_aabb_transform_array   ", vm_bench_cycles() - start, VM_BENCH_BATCH);
+  vm_bench_sink += vm_bench_aabb_out[VM_BENCH_BATCH - 1].max.x;
+}
+
+/* Best of several alternating runs, so neither variant profits from running second */
+#define VM_BENCH_REPEATS 5
+
+static void vm_bench_transformation(void)
+{
+  volatile vm_bench_transformation_fn matrix = vm_transformation_matrix;
+  volatile vm_bench_transformation_p_fn matrix_p = vm_transformation_matrix_p;
+
+  transformation parent = vm_transformation_init();
+  transformation child = vm_transformation_init();
+  m4x4 outputs[VM_BENCH_MATRICES];
+  vm_bench_u64 best = 0;
+  vm_bench_u64 best_p = 0;
+  vm_bench_u64 start;
+  vm_bench_u64 cycles;
+  int repeat;
+  int i;
+
+  vm_tranformation_rotate(&parent, vm_v3(0.0f, 1.0f, 0.0f), 0.5f);
+  child.position = vm_v3(1.0f, 0.0f, 0.0f);
+  child.parent = &parent;
+
+  /* Both variants write into the same ring of plain (non-volatile) matrices,
+     the sink is only read after the timed loops */
+  for (repeat = 0; repeat < VM_BENCH_REPEATS; ++repeat)
+  {
+    start = vm_bench_cycles();
+    for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+    {
+      child.position.y = (float)i;
+      outputs[i % VM_BENCH_MATRICES] = matrix(&child);
+    }
+    cycles = vm_bench_cycles() - start;
+    best = (repeat == 0 || cycles < best) ? cycles : best;
+
+    start = vm_bench_cycles();
+    for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+    {
+      child.position.y = (float)i;
+      matrix_p(&outputs[i % VM_BENCH_MATRICES], &child);
+    }
+    cycles = vm_bench_cycles() - start;
+    best_p = (repeat == 0 || cycles < best_p) ? cycles : best_p;
+
+    vm_bench_sink += outputs[VM_BENCH_MATRICES - 1].e[13];
+  }
+
+  vm_bench_report("vm_transformation_matrix  ", best, VM_BENCH_ITERATIONS);
+  vm_bench_report("vm_transformation_matrix_p", best_p, VM_BENCH_ITERATIONS);
+}
+
+/* 4-ary tree, 4096 nodes deep up to 6 levels */
+#define VM_BENCH_NODES 4096
+static transformation vm_bench_nodes[VM_BENCH_NODES];
+static transformation vm_bench_graph_locals[VM_BENCH_NODES];
+static int vm_bench_graph_parents[VM_BENCH_NODES];
+static m4x4 vm_bench_graph_worlds[VM_BENCH_NODES];
+static unsigned char vm_bench_graph_dirty[VM_BENCH_NODES];
+static int vm_bench_graph_changed[VM_BENCH_NODES];
+static m4x4 vm_bench_graph_inverse_worlds[VM_BENCH_NODES];
+
+static void vm_bench_transformation_graph(void)
+{
+  volatile vm_bench_transformation_p_fn matrix_p = vm_transformation_matrix_p;
+  volatile vm_bench_graph_update_fn update = vm_transformation_graph_update;
+  volatile vm_bench_from_trs_array_fn from_trs_array = vm_m4x4_from_trs_array;
+
+  transformation_graph g = vm_transformation_graph_init(vm_bench_graph_locals, vm_bench_graph_parents, vm_bench_graph_worlds, VM_BENCH_NODES);
+  m4x4 m;
+  vm_bench_u64 start;
+  int i;
+
+  for (i = 0; i < VM_BENCH_NODES; ++i)
+  {
+    int parent = i == 0 ? -1 : (i - 1) / 4;
+
+    vm_bench_nodes[i] = vm_transformation_init();
+    vm_tranformation_rotate(&vm_bench_nodes[i], vm_v3(0.0f, 1.0f, 0.0f), (float)i * 0.01f);
+    vm_bench_nodes[i].position = vm_v3(1.0f, 0.0f, 0.0f);
+    vm_bench_nodes[i].parent = parent < 0 ? 0 : &vm_bench_nodes[parent];
+
+    vm_transformation_graph_add(&g, vm_bench_nodes[i], parent);
+  }
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_NODES; ++i)
+  {
+    matrix_p(&m, &vm_bench_nodes[i]);
+    vm_bench_sink += m.e[12];
+  }
+  vm_bench_report("graph: per node matrix_p  ", vm_bench_cycles() - start, VM_BENCH_NODES);
+
+  start = vm_bench_cycles();
+  update(&g);
+  vm_bench_report("graph: graph_update       ", vm_bench_cycles() - start, VM_BENCH_NODES);
+  vm_bench_sink += g.worlds[VM_BENCH_NODES - 1].e[12];
+
+  start = vm_bench_cycles();
+  from_trs_array(vm_bench_graph_locals, vm_bench_graph_worlds, VM_BENCH_NODES);
+  vm_bench_report("graph: from_trs_array     ", vm_bench_cycles() - start, VM_BENCH_NODES);
+  vm_bench_sink += g.worlds[VM_BENCH_NODES - 1].e[12];
+
+  /* World to local of a deep node: inverse of the recomputed chain vs. the cached inverse */
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    m4x4 inverse = vm_m4x4_inverse(vm_transformation_matrix(&vm_bench_nodes[VM_BENCH_NODES - 1 - (i & 255)]));
+    vm_bench_sink += vm_m4x4_transform_point(&inverse, vm_v3((float)i, 0.0f, 0.0f)).x;
+  }
+  vm_bench_report("graph: inverse(matrix)    ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+
+  vm_transformation_graph_enable_inverse_cache(&g, vm_bench_graph_inverse_worlds);
+  update(&g);
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_ITERATIONS; ++i)
+  {
+    vm_bench_sink += vm_transformation_graph_point_to_local(&g, VM_BENCH_NODES - 1 - (i & 255), vm_v3((float)i, 0.0f, 0.0f)).x;
+  }
+  vm_bench_report("graph: point_to_local     ", vm_bench_cycles() - start, VM_BENCH_ITERATIONS);
+
+  /* Change tracking, one subtree of 1365 nodes (below node 1) is dirty */
+  vm_transformation_graph_enable_tracking(&g, vm_bench_graph_dirty, vm_bench_graph_changed);
+  update(&g);
+  vm_transformation_graph_mark_dirty(&g, 1);
+
+  start = vm_bench_cycles();
+  update(&g);
+  vm_bench_report("graph: update 1/3 dirty   ", vm_bench_cycles() - start, VM_BENCH_NODES);
+  vm_bench_sink += (float)g.changed_count;
+}
+
+/* The same objects as SoA streams through the 8 wide kernels */
+static float vm_bench_cull_x[VM_BENCH_OBJECTS];
+static float vm_bench_cull_y[VM_BENCH_OBJECTS];
+static float vm_bench_cull_z[VM_BENCH_OBJECTS];
+static float vm_bench_cull_radii[VM_BENCH_OBJECTS];
+static float vm_bench_cull_extents[VM_BENCH_OBJECTS];
+static unsigned char vm_bench_cull_visible[VM_BENCH_OBJECTS / 8 + 1];
+static float vm_bench_cull_axes[3][3][VM_BENCH_OBJECTS];
+static int vm_bench_cull_inside[VM_BENCH_OBJECTS];
+static int vm_bench_cull_intersecting[VM_BENCH_OBJECTS];
+
+static void vm_bench_culling_simd(const frustum *f, const v3 *centers)
+{
+  volatile vm_bench_cull_spheres_mask_fn cull_spheres_mask = vm_frustum_cull_spheres_mask;
+  volatile vm_bench_cull_aabbs_mask_fn cull_aabbs_mask = vm_frustum_cull_aabbs_mask;
+  volatile vm_bench_cull_aabbs_fn cull_aabbs = vm_frustum_cull_aabbs;
+  volatile vm_bench_cull_obbs_mask_fn cull_obbs_mask = vm_frustum_cull_obbs_mask;
+
+  frustum_simd simd;
+  v3_soa axes[3];
+  frustum_cull_list list = vm_frustum_cull_list(vm_bench_cull_inside, vm_bench_cull_intersecting);
+  v3_soa soa_centers = vm_v3_soa(vm_bench_cull_x, vm_bench_cull_y, vm_bench_cull_z, VM_BENCH_OBJECTS);
+  v3_soa soa_extents = vm_v3_soa(vm_bench_cull_extents, vm_bench_cull_extents, vm_bench_cull_extents, VM_BENCH_OBJECTS);
+  vm_bench_u64 start;
+  int rounds = VM_BENCH_ITERATIONS / VM_BENCH_OBJECTS;
+  int i, r;
+
+  vm_frustum_simd_p(&simd, f);
+
+  for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+  {
+    vm_bench_cull_x[i] = centers[i].x;
+    vm_bench_cull_y[i] = centers[i].y;
+    vm_bench_cull_z[i] = centers[i].z;
+    vm_bench_cull_radii[i] = 1.0f;
+    vm_bench_cull_extents[i] = 0.5f + 0.15f;
+  }
+
+  /* Boxes rotated by 30 degrees around y */
+  for (r = 0; r < 3; ++r)
+  {
+    axes[r] = vm_v3_soa(vm_bench_cull_axes[r][0], vm_bench_cull_axes[r][1], vm_bench_cull_axes[r][2], VM_BENCH_OBJECTS);
+
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      axes[r].x[i] = r == 0 ? 0.866f : (r == 2 ? 0.5f : 0.0f);
+      axes[r].y[i] = r == 1 ? 1.0f : 0.0f;
+      axes[r].z[i] = r == 0 ? -0.5f : (r == 2 ? 0.866f : 0.0f);
+    }
+  }
+
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    cull_aabbs_mask(&simd, &soa_centers, &soa_extents, vm_bench_cull_visible);
+    vm_bench_sink += (float)vm_bench_cull_visible[r & 7];
+  }
+  vm_bench_report("cull: aabbs_mask          ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    cull_spheres_mask(&simd, &soa_centers, vm_bench_cull_radii, vm_bench_cull_visible);
+    vm_bench_sink += (float)vm_bench_cull_visible[r & 7];
+  }
+  vm_bench_report("cull: spheres_mask        ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    cull_obbs_mask(&simd, &soa_centers, &soa_extents, axes, vm_bench_cull_visible);
+    vm_bench_sink += (float)vm_bench_cull_visible[r & 7];
+  }
+  vm_bench_report("cull: obbs_mask           ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+
+  /* Compacted index lists, about half of the objects are visible */
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    vm_bench_sink += (float)cull_aabbs(&simd, &soa_centers, &soa_extents, &list);
+  }
+  vm_bench_report("cull: aabbs (index lists) ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+}
+
+/* What rotated boxes needed before vm_frustum_is_obb_in_p: the world AABB around the box */
+static int vm_bench_obb_inflated(const frustum *f, v3 center, v3 half_extents, quat rotation)
+{
+  m4x4 m = vm_quat_to_rotation_matrix(rotation);
+  float world_extents[3];
+  int i;
+
+  for (i = 0; i < 3; ++i)
+  {
+    world_extents[i] = vm_absf(m.e[VM_M4X4_AT(i, 0)]) * half_extents.x + vm_absf(m.e[VM_M4X4_AT(i, 1)]) * half_extents.y + vm_absf(m.e[VM_M4X4_AT(i, 2)]) * half_extents.z;
+  }
+
+  return (vm_frustum_is_cube_in_p(f, center, vm_v3(2.0f * world_extents[0], 2.0f * world_extents[1], 2.0f * world_extents[2]), 0.0f));
+}
+
+/* ... or the 8 corners transformed by hand and tested against every plane */
+static int vm_bench_obb_corners(const frustum *f, v3 center, v3 half_extents, quat rotation)
+{
+  m4x4 m = vm_quat_to_rotation_matrix(rotation);
+  const v4 *planes = (const v4 *)f;
+  v3 corners[8];
+  int i, j;
+
+  for (j = 0; j < 8; ++j)
+  {
+    v3 local = vm_v3((j & 1) ? half_extents.x : -half_extents.x, (j & 2) ? half_extents.y : -half_extents.y, (j & 4) ? half_extents.z : -half_extents.z);
+    corners[j] = vm_v3_add(center, vm_m4x4_transform_vector(&m, local));
+  }
+
+  for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+  {
+    int outside = 1;
+
+    for (j = 0; j < 8 && outside; ++j)
+    {
+      outside = planes[i].x * corners[j].x + planes[i].y * corners[j].y + planes[i].z * corners[j].z + planes[i].w < 0.0f;
+    }
+
+    if (outside)
+    {
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+static void vm_bench_culling(void)
+{
+  volatile vm_bench_cube_fn cube = vm_frustum_is_cube_in;
+  volatile vm_bench_cube_p_fn cube_p = vm_frustum_is_cube_in_p;
+  volatile vm_bench_sphere_fn sphere = vm_frustum_is_sphere_in;
+  volatile vm_bench_sphere_p_fn sphere_p = vm_frustum_is_sphere_in_p;
+  volatile vm_bench_obb_p_fn obb_p = vm_frustum_is_obb_in_p;
+  volatile vm_bench_obb_p_fn obb_inflated = vm_bench_obb_inflated;
+  volatile vm_bench_obb_p_fn obb_corners = vm_bench_obb_corners;
+
+  frustum f = vm_bench_frustum();
+  v3 centers[VM_BENCH_OBJECTS];
+  v3 dimensions = vm_v3_one;
+  v3 half_extents = vm_v3(2.0f, 0.5f, 0.5f);
+  quat rotation = vm_quat_rotate(vm_v3(0.0f, 1.0f, 0.0f), vm_radf(30.0f));
+  vm_bench_u64 start;
+  int rounds = VM_BENCH_ITERATIONS / VM_BENCH_OBJECTS;
+  int visible;
+  int i, r;
+
+  for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+  {
+    centers[i] = vm_v3((float)(i % 32) * 4.0f - 64.0f, (float)(i / 32) * 2.0f - 32.0f, -(float)i * 0.25f);
+  }
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += cube(f, centers[i], dimensions, 0.15f);
+    }
+  }
+  vm_bench_report("vm_frustum_is_cube_in     ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += cube_p(&f, centers[i], dimensions, 0.15f);
+    }
+  }
+  vm_bench_report("vm_frustum_is_cube_in_p   ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += sphere(f, centers[i], 1.0f);
+    }
+  }
+  vm_bench_report("vm_frustum_is_sphere_in   ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += sphere_p(&f, centers[i], 1.0f);
+    }
+  }
+  vm_bench_report("vm_frustum_is_sphere_in_p ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  /* Rotated box: projected radius test vs. the world AABB around it */
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += obb_p(&f, centers[i], half_extents, rotation);
+    }
+  }
+  vm_bench_report("vm_frustum_is_obb_in_p    ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += obb_inflated(&f, centers[i], half_extents, rotation);
+    }
+  }
+  vm_bench_report("obb: inflated AABB        ", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  visible = 0;
+  start = vm_bench_cycles();
+  for (r = 0; r < rounds; ++r)
+  {
+    for (i = 0; i < VM_BENCH_OBJECTS; ++i)
+    {
+      visible += obb_corners(&f, centers[i], half_extents, rotation);
+    }
+  }
+  vm_bench_report("obb: 8 transformed corners", vm_bench_cycles() - start, rounds * VM_BENCH_OBJECTS);
+  vm_bench_sink += (float)visible;
+
+  vm_bench_culling_simd(&f, centers);
+}
+
+/* 262144 objects on a 2000 x 2000 plane around the camera, most of them outside */
+#define VM_BENCH_WORLD_OBJECTS 262144
+static float vm_bench_world_x[VM_BENCH_WORLD_OBJECTS];
+static float vm_bench_world_y[VM_BENCH_WORLD_OBJECTS];
+static float vm_bench_world_z[VM_BENCH_WORLD_OBJECTS];
+static float vm_bench_world_extents[VM_BENCH_WORLD_OBJECTS];
+static int vm_bench_world_inside[VM_BENCH_WORLD_OBJECTS];
+static int vm_bench_world_intersecting[VM_BENCH_WORLD_OBJECTS];
+static unsigned char vm_bench_world_memory[(VM_BENCH_WORLD_OBJECTS + 1) * (sizeof(int) + sizeof(bvh4_node)) + 16];
+
+static void vm_bench_bvh(void)
+{
+  volatile vm_bench_cull_aabbs_fn cull_aabbs = vm_frustum_cull_aabbs;
+  volatile vm_bench_bvh4_cull_fn bvh_cull = vm_bvh4_cull;
+
+  frustum_simd f = vm_frustum_simd(vm_bench_frustum());
+  v3_soa centers = vm_v3_soa(vm_bench_world_x, vm_bench_world_y, vm_bench_world_z, VM_BENCH_WORLD_OBJECTS);
+  v3_soa extents = vm_v3_soa(vm_bench_world_extents, vm_bench_world_extents, vm_bench_world_extents, VM_BENCH_WORLD_OBJECTS);
+  frustum_cull_list list = vm_frustum_cull_list(vm_bench_world_inside, vm_bench_world_intersecting);
+  vm_arena arena = vm_arena_init(vm_bench_world_memory, sizeof(vm_bench_world_memory));
+  bvh4 bvh;
+  vm_bench_u64 start;
+  int i;
+
+  for (i = 0; i < VM_BENCH_WORLD_OBJECTS; ++i)
+  {
+    vm_bench_world_x[i] = (float)(i % 512) * 3.9f - 1000.0f;
+    vm_bench_world_y[i] = (float)((i * 7) % 13) - 6.0f;
+    vm_bench_world_z[i] = (float)(i / 512) * 3.9f - 1000.0f;
+    vm_bench_world_extents[i] = 1.0f;
+  }
+
+  start = vm_bench_cycles();
+  vm_bvh4_build(&bvh, &arena, &centers, &extents);
+  vm_bench_report("bvh4: build               ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  start = vm_bench_cycles();
+  vm_bvh4_refit(&bvh, &centers, &extents);
+  vm_bench_report("bvh4: refit               ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  /* Cycles per object in the world, not per visible object */
+  start = vm_bench_cycles();
+  vm_bench_sink += (float)cull_aabbs(&f, &centers, &extents, &list);
+  vm_bench_report("bvh4: flat cull_aabbs     ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  start = vm_bench_cycles();
+  vm_bench_sink += (float)bvh_cull(&bvh, &f, &centers, &extents, &list);
+  vm_bench_report("bvh4: cull                ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+}
+
+#define VM_BENCH_VIEWS 4
+static unsigned char vm_bench_world_visible[VM_BENCH_VIEWS][VM_BENCH_WORLD_OBJECTS / 8];
+static unsigned int vm_bench_world_views[VM_BENCH_WORLD_OBJECTS];
+
+/* Shadow cascades: one pass per view vs. one pass over the objects for all views */
+static void vm_bench_culling_multi(void)
+{
+  volatile vm_bench_cull_aabbs_mask_fn cull_aabbs_mask = vm_frustum_cull_aabbs_mask;
+  volatile vm_bench_cull_aabbs_multi_fn cull_aabbs_multi = vm_frustum_cull_aabbs_multi;
+
+  v3_soa centers = vm_v3_soa(vm_bench_world_x, vm_bench_world_y, vm_bench_world_z, VM_BENCH_WORLD_OBJECTS);
+  v3_soa extents = vm_v3_soa(vm_bench_world_extents, vm_bench_world_extents, vm_bench_world_extents, VM_BENCH_WORLD_OBJECTS);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum_simd frusta[VM_BENCH_VIEWS];
+  vm_bench_u64 start;
+  int k;
+
+  for (k = 0; k < VM_BENCH_VIEWS; ++k)
+  {
+    float near_plane = k == 0 ? 0.1f : 30.0f * (float)(1 << (2 * (k - 1)));
+    m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, near_plane, 30.0f * (float)(1 << (2 * k)));
+    frusta[k] = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  }
+
+  /* Touch the outputs once so page faults are not measured, then cycles per object in the world for all views together */
+  cull_aabbs_multi(frusta, VM_BENCH_VIEWS, &centers, &extents, vm_bench_world_views);
+  for (k = 0; k < VM_BENCH_VIEWS; ++k)
+  {
+    cull_aabbs_mask(&frusta[k], &centers, &extents, vm_bench_world_visible[k]);
+  }
+
+  start = vm_bench_cycles();
+  for (k = 0; k < VM_BENCH_VIEWS; ++k)
+  {
+    cull_aabbs_mask(&frusta[k], &centers, &extents, vm_bench_world_visible[k]);
+  }
+  vm_bench_report("cull: 4 views, 4 passes   ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+  vm_bench_sink += (float)vm_bench_world_visible[VM_BENCH_VIEWS - 1][100];
+
+  start = vm_bench_cycles();
+  cull_aabbs_multi(frusta, VM_BENCH_VIEWS, &centers, &extents, vm_bench_world_views);
+  vm_bench_report("cull: 4 views, aabbs_multi", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+  vm_bench_sink += (float)vm_bench_world_views[100];
+}
+
+/* Moving objects: per object update cost of the spatial indices vs. a BVH refit */
+static unsigned char vm_bench_spatial_memory[VM_BENCH_WORLD_OBJECTS * 128 + 8 * 1024 * 1024];
+
+static void vm_bench_spatial(void)
+{
+  vm_arena arena = vm_arena_init(vm_bench_spatial_memory, sizeof(vm_bench_spatial_memory));
+  frustum_simd f = vm_frustum_simd(vm_bench_frustum());
+  spatial_query query = vm_spatial_query_frustum(&f);
+  spatial_grid grid;
+  loose_octree octree;
+  v3 extents = vm_v3(1.0f, 1.0f, 1.0f);
+  vm_bench_u64 start;
+  int i;
+
+  if (!vm_spatial_grid_init(&grid, &arena, vm_v3(-1000.0f, -16.0f, -1000.0f), 16.0f, 125, 2, 125, VM_BENCH_WORLD_OBJECTS) ||
+      !vm_loose_octree_init(&octree, &arena, vm_v3_zero, 1000.0f, 7, VM_BENCH_WORLD_OBJECTS))
+  {
+    return;
+  }
+
+  for (i = 0; i < VM_BENCH_WORLD_OBJECTS; ++i)
+  {
+    v3 center = vm_v3(vm_bench_world_x[i], vm_bench_world_y[i], vm_bench_world_z[i]);
+    vm_spatial_grid_insert(&grid, i, center, extents);
+    vm_loose_octree_insert(&octree, i, center, extents);
+  }
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_WORLD_OBJECTS; ++i)
+  {
+    vm_spatial_grid_move(&grid, i, vm_v3(vm_bench_world_x[i] + 2.5f, vm_bench_world_y[i], vm_bench_world_z[i]), extents);
+  }
+  vm_bench_report("grid: move                ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  start = vm_bench_cycles();
+  for (i = 0; i < VM_BENCH_WORLD_OBJECTS; ++i)
+  {
+    vm_loose_octree_move(&octree, i, vm_v3(vm_bench_world_x[i] + 2.5f, vm_bench_world_y[i], vm_bench_world_z[i]), extents);
+  }
+  vm_bench_report("octree: move              ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  /* Cycles per object in the world */
+  start = vm_bench_cycles();
+  vm_bench_sink += (float)vm_spatial_grid_query(&grid, &query, vm_bench_world_inside);
+  vm_bench_report("grid: frustum query       ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+
+  start = vm_bench_cycles();
+  vm_bench_sink += (float)vm_loose_octree_query(&octree, &query, vm_bench_world_inside);
+  vm_bench_report("octree: frustum query     ", vm_bench_cycles() - start, VM_BENCH_WORLD_OBJECTS);
+}
+
+int main(void)
+{
+  vm_bench_m4x4();
+  vm_bench_m4x4_batch();
+  vm_bench_aabb();
+  vm_bench_transformation();
+  vm_bench_transformation_graph();
+  vm_bench_culling();
+  vm_bench_bvh();
+  vm_bench_culling_multi();
+  vm_bench_spatial();
+
+  return 0;
+}
+
+/*
+   ------------------------------------------------------------------------------
+   This software is available under 2 licenses -- choose whichever you prefer.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE A - MIT License
+   Copyright (c) 2025 nickscha
+   Permission is hereby granted, free of charge, to any person obtaining a copy of
+   this software and associated documentation files (the "Software"), to deal in
+   the Software without restriction, including without limitation the rights to
+   use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+   of the Software, and to permit persons to whom the Software is furnished to do
+   so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE B - Public Domain (www.unlicense.org)
+   This is free and unencumbered software released into the public domain.
+   Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+   software, either in source code form or as a compiled binary, for any purpose,
+   commercial or non-commercial, and by any means.
+   In jurisdictions that recognize copyright laws, the author or authors of this
+   software dedicate any and all copyright interest in the software to the public
+   domain. We make this dedication for the benefit of the public at large and to
+   the detriment of our heirs and successors. We intend this dedication to be an
+   overt act of relinquishment in perpetuity of all present and future rights to
+   this software under copyright law.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+   WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+   ------------------------------------------------------------------------------
+*/
@@ -11,6 +11,10 @@ LICENSE
 
 */
 #define VM_USE_SSE
+#define VM_USE_DISPATCH
+#define VM_DEBUG
+#define VM_M4X4_STREAM_THRESHOLD 8 /* Exercise the non-temporal store path with small batches */
+#define VM_TRANSFORMATION_GRAPH_CHUNK 4 /* Split small levels across several workers */
 #include "../vm.h"
 
 #include "../deps/test.h" /* Simple Testing framework */
@@ -245,9 +249,9 @@ void vm_test_v2(void)
 
 void vm_test_v3(void)
 {
-  v3 a = {1.0f, 1.0f, 1.0f};
+  v3 a = vm_v3(1.0f, 1.0f, 1.0f);
   v3 b = vm_v3_one;
-  v3 c = {2.0f, 2.0f, 2.0f};
+  v3 c = vm_v3(2.0f, 2.0f, 2.0f);
   v3 d = vm_v3f(3.0f);
 
   assert(vm_v3_equals(a, b));
@@ -271,8 +275,8 @@ void vm_test_v3(void)
 
 void vm_test_v3_cross_dot_normalize(void)
 {
-  v3 a = {1.0f, 0.0f, 0.0f};
-  v3 b = {0.0f, 1.0f, 0.0f};
+  v3 a = vm_v3(1.0f, 0.0f, 0.0f);
+  v3 b = vm_v3(0.0f, 1.0f, 0.0f);
   v3 r = vm_v3_cross(a, b);
   float rf;
   float epsilon = 1e-2f;
@@ -385,9 +389,40 @@ void vm_test_v3_distance(void)
   assert(vm_absf(d - 1.41421356f) < 0.001f); /* sqrt(2) */
 }
 
+#ifdef VM_SIMD_STORAGE
+void vm_test_v3_simd_storage(void)
+{
+  v3 a = vm_v3(1.0f, 2.0f, 3.0f);
+  v3 b = vm_v3(-2.0f, 0.5f, 4.0f);
+  v3 c = vm_v3_normalize(vm_v3_cross(vm_v3_addf(a, 1.0f), vm_v3_div(b, a)));
+  v3 d = vm_v3_lerp(vm_v3_subf(a, 2.0f), vm_v3_divf(b, 2.0f), 0.5f);
+  v3 e = b;
+
+  /* Every operation has to keep the w lane defined */
+  assert(sizeof(v3) == 16);
+  assert(a.w == 0.0f && vm_v3_zero.w == 0.0f);
+  assert(vm_v3_addf(a, 1.0f).w == 0.0f);
+  assert(vm_v3_subf(a, 1.0f).w == 0.0f);
+  assert(vm_v3_div(a, b).w == 0.0f);
+  e.w = -0.0f;
+  assert(1.0f / vm_v3_div(a, e).w > 0.0f); /* w stays +0.0f whatever the sign of the divisor w lane */
+  assert(vm_v3_divf(a, 3.0f).w == 0.0f);
+  assert(vm_v3_cross(a, b).w == 0.0f);
+  assert(vm_v3_normalize(vm_v3_zero).w == 0.0f);
+  assert(c.w == 0.0f);
+  assert(d.w == 0.0f);
+
+  assert(vm_v3_equals(vm_v3_cross(a, b), vm_v3(6.5f, -10.0f, 4.5f)));
+  assert(vm_v3_dot(a, b) == 11.0f);
+  assert(vm_fequal(vm_v3_length(c), 1.0f));
+  assert(vm_v3_equals(d, vm_v3(-1.0f, 0.125f, 1.5f)));
+  assert(vm_v4_dot(vm_v4(1.0f, 2.0f, 3.0f, 4.0f), vm_v4(4.0f, 3.0f, 2.0f, 1.0f)) == 20.0f);
+}
+#endif
+
 void vm_test_v4(void)
 {
-  v4 a = {1.0f, 1.0f, 1.0f, 1.0f};
+  v4 a = vm_v4(1.0f, 1.0f, 1.0f, 1.0f);
   v4 b = vm_v4_one;
   v4 c = vm_v4f(3.0f);
 
@@ -415,6 +450,431 @@ void vm_test_v4(void)
   assert(vm_v4_divf(a, 0.5f).w == 2.0f);
 }
 
+void vm_test_v3_soa(void)
+{
+  float ax[15], ay[15], az[15];
+  float bx[15], by[15], bz[15];
+  float rx[15], ry[15], rz[15];
+  float rf[15];
+
+  v3_soa a = vm_v3_soa(ax, ay, az, 15);
+  v3_soa b = vm_v3_soa(bx, by, bz, 15);
+  v3_soa r = vm_v3_soa(rx, ry, rz, 15);
+
+  int i;
+
+  for (i = 0; i < 15; ++i)
+  {
+    vm_v3_soa_set(&a, i, vm_v3((float)i * 0.5f, 2.0f - (float)i, (i % 3 == 0) ? 0.0f : 1.5f));
+    vm_v3_soa_set(&b, i, vm_v3(1.0f, (float)(i % 4), -0.25f * (float)i));
+  }
+  vm_v3_soa_set(&a, 5, vm_v3_zero);
+
+  /* Full 8/4 wide groups go through the SIMD paths, the remaining 3 through the scalar tail */
+  vm_v3_soa_add(&r, &a, &b);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_v3_equals(vm_v3_soa_get(&r, i), vm_v3_add(vm_v3_soa_get(&a, i), vm_v3_soa_get(&b, i))));
+  }
+
+  vm_v3_soa_sub(&r, &a, &b);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_v3_equals(vm_v3_soa_get(&r, i), vm_v3_sub(vm_v3_soa_get(&a, i), vm_v3_soa_get(&b, i))));
+  }
+
+  vm_v3_soa_mulf(&r, &a, 2.0f);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_v3_equals(vm_v3_soa_get(&r, i), vm_v3_mulf(vm_v3_soa_get(&a, i), 2.0f)));
+  }
+
+  vm_v3_soa_cross(&r, &a, &b);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_v3_equals(vm_v3_soa_get(&r, i), vm_v3_cross(vm_v3_soa_get(&a, i), vm_v3_soa_get(&b, i))));
+  }
+
+  vm_v3_soa_dot(rf, &a, &b);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(rf[i] == vm_v3_dot(vm_v3_soa_get(&a, i), vm_v3_soa_get(&b, i)));
+  }
+
+  vm_v3_soa_lerp(&r, &a, &b, 0.25f);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_v3_equals(vm_v3_soa_get(&r, i), vm_v3_lerp(vm_v3_soa_get(&a, i), vm_v3_soa_get(&b, i), 0.25f)));
+  }
+
+  vm_v3_soa_normalize(&r, &a);
+  for (i = 0; i < 15; ++i)
+  {
+    v3 expected = vm_v3_normalize(vm_v3_soa_get(&a, i));
+    assert(vm_fequal(rx[i], expected.x));
+    assert(vm_fequal(ry[i], expected.y));
+    assert(vm_fequal(rz[i], expected.z));
+  }
+
+  vm_v3_soa_length(rf, &b);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_fequal(rf[i], vm_v3_length(vm_v3_soa_get(&b, i))));
+  }
+}
+
+void vm_test_v4_soa(void)
+{
+  float ax[13], ay[13], az[13], aw[13];
+  float bx[13], by[13], bz[13], bw[13];
+  float rx[13], ry[13], rz[13], rw[13];
+  float rf[13];
+
+  v4_soa a = vm_v4_soa(ax, ay, az, aw, 13);
+  v4_soa b = vm_v4_soa(bx, by, bz, bw, 13);
+  v4_soa r = vm_v4_soa(rx, ry, rz, rw, 13);
+
+  int i;
+
+  for (i = 0; i < 13; ++i)
+  {
+    vm_v4_soa_set(&a, i, vm_v4((float)i, 0.5f * (float)i, -2.0f, (float)(i % 2)));
+  }
+
+  vm_v4_soa_add(&r, &a, &a);
+  for (i = 0; i < 13; ++i)
+  {
+    assert(vm_v4_equals(vm_v4_soa_get(&r, i), vm_v4_add(vm_v4_soa_get(&a, i), vm_v4_soa_get(&a, i))));
+  }
+
+  vm_v4_soa_dot(rf, &a, &r);
+  for (i = 0; i < 13; ++i)
+  {
+    assert(rf[i] == vm_v4_dot(vm_v4_soa_get(&a, i), vm_v4_soa_get(&r, i)));
+  }
+
+  vm_v4_soa_lerp(&b, &a, &r, 0.25f);
+  for (i = 0; i < 13; ++i)
+  {
+    v4 va = vm_v4_soa_get(&a, i);
+    v4 vr = vm_v4_soa_get(&r, i);
+    v4 vb = vm_v4_soa_get(&b, i);
+    assert(vm_fequal(vb.x, (vr.x - va.x) * 0.25f + va.x));
+    assert(vm_fequal(vb.y, (vr.y - va.y) * 0.25f + va.y));
+    assert(vm_fequal(vb.z, (vr.z - va.z) * 0.25f + va.z));
+    assert(vm_fequal(vb.w, (vr.w - va.w) * 0.25f + va.w));
+  }
+
+  vm_v4_soa_set(&a, 3, vm_v4(0.0f, 0.0f, 0.0f, 0.0f));
+  vm_v4_soa_normalize(&r, &a);
+  for (i = 0; i < 13; ++i)
+  {
+    v4 v = vm_v4_soa_get(&a, i);
+    float length_squared = vm_v4_dot(v, v);
+    float scalar = (length_squared > 0.0f) ? vm_invsqrt(length_squared) : 0.0f;
+    assert(vm_fequal(rx[i], v.x * scalar));
+    assert(vm_fequal(ry[i], v.y * scalar));
+    assert(vm_fequal(rz[i], v.z * scalar));
+    assert(vm_fequal(rw[i], v.w * scalar));
+  }
+}
+
+void vm_test_v3x4(void)
+{
+  v3 a[8];
+  v3 b[8];
+  v3 r[8];
+  quat q[8];
+  int indices[8] = {7, 2, 5, 0, 1, 6, 3, 4};
+  float t[4] = {-1.0f, 0.25f, 0.5f, 2.0f};
+  int i;
+
+  v3x4 a4, b4, r4;
+  v3x8 a8, b8;
+  quatx4 q4;
+  f32x4 dot4;
+
+  for (i = 0; i < 8; ++i)
+  {
+    a[i] = vm_v3((float)i, 1.0f - (float)i, 2.0f);
+    b[i] = vm_v3(0.5f, (float)(i * 2), -1.0f);
+    q[i] = vm_quat_rotate(vm_v3_normalize(vm_v3(1.0f, (float)i, 0.5f)), (float)i * 0.3f);
+  }
+
+  a4 = vm_v3x4_load(a);
+  b4 = vm_v3x4_load(b);
+  q4 = vm_quatx4_load(q);
+
+  r4 = vm_v3x4_cross(a4, b4);
+  for (i = 0; i < 4; ++i)
+  {
+    assert(vm_v3_equals(vm_v3x4_get(r4, i), vm_v3_cross(a[i], b[i])));
+  }
+
+  dot4 = vm_v3x4_dot(a4, b4);
+  vm_f32x4_store(t, dot4);
+  for (i = 0; i < 4; ++i)
+  {
+    assert(t[i] == vm_v3_dot(a[i], b[i]));
+  }
+
+  vm_v3x4_store(r, vm_v3x4_normalize(a4));
+  for (i = 0; i < 4; ++i)
+  {
+    v3 expected = vm_v3_normalize(a[i]);
+    assert(vm_fequal(r[i].x, expected.x));
+    assert(vm_fequal(r[i].y, expected.y));
+    assert(vm_fequal(r[i].z, expected.z));
+  }
+
+  vm_v3x4_store(r, vm_v3x4_rotate(a4, q4));
+  for (i = 0; i < 4; ++i)
+  {
+    v3 expected = vm_v3_rotate(a[i], q[i]);
+    assert(vm_fequal(r[i].x, expected.x));
+    assert(vm_fequal(r[i].y, expected.y));
+    assert(vm_fequal(r[i].z, expected.z));
+  }
+
+  /* Lerp clamps per lane: lane 0 returns a, lane 3 returns b */
+  t[0] = -1.0f;
+  t[1] = 0.25f;
+  t[2] = 0.5f;
+  t[3] = 2.0f;
+  r4 = vm_v3x4_lerp(a4, b4, vm_f32x4_load(t));
+  for (i = 0; i < 4; ++i)
+  {
+    assert(vm_v3_equals(vm_v3x4_get(r4, i), vm_v3_lerp(a[i], b[i], t[i])));
+  }
+
+  /* Gather/scatter with indices and 8 lanes */
+  a8 = vm_v3x8_gather(a, indices);
+  b8 = vm_v3x8_gather(b, indices);
+  vm_v3x8_scatter(r, indices, vm_v3x8_sub(a8, b8));
+  for (i = 0; i < 8; ++i)
+  {
+    assert(vm_v3_equals(r[i], vm_v3_sub(a[i], b[i])));
+  }
+
+  vm_v3x8_store(r, vm_v3x8_rotate(vm_v3x8_load(a), vm_quatx8_load(q)));
+  for (i = 0; i < 8; ++i)
+  {
+    v3 expected = vm_v3_rotate(a[i], q[i]);
+    assert(vm_fequal(r[i].x, expected.x));
+    assert(vm_fequal(r[i].y, expected.y));
+    assert(vm_fequal(r[i].z, expected.z));
+  }
+}
+
+#ifdef VM_USE_DISPATCH
+void vm_test_dispatch(void)
+{
+  float px[35], py[35], pz[35];
+  float vx[35], vy[35], vz[35];
+  float rx[35], ry[35], rz[35];
+  v3 points[35];
+  v3 transformed[35];
+  m4x4 m = vm_m4x4_translate(vm_m4x4_rotate(vm_m4x4_identity, vm_radf(45.0f), vm_v3(1.0f, 0.0f, 0.0f)), vm_v3(3.0f, 2.0f, 1.0f));
+
+  v3_soa p = vm_v3_soa(px, py, pz, 35);
+  v3_soa v = vm_v3_soa(vx, vy, vz, 35);
+  v3_soa r = vm_v3_soa(rx, ry, rz, 35);
+
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum_simd planes = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  float cx[37], cy[37], cz[37], radii[37], ex[37], ey[37], ez[37];
+  v3_soa centers = vm_v3_soa(cx, cy, cz, 37);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 37);
+  unsigned char spheres_expected[5];
+  unsigned char aabbs_expected[5];
+  unsigned char visible[5];
+
+  int best = vm_dispatch_init();
+  int level;
+  int i;
+
+  /* Same scene as vm_test_frustum_simd, 37 objects are 2 groups of 16 plus a 5 element tail */
+  for (i = 0; i < 37; ++i)
+  {
+    cx[i] = (float)((i * 37) % 61) * 1.37f - 40.0f;
+    cy[i] = (float)((i * 13) % 23) * 0.91f - 10.0f;
+    cz[i] = (float)((i * 7) % 41) * 2.73f - 90.0f;
+    radii[i] = 0.5f + (float)(i % 5);
+    ex[i] = 0.5f + (float)(i % 3);
+    ey[i] = 1.0f + (float)(i % 4);
+    ez[i] = 0.25f + (float)(i % 7);
+  }
+
+  vm_frustum_cull_spheres_scalar(&planes, &centers, radii, spheres_expected);
+  vm_frustum_cull_aabbs_scalar(&planes, &centers, &extents, aabbs_expected);
+
+  /* The scalar kernels agree with the compile time culling functions */
+  vm_frustum_cull_spheres_mask(&planes, &centers, radii, visible);
+  for (i = 0; i < 5; ++i)
+  {
+    assert(visible[i] == spheres_expected[i]);
+  }
+  vm_frustum_cull_aabbs_mask(&planes, &centers, &extents, visible);
+  for (i = 0; i < 5; ++i)
+  {
+    assert(visible[i] == aabbs_expected[i]);
+  }
+
+  assert(best >= VM_DISPATCH_SCALAR && best <= VM_DISPATCH_AVX512);
+  assert(vm_dispatch.level == best);
+  assert(vm_dispatch_set(VM_DISPATCH_AVX512 + 1) == 0);
+  assert(vm_dispatch.level == best);
+
+  /* Every supported level has to match the scalar results (16/8/4 wide groups plus a 3 element tail) */
+  for (level = VM_DISPATCH_SCALAR; level <= best; ++level)
+  {
+    assert(vm_dispatch_set(level));
+    assert(vm_dispatch.level == level);
+
+    for (i = 0; i < 35; ++i)
+    {
+      vm_v3_soa_set(&p, i, vm_v3((float)i * 0.5f, 2.0f - (float)i, (i % 3 == 0) ? 0.0f : 1.5f));
+      vm_v3_soa_set(&v, i, vm_v3(1.0f, (float)(i % 4), -0.25f * (float)i));
+    }
+    vm_v3_soa_set(&p, 9, vm_v3_zero);
+
+    vm_dispatch.v3_soa_normalize(&r, &p);
+    for (i = 0; i < 35; ++i)
+    {
+      v3 difference = vm_v3_sub(vm_v3_soa_get(&r, i), vm_v3_normalize(vm_v3_soa_get(&p, i)));
+
+      /* The scalar vm_invsqrt fallback is less precise than the SIMD reciprocal square root */
+      assert(vm_v3_dot(difference, difference) < 0.00001f);
+    }
+    assert(rx[9] == 0.0f && ry[9] == 0.0f && rz[9] == 0.0f);
+
+    for (i = 0; i < 35; ++i)
+    {
+      points[i] = vm_v3_soa_get(&p, i);
+    }
+    vm_dispatch.m4x4_transform_points(&m, points, transformed, 35);
+    for (i = 0; i < 35; ++i)
+    {
+      v3 expected = vm_m4x4_transform_point(&m, points[i]);
+      assert(vm_fequal(transformed[i].x, expected.x) && vm_fequal(transformed[i].y, expected.y) && vm_fequal(transformed[i].z, expected.z));
+    }
+
+    vm_dispatch.v3_soa_integrate(&p, &v, 0.5f);
+    for (i = 0; i < 35; ++i)
+    {
+      assert(vm_fequal(px[i], ((i == 9) ? 0.0f : (float)i * 0.5f) + 0.5f));
+      assert(vm_fequal(pz[i], ((i % 3 == 0) ? 0.0f : 1.5f) - 0.125f * (float)i));
+    }
+
+    vm_dispatch.frustum_cull_spheres(&planes, &centers, radii, visible);
+    for (i = 0; i < 5; ++i)
+    {
+      assert(visible[i] == spheres_expected[i]);
+    }
+
+    vm_dispatch.frustum_cull_aabbs(&planes, &centers, &extents, visible);
+    for (i = 0; i < 5; ++i)
+    {
+      assert(visible[i] == aabbs_expected[i]);
+    }
+  }
+
+  vm_dispatch_init();
+}
+
+/* Spheres and boxes that touch a plane. The radii are the negated plane
+   distances as computed by the scalar kernel, so the result depends on the
+   last bit of every distance and all levels have to compute them the same way. */
+void vm_test_dispatch_cull_boundary(void)
+{
+  static float cx[1003], cy[1003], cz[1003], radii[1003], ex[1003], ey[1003], ez[1003];
+  static unsigned char spheres_expected[126];
+  static unsigned char aabbs_expected[126];
+  static unsigned char visible[126];
+
+  m4x4 projection = vm_m4x4_perspective(vm_radf(75.0f), 16.0f / 9.0f, 0.3f, 250.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(3.0f, 4.0f, 17.0f), vm_v3(0.5f, 0.25f, 0.0f), vm_v3(0.0f, 1.0f, 0.0f));
+  frustum_simd planes = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  v3_soa centers = vm_v3_soa(cx, cy, cz, 1003);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 1003);
+  int touching = 0;
+  int level;
+  int i;
+  int j;
+
+  for (i = 0; i < 1003; ++i)
+  {
+    float min_distance = 0.0f;
+    int closest = 0;
+
+    cx[i] = (float)((i * 37) % 211) * 1.37f - 140.0f;
+    cy[i] = (float)((i * 13) % 97) * 1.91f - 90.0f;
+    cz[i] = (float)((i * 7) % 241) * 1.13f - 260.0f;
+
+    /* Same operation order as vm_frustum_cull_spheres_scalar */
+    for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+    {
+      float distance = planes.x[j] * cx[i] + planes.w[j];
+      distance = planes.y[j] * cy[i] + distance;
+      distance = planes.z[j] * cz[i] + distance;
+
+      if (j == 0 || distance < min_distance)
+      {
+        min_distance = distance;
+        closest = j;
+      }
+    }
+
+    if (min_distance < 0.0f)
+    {
+      /* The sphere touches its closest plane, the box is scaled until its p-vertex (nearly) does */
+      float scale;
+
+      ex[i] = 0.5f + (float)(i % 3) * 0.37f;
+      ey[i] = 1.0f + (float)(i % 4) * 0.29f;
+      ez[i] = 0.25f + (float)(i % 7) * 0.41f;
+      scale = -min_distance / (planes.abs_x[closest] * ex[i] + planes.abs_y[closest] * ey[i] + planes.abs_z[closest] * ez[i]);
+
+      radii[i] = -min_distance;
+      ex[i] *= scale;
+      ey[i] *= scale;
+      ez[i] *= scale;
+      touching++;
+    }
+    else
+    {
+      radii[i] = 0.5f;
+      ex[i] = ey[i] = ez[i] = 0.5f;
+    }
+  }
+
+  assert(touching > 300);
+
+  vm_frustum_cull_spheres_scalar(&planes, &centers, radii, spheres_expected);
+  vm_frustum_cull_aabbs_scalar(&planes, &centers, &extents, aabbs_expected);
+
+  for (level = VM_DISPATCH_SCALAR; level <= vm_dispatch_best_level(); ++level)
+  {
+    assert(vm_dispatch_set(level));
+
+    vm_dispatch.frustum_cull_spheres(&planes, &centers, radii, visible);
+    for (i = 0; i < 126; ++i)
+    {
+      assert(visible[i] == spheres_expected[i]);
+    }
+
+    vm_dispatch.frustum_cull_aabbs(&planes, &centers, &extents, visible);
+    for (i = 0; i < 126; ++i)
+    {
+      assert(visible[i] == aabbs_expected[i]);
+    }
+  }
+
+  vm_dispatch_init();
+}
+#endif
+
 void vm_test_m4x4(void)
 {
   m4x4 a = vm_m4x4_identity;
@@ -609,9 +1069,419 @@ void vm_test_m4x4_inverse(void)
   }
 }
 
+void vm_test_m4x4_inverse_general(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(3.0f, 4.0f, 10.0f), vm_v3(0.5f, -1.0f, 0.0f), vm_v3(0.0f, 1.0f, 0.0f));
+  m4x4 model = vm_m4x4_translate(vm_m4x4_scale(vm_m4x4_rotate(vm_m4x4_identity, vm_radf(33.0f), vm_v3(1.0f, 2.0f, 3.0f)), vm_v3(2.0f, 0.5f, 3.0f)), vm_v3(-4.0f, 7.0f, 1.5f));
+  m4x4 singular = vm_m4x4_scale(vm_m4x4_identity, vm_v3(1.0f, 0.0f, 1.0f));
+  m4x4 transposed;
+  m4x4 in[5];
+  m4x4 out[5];
+  int i;
+  int k;
+
+  in[0] = vm_m4x4_mul(projection, view);
+  in[1] = model;
+  in[2] = vm_m4x4_zero;
+  in[3] = vm_m4x4_mul(in[0], model);
+  in[4] = view;
+
+  /* Singular matrices return vm_m4x4_zero */
+  assert(vm_m4x4_equals(vm_m4x4_inverse(vm_m4x4_zero), vm_m4x4_zero));
+  assert(vm_m4x4_equals(vm_m4x4_inverse(singular), vm_m4x4_zero));
+
+  vm_m4x4_inverse_array(in, out, 5);
+
+  for (k = 0; k < 5; ++k)
+  {
+    m4x4 identity = vm_m4x4_mul(in[k], out[k]);
+
+    assert(vm_m4x4_equals(out[k], vm_m4x4_inverse(in[k])));
+
+    for (i = 0; i < 16; ++i)
+    {
+      float expected = (k == 2) ? 0.0f : ((i % 5 == 0) ? 1.0f : 0.0f);
+      assert(vm_absf(identity.e[i] - expected) < 0.001f);
+    }
+  }
+
+  /* Transpose */
+  transposed = vm_m4x4_swap(model);
+  for (i = 0; i < 4; ++i)
+  {
+    for (k = 0; k < 4; ++k)
+    {
+      assert(transposed.e[VM_M4X4_AT(i, k)] == model.e[VM_M4X4_AT(k, i)]);
+    }
+  }
+  assert(vm_m4x4_equals(vm_m4x4_swap(transposed), model));
+}
+
+void vm_test_m4x4_inverse_affine_rigid(void)
+{
+  transformation t = vm_transformation_init();
+  m4x4 view = vm_m4x4_lookAt(vm_v3(3.0f, 4.0f, 10.0f), vm_v3(0.5f, -1.0f, 0.0f), vm_v3(0.0f, 1.0f, 0.0f));
+  m4x4 rotation = vm_quat_to_rotation_matrix(vm_quat_rotate(vm_v3(0.0f, 0.6f, 0.8f), 0.7f));
+  m4x4 rigid = vm_m4x4_translate(rotation, vm_v3(1.0f, -2.0f, 5.0f));
+  m4x4 affine;
+  m4x4 projection = vm_m4x4_perspective(vm_radf(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+  m4x4 expected;
+  m4x4 actual;
+  int i;
+
+  vm_tranformation_rotate(&t, vm_v3(0.0f, 1.0f, 1.0f), 1.2f);
+  t.position = vm_v3(-3.0f, 2.0f, 8.0f);
+  t.scale = vm_v3(2.0f, 0.5f, 4.0f);
+  affine = vm_transformation_matrix(&t);
+
+  assert(vm_m4x4_is_affine(&affine, 1e-4f));
+  assert(!vm_m4x4_is_rigid(&affine, 1e-4f));
+  assert(vm_m4x4_is_rigid(&rigid, 1e-4f));
+  assert(vm_m4x4_is_rigid(&rotation, 1e-4f));
+  assert(vm_m4x4_is_rigid(&view, 1e-2f)); /* the scalar vm_v3_normalize is an approximation */
+  assert(!vm_m4x4_is_affine(&projection, 1e-4f));
+
+  expected = vm_m4x4_inverse(affine);
+  actual = vm_m4x4_inverse_affine(affine);
+  for (i = 0; i < 16; ++i)
+  {
+    assert(vm_absf(actual.e[i] - expected.e[i]) < 0.0001f);
+  }
+
+  /* vm_sinf/vm_cosf are approximations, so the rotation is only orthonormal up to ~1e-4 */
+  expected = vm_m4x4_inverse(rigid);
+  actual = vm_m4x4_inverse_rigid(rigid);
+  for (i = 0; i < 16; ++i)
+  {
+    assert(vm_absf(actual.e[i] - expected.e[i]) < 0.001f);
+  }
+
+  actual = vm_m4x4_inverse_rigid(rotation);
+  assert(vm_m4x4_equals(actual, vm_m4x4_swap(rotation)));
+
+  actual = vm_m4x4_inverse_affine(rigid);
+  for (i = 0; i < 16; ++i)
+  {
+    assert(vm_absf(actual.e[i] - expected.e[i]) < 0.001f);
+  }
+
+  /* Singular upper 3x3 */
+  assert(vm_m4x4_equals(vm_m4x4_inverse_affine(vm_m4x4_scale(vm_m4x4_identity, vm_v3(1.0f, 0.0f, 1.0f))), vm_m4x4_zero));
+}
+
+void vm_test_m4x4_mul_array(void)
+{
+  VM_ALIGN_16 m4x4 out[15];
+  m4x4 a[15];
+  m4x4 b[15];
+  m4x4 shared = vm_m4x4_lookAt(vm_v3(3.0f, 4.0f, 10.0f), vm_v3(0.5f, -1.0f, 0.0f), vm_v3(0.0f, 1.0f, 0.0f));
+  int i;
+
+  for (i = 0; i < 15; ++i)
+  {
+    a[i] = vm_m4x4_translate(vm_m4x4_rotate(vm_m4x4_identity, (float)i * 0.3f, vm_v3(0.0f, 1.0f, 0.0f)), vm_v3((float)i, 2.0f, -1.0f));
+    b[i] = vm_m4x4_scale(vm_m4x4_rotate(vm_m4x4_identity, (float)i * -0.2f, vm_v3(1.0f, 0.0f, 0.0f)), vm_v3(1.0f, 2.0f, (float)i + 1.0f));
+    b[i].e[VM_M4X4_AT(3, 0)] = 0.25f * (float)i; /* not affine, so every element of the product matters */
+  }
+
+#ifdef VM_USE_SSE
+  assert(vm_m4x4_stream_enabled(out, 15));
+  assert(!vm_m4x4_stream_enabled(out, 7));
+#endif
+
+  /* The batch functions use the same kernel as vm_m4x4_mul */
+  vm_m4x4_mul_array(a, b, out, 15);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_m4x4_equals(out[i], vm_m4x4_mul(a[i], b[i])));
+  }
+
+  vm_m4x4_mul_array_shared(&shared, b, out, 15);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_m4x4_equals(out[i], vm_m4x4_mul(shared, b[i])));
+  }
+
+  /* Below the stream threshold */
+  vm_m4x4_mul_array_shared(&shared, a, out, 3);
+  for (i = 0; i < 3; ++i)
+  {
+    assert(vm_m4x4_equals(out[i], vm_m4x4_mul(shared, a[i])));
+  }
+}
+
+void vm_test_m3x4(void)
+{
+  transformation ta = vm_transformation_init();
+  transformation tb = vm_transformation_init();
+  m4x4 ma;
+  m4x4 mb;
+  m4x4 expected;
+  m4x4 actual;
+  m3x4 a;
+  m3x4 b;
+  v3 points[15];
+  v3 out[15];
+  v3 p = vm_v3(1.0f, -2.0f, 3.0f);
+  v3 q;
+  v3 r;
+  int i;
+
+  assert(sizeof(m3x4) == 48);
+
+  vm_tranformation_rotate(&ta, vm_v3(0.0f, 0.6f, 0.8f), 0.9f);
+  ta.position = vm_v3(4.0f, -1.0f, 2.5f);
+  ta.scale = vm_v3(2.0f, 1.0f, 0.5f);
+  vm_tranformation_rotate(&tb, vm_v3(1.0f, 0.0f, 0.0f), -0.4f);
+  tb.position = vm_v3(-3.0f, 7.0f, 1.0f);
+
+  ma = vm_transformation_matrix(&ta);
+  mb = vm_transformation_matrix(&tb);
+  a = vm_m3x4_from_m4x4(ma);
+  b = vm_m3x4_from_m4x4(mb);
+
+  /* Rows are stored as (linear part | translation) for both m4x4 storage orders */
+  assert(a.e[VM_M3X4_AT(0, 3)] == 4.0f);
+  assert(a.e[VM_M3X4_AT(1, 3)] == -1.0f);
+  assert(a.e[VM_M3X4_AT(2, 3)] == 2.5f);
+  assert(vm_m4x4_equals(vm_m4x4_from_m3x4(a), ma));
+  assert(vm_m4x4_equals(vm_m4x4_from_m3x4(vm_m3x4_identity), vm_m4x4_identity));
+
+  expected = vm_m4x4_mul(ma, mb);
+  actual = vm_m4x4_from_m3x4(vm_m3x4_mul(a, b));
+  for (i = 0; i < 16; ++i)
+  {
+    assert(vm_absf(actual.e[i] - expected.e[i]) < 0.0001f);
+  }
+
+  expected = vm_m4x4_inverse_affine(ma);
+  actual = vm_m4x4_from_m3x4(vm_m3x4_inverse(a));
+  for (i = 0; i < 16; ++i)
+  {
+    assert(vm_absf(actual.e[i] - expected.e[i]) < 0.0001f);
+  }
+
+  q = vm_m3x4_transform_point(&a, p);
+  r = vm_m4x4_transform_point(&ma, p);
+  assert(vm_fequal(q.x, r.x) && vm_fequal(q.y, r.y) && vm_fequal(q.z, r.z));
+
+  q = vm_m3x4_transform_vector(&a, p);
+  r = vm_m4x4_transform_vector(&ma, p);
+  assert(vm_fequal(q.x, r.x) && vm_fequal(q.y, r.y) && vm_fequal(q.z, r.z));
+
+  /* Round trip through the inverse */
+  q = vm_m3x4_transform_point(&a, p);
+  b = vm_m3x4_inverse(a);
+  q = vm_m3x4_transform_point(&b, q);
+  assert(vm_fequal(q.x, p.x) && vm_fequal(q.y, p.y) && vm_fequal(q.z, p.z));
+
+  for (i = 0; i < 15; ++i)
+  {
+    points[i] = vm_v3((float)i, (float)(i * 2) - 7.0f, 0.5f * (float)i);
+  }
+
+  vm_m3x4_transform_points(&a, points, out, 15);
+  for (i = 0; i < 15; ++i)
+  {
+    r = vm_m4x4_transform_point(&ma, points[i]);
+    assert(vm_fequal(out[i].x, r.x) && vm_fequal(out[i].y, r.y) && vm_fequal(out[i].z, r.z));
+  }
+
+  vm_m3x4_transform_vectors(&a, points, out, 15);
+  for (i = 0; i < 15; ++i)
+  {
+    r = vm_m4x4_transform_vector(&ma, points[i]);
+    assert(vm_fequal(out[i].x, r.x) && vm_fequal(out[i].y, r.y) && vm_fequal(out[i].z, r.z));
+  }
+
+  /* Singular linear part */
+  a = vm_m3x4_from_m4x4(vm_m4x4_scale(vm_m4x4_identity, vm_v3(0.0f, 1.0f, 1.0f)));
+  b = vm_m3x4_inverse(a);
+  for (i = 0; i < 12; ++i)
+  {
+    assert(b.e[i] == 0.0f);
+  }
+}
+
+void vm_test_pointer_api(void)
+{
+  m4x4 a = vm_m4x4_translate(vm_m4x4_rotate(vm_m4x4_identity, vm_radf(30.0f), vm_v3(0.0f, 1.0f, 0.0f)), vm_v3(1.0f, -2.0f, 5.0f));
+  m4x4 b = vm_m4x4_perspective(vm_radf(90.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+  m4x4 out;
+  frustum f;
+  frustum reference;
+  transformation parent = vm_transformation_init();
+  transformation child = vm_transformation_init();
+  int i;
+
+  /* The _p variants must produce the exact same results as their by-value counterparts */
+  vm_m4x4_mul_p(&out, &a, &b);
+  assert(vm_m4x4_equals(out, vm_m4x4_mul(a, b)));
+
+  vm_m4x4_inverse_p(&out, &a);
+  assert(vm_m4x4_equals(out, vm_m4x4_inverse(a)));
+
+  vm_m4x4_inverse_p(&out, &vm_m4x4_zero);
+  assert(vm_m4x4_equals(out, vm_m4x4_zero));
+
+  vm_frustum_extract_planes_p(&f, &b);
+  reference = vm_frustum_extract_planes(b);
+  for (i = 0; i < 6; ++i)
+  {
+    assert(vm_v4_equals(vm_frustum_data(&f)[i], vm_frustum_data(&reference)[i]));
+  }
+  assert(vm_frustum_is_point_in_p(&f, vm_v3(0.0f, 0.0f, -5.0f)) == vm_frustum_is_point_in(f, vm_v3(0.0f, 0.0f, -5.0f)));
+  assert(vm_frustum_is_point_in_p(&f, vm_v3(0.0f, 0.0f, 5.0f)) == vm_frustum_is_point_in(f, vm_v3(0.0f, 0.0f, 5.0f)));
+  assert(vm_frustum_is_cube_in_p(&f, vm_v3(0.0f, 0.0f, -5.0f), vm_v3_one, 0.15f));
+  assert(!vm_frustum_is_cube_in_p(&f, vm_v3(0.0f, 0.0f, 5.0f), vm_v3_one, 0.15f));
+  assert(vm_frustum_is_sphere_in_p(&f, vm_v3(0.0f, 0.0f, -5.0f), 1.0f));
+  assert(!vm_frustum_is_sphere_in_p(&f, vm_v3(0.0f, 0.0f, 5.0f), 1.0f));
+
+  vm_tranformation_rotate(&parent, vm_v3(0.0f, 1.0f, 0.0f), 0.5f);
+  parent.position = vm_v3(0.0f, 2.0f, 0.0f);
+  child.position = vm_v3(1.0f, 0.0f, 0.0f);
+  child.scale = vm_v3(2.0f, 2.0f, 2.0f);
+  child.parent = &parent;
+
+  vm_transformation_matrix_p(&out, &child);
+  assert(vm_m4x4_equals(out, vm_transformation_matrix(&child)));
+  assert(vm_fequal(out.e[VM_M4X4_AT(1, 3)], 2.0f));
+}
+
+void vm_test_m4x4_transform(void)
+{
+  m4x4 scale = vm_m4x4_scale(vm_m4x4_identity, vm_v3(2.0f, 3.0f, 4.0f));
+  m4x4 m = vm_m4x4_translate(vm_m4x4_mul(vm_m4x4_rotate(vm_m4x4_identity, vm_radf(30.0f), vm_v3(0.0f, 1.0f, 0.0f)), scale), vm_v3(1.0f, -2.0f, 5.0f));
+
+  v3 points[15];
+  v3 vectors[15];
+  v3 normals[15];
+  v3 tangents[15];
+  float sx[15], sy[15], sz[15];
+  float rx[15], ry[15], rz[15];
+
+  v3_soa in = vm_v3_soa(sx, sy, sz, 15);
+  v3_soa out = vm_v3_soa(rx, ry, rz, 15);
+
+  int i;
+  int row;
+
+  for (i = 0; i < 15; ++i)
+  {
+    points[i] = vm_v3((float)i - 7.0f, 0.5f * (float)i, (i % 2 == 0) ? 1.0f : -3.0f);
+    tangents[i] = vm_v3(1.0f, -1.0f, 0.25f * (float)i);
+    normals[i] = vm_v3(1.0f, 1.0f, 0.0f);
+    vm_v3_soa_set(&in, i, points[i]);
+  }
+
+  /* Points: reference is the plain row * (x, y, z, 1) sum (8 + 4 wide groups and a 3 element tail) */
+  vm_m4x4_transform_points(&m, points, vectors, 15);
+  vm_m4x4_transform_points_soa(&m, &in, &out);
+  for (i = 0; i < 15; ++i)
+  {
+    float *r = vm_v3_data(&vectors[i]);
+
+    for (row = 0; row < 3; ++row)
+    {
+      float expected = m.e[VM_M4X4_AT(row, 0)] * points[i].x + m.e[VM_M4X4_AT(row, 1)] * points[i].y + m.e[VM_M4X4_AT(row, 2)] * points[i].z + m.e[VM_M4X4_AT(row, 3)];
+      assert(vm_fequal(r[row], expected));
+    }
+    assert(vm_v3_equals(vm_v3_soa_get(&out, i), vectors[i]));
+  }
+  assert(vm_v3_equals(vm_m4x4_transform_point(&m, vm_v3_zero), vm_v3(1.0f, -2.0f, 5.0f)));
+
+  /* Vectors ignore the translation */
+  vm_m4x4_transform_vectors(&m, points, vectors, 15);
+  vm_m4x4_transform_vectors_soa(&m, &in, &out);
+  for (i = 0; i < 15; ++i)
+  {
+    v3 expected = vm_v3_sub(vm_m4x4_transform_point(&m, points[i]), vm_m4x4_transform_point(&m, vm_v3_zero));
+    assert(vm_fequal(vectors[i].x, expected.x) && vm_fequal(vectors[i].y, expected.y) && vm_fequal(vectors[i].z, expected.z));
+    assert(vm_v3_equals(vm_v3_soa_get(&out, i), vectors[i]));
+  }
+
+  /* Normals stay perpendicular to the transformed tangents under non uniform scale */
+  vm_m4x4_transform_vectors(&m, tangents, tangents, 15);
+  vm_m4x4_transform_normals(&m, normals, normals, 15);
+  for (i = 0; i < 15; ++i)
+  {
+    assert(vm_absf(vm_v3_dot(normals[i], tangents[i])) < 0.0001f);
+    assert(vm_absf(vm_v3_dot(vm_m4x4_transform_normal(&m, vm_v3(1.0f, 1.0f, 0.0f)), tangents[i])) < 0.0001f);
+  }
+
+  vm_m4x4_transform_normals_soa(&m, &in, &out);
+  assert(vm_v3_equals(vm_v3_soa_get(&out, 14), vm_m4x4_transform_normal(&m, points[14])));
+
+  /* Singular matrices have no normal matrix */
+  assert(vm_m4x4_equals(vm_m4x4_normal_matrix(&vm_m4x4_zero), vm_m4x4_zero));
+}
+
+void vm_test_m4x4_project(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 1.0f, 1.0f, 10.0f);
+  v4 viewport = vm_v4(10.0f, 20.0f, 800.0f, 600.0f);
+
+  v3 points[15];
+  v3 ndc[15];
+  v3 screen[15];
+  unsigned char flags[15];
+  unsigned int point_flags;
+
+  v3 p;
+  int i;
+
+  points[0] = vm_v3(0.0f, 0.0f, -5.0f);  /* center */
+  points[1] = vm_v3(10.0f, 0.0f, -5.0f); /* right */
+  points[2] = vm_v3(-10.0f, 0.0f, -5.0f);
+  points[3] = vm_v3(0.0f, 10.0f, -5.0f);
+  points[4] = vm_v3(0.0f, -10.0f, -5.0f);
+  points[5] = vm_v3(0.0f, 0.0f, -0.5f); /* in front of the near plane */
+  points[6] = vm_v3(0.0f, 0.0f, -20.0f);
+  points[7] = vm_v3(-20.0f, 20.0f, -5.0f);
+  for (i = 8; i < 15; ++i)
+  {
+    points[i] = vm_v3((float)i - 11.0f, 0.5f * (float)i - 4.0f, -1.5f * (float)i);
+  }
+
+  p = vm_m4x4_project_point(&projection, points[0], &point_flags);
+  assert(point_flags == 0);
+  assert(p.x == 0.0f && p.y == 0.0f && vm_fequal(p.z, 7.0f / 9.0f));
+
+  p = vm_m4x4_project_point_viewport(&projection, points[0], viewport, &point_flags);
+  assert(vm_fequal(p.x, 410.0f) && vm_fequal(p.y, 320.0f) && vm_fequal(p.z, 8.0f / 9.0f));
+
+  vm_m4x4_project_points(&projection, points, ndc, flags, 15);
+  assert(flags[0] == 0);
+  assert(flags[1] == VM_CLIP_RIGHT);
+  assert(flags[2] == VM_CLIP_LEFT);
+  assert(flags[3] == VM_CLIP_TOP);
+  assert(flags[4] == VM_CLIP_BOTTOM);
+  assert(flags[5] == VM_CLIP_NEAR);
+  assert(flags[6] == VM_CLIP_FAR);
+  assert(flags[7] == (VM_CLIP_LEFT | VM_CLIP_TOP));
+
+  /* Batch (8/4 wide and scalar tail) matches the single point functions */
+  vm_m4x4_project_points_viewport(&projection, points, screen, (unsigned char *)0, 15, viewport);
+  for (i = 0; i < 15; ++i)
+  {
+    v3 expected = vm_m4x4_project_point(&projection, points[i], &point_flags);
+    assert(flags[i] == point_flags);
+    assert(vm_fequal(ndc[i].x, expected.x) && vm_fequal(ndc[i].y, expected.y) && vm_fequal(ndc[i].z, expected.z));
+
+    expected = vm_m4x4_project_point_viewport(&projection, points[i], viewport, &point_flags);
+    assert(vm_fequal(screen[i].x, expected.x) && vm_fequal(screen[i].y, expected.y) && vm_fequal(screen[i].z, expected.z));
+  }
+
+  /* A point on the top plane is inside and lands on the top edge of the viewport */
+  p = vm_m4x4_project_point_viewport(&projection, vm_v3(0.0f, 5.0f, -5.0f), viewport, &point_flags);
+  assert(point_flags == 0);
+  assert(vm_fequal(p.y, 20.0f));
+}
+
 void vm_test_quat(void)
 {
-  quat a = {1.0f, 1.0f, 1.0f, 1.0f};
+  quat a = vm_quat(1.0f, 1.0f, 1.0f, 1.0f);
   quat b = vm_quatf(3.0f);
 
   assert(a.x == 1.0f);
@@ -667,6 +1537,966 @@ void vm_test_frustum(void)
   assert(vm_frustum_is_sphere_in(frustum_planes, sphere2_position, 100.0f));
 }
 
+void vm_test_frustum_simd(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum planes = vm_frustum_extract_planes(vm_m4x4_mul(projection, view));
+  frustum_simd simd = vm_frustum_simd(planes);
+
+  float x[37], y[37], z[37], radii[37], ex[37], ey[37], ez[37];
+  v3_soa centers = vm_v3_soa(x, y, z, 37);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 37);
+  unsigned char spheres_visible[5];
+  unsigned char aabbs_visible[5];
+  int inside[37];
+  int intersecting[37];
+  frustum_cull_list list = vm_frustum_cull_list(inside, intersecting);
+  int spheres_inside = 0;
+  int aabbs_inside = 0;
+  int pass;
+  int i;
+
+  /* Objects scattered around and behind the camera, 37 is not a multiple of 8 */
+  for (i = 0; i < 37; ++i)
+  {
+    x[i] = (float)((i * 37) % 61) * 1.37f - 40.0f;
+    y[i] = (float)((i * 13) % 23) * 0.91f - 10.0f;
+    z[i] = (float)((i * 7) % 41) * 2.73f - 90.0f;
+    radii[i] = 0.5f + (float)(i % 5);
+    ex[i] = 0.5f + (float)(i % 3);
+    ey[i] = 1.0f + (float)(i % 4);
+    ez[i] = 0.25f + (float)(i % 7);
+  }
+
+  vm_frustum_cull_spheres_mask(&simd, &centers, radii, spheres_visible);
+  vm_frustum_cull_aabbs_mask(&simd, &centers, &extents, aabbs_visible);
+
+  for (i = 0; i < 37; ++i)
+  {
+    v3 center = vm_v3(x[i], y[i], z[i]);
+    v3 dimensions = vm_v3(2.0f * ex[i], 2.0f * ey[i], 2.0f * ez[i]);
+    int sphere_in = (spheres_visible[i >> 3] >> (i & 7)) & 1;
+    int aabb_in = (aabbs_visible[i >> 3] >> (i & 7)) & 1;
+
+    assert(sphere_in == vm_frustum_is_sphere_in_p(&planes, center, radii[i]));
+    assert(aabb_in == vm_frustum_is_cube_in_p(&planes, center, dimensions, 0.0f));
+
+    spheres_inside += sphere_in;
+    aabbs_inside += aabb_in;
+  }
+
+  /* Both visible and culled objects were tested and the tail bits are cleared */
+  assert(spheres_inside > 0 && spheres_inside < 37);
+  assert(aabbs_inside > 0 && aabbs_inside < 37);
+  assert((spheres_visible[4] >> 5) == 0);
+  assert((aabbs_visible[4] >> 5) == 0);
+
+  /* Compacted lists hold the same objects in ascending order, split by inside/intersecting */
+  for (pass = 0; pass < 2; ++pass)
+  {
+    int visible_count = pass == 0 ? vm_frustum_cull_spheres(&simd, &centers, radii, &list) : vm_frustum_cull_aabbs(&simd, &centers, &extents, &list);
+    unsigned char *visible = pass == 0 ? spheres_visible : aabbs_visible;
+    int inside_at = 0;
+    int intersecting_at = 0;
+
+    assert(visible_count == (pass == 0 ? spheres_inside : aabbs_inside));
+    assert(list.inside_count > 0 && list.intersecting_count > 0);
+
+    for (i = 0; i < 37; ++i)
+    {
+      v3 center = vm_v3(x[i], y[i], z[i]);
+
+      if (!((visible[i >> 3] >> (i & 7)) & 1))
+      {
+        continue;
+      }
+
+      if (inside_at < list.inside_count && list.inside[inside_at] == i)
+      {
+        inside_at++;
+
+        if (pass == 0)
+        {
+          assert(vm_frustum_is_sphere_in_p(&planes, center, -radii[i]));
+        }
+        else
+        {
+          int corner;
+          for (corner = 0; corner < 8; ++corner)
+          {
+            v3 p = vm_v3(x[i] + ((corner & 1) ? ex[i] : -ex[i]), y[i] + ((corner & 2) ? ey[i] : -ey[i]), z[i] + ((corner & 4) ? ez[i] : -ez[i]));
+            assert(vm_frustum_is_point_in_p(&planes, p));
+          }
+        }
+      }
+      else
+      {
+        assert(intersecting_at < list.intersecting_count && list.intersecting[intersecting_at] == i);
+        intersecting_at++;
+      }
+    }
+
+    assert(inside_at == list.inside_count && intersecting_at == list.intersecting_count);
+  }
+
+  /* The 4 wide kernels */
+  assert(vm_frustum_simd_spheres_in_f32x4(&simd, vm_f32x4_load(x), vm_f32x4_load(y), vm_f32x4_load(z), vm_f32x4_load(radii)) == (spheres_visible[0] & 15));
+  assert(vm_frustum_simd_aabbs_in_f32x4(&simd, vm_f32x4_load(x), vm_f32x4_load(y), vm_f32x4_load(z), vm_f32x4_load(ex), vm_f32x4_load(ey), vm_f32x4_load(ez)) == (aabbs_visible[0] & 15));
+}
+
+void vm_test_frustum_plane_mask(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 1.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum planes = vm_frustum_extract_planes(vm_m4x4_mul(projection, view));
+  frustum_simd simd = vm_frustum_simd(planes);
+  unsigned char last_plane = 0;
+  int parent_mask;
+  int i;
+
+  /* Fully inside, outside to the right (plane 1), crossing the left plane (0) */
+  assert(vm_frustum_aabb_plane_mask(&simd, vm_v3_zero, vm_v3_one, VM_FRUSTUM_PLANES_ALL, 0) == 0);
+  assert(vm_frustum_aabb_plane_mask(&simd, vm_v3(100.0f, 0.0f, 0.0f), vm_v3_one, VM_FRUSTUM_PLANES_ALL, &last_plane) == -1);
+  assert(last_plane == 1);
+  assert(vm_frustum_aabb_plane_mask(&simd, vm_v3(100.0f, 0.0f, 0.0f), vm_v3_one, VM_FRUSTUM_PLANES_ALL, &last_plane) == -1);
+  assert(vm_frustum_aabb_plane_mask(&simd, vm_v3(-13.0f, 0.0f, 0.0f), vm_v3_one, VM_FRUSTUM_PLANES_ALL, &last_plane) == 1);
+  assert(last_plane == 1);
+
+  /* Planes not in the mask are not tested */
+  assert(vm_frustum_aabb_plane_mask(&simd, vm_v3(100.0f, 0.0f, 0.0f), vm_v3_one, VM_FRUSTUM_PLANES_ALL & ~2, 0) == 0);
+
+  assert(vm_frustum_sphere_plane_mask(&simd, vm_v3_zero, 1.0f, VM_FRUSTUM_PLANES_ALL, 0) == 0);
+  assert(vm_frustum_sphere_plane_mask(&simd, vm_v3(0.0f, 100.0f, 0.0f), 1.0f, VM_FRUSTUM_PLANES_ALL, &last_plane) == -1);
+  assert(last_plane == 3);
+  assert(vm_frustum_sphere_plane_mask(&simd, vm_v3(0.0f, 0.0f, -87.0f), 1.0f, VM_FRUSTUM_PLANES_ALL, 0) == 32);
+
+  /* Children of a parent box only test the planes the parent crosses and get the same result */
+  parent_mask = vm_frustum_aabb_plane_mask(&simd, vm_v3(-10.0f, 0.0f, 0.0f), vm_v3(8.0f, 8.0f, 8.0f), VM_FRUSTUM_PLANES_ALL, 0);
+  assert(parent_mask > 0);
+
+  for (i = 0; i < 16; ++i)
+  {
+    v3 center = vm_v3(-17.0f + 0.9f * (float)i, (float)(i % 5) - 2.0f, (float)(i % 7) - 3.0f);
+    v3 extents = vm_v3(0.5f, 0.5f, 0.5f);
+    int full = vm_frustum_aabb_plane_mask(&simd, center, extents, VM_FRUSTUM_PLANES_ALL, 0);
+    int child = vm_frustum_aabb_plane_mask(&simd, center, extents, parent_mask, 0);
+
+    assert(full == child);
+    assert((full >= 0) == vm_frustum_is_cube_in_p(&planes, center, vm_v3(1.0f, 1.0f, 1.0f), 0.0f));
+  }
+}
+
+void vm_test_frustum_obb(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum planes = vm_frustum_extract_planes(vm_m4x4_mul(projection, view));
+  frustum_simd simd = vm_frustum_simd(planes);
+  float x[19], y[19], z[19], ex[19], ey[19], ez[19];
+  float ax[3][19], ay[3][19], az[3][19];
+  v3_soa centers = vm_v3_soa(x, y, z, 19);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 19);
+  v3_soa axes[3];
+  unsigned char visible[3];
+  int visible_count = 0;
+  int i;
+  int j;
+  int k;
+
+  for (j = 0; j < 3; ++j)
+  {
+    axes[j] = vm_v3_soa(ax[j], ay[j], az[j], 19);
+  }
+
+  /* A long thin box parallel to the right plane and just outside of it: its
+     world AABB reaches into the frustum, the box itself does not */
+  {
+    v3 axis_x = vm_v3(0.8f, 0.0f, -0.6f);
+    v3 axis_z = vm_v3(0.6f, 0.0f, 0.8f);
+    v3 half_extents = vm_v3(12.0f, 0.5f, 0.5f);
+
+    assert(vm_frustum_is_cube_in_p(&planes, vm_v3(34.0f, 0.0f, -10.0f), vm_v3(2.0f * 9.9f, 1.0f, 2.0f * 7.6f), 0.0f));
+    assert(!vm_frustum_is_obb_basis_in_p(&planes, vm_v3(34.0f, 0.0f, -10.0f), half_extents, axis_x, vm_v3(0.0f, 1.0f, 0.0f), axis_z));
+    assert(vm_frustum_is_obb_basis_in_p(&planes, vm_v3(20.0f, 0.0f, -10.0f), half_extents, axis_x, vm_v3(0.0f, 1.0f, 0.0f), axis_z));
+    assert(vm_frustum_is_obb_in(planes, vm_v3_zero, half_extents, vm_quat_rotate(vm_v3(0.0f, 1.0f, 0.0f), vm_radf(30.0f))));
+  }
+
+  /* Rotated boxes scattered around the frustum against the 8 transformed corners */
+  for (i = 0; i < 19; ++i)
+  {
+    quat rotation = vm_quat_rotate(vm_v3_normalize(vm_v3(1.0f, (float)(i % 3), (float)(i % 5) - 2.0f)), vm_radf((float)(i * 37)));
+    m4x4 r = vm_quat_to_rotation_matrix(rotation);
+    v3 center = vm_v3((float)((i * 37) % 61) * 1.37f - 40.0f, (float)((i * 13) % 23) * 0.91f - 10.0f, (float)((i * 7) % 41) * 2.73f - 90.0f);
+    v3 half_extents = vm_v3(0.5f + (float)(i % 3), 1.0f + (float)(i % 4), 0.25f + (float)(i % 7));
+    int expected = 1;
+
+    for (k = 0; k < 6; ++k)
+    {
+      v4 plane = vm_frustum_data(&planes)[k];
+      int outside = 1;
+
+      for (j = 0; j < 8; ++j)
+      {
+        v3 local = vm_v3((j & 1) ? half_extents.x : -half_extents.x, (j & 2) ? half_extents.y : -half_extents.y, (j & 4) ? half_extents.z : -half_extents.z);
+        v3 corner = vm_v3_add(center, vm_m4x4_transform_vector(&r, local));
+
+        outside &= plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f;
+      }
+
+      expected &= !outside;
+    }
+
+    assert(vm_frustum_is_obb_in_p(&planes, center, half_extents, rotation) == expected);
+    visible_count += expected;
+
+    x[i] = center.x;
+    y[i] = center.y;
+    z[i] = center.z;
+    ex[i] = half_extents.x;
+    ey[i] = half_extents.y;
+    ez[i] = half_extents.z;
+
+    for (j = 0; j < 3; ++j)
+    {
+      ax[j][i] = r.e[VM_M4X4_AT(0, j)];
+      ay[j][i] = r.e[VM_M4X4_AT(1, j)];
+      az[j][i] = r.e[VM_M4X4_AT(2, j)];
+    }
+  }
+
+  assert(visible_count > 0 && visible_count < 19);
+
+  /* The batch form gives the same result, tail bits are cleared */
+  vm_frustum_cull_obbs_mask(&simd, &centers, &extents, axes, visible);
+
+  for (i = 0; i < 19; ++i)
+  {
+    int expected = vm_frustum_is_obb_basis_in_p(&planes, vm_v3(x[i], y[i], z[i]), vm_v3(ex[i], ey[i], ez[i]), vm_v3(ax[0][i], ay[0][i], az[0][i]), vm_v3(ax[1][i], ay[1][i], az[1][i]), vm_v3(ax[2][i], ay[2][i], az[2][i]));
+    assert(((visible[i >> 3] >> (i & 7)) & 1) == expected);
+  }
+
+  assert((visible[2] >> 3) == 0);
+}
+
+void vm_test_frustum_multi(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  v3 eyes[3];
+  frustum_simd frusta[3];
+  unsigned char visible[3][3];
+  unsigned int spheres_visible[21];
+  unsigned int aabbs_visible[21];
+  float x[21], y[21], z[21], radii[21], ex[21], ey[21], ez[21];
+  v3_soa centers = vm_v3_soa(x, y, z, 21);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 21);
+  int seen_by_some = 0;
+  int pass;
+  int i;
+  int k;
+
+  /* Three views looking at different parts of the scene */
+  eyes[0] = vm_v3(0.0f, 0.0f, 13.0f);
+  eyes[1] = vm_v3(40.0f, 0.0f, 13.0f);
+  eyes[2] = vm_v3(-40.0f, 5.0f, -60.0f);
+
+  for (k = 0; k < 3; ++k)
+  {
+    m4x4 view = vm_m4x4_lookAt(eyes[k], vm_v3(eyes[k].x, eyes[k].y, eyes[k].z - 1.0f), vm_v3(0.0f, 1.0f, 0.0f));
+    frusta[k] = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  }
+
+  /* 21 objects: two full blocks of 8 and a tail of 5 */
+  for (i = 0; i < 21; ++i)
+  {
+    x[i] = (float)((i * 37) % 61) * 1.9f - 60.0f;
+    y[i] = (float)((i * 13) % 23) * 0.91f - 10.0f;
+    z[i] = (float)((i * 7) % 41) * 2.73f - 90.0f;
+    radii[i] = 0.5f + (float)(i % 5);
+    ex[i] = 0.5f + (float)(i % 3);
+    ey[i] = 1.0f + (float)(i % 4);
+    ez[i] = 0.25f + (float)(i % 7);
+  }
+
+  vm_frustum_cull_spheres_multi(frusta, 3, &centers, radii, spheres_visible);
+  vm_frustum_cull_aabbs_multi(frusta, 3, &centers, &extents, aabbs_visible);
+
+  /* Same result as one single frustum pass per view */
+  for (pass = 0; pass < 2; ++pass)
+  {
+    unsigned int *multi = pass == 0 ? spheres_visible : aabbs_visible;
+
+    for (k = 0; k < 3; ++k)
+    {
+      if (pass == 0)
+      {
+        vm_frustum_cull_spheres_mask(&frusta[k], &centers, radii, visible[k]);
+      }
+      else
+      {
+        vm_frustum_cull_aabbs_mask(&frusta[k], &centers, &extents, visible[k]);
+      }
+    }
+
+    for (i = 0; i < 21; ++i)
+    {
+      unsigned int expected = 0;
+
+      for (k = 0; k < 3; ++k)
+      {
+        expected |= (unsigned int)((visible[k][i >> 3] >> (i & 7)) & 1) << k;
+      }
+
+      assert(multi[i] == expected);
+      seen_by_some |= multi[i] != 0 && multi[i] != 7;
+    }
+  }
+
+  /* Some objects are only visible in a subset of the views */
+  assert(seen_by_some);
+
+  /* No frusta gives empty masks */
+  vm_frustum_cull_spheres_multi(frusta, 0, &centers, radii, spheres_visible);
+  assert(spheres_visible[0] == 0 && spheres_visible[20] == 0);
+}
+
+void vm_test_bvh4(void)
+{
+  static unsigned char memory[64 * 1024];
+  static float x[300], y[300], z[300], ex[300], ey[300], ez[300];
+  static int inside[300], intersecting[300], flat_inside[300], flat_intersecting[300];
+  static unsigned char seen[300];
+
+  m4x4 projection = vm_m4x4_perspective(vm_radf(60.0f), 1.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum_simd f = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  v3_soa centers = vm_v3_soa(x, y, z, 300);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 300);
+  frustum_cull_list list = vm_frustum_cull_list(inside, intersecting);
+  frustum_cull_list flat = vm_frustum_cull_list(flat_inside, flat_intersecting);
+  vm_arena arena = vm_arena_init(memory, sizeof(memory));
+  vm_arena small = vm_arena_init(memory, 256);
+  bvh4 bvh;
+  int pass;
+  int i;
+
+  for (i = 0; i < 300; ++i)
+  {
+    x[i] = (float)((i * 37) % 101) * 0.8f - 40.0f;
+    y[i] = (float)((i * 13) % 67) * 0.6f - 20.0f;
+    z[i] = (float)((i * 7) % 89) * 1.1f - 90.0f;
+    ex[i] = 0.3f + 0.1f * (float)(i % 4);
+    ey[i] = 0.2f + 0.1f * (float)(i % 3);
+    ez[i] = 0.4f;
+  }
+
+  assert(vm_arena_alloc(&small, 8, 8) != 0);
+  assert(vm_arena_alloc(&small, 1024, 8) == 0);
+  assert(!vm_bvh4_build(&bvh, &small, &centers, &extents));
+
+  assert(vm_bvh4_memory_size(300) <= sizeof(memory));
+  assert(vm_bvh4_build(&bvh, &arena, &centers, &extents));
+  assert(bvh.node_count > 1 && bvh.count == 300);
+
+  /* Every object is referenced exactly once */
+  for (i = 0; i < 300; ++i)
+  {
+    seen[i] = 0;
+  }
+  for (i = 0; i < 300; ++i)
+  {
+    seen[bvh.indices[i]]++;
+  }
+  for (i = 0; i < 300; ++i)
+  {
+    assert(seen[i] == 1);
+  }
+
+  /* Same result as testing all objects, before and after moving them and refitting */
+  for (pass = 0; pass < 2; ++pass)
+  {
+    int count = vm_bvh4_cull(&bvh, &f, &centers, &extents, &list);
+
+    assert(count == vm_frustum_cull_aabbs(&f, &centers, &extents, &flat));
+    assert(list.inside_count == flat.inside_count);
+    assert(list.intersecting_count == flat.intersecting_count);
+    assert(count > 0 && count < 300);
+
+    for (i = 0; i < 300; ++i)
+    {
+      seen[i] = 0;
+    }
+    for (i = 0; i < list.inside_count; ++i)
+    {
+      seen[list.inside[i]] = 1;
+    }
+    for (i = 0; i < list.intersecting_count; ++i)
+    {
+      seen[list.intersecting[i]] = 2;
+    }
+    for (i = 0; i < flat.inside_count; ++i)
+    {
+      assert(seen[flat.inside[i]] == 1);
+    }
+    for (i = 0; i < flat.intersecting_count; ++i)
+    {
+      assert(seen[flat.intersecting[i]] == 2);
+    }
+
+    for (i = 0; i < 300; ++i)
+    {
+      x[i] += 5.0f;
+      z[i] += (float)(i % 3);
+    }
+
+    vm_bvh4_refit(&bvh, &centers, &extents);
+  }
+}
+
+/* Compares a query result with testing every inserted object */
+static void vm_test_spatial_check(const spatial_query *q, const v3 *centers, const v3 *extents, const unsigned char *inserted, int n, const int *found, int found_count)
+{
+  unsigned char marks[200];
+  int expected = 0;
+  int i;
+
+  for (i = 0; i < n; ++i)
+  {
+    marks[i] = 0;
+  }
+
+  for (i = 0; i < found_count; ++i)
+  {
+    assert(marks[found[i]] == 0);
+    marks[found[i]] = 1;
+  }
+
+  for (i = 0; i < n; ++i)
+  {
+    int hit = inserted[i] && vm_spatial_query_test(q, centers[i], extents[i], VM_FRUSTUM_PLANES_ALL) >= 0;
+    assert(marks[i] == hit);
+    expected += hit;
+  }
+
+  assert(expected == found_count);
+}
+
+void vm_test_spatial_index(void)
+{
+  static unsigned char memory[256 * 1024];
+  static v3 centers[200];
+  static v3 extents[200];
+  static unsigned char inserted[200];
+  static int found[200];
+
+  m4x4 projection = vm_m4x4_perspective(vm_radf(60.0f), 1.0f, 0.1f, 60.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum_simd f = vm_frustum_simd(vm_frustum_extract_planes(vm_m4x4_mul(projection, view)));
+  vm_arena arena = vm_arena_init(memory, sizeof(memory));
+  spatial_grid grid;
+  loose_octree octree;
+  spatial_query queries[4];
+  int pass;
+  int i;
+  int k;
+
+  assert(vm_spatial_grid_init(&grid, &arena, vm_v3(-50.0f, -50.0f, -50.0f), 10.0f, 10, 10, 10, 200));
+  assert(vm_loose_octree_init(&octree, &arena, vm_v3_zero, 50.0f, 5, 200));
+
+  queries[0] = vm_spatial_query_aabb(vm_v3(5.0f, 0.0f, -10.0f), vm_v3(12.0f, 8.0f, 20.0f));
+  queries[1] = vm_spatial_query_sphere(vm_v3(-20.0f, 10.0f, 5.0f), 18.0f);
+  queries[2] = vm_spatial_query_frustum(&f);
+  queries[3] = vm_spatial_query_aabb(vm_v3(60.0f, 0.0f, 0.0f), vm_v3(8.0f, 8.0f, 8.0f));
+
+  /* Small and large objects, a few outside of both structures */
+  for (i = 0; i < 200; ++i)
+  {
+    centers[i] = vm_v3((float)((i * 37) % 113) - 56.0f, (float)((i * 13) % 97) - 48.0f, (float)((i * 29) % 107) - 53.0f);
+    extents[i] = vm_v3(0.5f + (float)(i % 7) * (i % 13 == 0 ? 6.0f : 0.5f), 1.0f, 0.5f + (float)(i % 5));
+    inserted[i] = 1;
+
+    vm_spatial_grid_insert(&grid, i, centers[i], extents[i]);
+    vm_loose_octree_insert(&octree, i, centers[i], extents[i]);
+  }
+
+  for (pass = 0; pass < 2; ++pass)
+  {
+    for (k = 0; k < 4; ++k)
+    {
+      int count = vm_spatial_grid_query(&grid, &queries[k], found);
+      vm_test_spatial_check(&queries[k], centers, extents, inserted, 200, found, count);
+      assert(pass == 1 || k == 3 || count > 0);
+
+      count = vm_loose_octree_query(&octree, &queries[k], found);
+      vm_test_spatial_check(&queries[k], centers, extents, inserted, 200, found, count);
+    }
+
+    /* Move every third object, remove every seventh */
+    for (i = 0; i < 200; ++i)
+    {
+      if (i % 7 == 0)
+      {
+        vm_spatial_grid_remove(&grid, i);
+        vm_loose_octree_remove(&octree, i);
+        inserted[i] = 0;
+      }
+      else if (i % 3 == 0)
+      {
+        centers[i] = vm_v3(centers[i].z * 0.9f, centers[i].x + 3.0f, -centers[i].y);
+        extents[i] = vm_v3(extents[i].z, extents[i].x, 0.25f);
+
+        vm_spatial_grid_move(&grid, i, centers[i], extents[i]);
+        vm_loose_octree_move(&octree, i, centers[i], extents[i]);
+      }
+    }
+  }
+
+  /* Subtree counts are back in sync: the root counts all inserted objects */
+  k = 0;
+  for (i = 0; i < 200; ++i)
+  {
+    k += inserted[i];
+  }
+  assert(octree.count[0] == k);
+}
+
+void vm_test_aabb(void)
+{
+  m4x4 projection = vm_m4x4_perspective(vm_radf(90.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  m4x4 view = vm_m4x4_lookAt(vm_v3(0.0f, 0.0f, 13.0f), vm_v3_zero, vm_v3(0.0f, 1.0f, 0.0f));
+  frustum planes = vm_frustum_extract_planes(vm_m4x4_mul(projection, view));
+  frustum_simd simd = vm_frustum_simd(planes);
+  aabb boxes[11];
+  aabb transformed[11];
+  m4x4 worlds[11];
+  float x[11], y[11], z[11], ex[11], ey[11], ez[11];
+  v3_soa centers = vm_v3_soa(x, y, z, 11);
+  v3_soa extents = vm_v3_soa(ex, ey, ez, 11);
+  unsigned char visible[2];
+  aabb a;
+  int i;
+  int j;
+
+  /* Merging with the empty box and expanding by points */
+  a = vm_aabb_merge(vm_aabb_empty(), vm_aabb(vm_v3(-1.0f, 0.0f, 2.0f), vm_v3(1.0f, 3.0f, 4.0f)));
+  assert(vm_v3_equals(a.min, vm_v3(-1.0f, 0.0f, 2.0f)) && vm_v3_equals(a.max, vm_v3(1.0f, 3.0f, 4.0f)));
+  a = vm_aabb_expand(a, vm_v3(5.0f, -2.0f, 3.0f));
+  assert(vm_v3_equals(a.min, vm_v3(-1.0f, -2.0f, 2.0f)) && vm_v3_equals(a.max, vm_v3(5.0f, 3.0f, 4.0f)));
+  assert(vm_v3_equals(vm_aabb_center(a), vm_v3(2.0f, 0.5f, 3.0f)));
+  assert(vm_v3_equals(vm_aabb_extents(a), vm_v3(3.0f, 2.5f, 1.0f)));
+  a = vm_aabb_from_center_extents(vm_aabb_center(a), vm_aabb_extents(a));
+  assert(vm_v3_equals(a.min, vm_v3(-1.0f, -2.0f, 2.0f)) && vm_v3_equals(a.max, vm_v3(5.0f, 3.0f, 4.0f)));
+  a = vm_aabb_expand(vm_aabb_empty(), vm_v3(1.0f, 2.0f, 3.0f));
+  assert(vm_v3_equals(a.min, a.max));
+
+  for (i = 0; i < 11; ++i)
+  {
+    quat rotation = vm_quat_rotate(vm_v3_normalize(vm_v3(1.0f, (float)(i % 3), (float)(i % 5) - 2.0f)), vm_radf((float)(i * 37)));
+    v3 position = vm_v3((float)((i * 37) % 61) * 1.37f - 40.0f, (float)((i * 13) % 23) * 0.91f - 10.0f, (float)((i * 7) % 41) * 2.73f - 90.0f);
+
+    worlds[i] = vm_m4x4_from_trs(position, rotation, vm_v3(1.0f + 0.25f * (float)i, i % 2 ? -2.0f : 2.0f, 0.5f));
+    boxes[i] = vm_aabb(vm_v3(-1.0f, (float)i * 0.1f, -3.0f), vm_v3(2.0f, 1.0f + (float)i, 0.5f));
+  }
+
+  vm_aabb_transform_array(worlds, boxes, transformed, 11);
+
+  /* Same box as the bounds of the 8 transformed corners */
+  for (i = 0; i < 11; ++i)
+  {
+    aabb expected = vm_aabb_empty();
+    aabb single = vm_aabb_transform(worlds[i], boxes[i]);
+
+    for (j = 0; j < 8; ++j)
+    {
+      v3 corner = vm_v3((j & 1) ? boxes[i].max.x : boxes[i].min.x, (j & 2) ? boxes[i].max.y : boxes[i].min.y, (j & 4) ? boxes[i].max.z : boxes[i].min.z);
+      expected = vm_aabb_expand(expected, vm_m4x4_transform_point(&worlds[i], corner));
+    }
+
+    assert(vm_absf(transformed[i].min.x - expected.min.x) < 0.0001f && vm_absf(transformed[i].max.x - expected.max.x) < 0.0001f);
+    assert(vm_absf(transformed[i].min.y - expected.min.y) < 0.0001f && vm_absf(transformed[i].max.y - expected.max.y) < 0.0001f);
+    assert(vm_absf(transformed[i].min.z - expected.min.z) < 0.0001f && vm_absf(transformed[i].max.z - expected.max.z) < 0.0001f);
+    assert(vm_v3_equals(single.min, transformed[i].min) && vm_v3_equals(single.max, transformed[i].max));
+  }
+
+  /* In place */
+  vm_aabb_transform_array(worlds, boxes, boxes, 11);
+  assert(vm_v3_equals(boxes[10].min, transformed[10].min) && vm_v3_equals(boxes[10].max, transformed[10].max));
+
+  /* Straight into the culling functions */
+  vm_aabb_to_soa(transformed, &centers, &extents);
+  vm_frustum_cull_aabbs_mask(&simd, &centers, &extents, visible);
+
+  for (i = 0; i < 11; ++i)
+  {
+    v3 dimensions = vm_v3_sub(transformed[i].max, transformed[i].min);
+    assert(((visible[i >> 3] >> (i & 7)) & 1) == vm_frustum_is_cube_in_p(&planes, vm_aabb_center(transformed[i]), dimensions, 0.0f));
+  }
+}
+
+void vm_test_m4x4_from_trs(void)
+{
+  transformation in[9];
+  m4x4 out[9];
+  int i;
+  int k;
+
+  for (i = 0; i < 9; ++i)
+  {
+    in[i] = vm_transformation_init();
+    vm_tranformation_rotate(&in[i], vm_v3(0.0f, 0.6f, 0.8f), 0.4f * (float)i);
+    in[i].position = vm_v3((float)i, -2.0f, 0.5f * (float)i);
+    in[i].scale = vm_v3(1.0f + 0.1f * (float)i, 2.0f, 0.5f);
+  }
+
+  vm_m4x4_from_trs_array(in, out, 9);
+
+  for (i = 0; i < 9; ++i)
+  {
+    /* Same as multiplying the separate translation, rotation and scale matrices */
+    m4x4 t = vm_m4x4_translate(vm_m4x4_identity, in[i].position);
+    m4x4 r = vm_quat_to_rotation_matrix(in[i].rotation);
+    m4x4 s = vm_m4x4_scale(vm_m4x4_identity, in[i].scale);
+    m4x4 expected = vm_m4x4_mul(t, vm_m4x4_mul(r, s));
+    m4x4 trs = vm_m4x4_from_trs(in[i].position, in[i].rotation, in[i].scale);
+
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(trs.e[k] - expected.e[k]) < 0.0001f);
+      assert(vm_absf(out[i].e[k] - expected.e[k]) < 0.0001f);
+    }
+  }
+}
+
+void vm_test_transformation_graph(void)
+{
+  transformation locals[7];
+  int parents[7];
+  m4x4 worlds[7];
+  transformation nodes[7];
+  int expected_parents[7] = {-1, 0, 1, 0, 3, -1, 5};
+  transformation_graph g = vm_transformation_graph_init(locals, parents, worlds, 7);
+  int i;
+  int k;
+
+  /* Same hierarchy twice: linked through parent pointers and as a flat graph */
+  for (i = 0; i < 7; ++i)
+  {
+    nodes[i] = vm_transformation_init();
+    vm_tranformation_rotate(&nodes[i], vm_v3(0.0f, 0.6f, 0.8f), 0.3f * (float)i);
+    nodes[i].position = vm_v3((float)i, 1.0f - (float)i, 0.5f);
+    nodes[i].scale = vm_v3(1.0f + 0.1f * (float)i, 1.0f, 0.9f);
+    nodes[i].parent = expected_parents[i] < 0 ? 0 : &nodes[expected_parents[i]];
+
+    assert(vm_transformation_graph_add(&g, nodes[i], expected_parents[i]) == i);
+    assert(g.locals[i].parent == 0);
+  }
+
+  /* Full graph and invalid parents */
+  assert(vm_transformation_graph_add(&g, nodes[0], -1) == -1);
+  g.capacity = 8;
+  assert(vm_transformation_graph_add(&g, nodes[0], 7) == -1);
+  assert(vm_transformation_graph_add(&g, nodes[0], -2) == -1);
+  g.capacity = 7;
+  assert(g.count == 7);
+
+  vm_transformation_graph_update(&g);
+
+  for (i = 0; i < 7; ++i)
+  {
+    m4x4 expected = vm_transformation_matrix(&nodes[i]);
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(worlds[i].e[k] - expected.e[k]) < 0.0001f);
+    }
+  }
+
+  /* Moving a root moves its whole subtree */
+  g.locals[0].position = vm_v3(10.0f, 0.0f, 0.0f);
+  nodes[0].position = vm_v3(10.0f, 0.0f, 0.0f);
+  vm_transformation_graph_update(&g);
+
+  for (i = 0; i < 7; ++i)
+  {
+    m4x4 expected = vm_transformation_matrix(&nodes[i]);
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(worlds[i].e[k] - expected.e[k]) < 0.0001f);
+    }
+  }
+}
+
+void vm_test_transformation_graph_tracking(void)
+{
+  transformation locals[7];
+  int parents[7];
+  m4x4 worlds[7];
+  unsigned char dirty[7];
+  int changed[7];
+  transformation nodes[7];
+  int expected_parents[7] = {-1, 0, 1, 0, 3, -1, 5};
+  transformation_graph g = vm_transformation_graph_init(locals, parents, worlds, 7);
+  const int *indices;
+  int i;
+  int k;
+
+  for (i = 0; i < 7; ++i)
+  {
+    nodes[i] = vm_transformation_init();
+    vm_tranformation_rotate(&nodes[i], vm_v3(0.0f, 0.6f, 0.8f), 0.3f * (float)i);
+    nodes[i].position = vm_v3((float)i, 1.0f - (float)i, 0.5f);
+    nodes[i].parent = expected_parents[i] < 0 ? 0 : &nodes[expected_parents[i]];
+
+    vm_transformation_graph_add(&g, nodes[i], expected_parents[i]);
+  }
+
+  /* Enabling tracking starts fully dirty */
+  vm_transformation_graph_enable_tracking(&g, dirty, changed);
+  vm_transformation_graph_update(&g);
+  assert(vm_transformation_graph_changed(&g, &indices) == 7);
+
+  for (i = 0; i < 7; ++i)
+  {
+    assert(indices[i] == i);
+    assert(dirty[i] == 0);
+  }
+
+  /* Nothing changed */
+  vm_transformation_graph_update(&g);
+  assert(vm_transformation_graph_changed(&g, &indices) == 0);
+
+  /* Node 3 and its child 4 */
+  nodes[3].position = vm_v3(0.0f, 5.0f, 0.0f);
+  vm_transformation_graph_set_local(&g, 3, nodes[3]);
+  assert(g.locals[3].parent == 0);
+  vm_transformation_graph_update(&g);
+  assert(vm_transformation_graph_changed(&g, &indices) == 2);
+  assert(indices[0] == 3 && indices[1] == 4);
+
+  /* Root 0 moves 0..4 but not the second tree 5..6 */
+  g.locals[0].position = vm_v3(10.0f, 0.0f, 0.0f);
+  nodes[0].position = vm_v3(10.0f, 0.0f, 0.0f);
+  vm_transformation_graph_mark_dirty(&g, 0);
+  vm_transformation_graph_mark_dirty(&g, 6);
+  vm_transformation_graph_update(&g);
+  assert(vm_transformation_graph_changed(&g, &indices) == 6);
+  assert(indices[0] == 0 && indices[4] == 4 && indices[5] == 6);
+
+  for (i = 0; i < 7; ++i)
+  {
+    m4x4 expected = vm_transformation_matrix(&nodes[i]);
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(worlds[i].e[k] - expected.e[k]) < 0.0001f);
+    }
+  }
+}
+
+static int vm_test_barrier_calls;
+
+static void vm_test_barrier(void *user)
+{
+  (void)user;
+  vm_test_barrier_calls++;
+}
+
+/* 6 roots and 3 children: the second level starts at order position 6 (not a
+   multiple of VM_TRANSFORMATION_GRAPH_CHUNK 4) and is smaller than one chunk,
+   so only worker 0 may touch it */
+void vm_test_transformation_graph_level_chunks(void)
+{
+  transformation locals[9];
+  int parents[9];
+  m4x4 worlds[9];
+  int depths[9];
+  int order[9];
+  int first[3];
+  transformation_graph g = vm_transformation_graph_init(locals, parents, worlds, 9);
+  transformation_graph_levels levels;
+  int i;
+
+  for (i = 0; i < 9; ++i)
+  {
+    assert(vm_transformation_graph_add(&g, vm_transformation_init(), i < 6 ? -1 : 0) == i);
+  }
+
+  assert(vm_transformation_graph_build_levels(&g, &levels, depths, order, first, 2));
+  assert(levels.count == 2 && levels.first[1] == 6 && levels.first[2] == 9);
+
+  for (i = 6; i < 9; ++i)
+  {
+    worlds[i] = vm_m4x4_zero;
+  }
+
+  vm_transformation_graph_update_level(&g, &levels, 1, 1, 2);
+  for (i = 6; i < 9; ++i)
+  {
+    assert(worlds[i].e[0] == 0.0f);
+  }
+
+  vm_transformation_graph_update_level(&g, &levels, 1, 0, 2);
+  for (i = 6; i < 9; ++i)
+  {
+    assert(worlds[i].e[0] == 1.0f);
+  }
+}
+
+void vm_test_transformation_graph_levels(void)
+{
+  transformation locals[2][40];
+  int parents[2][40];
+  m4x4 worlds[2][40];
+  unsigned char dirty[2][40];
+  int changed[2][40];
+  int depths[40];
+  int order[40];
+  int first[9];
+  transformation_graph g[2];
+  transformation_graph_levels levels;
+  const int *indices;
+  int level;
+  int i;
+  int j;
+  int k;
+
+  for (j = 0; j < 2; ++j)
+  {
+    g[j] = vm_transformation_graph_init(locals[j], parents[j], worlds[j], 40);
+  }
+
+  /* Mixed depths, not stored level by level */
+  for (i = 0; i < 40; ++i)
+  {
+    transformation t = vm_transformation_init();
+    vm_tranformation_rotate(&t, vm_v3(0.0f, 0.6f, 0.8f), 0.1f * (float)i);
+    t.position = vm_v3(1.0f, 0.1f * (float)i, 0.0f);
+
+    for (j = 0; j < 2; ++j)
+    {
+      assert(vm_transformation_graph_add(&g[j], t, i % 4 == 0 ? i / 8 - 1 : i - 1) == i);
+    }
+  }
+
+  assert(!vm_transformation_graph_build_levels(&g[0], &levels, depths, order, first, 2));
+  assert(vm_transformation_graph_build_levels(&g[0], &levels, depths, order, first, 8));
+  assert(levels.first[0] == 0 && levels.first[levels.count] == 40);
+
+  for (level = 0; level < levels.count; ++level)
+  {
+    for (k = levels.first[level]; k < levels.first[level + 1]; ++k)
+    {
+      assert(depths[levels.order[k]] == level);
+    }
+  }
+
+  /* Three workers run one after the other per level, compared with the sequential update */
+  for (level = 0; level < levels.count; ++level)
+  {
+    for (j = 0; j < 3; ++j)
+    {
+      vm_transformation_graph_update_level(&g[0], &levels, level, j, 3);
+    }
+  }
+
+  vm_transformation_graph_update(&g[1]);
+
+  for (i = 0; i < 40; ++i)
+  {
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(worlds[0][i].e[k] - worlds[1][i].e[k]) < 0.0001f);
+    }
+  }
+
+  /* Change tracking through the single worker entry point */
+  for (j = 0; j < 2; ++j)
+  {
+    vm_transformation_graph_enable_tracking(&g[j], dirty[j], changed[j]);
+    vm_transformation_graph_update(&g[j]);
+
+    g[j].locals[5].position = vm_v3(0.0f, 3.0f, 0.0f);
+    vm_transformation_graph_mark_dirty(&g[j], 5);
+  }
+
+  vm_test_barrier_calls = 0;
+  vm_transformation_graph_update_worker(&g[0], &levels, 0, 1, vm_test_barrier, 0);
+  assert(vm_test_barrier_calls == levels.count);
+
+  vm_transformation_graph_update(&g[1]);
+  assert(vm_transformation_graph_changed(&g[0], &indices) == g[1].changed_count);
+  assert(g[0].changed_count > 1 && indices[0] == 5);
+
+  for (i = 0; i < g[0].changed_count; ++i)
+  {
+    assert(indices[i] == changed[1][i]);
+  }
+
+  for (i = 0; i < 40; ++i)
+  {
+    assert(dirty[0][i] == 0);
+
+    for (k = 0; k < 16; ++k)
+    {
+      assert(vm_absf(worlds[0][i].e[k] - worlds[1][i].e[k]) < 0.0001f);
+    }
+  }
+}
+
+void vm_test_transformation_graph_inverse_cache(void)
+{
+  transformation locals[7];
+  int parents[7];
+  m4x4 worlds[7];
+  m4x4 inverse_worlds[7];
+  unsigned char dirty[7];
+  int changed[7];
+  int node_parents[7] = {-1, 0, 1, 0, 3, -1, 5};
+  transformation_graph g = vm_transformation_graph_init(locals, parents, worlds, 7);
+  int pass;
+  int i;
+  int k;
+
+  for (i = 0; i < 7; ++i)
+  {
+    transformation t = vm_transformation_init();
+    vm_tranformation_rotate(&t, vm_v3(0.0f, 0.6f, 0.8f), 0.3f * (float)i);
+    t.position = vm_v3((float)i, 1.0f - (float)i, 0.5f);
+    t.scale = vm_v3(1.0f + 0.1f * (float)i, 1.0f, 0.9f);
+
+    vm_transformation_graph_add(&g, t, node_parents[i]);
+  }
+
+  vm_transformation_graph_enable_tracking(&g, dirty, changed);
+  vm_transformation_graph_enable_inverse_cache(&g, inverse_worlds);
+
+  for (pass = 0; pass < 2; ++pass)
+  {
+    vm_transformation_graph_update(&g);
+
+    for (i = 0; i < 7; ++i)
+    {
+      m4x4 expected = vm_m4x4_inverse(worlds[i]);
+      v3 p = vm_v3(1.0f, -2.0f, 3.0f);
+      v3 local = vm_transformation_graph_point_to_local(&g, i, p);
+      v3 world = vm_transformation_graph_point_to_world(&g, i, local);
+
+      for (k = 0; k < 16; ++k)
+      {
+        assert(vm_absf(inverse_worlds[i].e[k] - expected.e[k]) < 0.001f);
+      }
+
+      assert(vm_absf(world.x - p.x) < 0.001f);
+      assert(vm_absf(world.y - p.y) < 0.001f);
+      assert(vm_absf(world.z - p.z) < 0.001f);
+    }
+
+    /* Only the moved subtree (3, 4) gets new inverses in the second pass */
+    g.locals[3].position = vm_v3(0.0f, 4.0f, -1.0f);
+    vm_transformation_graph_mark_dirty(&g, 3);
+  }
+
+  assert(g.changed_count == 2);
+}
+
 int main(void)
 {
 
@@ -689,14 +2519,44 @@ int main(void)
   vm_test_v3_cross_dot_normalize();
   vm_test_v3_reflect_project_angle();
   vm_test_v3_distance();
+#ifdef VM_SIMD_STORAGE
+  vm_test_v3_simd_storage();
+#endif
   vm_test_v4();
+  vm_test_v3_soa();
+  vm_test_v4_soa();
+  vm_test_v3x4();
+#ifdef VM_USE_DISPATCH
+  vm_test_dispatch();
+  vm_test_dispatch_cull_boundary();
+#endif
   vm_test_m4x4();
   vm_test_m4x4_perspective();
   vm_test_m4x4_rotation();
   vm_test_m4x4_lookAt();
   vm_test_m4x4_inverse();
+  vm_test_m4x4_inverse_general();
+  vm_test_m4x4_inverse_affine_rigid();
+  vm_test_pointer_api();
+  vm_test_m4x4_transform();
+  vm_test_m4x4_project();
+  vm_test_m4x4_mul_array();
+  vm_test_m3x4();
   vm_test_quat();
   vm_test_frustum();
+  vm_test_frustum_simd();
+  vm_test_frustum_plane_mask();
+  vm_test_frustum_multi();
+  vm_test_frustum_obb();
+  vm_test_bvh4();
+  vm_test_spatial_index();
+  vm_test_aabb();
+  vm_test_m4x4_from_trs();
+  vm_test_transformation_graph();
+  vm_test_transformation_graph_tracking();
+  vm_test_transformation_graph_levels();
+  vm_test_transformation_graph_level_chunks();
+  vm_test_transformation_graph_inverse_cache();
 
   return 0;
 }
@@ -28,6 +28,25 @@ LICENSE
 
 #define VM_API static
 
+/* Pointer arguments marked with VM_RESTRICT must not alias each other */
+#if __STDC_VERSION__ >= 199901L
+#define VM_RESTRICT restrict
+#elif defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define VM_RESTRICT __restrict
+#else
+#define VM_RESTRICT
+#endif
+
+/* With VM_DEBUG the preconditions of some functions are checked (e.g. vm_m4x4_inverse_rigid).
+   A failed check writes to address 0, define VM_ASSERT before including vm.h to use your own handler */
+#ifndef VM_ASSERT
+#ifdef VM_DEBUG
+#define VM_ASSERT(expression) ((expression) ? (void)0 : (void)(*(volatile int *)0 = 0))
+#else
+#define VM_ASSERT(expression) ((void)0)
+#endif
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
 #define VM_ALIGN_16 __attribute__((aligned(16)))
 #elif defined(_MSC_VER)
@@ -36,12 +55,59 @@ LICENSE
 #define VM_ALIGN_16
 #endif
 
-/* If we are on a platform that does not use SSE we undefine VM_USE_SSE if accidently enabled by the user */
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_ALIGN_64 __attribute__((aligned(64)))
+#elif defined(_MSC_VER)
+#define VM_ALIGN_64 __declspec(align(64))
+#else
+#define VM_ALIGN_64
+#endif
+
+/* Allows anonymous structs inside unions (C11, but supported as an extension by all major compilers) */
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_EXTENSION __extension__
+#else
+#define VM_EXTENSION
+#endif
+
+/* Unsigned integer wide enough to hold a pointer (used for alignment checks) */
+#if defined(_MSC_VER) && defined(_WIN64)
+typedef unsigned __int64 vm_uptr;
+#elif defined(__SIZE_TYPE__)
+VM_EXTENSION typedef __SIZE_TYPE__ vm_uptr;
+#else
+typedef unsigned long vm_uptr;
+#endif
+
+/* If we are on a platform that does not use SSE we undefine VM_USE_SSE/VM_USE_AVX2 if accidently enabled by the user */
+#if defined(VM_USE_AVX2) && !(defined(__x86_64__) || defined(__i386__))
+#undef VM_USE_AVX2
+#endif
+
 #if defined(VM_USE_SSE) && !(defined(__x86_64__) || defined(__i386__))
 #undef VM_USE_SSE
 #endif
 
-#ifdef VM_USE_SSE
+/* AVX2 (with FMA) is a superset of the SSE backend */
+#if defined(VM_USE_AVX2) && !defined(VM_USE_SSE)
+#define VM_USE_SSE
+#endif
+
+/* VM_SIMD_STORAGE stores v3/v4/quat directly in a SSE register and needs VM_USE_SSE */
+#if defined(VM_SIMD_STORAGE) && !defined(VM_USE_SSE)
+#undef VM_SIMD_STORAGE
+#endif
+
+/* SSE4.1 (e.g. dpps) is only used if the compiler is allowed to emit it */
+#if defined(VM_USE_SSE) && (defined(__SSE4_1__) || defined(__AVX__))
+#define VM_USE_SSE41
+#endif
+
+#ifdef VM_USE_AVX2
+#include <immintrin.h>
+#elif defined(VM_USE_SSE41)
+#include <smmintrin.h>
+#elif defined(VM_USE_SSE)
 #include <xmmintrin.h>
 #endif
 
@@ -181,7 +247,7 @@ VM_API VM_INLINE float vm_invsqrt(float number)
     union
     {
         float f;
-        long i;
+        int i; /* Has to be 32 bits like float, long is 64 bits on LP64 platforms */
     } conv;
 
     float x2, y;
@@ -367,6 +433,16 @@ VM_API VM_INLINE float vm_absf(float x)
     return (x < 0.0f ? -x : x);
 }
 
+/* Returns (a * b) + c, with VM_USE_AVX2 as a single fused multiply-add (one rounding step) */
+VM_API VM_INLINE float vm_fmaf(float a, float b, float c)
+{
+#ifdef VM_USE_AVX2
+    return (_mm_cvtss_f32(_mm_fmadd_ss(_mm_set_ss(a), _mm_set_ss(b), _mm_set_ss(c))));
+#else
+    return ((a * b) + c);
+#endif
+}
+
 /* #############################################################################
  * # Easing Functions
  * #############################################################################
@@ -409,1117 +485,1173 @@ VM_API VM_INLINE float vm_ease_in_out_bounce(float t)
 }
 
 /* #############################################################################
- * # VECTOR 2 FUNCTIONS
+ * # SIMD LANE FUNCTIONS
  * #############################################################################
  */
-#define VM_V2_ELEMENT_COUNT 2
+#define VM_F32X4_WIDTH 4
 
-typedef struct v2
+/* A f32x4 holds 4 independent float lanes. With VM_USE_SSE it maps directly
+   to a SSE register, otherwise a plain array is used so that all code built on
+   top of it also works on platforms without SIMD support. */
+#ifdef VM_USE_SSE
+typedef __m128 f32x4;
+#else
+typedef union f32x4
 {
-    float x;
-    float y;
-} v2;
-
-static const v2 vm_v2_zero = {0.0f, 0.0f};
-static const v2 vm_v2_one = {1.0f, 1.0f};
+    float e[VM_F32X4_WIDTH];
+    unsigned int u[VM_F32X4_WIDTH]; /* Used for lane masks */
+} f32x4;
+#endif
 
-VM_API VM_INLINE v2 vm_v2(float x, float y)
+VM_API VM_INLINE f32x4 vm_f32x4_set1(float a)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_set1_ps(a));
+#else
+    f32x4 result;
 
-    result.x = x;
-    result.y = y;
+    result.e[0] = a;
+    result.e[1] = a;
+    result.e[2] = a;
+    result.e[3] = a;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2f(float c)
+VM_API VM_INLINE f32x4 vm_f32x4_load(const float *a)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_loadu_ps(a));
+#else
+    f32x4 result;
 
-    result.x = c;
-    result.y = c;
+    result.e[0] = a[0];
+    result.e[1] = a[1];
+    result.e[2] = a[2];
+    result.e[3] = a[3];
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE float *vm_v2_data(v2 *a)
-{
-    return ((float *)a);
-}
-
-VM_API VM_INLINE int vm_v2_equals(v2 a, v2 b)
+VM_API VM_INLINE void vm_f32x4_store(float *dst, f32x4 a)
 {
-    return (((a.x == b.x) && (a.y == b.y)) ? 1 : 0);
+#ifdef VM_USE_SSE
+    _mm_storeu_ps(dst, a);
+#else
+    dst[0] = a.e[0];
+    dst[1] = a.e[1];
+    dst[2] = a.e[2];
+    dst[3] = a.e[3];
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_add(v2 a, v2 b)
+VM_API VM_INLINE f32x4 vm_f32x4_add(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_add_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x + b.x;
-    result.y = a.y + b.y;
+    result.e[0] = a.e[0] + b.e[0];
+    result.e[1] = a.e[1] + b.e[1];
+    result.e[2] = a.e[2] + b.e[2];
+    result.e[3] = a.e[3] + b.e[3];
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_addf(v2 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x4_sub(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_sub_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x + b;
-    result.y = a.y + b;
+    result.e[0] = a.e[0] - b.e[0];
+    result.e[1] = a.e[1] - b.e[1];
+    result.e[2] = a.e[2] - b.e[2];
+    result.e[3] = a.e[3] - b.e[3];
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_sub(v2 a, v2 b)
+VM_API VM_INLINE f32x4 vm_f32x4_mul(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_mul_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x - b.x;
-    result.y = a.y - b.y;
+    result.e[0] = a.e[0] * b.e[0];
+    result.e[1] = a.e[1] * b.e[1];
+    result.e[2] = a.e[2] * b.e[2];
+    result.e[3] = a.e[3] * b.e[3];
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_subf(v2 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x4_div(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_div_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x - b;
-    result.y = a.y - b;
+    result.e[0] = a.e[0] / b.e[0];
+    result.e[1] = a.e[1] / b.e[1];
+    result.e[2] = a.e[2] / b.e[2];
+    result.e[3] = a.e[3] / b.e[3];
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_mul(v2 a, v2 b)
+/* Returns (a * b) + c, with VM_USE_AVX2 as a single fused multiply-add */
+VM_API VM_INLINE f32x4 vm_f32x4_madd(f32x4 a, f32x4 b, f32x4 c)
 {
-    v2 result;
-
-    result.x = a.x * b.x;
-    result.y = a.y * b.y;
-
-    return (result);
+#ifdef VM_USE_AVX2
+    return (_mm_fmadd_ps(a, b, c));
+#else
+    return (vm_f32x4_add(vm_f32x4_mul(a, b), c));
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_mulf(v2 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x4_min(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_min_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x * b;
-    result.y = a.y * b;
+    result.e[0] = vm_minf(a.e[0], b.e[0]);
+    result.e[1] = vm_minf(a.e[1], b.e[1]);
+    result.e[2] = vm_minf(a.e[2], b.e[2]);
+    result.e[3] = vm_minf(a.e[3], b.e[3]);
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_div(v2 a, v2 b)
+VM_API VM_INLINE f32x4 vm_f32x4_max(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_max_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x / b.x;
-    result.y = a.y / b.y;
+    result.e[0] = vm_maxf(a.e[0], b.e[0]);
+    result.e[1] = vm_maxf(a.e[1], b.e[1]);
+    result.e[2] = vm_maxf(a.e[2], b.e[2]);
+    result.e[3] = vm_maxf(a.e[3], b.e[3]);
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE v2 vm_v2_divf(v2 a, float b)
+/* Lane masks: every compare returns all bits set for lanes where the condition is true */
+VM_API VM_INLINE f32x4 vm_f32x4_cmplt(f32x4 a, f32x4 b)
 {
-    v2 result;
+#ifdef VM_USE_SSE
+    return (_mm_cmplt_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = a.x / b;
-    result.y = a.y / b;
+    result.u[0] = (a.e[0] < b.e[0]) ? 0xFFFFFFFFU : 0U;
+    result.u[1] = (a.e[1] < b.e[1]) ? 0xFFFFFFFFU : 0U;
+    result.u[2] = (a.e[2] < b.e[2]) ? 0xFFFFFFFFU : 0U;
+    result.u[3] = (a.e[3] < b.e[3]) ? 0xFFFFFFFFU : 0U;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE float vm_v2_length(v2 a)
-{
-    return (vm_sqrtf(a.x * a.x + a.y * a.y));
-}
-
-VM_API VM_INLINE float vm_v2_length_manhatten(v2 start, v2 end, float unit)
+VM_API VM_INLINE f32x4 vm_f32x4_cmpeq(f32x4 a, f32x4 b)
 {
-    return ((vm_absf(start.x - end.x) + vm_absf(start.y - end.y)) / (unit == 0.0f ? 1.0f : unit));
-}
-
-/* #############################################################################
- * # VECTOR 3 FUNCTIONS
- * #############################################################################
- */
-#define VM_V3_ELEMENT_COUNT 3
-
-#ifdef VM_LEFT_HAND_LAYOUT
-#define VM_FORWARD 1.0f
-#define VM_BACKWARD -1.0f
+#ifdef VM_USE_SSE
+    return (_mm_cmpeq_ps(a, b));
 #else
-#define VM_FORWARD -1.0f /* OpenGL layout */
-#define VM_BACKWARD 1.0f /* OpenGL layout */
-#endif
+    f32x4 result;
 
-typedef struct v3
-{
-    float x;
-    float y;
-    float z;
-} VM_ALIGN_16 v3;
+    result.u[0] = (a.e[0] == b.e[0]) ? 0xFFFFFFFFU : 0U;
+    result.u[1] = (a.e[1] == b.e[1]) ? 0xFFFFFFFFU : 0U;
+    result.u[2] = (a.e[2] == b.e[2]) ? 0xFFFFFFFFU : 0U;
+    result.u[3] = (a.e[3] == b.e[3]) ? 0xFFFFFFFFU : 0U;
 
-static const v3 vm_v3_zero = {0.0f, 0.0f, 0.0f};
-static const v3 vm_v3_one = {1.0f, 1.0f, 1.0f};
-static const v3 vm_v3_forward = {0.0f, 0.0f, VM_FORWARD};
-static const v3 vm_v3_back = {0.0f, 0.0f, VM_BACKWARD};
-static const v3 vm_v3_up = {0.0f, 1.0f, 0.0f};
-static const v3 vm_v3_down = {0.0f, -1.0f, 0.0f};
-static const v3 vm_v3_left = {-1.0f, 0.0f, 0.0};
-static const v3 vm_v3_right = {1.0f, 0.0f, 0.0f};
+    return (result);
+#endif
+}
 
-VM_API VM_INLINE v3 vm_v3(float x, float y, float z)
+VM_API VM_INLINE f32x4 vm_f32x4_cmpgt(f32x4 a, f32x4 b)
 {
-    v3 result;
-
-    result.x = x;
-    result.y = y;
-    result.z = z;
-
-    return (result);
+    return (vm_f32x4_cmplt(b, a));
 }
 
-VM_API VM_INLINE v3 vm_v3f(float c)
+VM_API VM_INLINE f32x4 vm_f32x4_cmple(f32x4 a, f32x4 b)
 {
-    v3 result;
+#ifdef VM_USE_SSE
+    return (_mm_cmple_ps(a, b));
+#else
+    f32x4 result;
 
-    result.x = c;
-    result.y = c;
-    result.z = c;
+    result.u[0] = (a.e[0] <= b.e[0]) ? 0xFFFFFFFFU : 0U;
+    result.u[1] = (a.e[1] <= b.e[1]) ? 0xFFFFFFFFU : 0U;
+    result.u[2] = (a.e[2] <= b.e[2]) ? 0xFFFFFFFFU : 0U;
+    result.u[3] = (a.e[3] <= b.e[3]) ? 0xFFFFFFFFU : 0U;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE float *vm_v3_data(v3 *a)
-{
-    return ((float *)a);
-}
-
-VM_API VM_INLINE int vm_v3_equals(v3 a, v3 b)
+VM_API VM_INLINE f32x4 vm_f32x4_cmpge(f32x4 a, f32x4 b)
 {
-    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z)) ? 1 : 0);
+    return (vm_f32x4_cmple(b, a));
 }
 
-VM_API VM_INLINE v3 vm_v3_add(v3 a, v3 b)
+VM_API VM_INLINE f32x4 vm_f32x4_and(f32x4 a, f32x4 b)
 {
 #ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+    return (_mm_and_ps(a, b));
 #else
-    v3 result;
+    f32x4 result;
 
-    result.x = a.x + b.x;
-    result.y = a.y + b.y;
-    result.z = a.z + b.z;
+    result.u[0] = a.u[0] & b.u[0];
+    result.u[1] = a.u[1] & b.u[1];
+    result.u[2] = a.u[2] & b.u[2];
+    result.u[3] = a.u[3] & b.u[3];
 
     return (result);
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_addf(v3 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x4_or(f32x4 a, f32x4 b)
 {
 #ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+    return (_mm_or_ps(a, b));
 #else
-    v3 result;
+    f32x4 result;
 
-    result.x = a.x + b;
-    result.y = a.y + b;
-    result.z = a.z + b;
+    result.u[0] = a.u[0] | b.u[0];
+    result.u[1] = a.u[1] | b.u[1];
+    result.u[2] = a.u[2] | b.u[2];
+    result.u[3] = a.u[3] | b.u[3];
 
     return (result);
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_sub(v3 a, v3 b)
+/* Returns (~a & b) */
+VM_API VM_INLINE f32x4 vm_f32x4_andnot(f32x4 a, f32x4 b)
 {
 #ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+    return (_mm_andnot_ps(a, b));
 #else
-    v3 result;
+    f32x4 result;
 
-    result.x = a.x - b.x;
-    result.y = a.y - b.y;
-    result.z = a.z - b.z;
+    result.u[0] = ~a.u[0] & b.u[0];
+    result.u[1] = ~a.u[1] & b.u[1];
+    result.u[2] = ~a.u[2] & b.u[2];
+    result.u[3] = ~a.u[3] & b.u[3];
 
     return (result);
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_subf(v3 a, float b)
+/* Picks a for lanes where mask is set, otherwise b */
+VM_API VM_INLINE f32x4 vm_f32x4_select(f32x4 mask, f32x4 a, f32x4 b)
+{
+    return (vm_f32x4_or(vm_f32x4_and(mask, a), vm_f32x4_andnot(mask, b)));
+}
+
+/* Returns the sign bit of every lane packed into the lowest 4 bits */
+VM_API VM_INLINE int vm_f32x4_movemask(f32x4 a)
 {
 #ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+    return (_mm_movemask_ps(a));
 #else
-    v3 result;
-
-    result.x = a.x - b;
-    result.y = a.y - b;
-    result.z = a.z - b;
-
-    return (result);
+    return ((int)((a.u[0] >> 31) | ((a.u[1] >> 31) << 1) | ((a.u[2] >> 31) << 2) | ((a.u[3] >> 31) << 3)));
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_mul(v3 a, v3 b)
+/* Same approximation and Newton-Raphson step as vm_invsqrt so lane results match the scalar ones */
+VM_API VM_INLINE f32x4 vm_f32x4_invsqrt(f32x4 a)
 {
 #ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+    __m128 y = _mm_rsqrt_ps(a);
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 xhalf = _mm_mul_ps(a, _mm_set1_ps(0.5f));
+    __m128 sub = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(xhalf, y2));
+    return (_mm_mul_ps(y, sub));
 #else
-    v3 result;
+    f32x4 result;
 
-    result.x = a.x * b.x;
-    result.y = a.y * b.y;
-    result.z = a.z * b.z;
+    result.e[0] = vm_invsqrt(a.e[0]);
+    result.e[1] = vm_invsqrt(a.e[1]);
+    result.e[2] = vm_invsqrt(a.e[2]);
+    result.e[3] = vm_invsqrt(a.e[3]);
 
     return (result);
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_mulf(v3 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x4_sqrt(f32x4 a)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v3 result;
+    return (vm_f32x4_mul(a, vm_f32x4_invsqrt(a)));
+}
 
-    result.x = a.x * b;
-    result.y = a.y * b;
-    result.z = a.z * b;
+#define VM_F32X8_WIDTH 8
 
-    return (result);
+/* A f32x8 holds 8 independent float lanes. With VM_USE_AVX2 it maps directly
+   to a AVX register, otherwise it is built from two f32x4 halves. */
+#ifdef VM_USE_AVX2
+typedef __m256 f32x8;
+#else
+typedef struct f32x8
+{
+    f32x4 lo;
+    f32x4 hi;
+} f32x8;
 #endif
-}
 
-VM_API VM_INLINE v3 vm_v3_div(v3 a, v3 b)
+VM_API VM_INLINE f32x8 vm_f32x8_combine(f32x4 lo, f32x4 hi)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+#ifdef VM_USE_AVX2
+    return (_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
 #else
-    v3 result;
+    f32x8 result;
 
-    result.x = a.x / b.x;
-    result.y = a.y / b.y;
-    result.z = a.z / b.z;
+    result.lo = lo;
+    result.hi = hi;
 
     return (result);
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_divf(v3 a, float b)
+VM_API VM_INLINE f32x4 vm_f32x8_lo(f32x8 a)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
-    v3 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
+#ifdef VM_USE_AVX2
+    return (_mm256_castps256_ps128(a));
 #else
-    v3 result;
+    return (a.lo);
+#endif
+}
 
-    result.x = a.x / b;
-    result.y = a.y / b;
-    result.z = a.z / b;
+VM_API VM_INLINE f32x4 vm_f32x8_hi(f32x8 a)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_extractf128_ps(a, 1));
+#else
+    return (a.hi);
+#endif
+}
 
-    return (result);
+VM_API VM_INLINE f32x8 vm_f32x8_set1(float a)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_set1_ps(a));
+#else
+    f32x4 b = vm_f32x4_set1(a);
+    return (vm_f32x8_combine(b, b));
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_cross(v3 a, v3 b)
+VM_API VM_INLINE f32x8 vm_f32x8_load(const float *a)
 {
-    v3 result;
+#ifdef VM_USE_AVX2
+    return (_mm256_loadu_ps(a));
+#else
+    return (vm_f32x8_combine(vm_f32x4_load(a), vm_f32x4_load(a + VM_F32X4_WIDTH)));
+#endif
+}
 
-    result.x = (a.y * b.z) - (a.z * b.y);
-    result.y = (a.z * b.x) - (a.x * b.z);
-    result.z = (a.x * b.y) - (a.y * b.x);
+VM_API VM_INLINE void vm_f32x8_store(float *dst, f32x8 a)
+{
+#ifdef VM_USE_AVX2
+    _mm256_storeu_ps(dst, a);
+#else
+    vm_f32x4_store(dst, a.lo);
+    vm_f32x4_store(dst + VM_F32X4_WIDTH, a.hi);
+#endif
+}
 
-    return (result);
+VM_API VM_INLINE f32x8 vm_f32x8_add(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_add_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_add(a.lo, b.lo), vm_f32x4_add(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE float vm_v3_dot(v3 a, v3 b)
+VM_API VM_INLINE f32x8 vm_f32x8_sub(f32x8 a, f32x8 b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 mul = _mm_mul_ps(a_vec, b_vec);
-    __m128 shuf = _mm_shuffle_ps(mul, mul, _MM_SHUFFLE(2, 3, 0, 1));
-    __m128 sum = _mm_add_ss(mul, shuf);
+#ifdef VM_USE_AVX2
+    return (_mm256_sub_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_sub(a.lo, b.lo), vm_f32x4_sub(a.hi, b.hi)));
+#endif
+}
 
-    float result;
+VM_API VM_INLINE f32x8 vm_f32x8_mul(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_mul_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_mul(a.lo, b.lo), vm_f32x4_mul(a.hi, b.hi)));
+#endif
+}
 
-    shuf = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 2));
-    sum = _mm_add_ss(sum, shuf);
-    _mm_store_ss(&result, sum);
-    return result;
+VM_API VM_INLINE f32x8 vm_f32x8_div(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_div_ps(a, b));
 #else
-    return ((a.x * b.x) + (a.y * b.y) + (a.z * b.z));
+    return (vm_f32x8_combine(vm_f32x4_div(a.lo, b.lo), vm_f32x4_div(a.hi, b.hi)));
 #endif
 }
 
-VM_API VM_INLINE v3 vm_v3_normalize(v3 a)
+/* Returns (a * b) + c, with VM_USE_AVX2 as a single fused multiply-add */
+VM_API VM_INLINE f32x8 vm_f32x8_madd(f32x8 a, f32x8 b, f32x8 c)
 {
-    float length_squared = (a.x * a.x) + (a.y * a.y) + (a.z * a.z);
-    float scalar = (length_squared > 0.0f) ? vm_invsqrt(length_squared) : 0.0f;
+#ifdef VM_USE_AVX2
+    return (_mm256_fmadd_ps(a, b, c));
+#else
+    return (vm_f32x8_combine(vm_f32x4_madd(a.lo, b.lo, c.lo), vm_f32x4_madd(a.hi, b.hi, c.hi)));
+#endif
+}
 
-    v3 result;
+VM_API VM_INLINE f32x8 vm_f32x8_min(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_min_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_min(a.lo, b.lo), vm_f32x4_min(a.hi, b.hi)));
+#endif
+}
 
-    result.x = a.x * scalar;
-    result.y = a.y * scalar;
-    result.z = a.z * scalar;
+VM_API VM_INLINE f32x8 vm_f32x8_max(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_max_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_max(a.lo, b.lo), vm_f32x4_max(a.hi, b.hi)));
+#endif
+}
 
-    return (result);
+/* Lane masks: every compare returns all bits set for lanes where the condition is true */
+VM_API VM_INLINE f32x8 vm_f32x8_cmplt(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+#else
+    return (vm_f32x8_combine(vm_f32x4_cmplt(a.lo, b.lo), vm_f32x4_cmplt(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE float vm_v3_length(v3 a)
+VM_API VM_INLINE f32x8 vm_f32x8_cmpeq(f32x8 a, f32x8 b)
 {
-    return (vm_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z));
+#ifdef VM_USE_AVX2
+    return (_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+#else
+    return (vm_f32x8_combine(vm_f32x4_cmpeq(a.lo, b.lo), vm_f32x4_cmpeq(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE v3 vm_v3_lerp(v3 a, v3 b, float t)
+VM_API VM_INLINE f32x8 vm_f32x8_cmpgt(f32x8 a, f32x8 b)
 {
-    v3 result;
+    return (vm_f32x8_cmplt(b, a));
+}
 
-    if (t <= 0.0f)
-    {
-        return a;
-    }
-    else if (t >= 1.0f)
-    {
-        return b;
-    }
+VM_API VM_INLINE f32x8 vm_f32x8_cmple(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_cmp_ps(a, b, _CMP_LE_OQ));
+#else
+    return (vm_f32x8_combine(vm_f32x4_cmple(a.lo, b.lo), vm_f32x4_cmple(a.hi, b.hi)));
+#endif
+}
 
-    result.x = ((b.x - a.x) * t) + a.x;
-    result.y = ((b.y - a.y) * t) + a.y;
-    result.z = ((b.z - a.z) * t) + a.z;
+VM_API VM_INLINE f32x8 vm_f32x8_cmpge(f32x8 a, f32x8 b)
+{
+    return (vm_f32x8_cmple(b, a));
+}
 
-    return (result);
+VM_API VM_INLINE f32x8 vm_f32x8_and(f32x8 a, f32x8 b)
+{
+#ifdef VM_USE_AVX2
+    return (_mm256_and_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_and(a.lo, b.lo), vm_f32x4_and(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE float vm_v3_length_manhatten(v3 start, v3 end, float unit)
+VM_API VM_INLINE f32x8 vm_f32x8_or(f32x8 a, f32x8 b)
 {
-    return ((vm_absf(start.x - end.x) + vm_absf(start.y - end.y) + vm_absf(start.z - end.z)) / (unit == 0.0f ? 1.0f : unit));
+#ifdef VM_USE_AVX2
+    return (_mm256_or_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_or(a.lo, b.lo), vm_f32x4_or(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE v3 vm_v3_reflect(v3 incident, v3 normal)
+/* Returns (~a & b) */
+VM_API VM_INLINE f32x8 vm_f32x8_andnot(f32x8 a, f32x8 b)
 {
-    float dot = vm_v3_dot(incident, normal);
-    return (vm_v3_sub(incident, vm_v3_mulf(normal, 2.0f * dot)));
+#ifdef VM_USE_AVX2
+    return (_mm256_andnot_ps(a, b));
+#else
+    return (vm_f32x8_combine(vm_f32x4_andnot(a.lo, b.lo), vm_f32x4_andnot(a.hi, b.hi)));
+#endif
 }
 
-VM_API VM_INLINE v3 vm_v3_project(v3 a, v3 b)
+/* Picks a for lanes where mask is set, otherwise b */
+VM_API VM_INLINE f32x8 vm_f32x8_select(f32x8 mask, f32x8 a, f32x8 b)
 {
-    float dotAB = vm_v3_dot(a, b);
-    float dotBB = vm_v3_dot(b, b);
-    return (vm_v3_mulf(b, dotAB / dotBB));
+#ifdef VM_USE_AVX2
+    return (_mm256_blendv_ps(b, a, mask));
+#else
+    return (vm_f32x8_or(vm_f32x8_and(mask, a), vm_f32x8_andnot(mask, b)));
+#endif
 }
 
-VM_API VM_INLINE float vm_v3_angle(v3 a, v3 b)
+/* Returns the sign bit of every lane packed into the lowest 8 bits */
+VM_API VM_INLINE int vm_f32x8_movemask(f32x8 a)
 {
-    float dot = vm_v3_dot(vm_v3_normalize(a), vm_v3_normalize(b));
-    return (vm_acosf(vm_clampf(dot, -1.0f, 1.0f)));
+#ifdef VM_USE_AVX2
+    return (_mm256_movemask_ps(a));
+#else
+    return (vm_f32x4_movemask(a.lo) | (vm_f32x4_movemask(a.hi) << 4));
+#endif
 }
 
-VM_API VM_INLINE float vm_v3_distance(v3 a, v3 b)
+/* Same approximation and Newton-Raphson step as vm_invsqrt so lane results match the scalar ones */
+VM_API VM_INLINE f32x8 vm_f32x8_invsqrt(f32x8 a)
 {
-    v3 d = vm_v3_sub(a, b);
-    return (vm_sqrtf(vm_v3_dot(d, d)));
+#ifdef VM_USE_AVX2
+    __m256 y = _mm256_rsqrt_ps(a);
+    __m256 y2 = _mm256_mul_ps(y, y);
+    __m256 xhalf = _mm256_mul_ps(a, _mm256_set1_ps(0.5f));
+    __m256 sub = _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(xhalf, y2));
+    return (_mm256_mul_ps(y, sub));
+#else
+    return (vm_f32x8_combine(vm_f32x4_invsqrt(a.lo), vm_f32x4_invsqrt(a.hi)));
+#endif
+}
+
+VM_API VM_INLINE f32x8 vm_f32x8_sqrt(f32x8 a)
+{
+    return (vm_f32x8_mul(a, vm_f32x8_invsqrt(a)));
 }
 
 /* #############################################################################
- * # VECTOR 4 FUNCTIONS
+ * # VECTOR 2 FUNCTIONS
  * #############################################################################
  */
-#define VM_V4_ELEMENT_COUNT 4
+#define VM_V2_ELEMENT_COUNT 2
 
-typedef struct v4
+typedef struct v2
 {
     float x;
     float y;
-    float z;
-    float w;
-} VM_ALIGN_16 v4;
+} v2;
 
-static const v4 vm_v4_zero = {0.0f, 0.0f, 0.0f, 0.0f};
-static const v4 vm_v4_one = {1.0f, 1.0f, 1.0f, 1.0f};
+static const v2 vm_v2_zero = {0.0f, 0.0f};
+static const v2 vm_v2_one = {1.0f, 1.0f};
 
-VM_API VM_INLINE v4 vm_v4(float x, float y, float z, float w)
+VM_API VM_INLINE v2 vm_v2(float x, float y)
 {
-    v4 result;
+    v2 result;
 
     result.x = x;
     result.y = y;
-    result.z = z;
-    result.w = w;
 
     return (result);
 }
 
-VM_API VM_INLINE v4 vm_v4f(float c)
+VM_API VM_INLINE v2 vm_v2f(float c)
 {
-    v4 result;
+    v2 result;
 
     result.x = c;
     result.y = c;
-    result.z = c;
-    result.w = c;
 
     return (result);
 }
 
-VM_API VM_INLINE float *vm_v4_data(v4 *a)
+VM_API VM_INLINE float *vm_v2_data(v2 *a)
 {
     return ((float *)a);
 }
 
-VM_API VM_INLINE int vm_v4_equals(v4 a, v4 b)
+VM_API VM_INLINE int vm_v2_equals(v2 a, v2 b)
 {
-    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.w == b.w)) ? 1 : 0);
+    return (((a.x == b.x) && (a.y == b.y)) ? 1 : 0);
 }
 
-VM_API VM_INLINE v4 vm_v4_add(v4 a, v4 b)
+VM_API VM_INLINE v2 vm_v2_add(v2 a, v2 b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x + b.x;
     result.y = a.y + b.y;
-    result.z = a.z + b.z;
-    result.w = a.w + b.w;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_addf(v4 a, float b)
+VM_API VM_INLINE v2 vm_v2_addf(v2 a, float b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x + b;
     result.y = a.y + b;
-    result.z = a.z + b;
-    result.w = a.w + b;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_sub(v4 a, v4 b)
+VM_API VM_INLINE v2 vm_v2_sub(v2 a, v2 b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x - b.x;
     result.y = a.y - b.y;
-    result.z = a.z - b.z;
-    result.w = a.w - b.w;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_subf(v4 a, float b)
+VM_API VM_INLINE v2 vm_v2_subf(v2 a, float b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x - b;
     result.y = a.y - b;
-    result.z = a.z - b;
-    result.w = a.w - b;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_mul(v4 a, v4 b)
+VM_API VM_INLINE v2 vm_v2_mul(v2 a, v2 b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x * b.x;
     result.y = a.y * b.y;
-    result.z = a.z * b.z;
-    result.w = a.w * b.w;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_mulf(v4 a, float b)
+VM_API VM_INLINE v2 vm_v2_mulf(v2 a, float b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x * b;
     result.y = a.y * b;
-    result.z = a.z * b;
-    result.w = a.w * b;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_div(v4 a, v4 b)
+VM_API VM_INLINE v2 vm_v2_div(v2 a, v2 b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_loadu_ps((float *)&b);
-    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x / b.x;
     result.y = a.y / b.y;
-    result.z = a.z / b.z;
-    result.w = a.w / b.w;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE v4 vm_v4_divf(v4 a, float b)
+VM_API VM_INLINE v2 vm_v2_divf(v2 a, float b)
 {
-#ifdef VM_USE_SSE
-    __m128 a_vec = _mm_loadu_ps((float *)&a);
-    __m128 b_vec = _mm_set1_ps(b);
-    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
-    v4 result;
-    _mm_storeu_ps((float *)&result, result_vec);
-    return result;
-#else
-    v4 result;
+    v2 result;
 
     result.x = a.x / b;
     result.y = a.y / b;
-    result.z = a.z / b;
-    result.w = a.w / b;
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE float vm_v4_dot(v4 v1, v4 v2)
+VM_API VM_INLINE float vm_v2_length(v2 a)
 {
-    return ((v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z) + (v1.w * v2.w));
+    return (vm_sqrtf(a.x * a.x + a.y * a.y));
 }
 
-VM_API VM_INLINE float vm_v4_length(v4 a)
+VM_API VM_INLINE float vm_v2_length_manhatten(v2 start, v2 end, float unit)
 {
-    return (vm_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w));
+    return ((vm_absf(start.x - end.x) + vm_absf(start.y - end.y)) / (unit == 0.0f ? 1.0f : unit));
 }
 
 /* #############################################################################
- * # MATRIX 4x4 FUNCTIONS
+ * # VECTOR 3 FUNCTIONS
  * #############################################################################
  */
-#define VM_M4X4_ELEMENT_COUNT 16
+#define VM_V3_ELEMENT_COUNT 3
 
-#ifdef VM_M4X4_ROW_MAJOR_ORDER
-#define VM_M4X4_AT(row, col) ((row) * 4 + (col)) /* Row-major order */
+#ifdef VM_LEFT_HAND_LAYOUT
+#define VM_FORWARD 1.0f
+#define VM_BACKWARD -1.0f
 #else
-#define VM_M4X4_AT(row, col) ((col) * 4 + (row)) /* Column-major order */
+#define VM_FORWARD -1.0f /* OpenGL layout */
+#define VM_BACKWARD 1.0f /* OpenGL layout */
 #endif
 
-typedef struct m4x4
-{
-    float e[VM_M4X4_ELEMENT_COUNT];
-} m4x4;
-
-static const m4x4 vm_m4x4_zero =
-    {{0.0f, 0.0f, 0.0f, 0.0f,
-      0.0f, 0.0f, 0.0f, 0.0f,
-      0.0f, 0.0f, 0.0f, 0.0f,
-      0.0f, 0.0f, 0.0f, 0.0f}};
-
-static const m4x4 vm_m4x4_identity =
-    {{1.0f, 0.0f, 0.0f, 0.0f,
-      0.0f, 1.0f, 0.0f, 0.0f,
-      0.0f, 0.0f, 1.0f, 0.0f,
-      0.0f, 0.0f, 0.0f, 1.0f}};
-
-VM_API VM_INLINE m4x4 vm_m4x4_mul(m4x4 a, m4x4 b)
+#ifdef VM_SIMD_STORAGE
+/* The v3 lives in a SSE register, the w lane is kept at 0.0f */
+typedef union v3
 {
-#ifdef VM_USE_SSE
-#ifdef VM_M4X4_ROW_MAJOR_ORDER
-    m4x4 result;
-    int i;
-    for (i = 0; i < 4; ++i)
+    VM_EXTENSION struct
     {
-        float *ar = &a.e[VM_M4X4_AT(i, 0)];
-        __m128 arow = _mm_loadu_ps(ar); /* a0 a1 a2 a3 */
+        float x;
+        float y;
+        float z;
+        float w;
+    };
+    __m128 m;
+} v3;
+#else
+typedef struct v3
+{
+    float x;
+    float y;
+    float z;
+} VM_ALIGN_16 v3;
+#endif
 
-        __m128 brow0 = _mm_loadu_ps(&b.e[VM_M4X4_AT(0, 0)]);
-        __m128 brow1 = _mm_loadu_ps(&b.e[VM_M4X4_AT(1, 0)]);
-        __m128 brow2 = _mm_loadu_ps(&b.e[VM_M4X4_AT(2, 0)]);
-        __m128 brow3 = _mm_loadu_ps(&b.e[VM_M4X4_AT(3, 0)]);
+/* Initializer for constant v3 values that works with and without VM_SIMD_STORAGE */
+#ifdef VM_SIMD_STORAGE
+#define VM_V3_CONST(x, y, z) {{(x), (y), (z), 0.0f}}
+#else
+#define VM_V3_CONST(x, y, z) {(x), (y), (z)}
+#endif
 
-        /* broadcast each scalar from arow and multiply-add */
-        __m128 t0 = _mm_mul_ps(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(0, 0, 0, 0)), brow0);
-        __m128 t1 = _mm_mul_ps(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(1, 1, 1, 1)), brow1);
-        __m128 t2 = _mm_mul_ps(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(2, 2, 2, 2)), brow2);
-        __m128 t3 = _mm_mul_ps(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(3, 3, 3, 3)), brow3);
+static const v3 vm_v3_zero = VM_V3_CONST(0.0f, 0.0f, 0.0f);
+static const v3 vm_v3_one = VM_V3_CONST(1.0f, 1.0f, 1.0f);
+static const v3 vm_v3_forward = VM_V3_CONST(0.0f, 0.0f, VM_FORWARD);
+static const v3 vm_v3_back = VM_V3_CONST(0.0f, 0.0f, VM_BACKWARD);
+static const v3 vm_v3_up = VM_V3_CONST(0.0f, 1.0f, 0.0f);
+static const v3 vm_v3_down = VM_V3_CONST(0.0f, -1.0f, 0.0f);
+static const v3 vm_v3_left = VM_V3_CONST(-1.0f, 0.0f, 0.0f);
+static const v3 vm_v3_right = VM_V3_CONST(1.0f, 0.0f, 0.0f);
 
-        __m128 sum01 = _mm_add_ps(t0, t1);
-        __m128 sum23 = _mm_add_ps(t2, t3);
-        __m128 sum = _mm_add_ps(sum01, sum23);
+VM_API VM_INLINE v3 vm_v3(float x, float y, float z)
+{
+    v3 result;
 
-        _mm_storeu_ps(&result.e[VM_M4X4_AT(i, 0)], sum);
-    }
-    return result;
+#ifdef VM_SIMD_STORAGE
+    result.m = _mm_set_ps(0.0f, z, y, x);
 #else
-    m4x4 result;
-    int j;
-    for (j = 0; j < 4; ++j)
-    {
-        float *bc = &b.e[VM_M4X4_AT(0, j)]; /* contiguous column */
-        __m128 bcol = _mm_loadu_ps(bc);     /* b0 b1 b2 b3 - elements of column j */
-
-        __m128 acol0 = _mm_loadu_ps(&a.e[VM_M4X4_AT(0, 0)]); /* column 0 */
-        __m128 acol1 = _mm_loadu_ps(&a.e[VM_M4X4_AT(0, 1)]); /* column 1 */
-        __m128 acol2 = _mm_loadu_ps(&a.e[VM_M4X4_AT(0, 2)]); /* column 2 */
-        __m128 acol3 = _mm_loadu_ps(&a.e[VM_M4X4_AT(0, 3)]); /* column 3 */
+    result.x = x;
+    result.y = y;
+    result.z = z;
+#endif
 
-        /* broadcast each scalar from bcol and multiply-add */
-        __m128 t0 = _mm_mul_ps(_mm_shuffle_ps(bcol, bcol, _MM_SHUFFLE(0, 0, 0, 0)), acol0);
-        __m128 t1 = _mm_mul_ps(_mm_shuffle_ps(bcol, bcol, _MM_SHUFFLE(1, 1, 1, 1)), acol1);
-        __m128 t2 = _mm_mul_ps(_mm_shuffle_ps(bcol, bcol, _MM_SHUFFLE(2, 2, 2, 2)), acol2);
-        __m128 t3 = _mm_mul_ps(_mm_shuffle_ps(bcol, bcol, _MM_SHUFFLE(3, 3, 3, 3)), acol3);
+    return (result);
+}
 
-        __m128 sum01 = _mm_add_ps(t0, t1);
-        __m128 sum23 = _mm_add_ps(t2, t3);
-        __m128 sum = _mm_add_ps(sum01, sum23);
+VM_API VM_INLINE v3 vm_v3f(float c)
+{
+    v3 result;
 
-        _mm_storeu_ps(&result.e[VM_M4X4_AT(0, j)], sum);
-    }
-    return result;
-#endif
+#ifdef VM_SIMD_STORAGE
+    result.m = _mm_set_ps(0.0f, c, c, c);
 #else
-    m4x4 result;
-
-    int i = 0;
-    for (; i < 4; ++i)
-    {
-        float a0 = a.e[VM_M4X4_AT(i, 0)];
-        float a1 = a.e[VM_M4X4_AT(i, 1)];
-        float a2 = a.e[VM_M4X4_AT(i, 2)];
-        float a3 = a.e[VM_M4X4_AT(i, 3)];
-
-        result.e[VM_M4X4_AT(i, 0)] = a0 * b.e[VM_M4X4_AT(0, 0)] + a1 * b.e[VM_M4X4_AT(1, 0)] + a2 * b.e[VM_M4X4_AT(2, 0)] + a3 * b.e[VM_M4X4_AT(3, 0)];
-        result.e[VM_M4X4_AT(i, 1)] = a0 * b.e[VM_M4X4_AT(0, 1)] + a1 * b.e[VM_M4X4_AT(1, 1)] + a2 * b.e[VM_M4X4_AT(2, 1)] + a3 * b.e[VM_M4X4_AT(3, 1)];
-        result.e[VM_M4X4_AT(i, 2)] = a0 * b.e[VM_M4X4_AT(0, 2)] + a1 * b.e[VM_M4X4_AT(1, 2)] + a2 * b.e[VM_M4X4_AT(2, 2)] + a3 * b.e[VM_M4X4_AT(3, 2)];
-        result.e[VM_M4X4_AT(i, 3)] = a0 * b.e[VM_M4X4_AT(0, 3)] + a1 * b.e[VM_M4X4_AT(1, 3)] + a2 * b.e[VM_M4X4_AT(2, 3)] + a3 * b.e[VM_M4X4_AT(3, 3)];
-    }
+    result.x = c;
+    result.y = c;
+    result.z = c;
+#endif
 
     return (result);
-#endif
 }
 
-VM_API VM_INLINE int vm_m4x4_equals(m4x4 a, m4x4 b)
-{
 #ifdef VM_USE_SSE
-    int i;
-    for (i = 0; i < 4; ++i)
-    {
-        __m128 va = _mm_loadu_ps(&a.e[i * 4]);
-        __m128 vb = _mm_loadu_ps(&b.e[i * 4]);
-        __m128 cmp = _mm_cmpeq_ps(va, vb);
-        int mask = _mm_movemask_ps(cmp);
-        if ((mask & 0xF) != 0xF)
-        {
-            return 0;
-        }
-    }
-    return 1;
+/* Returns the v3 as SSE register (no memory round trip with VM_SIMD_STORAGE) */
+VM_API VM_INLINE __m128 vm_v3_m128(v3 a)
+{
+#ifdef VM_SIMD_STORAGE
+    return (a.m);
 #else
-    return (
-        a.e[VM_M4X4_AT(0, 0)] == b.e[VM_M4X4_AT(0, 0)] &&
-        a.e[VM_M4X4_AT(0, 1)] == b.e[VM_M4X4_AT(0, 1)] &&
-        a.e[VM_M4X4_AT(0, 2)] == b.e[VM_M4X4_AT(0, 2)] &&
-        a.e[VM_M4X4_AT(0, 3)] == b.e[VM_M4X4_AT(0, 3)] &&
-
-        a.e[VM_M4X4_AT(1, 0)] == b.e[VM_M4X4_AT(1, 0)] &&
-        a.e[VM_M4X4_AT(1, 1)] == b.e[VM_M4X4_AT(1, 1)] &&
-        a.e[VM_M4X4_AT(1, 2)] == b.e[VM_M4X4_AT(1, 2)] &&
-        a.e[VM_M4X4_AT(1, 3)] == b.e[VM_M4X4_AT(1, 3)] &&
-
-        a.e[VM_M4X4_AT(2, 0)] == b.e[VM_M4X4_AT(2, 0)] &&
-        a.e[VM_M4X4_AT(2, 1)] == b.e[VM_M4X4_AT(2, 1)] &&
-        a.e[VM_M4X4_AT(2, 2)] == b.e[VM_M4X4_AT(2, 2)] &&
-        a.e[VM_M4X4_AT(2, 3)] == b.e[VM_M4X4_AT(2, 3)] &&
-
-        a.e[VM_M4X4_AT(3, 0)] == b.e[VM_M4X4_AT(3, 0)] &&
-        a.e[VM_M4X4_AT(3, 1)] == b.e[VM_M4X4_AT(3, 1)] &&
-        a.e[VM_M4X4_AT(3, 2)] == b.e[VM_M4X4_AT(3, 2)] &&
-        a.e[VM_M4X4_AT(3, 3)] == b.e[VM_M4X4_AT(3, 3)]);
+    return (_mm_loadu_ps((float *)&a));
 #endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_perspective(float fov, float aspectRatio, float zNear, float zFar)
+VM_API VM_INLINE v3 vm_v3_from_m128(__m128 a)
 {
-    float f = 1.0f / vm_tanf(fov * 0.5f);
-    float fn = 1.0f / (zNear - zFar);
-
-    m4x4 result = vm_m4x4_zero;
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 0)] = f / aspectRatio;
-    result.e[VM_M4X4_AT(1, 1)] = f;
-    result.e[VM_M4X4_AT(2, 2)] = (zNear + zFar) * fn;
-    result.e[VM_M4X4_AT(2, 3)] = (2.0f * zNear * zFar) * fn;
-    result.e[VM_M4X4_AT(3, 2)] = -1.0f;
+#ifdef VM_SIMD_STORAGE
+    result.m = a;
+#else
+    _mm_storeu_ps((float *)&result, a);
+#endif
 
     return (result);
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_orthographic(float left, float right, float bottom, float top, float near, float far)
+/* Broadcasts b into x, y and z. With VM_SIMD_STORAGE the w lane is set to w
+ * so that the operation keeps the w lane of the result at 0.0f */
+VM_API VM_INLINE __m128 vm_v3_m128f(float b, float w)
 {
-    float width = right - left;
-    float height = top - bottom;
-    float depth = far - near;
-
-    m4x4 result = vm_m4x4_zero;
+#ifdef VM_SIMD_STORAGE
+    return (_mm_set_ps(w, b, b, b));
+#else
+    (void)w;
+    return (_mm_set1_ps(b));
+#endif
+}
+#endif
 
-    result.e[VM_M4X4_AT(0, 0)] = 2.0f / width;
-    result.e[VM_M4X4_AT(0, 3)] = -(right + left) / width;
-    result.e[VM_M4X4_AT(1, 1)] = 2.0f / height;
-    result.e[VM_M4X4_AT(1, 3)] = -(top + bottom) / height;
-    result.e[VM_M4X4_AT(2, 2)] = -2.0f / depth;
-    result.e[VM_M4X4_AT(2, 3)] = -(far + near) / depth;
-    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+VM_API VM_INLINE float *vm_v3_data(v3 *a)
+{
+    return ((float *)a);
+}
 
-    return (result);
+VM_API VM_INLINE int vm_v3_equals(v3 a, v3 b)
+{
+    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z)) ? 1 : 0);
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_rotation(v3 forward, v3 up, v3 right)
+VM_API VM_INLINE v3 vm_v3_add(v3 a, v3 b)
 {
-    m4x4 result = vm_m4x4_zero;
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128(b);
+    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 0)] = right.x;
-    result.e[VM_M4X4_AT(0, 1)] = right.y;
-    result.e[VM_M4X4_AT(0, 2)] = right.z;
-    result.e[VM_M4X4_AT(0, 3)] = 0.0f;
+    result.x = a.x + b.x;
+    result.y = a.y + b.y;
+    result.z = a.z + b.z;
 
-    result.e[VM_M4X4_AT(1, 0)] = up.x;
-    result.e[VM_M4X4_AT(1, 1)] = up.y;
-    result.e[VM_M4X4_AT(1, 2)] = up.z;
-    result.e[VM_M4X4_AT(1, 3)] = 0.0f;
+    return (result);
+#endif
+}
 
-    result.e[VM_M4X4_AT(2, 0)] = forward.x;
-    result.e[VM_M4X4_AT(2, 1)] = forward.y;
-    result.e[VM_M4X4_AT(2, 2)] = forward.z;
-    result.e[VM_M4X4_AT(2, 3)] = 0.0f;
+VM_API VM_INLINE v3 vm_v3_addf(v3 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128f(b, 0.0f);
+    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    result.e[VM_M4X4_AT(3, 0)] = 0.0f;
-    result.e[VM_M4X4_AT(3, 1)] = 0.0f;
-    result.e[VM_M4X4_AT(3, 2)] = 0.0f;
-    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+    result.x = a.x + b;
+    result.y = a.y + b;
+    result.z = a.z + b;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_translate(m4x4 src, v3 b)
+VM_API VM_INLINE v3 vm_v3_sub(v3 a, v3 b)
 {
-    m4x4 result = src;
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128(b);
+    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 3)] = b.x;
-    result.e[VM_M4X4_AT(1, 3)] = b.y;
-    result.e[VM_M4X4_AT(2, 3)] = b.z;
+    result.x = a.x - b.x;
+    result.y = a.y - b.y;
+    result.z = a.z - b.z;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_scale(m4x4 src, v3 factor)
+VM_API VM_INLINE v3 vm_v3_subf(v3 a, float b)
 {
-    m4x4 result = src;
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128f(b, 0.0f);
+    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 0)] = factor.x;
-    result.e[VM_M4X4_AT(1, 1)] = factor.y;
-    result.e[VM_M4X4_AT(2, 2)] = factor.z;
-    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+    result.x = a.x - b;
+    result.y = a.y - b;
+    result.z = a.z - b;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_scalef(m4x4 src, float factor)
+VM_API VM_INLINE v3 vm_v3_mul(v3 a, v3 b)
 {
-    m4x4 result = src;
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128(b);
+    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 0)] = factor;
-    result.e[VM_M4X4_AT(1, 1)] = factor;
-    result.e[VM_M4X4_AT(2, 2)] = factor;
-    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+    result.x = a.x * b.x;
+    result.y = a.y * b.y;
+    result.z = a.z * b.z;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_swap(m4x4 src)
+VM_API VM_INLINE v3 vm_v3_mulf(v3 a, float b)
 {
-    m4x4 result;
-    int i;
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128f(b, 0.0f);
+    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    for (i = 0; i < 4; ++i)
-    {
-        result.e[VM_M4X4_AT(i, 0)] = src.e[VM_M4X4_AT(0, i)];
-        result.e[VM_M4X4_AT(i, 1)] = src.e[VM_M4X4_AT(1, i)];
-        result.e[VM_M4X4_AT(i, 2)] = src.e[VM_M4X4_AT(2, i)];
-        result.e[VM_M4X4_AT(i, 3)] = src.e[VM_M4X4_AT(3, i)];
-    }
+    result.x = a.x * b;
+    result.y = a.y * b;
+    result.z = a.z * b;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_rotate(m4x4 src, float angle, v3 axis)
+VM_API VM_INLINE v3 vm_v3_div(v3 a, v3 b)
 {
-    float c = vm_cosf(angle);
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+#ifdef VM_SIMD_STORAGE
+    /* w lane of b is replaced by 1.0f so that 0.0f / 1.0f keeps w at 0.0f:
+       (b.z, 1.0f, b.w, 1.0f) supplies z and w for the final (x, y, z, 1.0f) */
+    __m128 b_zw = _mm_unpackhi_ps(vm_v3_m128(b), _mm_set1_ps(1.0f));
+    __m128 b_vec = _mm_shuffle_ps(vm_v3_m128(b), b_zw, _MM_SHUFFLE(1, 0, 1, 0));
+#else
+    __m128 b_vec = vm_v3_m128(b);
+#endif
+    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    v3 axisn = vm_v3_normalize(axis);
-    v3 v = vm_v3_mulf(axisn, 1.0f - c);
-    v3 vs = vm_v3_mulf(axisn, vm_sinf(angle));
+    result.x = a.x / b.x;
+    result.y = a.y / b.y;
+    result.z = a.z / b.z;
 
-    m4x4 rot = vm_m4x4_zero;
+    return (result);
+#endif
+}
 
-    v3 a;
-    v3 b;
-    v3 f;
+VM_API VM_INLINE v3 vm_v3_divf(v3 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128f(b, 1.0f);
+    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
+    return (vm_v3_from_m128(result_vec));
+#else
+    v3 result;
 
-    a = vm_v3_mulf(axisn, v.x);
-    rot.e[VM_M4X4_AT(0, 0)] = a.x;
-    rot.e[VM_M4X4_AT(1, 0)] = a.y;
-    rot.e[VM_M4X4_AT(2, 0)] = a.z;
+    result.x = a.x / b;
+    result.y = a.y / b;
+    result.z = a.z / b;
 
-    b = vm_v3_mulf(axisn, v.y);
-    rot.e[VM_M4X4_AT(0, 1)] = b.x;
-    rot.e[VM_M4X4_AT(1, 1)] = b.y;
-    rot.e[VM_M4X4_AT(2, 1)] = b.z;
+    return (result);
+#endif
+}
 
-    f = vm_v3_mulf(axisn, v.z);
-    rot.e[VM_M4X4_AT(0, 2)] = f.x;
-    rot.e[VM_M4X4_AT(1, 2)] = f.y;
-    rot.e[VM_M4X4_AT(2, 2)] = f.z;
+VM_API VM_INLINE v3 vm_v3_cross(v3 a, v3 b)
+{
+#ifdef VM_SIMD_STORAGE
+    /* (a * b.yzx - a.yzx * b).yzx, the w lane stays 0.0f */
+    __m128 a_yzx = _mm_shuffle_ps(a.m, a.m, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b.m, b.m, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a.m, b_yzx), _mm_mul_ps(a_yzx, b.m));
 
-    rot.e[VM_M4X4_AT(0, 0)] += c;
-    rot.e[VM_M4X4_AT(0, 1)] -= vs.z;
-    rot.e[VM_M4X4_AT(0, 2)] += vs.y;
-    rot.e[VM_M4X4_AT(1, 0)] += vs.z;
-    rot.e[VM_M4X4_AT(1, 1)] += c;
-    rot.e[VM_M4X4_AT(1, 2)] -= vs.x;
-    rot.e[VM_M4X4_AT(2, 0)] -= vs.y;
-    rot.e[VM_M4X4_AT(2, 1)] += vs.x;
-    rot.e[VM_M4X4_AT(2, 2)] += c;
+    v3 result;
 
-    rot.e[VM_M4X4_AT(3, 0)] = 0.0f;
-    rot.e[VM_M4X4_AT(3, 1)] = 0.0f;
-    rot.e[VM_M4X4_AT(3, 2)] = 0.0f;
-    rot.e[VM_M4X4_AT(0, 3)] = 0.0f;
-    rot.e[VM_M4X4_AT(1, 3)] = 0.0f;
-    rot.e[VM_M4X4_AT(2, 3)] = 0.0f;
-    rot.e[VM_M4X4_AT(3, 3)] = 1.0f;
+    result.m = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
 
-    return (vm_m4x4_mul(src, rot));
+    return (result);
+#else
+    v3 result;
+
+    result.x = (a.y * b.z) - (a.z * b.y);
+    result.y = (a.z * b.x) - (a.x * b.z);
+    result.z = (a.x * b.y) - (a.y * b.x);
+
+    return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_lookAt(v3 eye, v3 target, v3 up)
+VM_API VM_INLINE float vm_v3_dot(v3 a, v3 b)
 {
-    v3 f = vm_v3_normalize(vm_v3_sub(target, eye));
-    v3 s = vm_v3_normalize(vm_v3_cross(f, up));
-    v3 u = vm_v3_cross(s, f);
-
-    m4x4 result = vm_m4x4_zero;
+#if defined(VM_SIMD_STORAGE) && defined(VM_USE_SSE41)
+    /* Multiply x, y and z (0x70) and store the sum in lane 0 (0x01) */
+    return (_mm_cvtss_f32(_mm_dp_ps(a.m, b.m, 0x71)));
+#elif defined(VM_USE_AVX2)
+    /* Fused (x * x) + (y * y) + (z * z), does not touch the padding lane */
+    __m128 sum = _mm_mul_ss(_mm_set_ss(a.x), _mm_set_ss(b.x));
+    sum = _mm_fmadd_ss(_mm_set_ss(a.y), _mm_set_ss(b.y), sum);
+    sum = _mm_fmadd_ss(_mm_set_ss(a.z), _mm_set_ss(b.z), sum);
+    return (_mm_cvtss_f32(sum));
+#elif defined(VM_USE_SSE)
+    __m128 a_vec = vm_v3_m128(a);
+    __m128 b_vec = vm_v3_m128(b);
+    __m128 mul = _mm_mul_ps(a_vec, b_vec);
+    __m128 shuf = _mm_shuffle_ps(mul, mul, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sum = _mm_add_ss(mul, shuf);
 
-    result.e[VM_M4X4_AT(0, 0)] = s.x;
-    result.e[VM_M4X4_AT(0, 1)] = s.y;
-    result.e[VM_M4X4_AT(0, 2)] = s.z;
-    result.e[VM_M4X4_AT(0, 3)] = -vm_v3_dot(s, eye);
-    result.e[VM_M4X4_AT(1, 0)] = u.x;
-    result.e[VM_M4X4_AT(1, 1)] = u.y;
-    result.e[VM_M4X4_AT(1, 2)] = u.z;
-    result.e[VM_M4X4_AT(1, 3)] = -vm_v3_dot(u, eye);
-    result.e[VM_M4X4_AT(2, 0)] = -f.x;
-    result.e[VM_M4X4_AT(2, 1)] = -f.y;
-    result.e[VM_M4X4_AT(2, 2)] = -f.z;
-    result.e[VM_M4X4_AT(2, 3)] = vm_v3_dot(f, eye);
-    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+    float result;
 
-    return (result);
+    shuf = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 2));
+    sum = _mm_add_ss(sum, shuf);
+    _mm_store_ss(&result, sum);
+    return result;
+#else
+    return ((a.x * b.x) + (a.y * b.y) + (a.z * b.z));
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_lookAt_model(v3 eye, v3 target, v3 up)
+VM_API VM_INLINE v3 vm_v3_normalize(v3 a)
 {
-    v3 f = vm_v3_normalize(vm_v3_sub(target, eye));
-    v3 r = vm_v3_normalize(vm_v3_cross(up, f));
-    v3 u = vm_v3_cross(f, r);
+#ifdef VM_SIMD_STORAGE
+#ifdef VM_USE_SSE41
+    __m128 length_squared = _mm_dp_ps(a.m, a.m, 0x7F); /* x, y and z summed into all lanes */
+#else
+    __m128 squared = _mm_mul_ps(a.m, a.m);
+    __m128 length_squared = _mm_add_ps(
+        _mm_add_ps(_mm_shuffle_ps(squared, squared, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1))),
+        _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2)));
+#endif
+    __m128 y = _mm_rsqrt_ps(length_squared);
 
-    m4x4 result = vm_m4x4_identity;
+    v3 result;
 
-    result.e[VM_M4X4_AT(0, 0)] = r.x;
-    result.e[VM_M4X4_AT(1, 0)] = r.y;
-    result.e[VM_M4X4_AT(2, 0)] = r.z;
-    result.e[VM_M4X4_AT(0, 1)] = u.x;
-    result.e[VM_M4X4_AT(1, 1)] = u.y;
-    result.e[VM_M4X4_AT(2, 1)] = u.z;
-    result.e[VM_M4X4_AT(0, 2)] = f.x;
-    result.e[VM_M4X4_AT(1, 2)] = f.y;
-    result.e[VM_M4X4_AT(2, 2)] = f.z;
-    result.e[VM_M4X4_AT(0, 3)] = eye.x;
-    result.e[VM_M4X4_AT(1, 3)] = eye.y;
-    result.e[VM_M4X4_AT(2, 3)] = eye.z;
+    /* One iteration of Newton-Raphson refinement like vm_invsqrt, zero length stays zero */
+    y = _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(length_squared, _mm_set1_ps(0.5f)), _mm_mul_ps(y, y))));
+    y = _mm_and_ps(y, _mm_cmpgt_ps(length_squared, _mm_setzero_ps()));
+
+    result.m = _mm_mul_ps(a.m, y);
+
+    return (result);
+#else
+    float length_squared = (a.x * a.x) + (a.y * a.y) + (a.z * a.z);
+    float scalar = (length_squared > 0.0f) ? vm_invsqrt(length_squared) : 0.0f;
+
+    v3 result;
+
+    result.x = a.x * scalar;
+    result.y = a.y * scalar;
+    result.z = a.z * scalar;
 
     return (result);
+#endif
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_inverse(m4x4 m)
+VM_API VM_INLINE float vm_v3_length(v3 a)
 {
-    m4x4 inv;
-    float *e = m.e;
-    float *o = inv.e;
-
-    float a0 = e[0] * e[5] - e[1] * e[4];
-    float a1 = e[0] * e[6] - e[2] * e[4];
-    float a2 = e[0] * e[7] - e[3] * e[4];
-    float a3 = e[1] * e[6] - e[2] * e[5];
-    float a4 = e[1] * e[7] - e[3] * e[5];
-    float a5 = e[2] * e[7] - e[3] * e[6];
-    float b0 = e[8] * e[13] - e[9] * e[12];
-    float b1 = e[8] * e[14] - e[10] * e[12];
-    float b2 = e[8] * e[15] - e[11] * e[12];
-    float b3 = e[9] * e[14] - e[10] * e[13];
-    float b4 = e[9] * e[15] - e[11] * e[13];
-    float b5 = e[10] * e[15] - e[11] * e[14];
-
-    float det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+    return (vm_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z));
+}
 
-    float inv_det;
+VM_API VM_INLINE v3 vm_v3_lerp(v3 a, v3 b, float t)
+{
+    v3 result;
 
-    if (det == 0.0f)
+    if (t <= 0.0f)
+    {
+        return a;
+    }
+    else if (t >= 1.0f)
     {
-        return (vm_m4x4_zero);
+        return b;
     }
 
-    inv_det = 1.0f / det;
+#ifdef VM_SIMD_STORAGE
+    result.m = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b.m, a.m), _mm_set1_ps(t)), a.m);
+#else
+    result.x = ((b.x - a.x) * t) + a.x;
+    result.y = ((b.y - a.y) * t) + a.y;
+    result.z = ((b.z - a.z) * t) + a.z;
+#endif
+
+    return (result);
+}
 
-    o[0] = (+e[5] * b5 - e[6] * b4 + e[7] * b3) * inv_det;
-    o[1] = (-e[1] * b5 + e[2] * b4 - e[3] * b3) * inv_det;
-    o[2] = (+e[13] * a5 - e[14] * a4 + e[15] * a3) * inv_det;
-    o[3] = (-e[9] * a5 + e[10] * a4 - e[11] * a3) * inv_det;
+VM_API VM_INLINE float vm_v3_length_manhatten(v3 start, v3 end, float unit)
+{
+    return ((vm_absf(start.x - end.x) + vm_absf(start.y - end.y) + vm_absf(start.z - end.z)) / (unit == 0.0f ? 1.0f : unit));
+}
 
-    o[4] = (-e[4] * b5 + e[6] * b2 - e[7] * b1) * inv_det;
-    o[5] = (+e[0] * b5 - e[2] * b2 + e[3] * b1) * inv_det;
-    o[6] = (-e[12] * a5 + e[14] * a2 - e[15] * a1) * inv_det;
-    o[7] = (+e[8] * a5 - e[10] * a2 + e[11] * a1) * inv_det;
+VM_API VM_INLINE v3 vm_v3_reflect(v3 incident, v3 normal)
+{
+    float dot = vm_v3_dot(incident, normal);
+    return (vm_v3_sub(incident, vm_v3_mulf(normal, 2.0f * dot)));
+}
 
-    o[8] = (+e[4] * b4 - e[5] * b2 + e[7] * b0) * inv_det;
-    o[9] = (-e[0] * b4 + e[1] * b2 - e[3] * b0) * inv_det;
-    o[10] = (+e[12] * a4 - e[13] * a2 + e[15] * a0) * inv_det;
-    o[11] = (-e[8] * a4 + e[9] * a2 - e[11] * a0) * inv_det;
+VM_API VM_INLINE v3 vm_v3_project(v3 a, v3 b)
+{
+    float dotAB = vm_v3_dot(a, b);
+    float dotBB = vm_v3_dot(b, b);
+    return (vm_v3_mulf(b, dotAB / dotBB));
+}
 
-    o[12] = (-e[4] * b3 + e[5] * b1 - e[6] * b0) * inv_det;
-    o[13] = (+e[0] * b3 - e[1] * b1 + e[2] * b0) * inv_det;
-    o[14] = (-e[12] * a3 + e[13] * a1 - e[14] * a0) * inv_det;
-    o[15] = (+e[8] * a3 - e[9] * a1 + e[10] * a0) * inv_det;
+VM_API VM_INLINE float vm_v3_angle(v3 a, v3 b)
+{
+    float dot = vm_v3_dot(vm_v3_normalize(a), vm_v3_normalize(b));
+    return (vm_acosf(vm_clampf(dot, -1.0f, 1.0f)));
+}
 
-    return (inv);
+VM_API VM_INLINE float vm_v3_distance(v3 a, v3 b)
+{
+    v3 d = vm_v3_sub(a, b);
+    return (vm_sqrtf(vm_v3_dot(d, d)));
 }
 
 /* #############################################################################
- * # Quaternion FUNCTIONS
- * ######################################################################## #####
+ * # VECTOR 4 FUNCTIONS
+ * #############################################################################
  */
-#define VM_QUAT_ELEMENT_COUNT 4
+#define VM_V4_ELEMENT_COUNT 4
 
-typedef v4 quat;
+#ifdef VM_SIMD_STORAGE
+/* The v4 (and quat) lives in a SSE register */
+typedef union v4
+{
+    VM_EXTENSION struct
+    {
+        float x;
+        float y;
+        float z;
+        float w;
+    };
+    __m128 m;
+} v4;
+#else
+typedef struct v4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+} VM_ALIGN_16 v4;
+#endif
+
+/* Initializer for constant v4/quat values that works with and without VM_SIMD_STORAGE */
+#ifdef VM_SIMD_STORAGE
+#define VM_V4_CONST(x, y, z, w) {{(x), (y), (z), (w)}}
+#else
+#define VM_V4_CONST(x, y, z, w) {(x), (y), (z), (w)}
+#endif
 
-static const quat vm_qaut_zero = {0.0f, 0.0f, 0.0f, 0.0f};
-static const quat vm_quat_one = {1.0f, 1.0f, 1.0f, 1.0f};
-static const quat vm_quat_rot = {0.0f, 0.0f, 0.0f, 1.0f};
+static const v4 vm_v4_zero = VM_V4_CONST(0.0f, 0.0f, 0.0f, 0.0f);
+static const v4 vm_v4_one = VM_V4_CONST(1.0f, 1.0f, 1.0f, 1.0f);
 
-VM_API VM_INLINE quat vm_quat(float x, float y, float z, float w)
+VM_API VM_INLINE v4 vm_v4(float x, float y, float z, float w)
 {
-    quat result;
+    v4 result;
 
     result.x = x;
     result.y = y;
@@ -1529,9 +1661,9 @@ VM_API VM_INLINE quat vm_quat(float x, float y, float z, float w)
     return (result);
 }
 
-VM_API VM_INLINE quat vm_quatf(float c)
+VM_API VM_INLINE v4 vm_v4f(float c)
 {
-    quat result;
+    v4 result;
 
     result.x = c;
     result.y = c;
@@ -1541,642 +1673,7721 @@ VM_API VM_INLINE quat vm_quatf(float c)
     return (result);
 }
 
-VM_API VM_INLINE float *vm_quat_data(quat *a)
-{
-    return ((float *)a);
-}
-
-VM_API VM_INLINE int vm_quat_equals(quat a, quat b)
+#ifdef VM_USE_SSE
+/* Returns the v4 as SSE register (no memory round trip with VM_SIMD_STORAGE) */
+VM_API VM_INLINE __m128 vm_v4_m128(v4 a)
 {
-    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.w == b.w)) ? 1 : 0);
+#ifdef VM_SIMD_STORAGE
+    return (a.m);
+#else
+    return (_mm_loadu_ps((float *)&a));
+#endif
 }
 
-VM_API VM_INLINE quat vm_quat_rotate(v3 axis, float angle)
+VM_API VM_INLINE v4 vm_v4_from_m128(__m128 a)
 {
-    quat result;
-
-    const float halfAngle = angle * 0.5f;
-    const float sinHalfAngle = vm_sinf(halfAngle);
-    const float cosHalfAngle = vm_cosf(halfAngle);
+    v4 result;
 
-    result.x = axis.x * sinHalfAngle;
-    result.y = axis.y * sinHalfAngle;
-    result.z = axis.z * sinHalfAngle;
-    result.w = cosHalfAngle;
+#ifdef VM_SIMD_STORAGE
+    result.m = a;
+#else
+    _mm_storeu_ps((float *)&result, a);
+#endif
 
     return (result);
 }
+#endif
 
-VM_API VM_INLINE quat vm_quat_normalize(quat a)
+VM_API VM_INLINE float *vm_v4_data(v4 *a)
+{
+    return ((float *)a);
+}
+
+VM_API VM_INLINE int vm_v4_equals(v4 a, v4 b)
+{
+    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.w == b.w)) ? 1 : 0);
+}
+
+VM_API VM_INLINE v4 vm_v4_add(v4 a, v4 b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = vm_v4_m128(b);
+    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x + b.x;
+    result.y = a.y + b.y;
+    result.z = a.z + b.z;
+    result.w = a.w + b.w;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_addf(v4 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = _mm_set1_ps(b);
+    __m128 result_vec = _mm_add_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x + b;
+    result.y = a.y + b;
+    result.z = a.z + b;
+    result.w = a.w + b;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_sub(v4 a, v4 b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = vm_v4_m128(b);
+    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x - b.x;
+    result.y = a.y - b.y;
+    result.z = a.z - b.z;
+    result.w = a.w - b.w;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_subf(v4 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = _mm_set1_ps(b);
+    __m128 result_vec = _mm_sub_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x - b;
+    result.y = a.y - b;
+    result.z = a.z - b;
+    result.w = a.w - b;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_mul(v4 a, v4 b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = vm_v4_m128(b);
+    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x * b.x;
+    result.y = a.y * b.y;
+    result.z = a.z * b.z;
+    result.w = a.w * b.w;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_mulf(v4 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = _mm_set1_ps(b);
+    __m128 result_vec = _mm_mul_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x * b;
+    result.y = a.y * b;
+    result.z = a.z * b;
+    result.w = a.w * b;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_div(v4 a, v4 b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = vm_v4_m128(b);
+    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x / b.x;
+    result.y = a.y / b.y;
+    result.z = a.z / b.z;
+    result.w = a.w / b.w;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE v4 vm_v4_divf(v4 a, float b)
+{
+#ifdef VM_USE_SSE
+    __m128 a_vec = vm_v4_m128(a);
+    __m128 b_vec = _mm_set1_ps(b);
+    __m128 result_vec = _mm_div_ps(a_vec, b_vec);
+    return (vm_v4_from_m128(result_vec));
+#else
+    v4 result;
+
+    result.x = a.x / b;
+    result.y = a.y / b;
+    result.z = a.z / b;
+    result.w = a.w / b;
+
+    return (result);
+#endif
+}
+
+VM_API VM_INLINE float vm_v4_dot(v4 v1, v4 v2)
+{
+#if defined(VM_SIMD_STORAGE) && defined(VM_USE_SSE41)
+    return (_mm_cvtss_f32(_mm_dp_ps(v1.m, v2.m, 0xF1)));
+#else
+    return ((v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z) + (v1.w * v2.w));
+#endif
+}
+
+VM_API VM_INLINE float vm_v4_length(v4 a)
+{
+    return (vm_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w));
+}
+
+/* #############################################################################
+ * # STRUCTURE OF ARRAYS (SoA) STREAM FUNCTIONS
+ * #############################################################################
+ *
+ * The stream functions process "count" elements stored in separate component
+ * arrays (x[], y[], z[] ...) and handle VM_F32X4_WIDTH elements per step. The
+ * remaining elements are processed with the same scalar math so the results
+ * match the single value v3/v4 functions.
+ *
+ * The output stream may be identical to one of the input streams.
+ */
+typedef struct v3_soa
+{
+    float *x;
+    float *y;
+    float *z;
+    int count;
+} v3_soa;
+
+typedef struct v4_soa
+{
+    float *x;
+    float *y;
+    float *z;
+    float *w;
+    int count;
+} v4_soa;
+
+VM_API VM_INLINE v3_soa vm_v3_soa(float *x, float *y, float *z, int count)
+{
+    v3_soa result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.count = count;
+
+    return (result);
+}
+
+VM_API VM_INLINE v3 vm_v3_soa_get(v3_soa *a, int index)
+{
+    return (vm_v3(a->x[index], a->y[index], a->z[index]));
+}
+
+VM_API VM_INLINE void vm_v3_soa_set(v3_soa *a, int index, v3 value)
+{
+    a->x[index] = value.x;
+    a->y[index] = value.y;
+    a->z[index] = value.z;
+}
+
+VM_API VM_INLINE void vm_v3_soa_add(v3_soa *out, v3_soa *a, v3_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_add(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_add(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_add(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_add(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_add(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_add(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] + b->x[i];
+        out->y[i] = a->y[i] + b->y[i];
+        out->z[i] = a->z[i] + b->z[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_sub(v3_soa *out, v3_soa *a, v3_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_sub(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_sub(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_sub(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_sub(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_sub(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_sub(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] - b->x[i];
+        out->y[i] = a->y[i] - b->y[i];
+        out->z[i] = a->z[i] - b->z[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_mul(v3_soa *out, v3_soa *a, v3_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] * b->x[i];
+        out->y[i] = a->y[i] * b->y[i];
+        out->z[i] = a->z[i] * b->z[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_mulf(v3_soa *out, v3_soa *a, float b)
+{
+    f32x4 b_vec = vm_f32x4_set1(b);
+#ifdef VM_USE_AVX2
+    f32x8 b_vec8 = vm_f32x8_set1(b);
+#endif
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(vm_f32x8_load(&a->x[i]), b_vec8));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(vm_f32x8_load(&a->y[i]), b_vec8));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(vm_f32x8_load(&a->z[i]), b_vec8));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(vm_f32x4_load(&a->x[i]), b_vec));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(vm_f32x4_load(&a->y[i]), b_vec));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(vm_f32x4_load(&a->z[i]), b_vec));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] * b;
+        out->y[i] = a->y[i] * b;
+        out->z[i] = a->z[i] * b;
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_cross(v3_soa *out, v3_soa *a, v3_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 ax = vm_f32x8_load(&a->x[i]);
+        f32x8 ay = vm_f32x8_load(&a->y[i]);
+        f32x8 az = vm_f32x8_load(&a->z[i]);
+        f32x8 bx = vm_f32x8_load(&b->x[i]);
+        f32x8 by = vm_f32x8_load(&b->y[i]);
+        f32x8 bz = vm_f32x8_load(&b->z[i]);
+
+        vm_f32x8_store(&out->x[i], vm_f32x8_sub(vm_f32x8_mul(ay, bz), vm_f32x8_mul(az, by)));
+        vm_f32x8_store(&out->y[i], vm_f32x8_sub(vm_f32x8_mul(az, bx), vm_f32x8_mul(ax, bz)));
+        vm_f32x8_store(&out->z[i], vm_f32x8_sub(vm_f32x8_mul(ax, by), vm_f32x8_mul(ay, bx)));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 ax = vm_f32x4_load(&a->x[i]);
+        f32x4 ay = vm_f32x4_load(&a->y[i]);
+        f32x4 az = vm_f32x4_load(&a->z[i]);
+        f32x4 bx = vm_f32x4_load(&b->x[i]);
+        f32x4 by = vm_f32x4_load(&b->y[i]);
+        f32x4 bz = vm_f32x4_load(&b->z[i]);
+
+        vm_f32x4_store(&out->x[i], vm_f32x4_sub(vm_f32x4_mul(ay, bz), vm_f32x4_mul(az, by)));
+        vm_f32x4_store(&out->y[i], vm_f32x4_sub(vm_f32x4_mul(az, bx), vm_f32x4_mul(ax, bz)));
+        vm_f32x4_store(&out->z[i], vm_f32x4_sub(vm_f32x4_mul(ax, by), vm_f32x4_mul(ay, bx)));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_v3_cross(vm_v3_soa_get(a, i), vm_v3_soa_get(b, i)));
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_dot(float *out, v3_soa *a, v3_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= a->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 dot = vm_f32x8_mul(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i]));
+        dot = vm_f32x8_madd(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i]), dot);
+        dot = vm_f32x8_madd(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i]), dot);
+
+        vm_f32x8_store(&out[i], dot);
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= a->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 dot = vm_f32x4_mul(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i]));
+        dot = vm_f32x4_madd(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i]), dot);
+        dot = vm_f32x4_madd(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i]), dot);
+
+        vm_f32x4_store(&out[i], dot);
+    }
+
+    for (; i < a->count; ++i)
+    {
+        out[i] = vm_v3_dot(vm_v3_soa_get(a, i), vm_v3_soa_get(b, i));
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_length(float *out, v3_soa *a)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= a->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 x = vm_f32x8_load(&a->x[i]);
+        f32x8 y = vm_f32x8_load(&a->y[i]);
+        f32x8 z = vm_f32x8_load(&a->z[i]);
+        f32x8 length_squared = vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(x, x), vm_f32x8_mul(y, y)), vm_f32x8_mul(z, z));
+
+        vm_f32x8_store(&out[i], vm_f32x8_sqrt(length_squared));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= a->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 x = vm_f32x4_load(&a->x[i]);
+        f32x4 y = vm_f32x4_load(&a->y[i]);
+        f32x4 z = vm_f32x4_load(&a->z[i]);
+        f32x4 length_squared = vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(x, x), vm_f32x4_mul(y, y)), vm_f32x4_mul(z, z));
+
+        vm_f32x4_store(&out[i], vm_f32x4_sqrt(length_squared));
+    }
+
+    for (; i < a->count; ++i)
+    {
+        out[i] = vm_v3_length(vm_v3_soa_get(a, i));
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_normalize(v3_soa *out, v3_soa *a)
+{
+    f32x4 zero = vm_f32x4_set1(0.0f);
+#ifdef VM_USE_AVX2
+    f32x8 zero8 = vm_f32x8_set1(0.0f);
+#endif
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 x = vm_f32x8_load(&a->x[i]);
+        f32x8 y = vm_f32x8_load(&a->y[i]);
+        f32x8 z = vm_f32x8_load(&a->z[i]);
+        f32x8 length_squared = vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(x, x), vm_f32x8_mul(y, y)), vm_f32x8_mul(z, z));
+
+        /* Zero length vectors stay zero like in vm_v3_normalize */
+        f32x8 scalar = vm_f32x8_and(vm_f32x8_cmpgt(length_squared, zero8), vm_f32x8_invsqrt(length_squared));
+
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(x, scalar));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(y, scalar));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(z, scalar));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 x = vm_f32x4_load(&a->x[i]);
+        f32x4 y = vm_f32x4_load(&a->y[i]);
+        f32x4 z = vm_f32x4_load(&a->z[i]);
+        f32x4 length_squared = vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(x, x), vm_f32x4_mul(y, y)), vm_f32x4_mul(z, z));
+
+        /* Zero length vectors stay zero like in vm_v3_normalize */
+        f32x4 scalar = vm_f32x4_and(vm_f32x4_cmpgt(length_squared, zero), vm_f32x4_invsqrt(length_squared));
+
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(x, scalar));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(y, scalar));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(z, scalar));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_v3_normalize(vm_v3_soa_get(a, i)));
+    }
+}
+
+VM_API VM_INLINE void vm_v3_soa_lerp(v3_soa *out, v3_soa *a, v3_soa *b, float t)
+{
+    f32x4 t_vec;
+#ifdef VM_USE_AVX2
+    f32x8 t_vec8;
+#endif
+    int i = 0;
+
+    /* Same clamping behaviour as vm_v3_lerp */
+    if (t <= 0.0f || t >= 1.0f)
+    {
+        v3_soa *src = (t <= 0.0f) ? a : b;
+
+        for (; i < out->count; ++i)
+        {
+            out->x[i] = src->x[i];
+            out->y[i] = src->y[i];
+            out->z[i] = src->z[i];
+        }
+        return;
+    }
+
+    t_vec = vm_f32x4_set1(t);
+#ifdef VM_USE_AVX2
+    t_vec8 = vm_f32x8_set1(t);
+#endif
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 ax = vm_f32x8_load(&a->x[i]);
+        f32x8 ay = vm_f32x8_load(&a->y[i]);
+        f32x8 az = vm_f32x8_load(&a->z[i]);
+
+        vm_f32x8_store(&out->x[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->x[i]), ax), t_vec8), ax));
+        vm_f32x8_store(&out->y[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->y[i]), ay), t_vec8), ay));
+        vm_f32x8_store(&out->z[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->z[i]), az), t_vec8), az));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 ax = vm_f32x4_load(&a->x[i]);
+        f32x4 ay = vm_f32x4_load(&a->y[i]);
+        f32x4 az = vm_f32x4_load(&a->z[i]);
+
+        vm_f32x4_store(&out->x[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->x[i]), ax), t_vec), ax));
+        vm_f32x4_store(&out->y[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->y[i]), ay), t_vec), ay));
+        vm_f32x4_store(&out->z[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->z[i]), az), t_vec), az));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_v3_lerp(vm_v3_soa_get(a, i), vm_v3_soa_get(b, i), t));
+    }
+}
+
+VM_API VM_INLINE v4_soa vm_v4_soa(float *x, float *y, float *z, float *w, int count)
+{
+    v4_soa result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+    result.count = count;
+
+    return (result);
+}
+
+VM_API VM_INLINE v4 vm_v4_soa_get(v4_soa *a, int index)
+{
+    return (vm_v4(a->x[index], a->y[index], a->z[index], a->w[index]));
+}
+
+VM_API VM_INLINE void vm_v4_soa_set(v4_soa *a, int index, v4 value)
+{
+    a->x[index] = value.x;
+    a->y[index] = value.y;
+    a->z[index] = value.z;
+    a->w[index] = value.w;
+}
+
+VM_API VM_INLINE void vm_v4_soa_add(v4_soa *out, v4_soa *a, v4_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_add(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_add(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_add(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+        vm_f32x8_store(&out->w[i], vm_f32x8_add(vm_f32x8_load(&a->w[i]), vm_f32x8_load(&b->w[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_add(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_add(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_add(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+        vm_f32x4_store(&out->w[i], vm_f32x4_add(vm_f32x4_load(&a->w[i]), vm_f32x4_load(&b->w[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] + b->x[i];
+        out->y[i] = a->y[i] + b->y[i];
+        out->z[i] = a->z[i] + b->z[i];
+        out->w[i] = a->w[i] + b->w[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_sub(v4_soa *out, v4_soa *a, v4_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_sub(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_sub(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_sub(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+        vm_f32x8_store(&out->w[i], vm_f32x8_sub(vm_f32x8_load(&a->w[i]), vm_f32x8_load(&b->w[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_sub(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_sub(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_sub(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+        vm_f32x4_store(&out->w[i], vm_f32x4_sub(vm_f32x4_load(&a->w[i]), vm_f32x4_load(&b->w[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] - b->x[i];
+        out->y[i] = a->y[i] - b->y[i];
+        out->z[i] = a->z[i] - b->z[i];
+        out->w[i] = a->w[i] - b->w[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_mul(v4_soa *out, v4_soa *a, v4_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i])));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i])));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i])));
+        vm_f32x8_store(&out->w[i], vm_f32x8_mul(vm_f32x8_load(&a->w[i]), vm_f32x8_load(&b->w[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i])));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i])));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i])));
+        vm_f32x4_store(&out->w[i], vm_f32x4_mul(vm_f32x4_load(&a->w[i]), vm_f32x4_load(&b->w[i])));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] * b->x[i];
+        out->y[i] = a->y[i] * b->y[i];
+        out->z[i] = a->z[i] * b->z[i];
+        out->w[i] = a->w[i] * b->w[i];
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_mulf(v4_soa *out, v4_soa *a, float b)
+{
+    f32x4 b_vec = vm_f32x4_set1(b);
+#ifdef VM_USE_AVX2
+    f32x8 b_vec8 = vm_f32x8_set1(b);
+#endif
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(vm_f32x8_load(&a->x[i]), b_vec8));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(vm_f32x8_load(&a->y[i]), b_vec8));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(vm_f32x8_load(&a->z[i]), b_vec8));
+        vm_f32x8_store(&out->w[i], vm_f32x8_mul(vm_f32x8_load(&a->w[i]), b_vec8));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(vm_f32x4_load(&a->x[i]), b_vec));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(vm_f32x4_load(&a->y[i]), b_vec));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(vm_f32x4_load(&a->z[i]), b_vec));
+        vm_f32x4_store(&out->w[i], vm_f32x4_mul(vm_f32x4_load(&a->w[i]), b_vec));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = a->x[i] * b;
+        out->y[i] = a->y[i] * b;
+        out->z[i] = a->z[i] * b;
+        out->w[i] = a->w[i] * b;
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_dot(float *out, v4_soa *a, v4_soa *b)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= a->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 xx = vm_f32x8_mul(vm_f32x8_load(&a->x[i]), vm_f32x8_load(&b->x[i]));
+        f32x8 yy = vm_f32x8_mul(vm_f32x8_load(&a->y[i]), vm_f32x8_load(&b->y[i]));
+        f32x8 zz = vm_f32x8_mul(vm_f32x8_load(&a->z[i]), vm_f32x8_load(&b->z[i]));
+        f32x8 ww = vm_f32x8_mul(vm_f32x8_load(&a->w[i]), vm_f32x8_load(&b->w[i]));
+
+        vm_f32x8_store(&out[i], vm_f32x8_add(vm_f32x8_add(vm_f32x8_add(xx, yy), zz), ww));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= a->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 xx = vm_f32x4_mul(vm_f32x4_load(&a->x[i]), vm_f32x4_load(&b->x[i]));
+        f32x4 yy = vm_f32x4_mul(vm_f32x4_load(&a->y[i]), vm_f32x4_load(&b->y[i]));
+        f32x4 zz = vm_f32x4_mul(vm_f32x4_load(&a->z[i]), vm_f32x4_load(&b->z[i]));
+        f32x4 ww = vm_f32x4_mul(vm_f32x4_load(&a->w[i]), vm_f32x4_load(&b->w[i]));
+
+        vm_f32x4_store(&out[i], vm_f32x4_add(vm_f32x4_add(vm_f32x4_add(xx, yy), zz), ww));
+    }
+
+    for (; i < a->count; ++i)
+    {
+        out[i] = vm_v4_dot(vm_v4_soa_get(a, i), vm_v4_soa_get(b, i));
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_length(float *out, v4_soa *a)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= a->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 x = vm_f32x8_load(&a->x[i]);
+        f32x8 y = vm_f32x8_load(&a->y[i]);
+        f32x8 z = vm_f32x8_load(&a->z[i]);
+        f32x8 w = vm_f32x8_load(&a->w[i]);
+        f32x8 length_squared = vm_f32x8_add(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(x, x), vm_f32x8_mul(y, y)), vm_f32x8_mul(z, z)), vm_f32x8_mul(w, w));
+
+        vm_f32x8_store(&out[i], vm_f32x8_sqrt(length_squared));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= a->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 x = vm_f32x4_load(&a->x[i]);
+        f32x4 y = vm_f32x4_load(&a->y[i]);
+        f32x4 z = vm_f32x4_load(&a->z[i]);
+        f32x4 w = vm_f32x4_load(&a->w[i]);
+        f32x4 length_squared = vm_f32x4_add(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(x, x), vm_f32x4_mul(y, y)), vm_f32x4_mul(z, z)), vm_f32x4_mul(w, w));
+
+        vm_f32x4_store(&out[i], vm_f32x4_sqrt(length_squared));
+    }
+
+    for (; i < a->count; ++i)
+    {
+        out[i] = vm_v4_length(vm_v4_soa_get(a, i));
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_normalize(v4_soa *out, v4_soa *a)
+{
+    f32x4 zero = vm_f32x4_set1(0.0f);
+#ifdef VM_USE_AVX2
+    f32x8 zero8 = vm_f32x8_set1(0.0f);
+#endif
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 x = vm_f32x8_load(&a->x[i]);
+        f32x8 y = vm_f32x8_load(&a->y[i]);
+        f32x8 z = vm_f32x8_load(&a->z[i]);
+        f32x8 w = vm_f32x8_load(&a->w[i]);
+        f32x8 length_squared = vm_f32x8_add(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(x, x), vm_f32x8_mul(y, y)), vm_f32x8_mul(z, z)), vm_f32x8_mul(w, w));
+
+        /* Zero length vectors stay zero like in vm_v3_soa_normalize */
+        f32x8 scalar = vm_f32x8_and(vm_f32x8_cmpgt(length_squared, zero8), vm_f32x8_invsqrt(length_squared));
+
+        vm_f32x8_store(&out->x[i], vm_f32x8_mul(x, scalar));
+        vm_f32x8_store(&out->y[i], vm_f32x8_mul(y, scalar));
+        vm_f32x8_store(&out->z[i], vm_f32x8_mul(z, scalar));
+        vm_f32x8_store(&out->w[i], vm_f32x8_mul(w, scalar));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 x = vm_f32x4_load(&a->x[i]);
+        f32x4 y = vm_f32x4_load(&a->y[i]);
+        f32x4 z = vm_f32x4_load(&a->z[i]);
+        f32x4 w = vm_f32x4_load(&a->w[i]);
+        f32x4 length_squared = vm_f32x4_add(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(x, x), vm_f32x4_mul(y, y)), vm_f32x4_mul(z, z)), vm_f32x4_mul(w, w));
+
+        /* Zero length vectors stay zero like in vm_v3_soa_normalize */
+        f32x4 scalar = vm_f32x4_and(vm_f32x4_cmpgt(length_squared, zero), vm_f32x4_invsqrt(length_squared));
+
+        vm_f32x4_store(&out->x[i], vm_f32x4_mul(x, scalar));
+        vm_f32x4_store(&out->y[i], vm_f32x4_mul(y, scalar));
+        vm_f32x4_store(&out->z[i], vm_f32x4_mul(z, scalar));
+        vm_f32x4_store(&out->w[i], vm_f32x4_mul(w, scalar));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        float length_squared = (a->x[i] * a->x[i]) + (a->y[i] * a->y[i]) + (a->z[i] * a->z[i]) + (a->w[i] * a->w[i]);
+        float scalar = (length_squared > 0.0f) ? vm_invsqrt(length_squared) : 0.0f;
+
+        out->x[i] = a->x[i] * scalar;
+        out->y[i] = a->y[i] * scalar;
+        out->z[i] = a->z[i] * scalar;
+        out->w[i] = a->w[i] * scalar;
+    }
+}
+
+VM_API VM_INLINE void vm_v4_soa_lerp(v4_soa *out, v4_soa *a, v4_soa *b, float t)
+{
+    f32x4 t_vec;
+#ifdef VM_USE_AVX2
+    f32x8 t_vec8;
+#endif
+    int i = 0;
+
+    /* Same clamping behaviour as vm_v3_soa_lerp */
+    if (t <= 0.0f || t >= 1.0f)
+    {
+        v4_soa *src = (t <= 0.0f) ? a : b;
+
+        for (; i < out->count; ++i)
+        {
+            out->x[i] = src->x[i];
+            out->y[i] = src->y[i];
+            out->z[i] = src->z[i];
+            out->w[i] = src->w[i];
+        }
+        return;
+    }
+
+    t_vec = vm_f32x4_set1(t);
+#ifdef VM_USE_AVX2
+    t_vec8 = vm_f32x8_set1(t);
+#endif
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        f32x8 ax = vm_f32x8_load(&a->x[i]);
+        f32x8 ay = vm_f32x8_load(&a->y[i]);
+        f32x8 az = vm_f32x8_load(&a->z[i]);
+        f32x8 aw = vm_f32x8_load(&a->w[i]);
+
+        vm_f32x8_store(&out->x[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->x[i]), ax), t_vec8), ax));
+        vm_f32x8_store(&out->y[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->y[i]), ay), t_vec8), ay));
+        vm_f32x8_store(&out->z[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->z[i]), az), t_vec8), az));
+        vm_f32x8_store(&out->w[i], vm_f32x8_add(vm_f32x8_mul(vm_f32x8_sub(vm_f32x8_load(&b->w[i]), aw), t_vec8), aw));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        f32x4 ax = vm_f32x4_load(&a->x[i]);
+        f32x4 ay = vm_f32x4_load(&a->y[i]);
+        f32x4 az = vm_f32x4_load(&a->z[i]);
+        f32x4 aw = vm_f32x4_load(&a->w[i]);
+
+        vm_f32x4_store(&out->x[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->x[i]), ax), t_vec), ax));
+        vm_f32x4_store(&out->y[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->y[i]), ay), t_vec), ay));
+        vm_f32x4_store(&out->z[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->z[i]), az), t_vec), az));
+        vm_f32x4_store(&out->w[i], vm_f32x4_add(vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(&b->w[i]), aw), t_vec), aw));
+    }
+
+    for (; i < out->count; ++i)
+    {
+        out->x[i] = (b->x[i] - a->x[i]) * t + a->x[i];
+        out->y[i] = (b->y[i] - a->y[i]) * t + a->y[i];
+        out->z[i] = (b->z[i] - a->z[i]) * t + a->z[i];
+        out->w[i] = (b->w[i] - a->w[i]) * t + a->w[i];
+    }
+}
+
+/* #############################################################################
+ * # MATRIX 4x4 FUNCTIONS
+ * #############################################################################
+ */
+#define VM_M4X4_ELEMENT_COUNT 16
+
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+#define VM_M4X4_AT(row, col) ((row) * 4 + (col)) /* Row-major order */
+#else
+#define VM_M4X4_AT(row, col) ((col) * 4 + (row)) /* Column-major order */
+#endif
+
+typedef struct m4x4
+{
+    float e[VM_M4X4_ELEMENT_COUNT];
+} m4x4;
+
+static const m4x4 vm_m4x4_zero =
+    {{0.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f}};
+
+static const m4x4 vm_m4x4_identity =
+    {{1.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 1.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 1.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 1.0f}};
+
+#ifdef VM_USE_SSE
+/* b0 * c.x + b1 * c.y + b2 * c.z + b3 * c.w: one stored vector (column or row) of a 4x4 product.
+   The scalars of c are broadcast and multiply-added (fused with VM_USE_AVX2). */
+VM_API VM_INLINE __m128 vm_m4x4_mul_f32x4(__m128 c, __m128 b0, __m128 b1, __m128 b2, __m128 b3)
+{
+    __m128 t0 = _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+    __m128 t2 = _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)), b2);
+
+    __m128 sum01 = vm_f32x4_madd(_mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)), b1, t0);
+    __m128 sum23 = vm_f32x4_madd(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)), b3, t2);
+
+    return (_mm_add_ps(sum01, sum23));
+}
+#endif
+
+/* out = a * b, out must not point to a or b */
+VM_API VM_INLINE void vm_m4x4_mul_p(m4x4 *VM_RESTRICT out, const m4x4 *a, const m4x4 *b)
+{
+#ifdef VM_USE_SSE
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+    /* row i of the result = sum over k of a[i][k] * row k of b */
+    const float *basis = b->e;
+    const float *coef = a->e;
+#else
+    /* column j of the result = sum over k of column k of a * b[k][j] */
+    const float *basis = a->e;
+    const float *coef = b->e;
+#endif
+    __m128 b0 = _mm_loadu_ps(&basis[0]);
+    __m128 b1 = _mm_loadu_ps(&basis[4]);
+    __m128 b2 = _mm_loadu_ps(&basis[8]);
+    __m128 b3 = _mm_loadu_ps(&basis[12]);
+
+    _mm_storeu_ps(&out->e[0], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[0]), b0, b1, b2, b3));
+    _mm_storeu_ps(&out->e[4], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[4]), b0, b1, b2, b3));
+    _mm_storeu_ps(&out->e[8], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[8]), b0, b1, b2, b3));
+    _mm_storeu_ps(&out->e[12], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[12]), b0, b1, b2, b3));
+#else
+    int i = 0;
+    for (; i < 4; ++i)
+    {
+        float a0 = a->e[VM_M4X4_AT(i, 0)];
+        float a1 = a->e[VM_M4X4_AT(i, 1)];
+        float a2 = a->e[VM_M4X4_AT(i, 2)];
+        float a3 = a->e[VM_M4X4_AT(i, 3)];
+
+        out->e[VM_M4X4_AT(i, 0)] = a0 * b->e[VM_M4X4_AT(0, 0)] + a1 * b->e[VM_M4X4_AT(1, 0)] + a2 * b->e[VM_M4X4_AT(2, 0)] + a3 * b->e[VM_M4X4_AT(3, 0)];
+        out->e[VM_M4X4_AT(i, 1)] = a0 * b->e[VM_M4X4_AT(0, 1)] + a1 * b->e[VM_M4X4_AT(1, 1)] + a2 * b->e[VM_M4X4_AT(2, 1)] + a3 * b->e[VM_M4X4_AT(3, 1)];
+        out->e[VM_M4X4_AT(i, 2)] = a0 * b->e[VM_M4X4_AT(0, 2)] + a1 * b->e[VM_M4X4_AT(1, 2)] + a2 * b->e[VM_M4X4_AT(2, 2)] + a3 * b->e[VM_M4X4_AT(3, 2)];
+        out->e[VM_M4X4_AT(i, 3)] = a0 * b->e[VM_M4X4_AT(0, 3)] + a1 * b->e[VM_M4X4_AT(1, 3)] + a2 * b->e[VM_M4X4_AT(2, 3)] + a3 * b->e[VM_M4X4_AT(3, 3)];
+    }
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_mul(m4x4 a, m4x4 b)
+{
+    m4x4 result;
+    vm_m4x4_mul_p(&result, &a, &b);
+    return (result);
+}
+
+/* Batches with at least this many output matrices are written with non-temporal
+   stores (bypassing the cache) if the output is 16 byte aligned. 8192 matrices
+   are 512 KiB, define it before including vm.h to match your cache size. */
+#ifndef VM_M4X4_STREAM_THRESHOLD
+#define VM_M4X4_STREAM_THRESHOLD 8192
+#endif
+
+/* How many matrices ahead the batch functions prefetch their inputs */
+#ifndef VM_M4X4_PREFETCH_DISTANCE
+#define VM_M4X4_PREFETCH_DISTANCE 4
+#endif
+
+#ifdef VM_USE_SSE
+VM_API VM_INLINE int vm_m4x4_stream_enabled(const m4x4 *out, int n)
+{
+    return (n >= VM_M4X4_STREAM_THRESHOLD && ((vm_uptr)out & 15) == 0);
+}
+
+#ifdef VM_USE_AVX2
+/* The same 4 floats in both 128 bit lanes */
+VM_API VM_INLINE __m256 vm_m4x4_dup_f32x8(const float *p)
+{
+    __m128 v = _mm_loadu_ps(p);
+    return (_mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1));
+}
+
+/* Two stored vectors of a 4x4 product at once (see vm_m4x4_mul_f32x4), b0..b3 are duplicated in both lanes */
+VM_API VM_INLINE __m256 vm_m4x4_mul_f32x8(__m256 c, __m256 b0, __m256 b1, __m256 b2, __m256 b3)
+{
+    __m256 t0 = _mm256_mul_ps(_mm256_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+    __m256 t2 = _mm256_mul_ps(_mm256_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)), b2);
+
+    __m256 sum01 = _mm256_fmadd_ps(_mm256_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)), b1, t0);
+    __m256 sum23 = _mm256_fmadd_ps(_mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)), b3, t2);
+
+    return (_mm256_add_ps(sum01, sum23));
+}
+
+VM_API VM_INLINE void vm_m4x4_store_f32x8(float *dst, __m256 v, int stream)
+{
+    if (stream)
+    {
+        _mm_stream_ps(dst, _mm256_castps256_ps128(v));
+        _mm_stream_ps(dst + 4, _mm256_extractf128_ps(v, 1));
+    }
+    else
+    {
+        _mm256_storeu_ps(dst, v);
+    }
+}
+#else
+VM_API VM_INLINE void vm_m4x4_store_f32x4(float *dst, __m128 v, int stream)
+{
+    if (stream)
+    {
+        _mm_stream_ps(dst, v);
+    }
+    else
+    {
+        _mm_storeu_ps(dst, v);
+    }
+}
+#endif
+#endif
+
+/* out[i] = a[i] * b[i] (e.g. parent * local), out must not overlap a or b */
+VM_API VM_INLINE void vm_m4x4_mul_array(const m4x4 *a, const m4x4 *b, m4x4 *out, int n)
+{
+    int i;
+#ifdef VM_USE_SSE
+    int stream = vm_m4x4_stream_enabled(out, n);
+
+    for (i = 0; i < n; ++i)
+    {
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+        const float *basis = b[i].e;
+        const float *coef = a[i].e;
+#else
+        const float *basis = a[i].e;
+        const float *coef = b[i].e;
+#endif
+        float *o = out[i].e;
+
+        if (i + VM_M4X4_PREFETCH_DISTANCE < n)
+        {
+            _mm_prefetch((const char *)&a[i + VM_M4X4_PREFETCH_DISTANCE], _MM_HINT_T0);
+            _mm_prefetch((const char *)&b[i + VM_M4X4_PREFETCH_DISTANCE], _MM_HINT_T0);
+        }
+
+#ifdef VM_USE_AVX2
+        {
+            __m256 b0 = vm_m4x4_dup_f32x8(&basis[0]);
+            __m256 b1 = vm_m4x4_dup_f32x8(&basis[4]);
+            __m256 b2 = vm_m4x4_dup_f32x8(&basis[8]);
+            __m256 b3 = vm_m4x4_dup_f32x8(&basis[12]);
+
+            vm_m4x4_store_f32x8(&o[0], vm_m4x4_mul_f32x8(_mm256_loadu_ps(&coef[0]), b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x8(&o[8], vm_m4x4_mul_f32x8(_mm256_loadu_ps(&coef[8]), b0, b1, b2, b3), stream);
+        }
+#else
+        {
+            __m128 b0 = _mm_loadu_ps(&basis[0]);
+            __m128 b1 = _mm_loadu_ps(&basis[4]);
+            __m128 b2 = _mm_loadu_ps(&basis[8]);
+            __m128 b3 = _mm_loadu_ps(&basis[12]);
+
+            vm_m4x4_store_f32x4(&o[0], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[0]), b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[4], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[4]), b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[8], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[8]), b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[12], vm_m4x4_mul_f32x4(_mm_loadu_ps(&coef[12]), b0, b1, b2, b3), stream);
+        }
+#endif
+    }
+
+    if (stream)
+    {
+        _mm_sfence();
+    }
+#else
+    for (i = 0; i < n; ++i)
+    {
+        vm_m4x4_mul_p(&out[i], &a[i], &b[i]);
+    }
+#endif
+}
+
+/* out[i] = (*a) * b[i] (e.g. view * model), the shared matrix stays in registers.
+   out must not overlap a or b */
+VM_API VM_INLINE void vm_m4x4_mul_array_shared(const m4x4 *a, const m4x4 *b, m4x4 *out, int n)
+{
+    int i;
+#if defined(VM_USE_AVX2)
+    int stream = vm_m4x4_stream_enabled(out, n);
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+    /* the rows of a are the broadcast coefficients */
+    __m256 c01 = _mm256_loadu_ps(&a->e[0]);
+    __m256 c23 = _mm256_loadu_ps(&a->e[8]);
+#else
+    /* the columns of a are the basis */
+    __m256 b0 = vm_m4x4_dup_f32x8(&a->e[0]);
+    __m256 b1 = vm_m4x4_dup_f32x8(&a->e[4]);
+    __m256 b2 = vm_m4x4_dup_f32x8(&a->e[8]);
+    __m256 b3 = vm_m4x4_dup_f32x8(&a->e[12]);
+#endif
+
+    for (i = 0; i < n; ++i)
+    {
+        const float *e = b[i].e;
+        float *o = out[i].e;
+
+        if (i + VM_M4X4_PREFETCH_DISTANCE < n)
+        {
+            _mm_prefetch((const char *)&b[i + VM_M4X4_PREFETCH_DISTANCE], _MM_HINT_T0);
+        }
+
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+        {
+            __m256 b0 = vm_m4x4_dup_f32x8(&e[0]);
+            __m256 b1 = vm_m4x4_dup_f32x8(&e[4]);
+            __m256 b2 = vm_m4x4_dup_f32x8(&e[8]);
+            __m256 b3 = vm_m4x4_dup_f32x8(&e[12]);
+
+            vm_m4x4_store_f32x8(&o[0], vm_m4x4_mul_f32x8(c01, b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x8(&o[8], vm_m4x4_mul_f32x8(c23, b0, b1, b2, b3), stream);
+        }
+#else
+        vm_m4x4_store_f32x8(&o[0], vm_m4x4_mul_f32x8(_mm256_loadu_ps(&e[0]), b0, b1, b2, b3), stream);
+        vm_m4x4_store_f32x8(&o[8], vm_m4x4_mul_f32x8(_mm256_loadu_ps(&e[8]), b0, b1, b2, b3), stream);
+#endif
+    }
+
+    if (stream)
+    {
+        _mm_sfence();
+    }
+#elif defined(VM_USE_SSE)
+    int stream = vm_m4x4_stream_enabled(out, n);
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+    /* the rows of a are the broadcast coefficients */
+    __m128 c0 = _mm_loadu_ps(&a->e[0]);
+    __m128 c1 = _mm_loadu_ps(&a->e[4]);
+    __m128 c2 = _mm_loadu_ps(&a->e[8]);
+    __m128 c3 = _mm_loadu_ps(&a->e[12]);
+#else
+    /* the columns of a are the basis */
+    __m128 b0 = _mm_loadu_ps(&a->e[0]);
+    __m128 b1 = _mm_loadu_ps(&a->e[4]);
+    __m128 b2 = _mm_loadu_ps(&a->e[8]);
+    __m128 b3 = _mm_loadu_ps(&a->e[12]);
+#endif
+
+    for (i = 0; i < n; ++i)
+    {
+        const float *e = b[i].e;
+        float *o = out[i].e;
+
+        if (i + VM_M4X4_PREFETCH_DISTANCE < n)
+        {
+            _mm_prefetch((const char *)&b[i + VM_M4X4_PREFETCH_DISTANCE], _MM_HINT_T0);
+        }
+
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+        {
+            __m128 b0 = _mm_loadu_ps(&e[0]);
+            __m128 b1 = _mm_loadu_ps(&e[4]);
+            __m128 b2 = _mm_loadu_ps(&e[8]);
+            __m128 b3 = _mm_loadu_ps(&e[12]);
+
+            vm_m4x4_store_f32x4(&o[0], vm_m4x4_mul_f32x4(c0, b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[4], vm_m4x4_mul_f32x4(c1, b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[8], vm_m4x4_mul_f32x4(c2, b0, b1, b2, b3), stream);
+            vm_m4x4_store_f32x4(&o[12], vm_m4x4_mul_f32x4(c3, b0, b1, b2, b3), stream);
+        }
+#else
+        vm_m4x4_store_f32x4(&o[0], vm_m4x4_mul_f32x4(_mm_loadu_ps(&e[0]), b0, b1, b2, b3), stream);
+        vm_m4x4_store_f32x4(&o[4], vm_m4x4_mul_f32x4(_mm_loadu_ps(&e[4]), b0, b1, b2, b3), stream);
+        vm_m4x4_store_f32x4(&o[8], vm_m4x4_mul_f32x4(_mm_loadu_ps(&e[8]), b0, b1, b2, b3), stream);
+        vm_m4x4_store_f32x4(&o[12], vm_m4x4_mul_f32x4(_mm_loadu_ps(&e[12]), b0, b1, b2, b3), stream);
+#endif
+    }
+
+    if (stream)
+    {
+        _mm_sfence();
+    }
+#else
+    for (i = 0; i < n; ++i)
+    {
+        vm_m4x4_mul_p(&out[i], a, &b[i]);
+    }
+#endif
+}
+
+VM_API VM_INLINE int vm_m4x4_equals(m4x4 a, m4x4 b)
+{
+#ifdef VM_USE_SSE
+    int i;
+    for (i = 0; i < 4; ++i)
+    {
+        __m128 va = _mm_loadu_ps(&a.e[i * 4]);
+        __m128 vb = _mm_loadu_ps(&b.e[i * 4]);
+        __m128 cmp = _mm_cmpeq_ps(va, vb);
+        int mask = _mm_movemask_ps(cmp);
+        if ((mask & 0xF) != 0xF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+#else
+    return (
+        a.e[VM_M4X4_AT(0, 0)] == b.e[VM_M4X4_AT(0, 0)] &&
+        a.e[VM_M4X4_AT(0, 1)] == b.e[VM_M4X4_AT(0, 1)] &&
+        a.e[VM_M4X4_AT(0, 2)] == b.e[VM_M4X4_AT(0, 2)] &&
+        a.e[VM_M4X4_AT(0, 3)] == b.e[VM_M4X4_AT(0, 3)] &&
+
+        a.e[VM_M4X4_AT(1, 0)] == b.e[VM_M4X4_AT(1, 0)] &&
+        a.e[VM_M4X4_AT(1, 1)] == b.e[VM_M4X4_AT(1, 1)] &&
+        a.e[VM_M4X4_AT(1, 2)] == b.e[VM_M4X4_AT(1, 2)] &&
+        a.e[VM_M4X4_AT(1, 3)] == b.e[VM_M4X4_AT(1, 3)] &&
+
+        a.e[VM_M4X4_AT(2, 0)] == b.e[VM_M4X4_AT(2, 0)] &&
+        a.e[VM_M4X4_AT(2, 1)] == b.e[VM_M4X4_AT(2, 1)] &&
+        a.e[VM_M4X4_AT(2, 2)] == b.e[VM_M4X4_AT(2, 2)] &&
+        a.e[VM_M4X4_AT(2, 3)] == b.e[VM_M4X4_AT(2, 3)] &&
+
+        a.e[VM_M4X4_AT(3, 0)] == b.e[VM_M4X4_AT(3, 0)] &&
+        a.e[VM_M4X4_AT(3, 1)] == b.e[VM_M4X4_AT(3, 1)] &&
+        a.e[VM_M4X4_AT(3, 2)] == b.e[VM_M4X4_AT(3, 2)] &&
+        a.e[VM_M4X4_AT(3, 3)] == b.e[VM_M4X4_AT(3, 3)]);
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_perspective(float fov, float aspectRatio, float zNear, float zFar)
+{
+    float f = 1.0f / vm_tanf(fov * 0.5f);
+    float fn = 1.0f / (zNear - zFar);
+
+    m4x4 result = vm_m4x4_zero;
+
+    result.e[VM_M4X4_AT(0, 0)] = f / aspectRatio;
+    result.e[VM_M4X4_AT(1, 1)] = f;
+    result.e[VM_M4X4_AT(2, 2)] = (zNear + zFar) * fn;
+    result.e[VM_M4X4_AT(2, 3)] = (2.0f * zNear * zFar) * fn;
+    result.e[VM_M4X4_AT(3, 2)] = -1.0f;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_orthographic(float left, float right, float bottom, float top, float near, float far)
+{
+    float width = right - left;
+    float height = top - bottom;
+    float depth = far - near;
+
+    m4x4 result = vm_m4x4_zero;
+
+    result.e[VM_M4X4_AT(0, 0)] = 2.0f / width;
+    result.e[VM_M4X4_AT(0, 3)] = -(right + left) / width;
+    result.e[VM_M4X4_AT(1, 1)] = 2.0f / height;
+    result.e[VM_M4X4_AT(1, 3)] = -(top + bottom) / height;
+    result.e[VM_M4X4_AT(2, 2)] = -2.0f / depth;
+    result.e[VM_M4X4_AT(2, 3)] = -(far + near) / depth;
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_rotation(v3 forward, v3 up, v3 right)
+{
+    m4x4 result = vm_m4x4_zero;
+
+    result.e[VM_M4X4_AT(0, 0)] = right.x;
+    result.e[VM_M4X4_AT(0, 1)] = right.y;
+    result.e[VM_M4X4_AT(0, 2)] = right.z;
+    result.e[VM_M4X4_AT(0, 3)] = 0.0f;
+
+    result.e[VM_M4X4_AT(1, 0)] = up.x;
+    result.e[VM_M4X4_AT(1, 1)] = up.y;
+    result.e[VM_M4X4_AT(1, 2)] = up.z;
+    result.e[VM_M4X4_AT(1, 3)] = 0.0f;
+
+    result.e[VM_M4X4_AT(2, 0)] = forward.x;
+    result.e[VM_M4X4_AT(2, 1)] = forward.y;
+    result.e[VM_M4X4_AT(2, 2)] = forward.z;
+    result.e[VM_M4X4_AT(2, 3)] = 0.0f;
+
+    result.e[VM_M4X4_AT(3, 0)] = 0.0f;
+    result.e[VM_M4X4_AT(3, 1)] = 0.0f;
+    result.e[VM_M4X4_AT(3, 2)] = 0.0f;
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_translate(m4x4 src, v3 b)
+{
+    m4x4 result = src;
+
+    result.e[VM_M4X4_AT(0, 3)] = b.x;
+    result.e[VM_M4X4_AT(1, 3)] = b.y;
+    result.e[VM_M4X4_AT(2, 3)] = b.z;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_scale(m4x4 src, v3 factor)
+{
+    m4x4 result = src;
+
+    result.e[VM_M4X4_AT(0, 0)] = factor.x;
+    result.e[VM_M4X4_AT(1, 1)] = factor.y;
+    result.e[VM_M4X4_AT(2, 2)] = factor.z;
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_scalef(m4x4 src, float factor)
+{
+    m4x4 result = src;
+
+    result.e[VM_M4X4_AT(0, 0)] = factor;
+    result.e[VM_M4X4_AT(1, 1)] = factor;
+    result.e[VM_M4X4_AT(2, 2)] = factor;
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+/* Transpose, the same shuffle sequence works for both storage orders */
+VM_API VM_INLINE m4x4 vm_m4x4_swap(m4x4 src)
+{
+    m4x4 result;
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps(&src.e[0]);
+    __m128 r1 = _mm_loadu_ps(&src.e[4]);
+    __m128 r2 = _mm_loadu_ps(&src.e[8]);
+    __m128 r3 = _mm_loadu_ps(&src.e[12]);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(&result.e[0], r0);
+    _mm_storeu_ps(&result.e[4], r1);
+    _mm_storeu_ps(&result.e[8], r2);
+    _mm_storeu_ps(&result.e[12], r3);
+#else
+    int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        result.e[VM_M4X4_AT(i, 0)] = src.e[VM_M4X4_AT(0, i)];
+        result.e[VM_M4X4_AT(i, 1)] = src.e[VM_M4X4_AT(1, i)];
+        result.e[VM_M4X4_AT(i, 2)] = src.e[VM_M4X4_AT(2, i)];
+        result.e[VM_M4X4_AT(i, 3)] = src.e[VM_M4X4_AT(3, i)];
+    }
+#endif
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_rotate(m4x4 src, float angle, v3 axis)
+{
+    float c = vm_cosf(angle);
+
+    v3 axisn = vm_v3_normalize(axis);
+    v3 v = vm_v3_mulf(axisn, 1.0f - c);
+    v3 vs = vm_v3_mulf(axisn, vm_sinf(angle));
+
+    m4x4 rot = vm_m4x4_zero;
+
+    v3 a;
+    v3 b;
+    v3 f;
+
+    a = vm_v3_mulf(axisn, v.x);
+    rot.e[VM_M4X4_AT(0, 0)] = a.x;
+    rot.e[VM_M4X4_AT(1, 0)] = a.y;
+    rot.e[VM_M4X4_AT(2, 0)] = a.z;
+
+    b = vm_v3_mulf(axisn, v.y);
+    rot.e[VM_M4X4_AT(0, 1)] = b.x;
+    rot.e[VM_M4X4_AT(1, 1)] = b.y;
+    rot.e[VM_M4X4_AT(2, 1)] = b.z;
+
+    f = vm_v3_mulf(axisn, v.z);
+    rot.e[VM_M4X4_AT(0, 2)] = f.x;
+    rot.e[VM_M4X4_AT(1, 2)] = f.y;
+    rot.e[VM_M4X4_AT(2, 2)] = f.z;
+
+    rot.e[VM_M4X4_AT(0, 0)] += c;
+    rot.e[VM_M4X4_AT(0, 1)] -= vs.z;
+    rot.e[VM_M4X4_AT(0, 2)] += vs.y;
+    rot.e[VM_M4X4_AT(1, 0)] += vs.z;
+    rot.e[VM_M4X4_AT(1, 1)] += c;
+    rot.e[VM_M4X4_AT(1, 2)] -= vs.x;
+    rot.e[VM_M4X4_AT(2, 0)] -= vs.y;
+    rot.e[VM_M4X4_AT(2, 1)] += vs.x;
+    rot.e[VM_M4X4_AT(2, 2)] += c;
+
+    rot.e[VM_M4X4_AT(3, 0)] = 0.0f;
+    rot.e[VM_M4X4_AT(3, 1)] = 0.0f;
+    rot.e[VM_M4X4_AT(3, 2)] = 0.0f;
+    rot.e[VM_M4X4_AT(0, 3)] = 0.0f;
+    rot.e[VM_M4X4_AT(1, 3)] = 0.0f;
+    rot.e[VM_M4X4_AT(2, 3)] = 0.0f;
+    rot.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (vm_m4x4_mul(src, rot));
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_lookAt(v3 eye, v3 target, v3 up)
+{
+    v3 f = vm_v3_normalize(vm_v3_sub(target, eye));
+    v3 s = vm_v3_normalize(vm_v3_cross(f, up));
+    v3 u = vm_v3_cross(s, f);
+
+    m4x4 result = vm_m4x4_zero;
+
+    result.e[VM_M4X4_AT(0, 0)] = s.x;
+    result.e[VM_M4X4_AT(0, 1)] = s.y;
+    result.e[VM_M4X4_AT(0, 2)] = s.z;
+    result.e[VM_M4X4_AT(0, 3)] = -vm_v3_dot(s, eye);
+    result.e[VM_M4X4_AT(1, 0)] = u.x;
+    result.e[VM_M4X4_AT(1, 1)] = u.y;
+    result.e[VM_M4X4_AT(1, 2)] = u.z;
+    result.e[VM_M4X4_AT(1, 3)] = -vm_v3_dot(u, eye);
+    result.e[VM_M4X4_AT(2, 0)] = -f.x;
+    result.e[VM_M4X4_AT(2, 1)] = -f.y;
+    result.e[VM_M4X4_AT(2, 2)] = -f.z;
+    result.e[VM_M4X4_AT(2, 3)] = vm_v3_dot(f, eye);
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_lookAt_model(v3 eye, v3 target, v3 up)
+{
+    v3 f = vm_v3_normalize(vm_v3_sub(target, eye));
+    v3 r = vm_v3_normalize(vm_v3_cross(up, f));
+    v3 u = vm_v3_cross(f, r);
+
+    m4x4 result = vm_m4x4_identity;
+
+    result.e[VM_M4X4_AT(0, 0)] = r.x;
+    result.e[VM_M4X4_AT(1, 0)] = r.y;
+    result.e[VM_M4X4_AT(2, 0)] = r.z;
+    result.e[VM_M4X4_AT(0, 1)] = u.x;
+    result.e[VM_M4X4_AT(1, 1)] = u.y;
+    result.e[VM_M4X4_AT(2, 1)] = u.z;
+    result.e[VM_M4X4_AT(0, 2)] = f.x;
+    result.e[VM_M4X4_AT(1, 2)] = f.y;
+    result.e[VM_M4X4_AT(2, 2)] = f.z;
+    result.e[VM_M4X4_AT(0, 3)] = eye.x;
+    result.e[VM_M4X4_AT(1, 3)] = eye.y;
+    result.e[VM_M4X4_AT(2, 3)] = eye.z;
+
+    return (result);
+}
+
+#ifdef VM_USE_SSE
+/* 2x2 matrices packed as (m00 m01 m10 m11) for the block wise SIMD inverse:
+   a * b, adj(a) * b and a * adj(b) */
+VM_API VM_INLINE __m128 vm_m2x2_mul_f32x4(__m128 a, __m128 b)
+{
+    return (_mm_add_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))));
+}
+
+VM_API VM_INLINE __m128 vm_m2x2_adj_mul_f32x4(__m128 a, __m128 b)
+{
+    return (_mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)))));
+}
+
+VM_API VM_INLINE __m128 vm_m2x2_mul_adj_f32x4(__m128 a, __m128 b)
+{
+    return (_mm_sub_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))));
+}
+
+/* Inverts the 4x4 matrix given by its four stored rows/columns in place.
+   The matrix is split into the 2x2 blocks | A B ; C D | and the inverse is
+   built from their adjugates (inverse(transpose(M)) == transpose(inverse(M)),
+   so the storage order does not matter). Singular matrices produce zeros. */
+VM_API VM_INLINE void vm_m4x4_inverse_f32x4(__m128 *r0, __m128 *r1, __m128 *r2, __m128 *r3)
+{
+    __m128 a = _mm_shuffle_ps(*r0, *r1, _MM_SHUFFLE(1, 0, 1, 0));
+    __m128 b = _mm_shuffle_ps(*r0, *r1, _MM_SHUFFLE(3, 2, 3, 2));
+    __m128 c = _mm_shuffle_ps(*r2, *r3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m128 d = _mm_shuffle_ps(*r2, *r3, _MM_SHUFFLE(3, 2, 3, 2));
+
+    /* |A| |B| |C| |D| */
+    __m128 det_sub = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(*r0, *r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(*r1, *r3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(*r0, *r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(*r1, *r3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 det_a = _mm_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 det_b = _mm_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 det_c = _mm_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 det_d = _mm_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 d_c = vm_m2x2_adj_mul_f32x4(d, c);
+    __m128 a_b = vm_m2x2_adj_mul_f32x4(a, b);
+
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), vm_m2x2_mul_f32x4(b, d_c));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), vm_m2x2_mul_f32x4(c, a_b));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), vm_m2x2_mul_adj_f32x4(d, a_b));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), vm_m2x2_mul_adj_f32x4(a, d_c));
+
+    /* |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C) */
+    __m128 tr = _mm_mul_ps(a_b, _mm_shuffle_ps(d_c, d_c, _MM_SHUFFLE(3, 1, 2, 0)));
+    __m128 det;
+    __m128 inv_det;
+    __m128 nonsingular;
+
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+    nonsingular = _mm_cmpneq_ps(det, _mm_setzero_ps());
+    inv_det = _mm_and_ps(_mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det), nonsingular);
+
+    x = _mm_mul_ps(x, inv_det);
+    y = _mm_mul_ps(y, inv_det);
+    z = _mm_mul_ps(z, inv_det);
+    w = _mm_mul_ps(w, inv_det);
+
+    /* adjugate shuffle of the blocks combined with the store shuffle */
+    *r0 = _mm_and_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)), nonsingular);
+    *r1 = _mm_and_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)), nonsingular);
+    *r2 = _mm_and_ps(_mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)), nonsingular);
+    *r3 = _mm_and_ps(_mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)), nonsingular);
+}
+
+#ifdef VM_USE_AVX2
+VM_API VM_INLINE __m256 vm_m2x2_mul_f32x8(__m256 a, __m256 b)
+{
+    return (_mm256_add_ps(
+        _mm256_mul_ps(a, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+        _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))));
+}
+
+VM_API VM_INLINE __m256 vm_m2x2_adj_mul_f32x8(__m256 a, __m256 b)
+{
+    return (_mm256_sub_ps(
+        _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+        _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)))));
+}
+
+VM_API VM_INLINE __m256 vm_m2x2_mul_adj_f32x8(__m256 a, __m256 b)
+{
+    return (_mm256_sub_ps(
+        _mm256_mul_ps(a, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+        _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))));
+}
+
+/* Same as vm_m4x4_inverse_f32x4 for two matrices, one per 128 bit lane (all shuffles stay in-lane) */
+VM_API VM_INLINE void vm_m4x4_inverse_f32x8(__m256 *r0, __m256 *r1, __m256 *r2, __m256 *r3)
+{
+    __m256 a = _mm256_shuffle_ps(*r0, *r1, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 b = _mm256_shuffle_ps(*r0, *r1, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 c = _mm256_shuffle_ps(*r2, *r3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 d = _mm256_shuffle_ps(*r2, *r3, _MM_SHUFFLE(3, 2, 3, 2));
+
+    /* |A| |B| |C| |D| */
+    __m256 det_sub = _mm256_sub_ps(
+        _mm256_mul_ps(_mm256_shuffle_ps(*r0, *r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(*r1, *r3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm256_mul_ps(_mm256_shuffle_ps(*r0, *r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm256_shuffle_ps(*r1, *r3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m256 det_a = _mm256_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(0, 0, 0, 0));
+    __m256 det_b = _mm256_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(1, 1, 1, 1));
+    __m256 det_c = _mm256_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(2, 2, 2, 2));
+    __m256 det_d = _mm256_shuffle_ps(det_sub, det_sub, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m256 d_c = vm_m2x2_adj_mul_f32x8(d, c);
+    __m256 a_b = vm_m2x2_adj_mul_f32x8(a, b);
+
+    __m256 x = _mm256_sub_ps(_mm256_mul_ps(det_d, a), vm_m2x2_mul_f32x8(b, d_c));
+    __m256 w = _mm256_sub_ps(_mm256_mul_ps(det_a, d), vm_m2x2_mul_f32x8(c, a_b));
+    __m256 y = _mm256_sub_ps(_mm256_mul_ps(det_b, c), vm_m2x2_mul_adj_f32x8(d, a_b));
+    __m256 z = _mm256_sub_ps(_mm256_mul_ps(det_c, b), vm_m2x2_mul_adj_f32x8(a, d_c));
+
+    /* |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C) */
+    __m256 tr = _mm256_mul_ps(a_b, _mm256_shuffle_ps(d_c, d_c, _MM_SHUFFLE(3, 1, 2, 0)));
+    __m256 det;
+    __m256 inv_det;
+    __m256 nonsingular;
+
+    tr = _mm256_add_ps(tr, _mm256_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+    tr = _mm256_add_ps(tr, _mm256_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    det = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(det_a, det_d), _mm256_mul_ps(det_b, det_c)), tr);
+    nonsingular = _mm256_cmp_ps(det, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+    inv_det = _mm256_and_ps(_mm256_div_ps(_mm256_setr_ps(1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f), det), nonsingular);
+
+    x = _mm256_mul_ps(x, inv_det);
+    y = _mm256_mul_ps(y, inv_det);
+    z = _mm256_mul_ps(z, inv_det);
+    w = _mm256_mul_ps(w, inv_det);
+
+    /* adjugate shuffle of the blocks combined with the store shuffle */
+    *r0 = _mm256_and_ps(_mm256_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)), nonsingular);
+    *r1 = _mm256_and_ps(_mm256_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)), nonsingular);
+    *r2 = _mm256_and_ps(_mm256_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)), nonsingular);
+    *r3 = _mm256_and_ps(_mm256_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)), nonsingular);
+}
+#endif
+#endif
+
+/* out = inverse of m (vm_m4x4_zero if singular), out must not point to m */
+VM_API VM_INLINE void vm_m4x4_inverse_p(m4x4 *VM_RESTRICT out, const m4x4 *m)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps(&m->e[0]);
+    __m128 r1 = _mm_loadu_ps(&m->e[4]);
+    __m128 r2 = _mm_loadu_ps(&m->e[8]);
+    __m128 r3 = _mm_loadu_ps(&m->e[12]);
+
+    vm_m4x4_inverse_f32x4(&r0, &r1, &r2, &r3);
+
+    _mm_storeu_ps(&out->e[0], r0);
+    _mm_storeu_ps(&out->e[4], r1);
+    _mm_storeu_ps(&out->e[8], r2);
+    _mm_storeu_ps(&out->e[12], r3);
+#else
+    const float *e = m->e;
+    float *o = out->e;
+
+    float a0 = vm_fmaf(e[0], e[5], -(e[1] * e[4]));
+    float a1 = vm_fmaf(e[0], e[6], -(e[2] * e[4]));
+    float a2 = vm_fmaf(e[0], e[7], -(e[3] * e[4]));
+    float a3 = vm_fmaf(e[1], e[6], -(e[2] * e[5]));
+    float a4 = vm_fmaf(e[1], e[7], -(e[3] * e[5]));
+    float a5 = vm_fmaf(e[2], e[7], -(e[3] * e[6]));
+    float b0 = vm_fmaf(e[8], e[13], -(e[9] * e[12]));
+    float b1 = vm_fmaf(e[8], e[14], -(e[10] * e[12]));
+    float b2 = vm_fmaf(e[8], e[15], -(e[11] * e[12]));
+    float b3 = vm_fmaf(e[9], e[14], -(e[10] * e[13]));
+    float b4 = vm_fmaf(e[9], e[15], -(e[11] * e[13]));
+    float b5 = vm_fmaf(e[10], e[15], -(e[11] * e[14]));
+
+    float det = vm_fmaf(a5, b0, vm_fmaf(-a4, b1, vm_fmaf(a3, b2, vm_fmaf(a2, b3, vm_fmaf(-a1, b4, a0 * b5)))));
+
+    float inv_det;
+
+    if (det == 0.0f)
+    {
+        *out = vm_m4x4_zero;
+        return;
+    }
+
+    inv_det = 1.0f / det;
+
+    o[0] = vm_fmaf(e[7], b3, vm_fmaf(-e[6], b4, e[5] * b5)) * inv_det;
+    o[1] = vm_fmaf(-e[3], b3, vm_fmaf(e[2], b4, -e[1] * b5)) * inv_det;
+    o[2] = vm_fmaf(e[15], a3, vm_fmaf(-e[14], a4, e[13] * a5)) * inv_det;
+    o[3] = vm_fmaf(-e[11], a3, vm_fmaf(e[10], a4, -e[9] * a5)) * inv_det;
+
+    o[4] = vm_fmaf(-e[7], b1, vm_fmaf(e[6], b2, -e[4] * b5)) * inv_det;
+    o[5] = vm_fmaf(e[3], b1, vm_fmaf(-e[2], b2, e[0] * b5)) * inv_det;
+    o[6] = vm_fmaf(-e[15], a1, vm_fmaf(e[14], a2, -e[12] * a5)) * inv_det;
+    o[7] = vm_fmaf(e[11], a1, vm_fmaf(-e[10], a2, e[8] * a5)) * inv_det;
+
+    o[8] = vm_fmaf(e[7], b0, vm_fmaf(-e[5], b2, e[4] * b4)) * inv_det;
+    o[9] = vm_fmaf(-e[3], b0, vm_fmaf(e[1], b2, -e[0] * b4)) * inv_det;
+    o[10] = vm_fmaf(e[15], a0, vm_fmaf(-e[13], a2, e[12] * a4)) * inv_det;
+    o[11] = vm_fmaf(-e[11], a0, vm_fmaf(e[9], a2, -e[8] * a4)) * inv_det;
+
+    o[12] = vm_fmaf(-e[6], b0, vm_fmaf(e[5], b1, -e[4] * b3)) * inv_det;
+    o[13] = vm_fmaf(e[2], b0, vm_fmaf(-e[1], b1, e[0] * b3)) * inv_det;
+    o[14] = vm_fmaf(-e[14], a0, vm_fmaf(e[13], a1, -e[12] * a3)) * inv_det;
+    o[15] = vm_fmaf(e[10], a0, vm_fmaf(-e[9], a1, e[8] * a3)) * inv_det;
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_inverse(m4x4 m)
+{
+    m4x4 result;
+    vm_m4x4_inverse_p(&result, &m);
+    return (result);
+}
+
+/* out[i] = inverse of in[i] (vm_m4x4_zero if singular), with VM_USE_AVX2 two matrices per iteration */
+VM_API VM_INLINE void vm_m4x4_inverse_array(const m4x4 *in, m4x4 *out, int n)
+{
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + 2 <= n; i += 2)
+    {
+        const float *e0 = in[i].e;
+        const float *e1 = in[i + 1].e;
+
+        __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&e0[0])), _mm_loadu_ps(&e1[0]), 1);
+        __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&e0[4])), _mm_loadu_ps(&e1[4]), 1);
+        __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&e0[8])), _mm_loadu_ps(&e1[8]), 1);
+        __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&e0[12])), _mm_loadu_ps(&e1[12]), 1);
+
+        vm_m4x4_inverse_f32x8(&r0, &r1, &r2, &r3);
+
+        _mm_storeu_ps(&out[i].e[0], _mm256_castps256_ps128(r0));
+        _mm_storeu_ps(&out[i].e[4], _mm256_castps256_ps128(r1));
+        _mm_storeu_ps(&out[i].e[8], _mm256_castps256_ps128(r2));
+        _mm_storeu_ps(&out[i].e[12], _mm256_castps256_ps128(r3));
+        _mm_storeu_ps(&out[i + 1].e[0], _mm256_extractf128_ps(r0, 1));
+        _mm_storeu_ps(&out[i + 1].e[4], _mm256_extractf128_ps(r1, 1));
+        _mm_storeu_ps(&out[i + 1].e[8], _mm256_extractf128_ps(r2, 1));
+        _mm_storeu_ps(&out[i + 1].e[12], _mm256_extractf128_ps(r3, 1));
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        vm_m4x4_inverse_p(&out[i], &in[i]);
+    }
+}
+
+/* Bottom row is (0, 0, 0, 1) */
+VM_API VM_INLINE int vm_m4x4_is_affine(const m4x4 *m, float epsilon)
+{
+    return (
+        vm_absf(m->e[VM_M4X4_AT(3, 0)]) <= epsilon &&
+        vm_absf(m->e[VM_M4X4_AT(3, 1)]) <= epsilon &&
+        vm_absf(m->e[VM_M4X4_AT(3, 2)]) <= epsilon &&
+        vm_absf(m->e[VM_M4X4_AT(3, 3)] - 1.0f) <= epsilon);
+}
+
+/* Affine with an orthonormal upper 3x3 (rotation + translation only, no scale or shear) */
+VM_API VM_INLINE int vm_m4x4_is_rigid(const m4x4 *m, float epsilon)
+{
+    v3 c0 = vm_v3(m->e[VM_M4X4_AT(0, 0)], m->e[VM_M4X4_AT(1, 0)], m->e[VM_M4X4_AT(2, 0)]);
+    v3 c1 = vm_v3(m->e[VM_M4X4_AT(0, 1)], m->e[VM_M4X4_AT(1, 1)], m->e[VM_M4X4_AT(2, 1)]);
+    v3 c2 = vm_v3(m->e[VM_M4X4_AT(0, 2)], m->e[VM_M4X4_AT(1, 2)], m->e[VM_M4X4_AT(2, 2)]);
+
+    return (
+        vm_m4x4_is_affine(m, epsilon) &&
+        vm_absf(vm_v3_dot(c0, c0) - 1.0f) <= epsilon &&
+        vm_absf(vm_v3_dot(c1, c1) - 1.0f) <= epsilon &&
+        vm_absf(vm_v3_dot(c2, c2) - 1.0f) <= epsilon &&
+        vm_absf(vm_v3_dot(c0, c1)) <= epsilon &&
+        vm_absf(vm_v3_dot(c0, c2)) <= epsilon &&
+        vm_absf(vm_v3_dot(c1, c2)) <= epsilon);
+}
+
+#ifdef VM_USE_SSE
+/* cross(a, b) on the xyz lanes, the w lane becomes 0.0f */
+VM_API VM_INLINE __m128 vm_v3_cross_f32x4(__m128 a, __m128 b)
+{
+    __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+    return (_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+}
+
+/* Writes the inverse of the affine m given the inverse of its upper 3x3 as
+   x0..x2 (its rows in column major order, its columns in row major order,
+   which is the same memory layout as the stored vectors of m) */
+VM_API VM_INLINE void vm_m4x4_inverse_affine_store_f32x4(m4x4 *VM_RESTRICT out, const m4x4 *m, __m128 x0, __m128 x1, __m128 x2)
+{
+    __m128 s3;
+    __m128 t;
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+    /* the translation is the w lane of the stored rows */
+    t = _mm_mul_ps(_mm_set1_ps(m->e[3]), x0);
+    t = vm_f32x4_madd(_mm_set1_ps(m->e[7]), x1, t);
+    t = vm_f32x4_madd(_mm_set1_ps(m->e[11]), x2, t);
+    s3 = _mm_sub_ps(_mm_setzero_ps(), t);
+
+    /* transposing (x0, x1, x2, -inverse(A) * t) puts the new translation into the w lanes */
+    _MM_TRANSPOSE4_PS(x0, x1, x2, s3);
+    s3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+#else
+    s3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x0, x1, x2, s3);
+
+    /* x0..x2 are now the columns of inverse(A) with w = 0 */
+    t = _mm_mul_ps(_mm_set1_ps(m->e[12]), x0);
+    t = vm_f32x4_madd(_mm_set1_ps(m->e[13]), x1, t);
+    t = vm_f32x4_madd(_mm_set1_ps(m->e[14]), x2, t);
+    s3 = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), t);
+#endif
+    _mm_storeu_ps(&out->e[0], x0);
+    _mm_storeu_ps(&out->e[4], x1);
+    _mm_storeu_ps(&out->e[8], x2);
+    _mm_storeu_ps(&out->e[12], s3);
+}
+#endif
+
+/* out = inverse of an affine m (vm_m4x4_zero if the upper 3x3 is singular), out must not point to m.
+   Inverts the upper 3x3 with cross products and applies it to the negated translation. */
+VM_API VM_INLINE void vm_m4x4_inverse_affine_p(m4x4 *VM_RESTRICT out, const m4x4 *m)
+{
+#ifdef VM_USE_SSE
+    __m128 s0 = _mm_loadu_ps(&m->e[0]);
+    __m128 s1 = _mm_loadu_ps(&m->e[4]);
+    __m128 s2 = _mm_loadu_ps(&m->e[8]);
+
+    /* adjugate of the upper 3x3, the w lanes are 0.0f */
+    __m128 x0 = vm_v3_cross_f32x4(s1, s2);
+    __m128 x1 = vm_v3_cross_f32x4(s2, s0);
+    __m128 x2 = vm_v3_cross_f32x4(s0, s1);
+
+    __m128 d = _mm_mul_ps(s0, x0);
+    float det;
+    __m128 inv_det;
+
+    VM_ASSERT(vm_m4x4_is_affine(m, 1e-4f));
+
+    d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+    det = _mm_cvtss_f32(_mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))));
+
+    if (det == 0.0f)
+    {
+        *out = vm_m4x4_zero;
+        return;
+    }
+
+    inv_det = _mm_set1_ps(1.0f / det);
+
+    vm_m4x4_inverse_affine_store_f32x4(out, m, _mm_mul_ps(x0, inv_det), _mm_mul_ps(x1, inv_det), _mm_mul_ps(x2, inv_det));
+#else
+    v3 c0 = vm_v3(m->e[VM_M4X4_AT(0, 0)], m->e[VM_M4X4_AT(1, 0)], m->e[VM_M4X4_AT(2, 0)]);
+    v3 c1 = vm_v3(m->e[VM_M4X4_AT(0, 1)], m->e[VM_M4X4_AT(1, 1)], m->e[VM_M4X4_AT(2, 1)]);
+    v3 c2 = vm_v3(m->e[VM_M4X4_AT(0, 2)], m->e[VM_M4X4_AT(1, 2)], m->e[VM_M4X4_AT(2, 2)]);
+    v3 t = vm_v3(m->e[VM_M4X4_AT(0, 3)], m->e[VM_M4X4_AT(1, 3)], m->e[VM_M4X4_AT(2, 3)]);
+
+    /* rows of the inverse 3x3 (before dividing by the determinant) */
+    v3 r0 = vm_v3_cross(c1, c2);
+    v3 r1 = vm_v3_cross(c2, c0);
+    v3 r2 = vm_v3_cross(c0, c1);
+
+    float det = vm_v3_dot(c0, r0);
+    float inv_det;
+
+    VM_ASSERT(vm_m4x4_is_affine(m, 1e-4f));
+
+    if (det == 0.0f)
+    {
+        *out = vm_m4x4_zero;
+        return;
+    }
+
+    inv_det = 1.0f / det;
+    r0 = vm_v3_mulf(r0, inv_det);
+    r1 = vm_v3_mulf(r1, inv_det);
+    r2 = vm_v3_mulf(r2, inv_det);
+
+    out->e[VM_M4X4_AT(0, 0)] = r0.x;
+    out->e[VM_M4X4_AT(0, 1)] = r0.y;
+    out->e[VM_M4X4_AT(0, 2)] = r0.z;
+    out->e[VM_M4X4_AT(0, 3)] = -vm_v3_dot(r0, t);
+
+    out->e[VM_M4X4_AT(1, 0)] = r1.x;
+    out->e[VM_M4X4_AT(1, 1)] = r1.y;
+    out->e[VM_M4X4_AT(1, 2)] = r1.z;
+    out->e[VM_M4X4_AT(1, 3)] = -vm_v3_dot(r1, t);
+
+    out->e[VM_M4X4_AT(2, 0)] = r2.x;
+    out->e[VM_M4X4_AT(2, 1)] = r2.y;
+    out->e[VM_M4X4_AT(2, 2)] = r2.z;
+    out->e[VM_M4X4_AT(2, 3)] = -vm_v3_dot(r2, t);
+
+    out->e[VM_M4X4_AT(3, 0)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 1)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 2)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 3)] = 1.0f;
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_inverse_affine(m4x4 m)
+{
+    m4x4 result;
+    vm_m4x4_inverse_affine_p(&result, &m);
+    return (result);
+}
+
+/* out = inverse of a rigid m (rotation + translation), out must not point to m.
+   The rotation is transposed and the translation becomes -transpose(R) * t. */
+VM_API VM_INLINE void vm_m4x4_inverse_rigid_p(m4x4 *VM_RESTRICT out, const m4x4 *m)
+{
+#ifdef VM_USE_SSE
+    VM_ASSERT(vm_m4x4_is_rigid(m, 1e-2f));
+
+    /* the stored rotation vectors are already the inverse 3x3 in the layout the store expects */
+    vm_m4x4_inverse_affine_store_f32x4(out, m, _mm_loadu_ps(&m->e[0]), _mm_loadu_ps(&m->e[4]), _mm_loadu_ps(&m->e[8]));
+#else
+    float tx = m->e[VM_M4X4_AT(0, 3)];
+    float ty = m->e[VM_M4X4_AT(1, 3)];
+    float tz = m->e[VM_M4X4_AT(2, 3)];
+    int i;
+
+    VM_ASSERT(vm_m4x4_is_rigid(m, 1e-2f));
+
+    for (i = 0; i < 3; ++i)
+    {
+        float r0 = m->e[VM_M4X4_AT(0, i)];
+        float r1 = m->e[VM_M4X4_AT(1, i)];
+        float r2 = m->e[VM_M4X4_AT(2, i)];
+
+        out->e[VM_M4X4_AT(i, 0)] = r0;
+        out->e[VM_M4X4_AT(i, 1)] = r1;
+        out->e[VM_M4X4_AT(i, 2)] = r2;
+        out->e[VM_M4X4_AT(i, 3)] = -vm_fmaf(r0, tx, vm_fmaf(r1, ty, r2 * tz));
+        out->e[VM_M4X4_AT(3, i)] = 0.0f;
+    }
+
+    out->e[VM_M4X4_AT(3, 3)] = 1.0f;
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_inverse_rigid(m4x4 m)
+{
+    m4x4 result;
+    vm_m4x4_inverse_rigid_p(&result, &m);
+    return (result);
+}
+
+/* #############################################################################
+ * # Quaternion FUNCTIONS
+ * ######################################################################## #####
+ */
+#define VM_QUAT_ELEMENT_COUNT 4
+
+typedef v4 quat;
+
+static const quat vm_qaut_zero = VM_V4_CONST(0.0f, 0.0f, 0.0f, 0.0f);
+static const quat vm_quat_one = VM_V4_CONST(1.0f, 1.0f, 1.0f, 1.0f);
+static const quat vm_quat_rot = VM_V4_CONST(0.0f, 0.0f, 0.0f, 1.0f);
+
+VM_API VM_INLINE quat vm_quat(float x, float y, float z, float w)
+{
+    quat result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quatf(float c)
+{
+    quat result;
+
+    result.x = c;
+    result.y = c;
+    result.z = c;
+    result.w = c;
+
+    return (result);
+}
+
+VM_API VM_INLINE float *vm_quat_data(quat *a)
+{
+    return ((float *)a);
+}
+
+VM_API VM_INLINE int vm_quat_equals(quat a, quat b)
+{
+    return (((a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.w == b.w)) ? 1 : 0);
+}
+
+VM_API VM_INLINE quat vm_quat_rotate(v3 axis, float angle)
+{
+    quat result;
+
+    const float halfAngle = angle * 0.5f;
+    const float sinHalfAngle = vm_sinf(halfAngle);
+    const float cosHalfAngle = vm_cosf(halfAngle);
+
+    result.x = axis.x * sinHalfAngle;
+    result.y = axis.y * sinHalfAngle;
+    result.z = axis.z * sinHalfAngle;
+    result.w = cosHalfAngle;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_normalize(quat a)
 {
     float length_squared = (a.x * a.x) + (a.y * a.y) + (a.z * a.z) + (a.w * a.w);
     float scalar = vm_invsqrt(length_squared);
 
-    quat result;
+    quat result;
+
+    result.x = a.x * scalar;
+    result.y = a.y * scalar;
+    result.z = a.z * scalar;
+    result.w = a.w * scalar;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_conjugate(quat a)
+{
+    quat result;
+
+    result.x = -a.x;
+    result.y = -a.y;
+    result.z = -a.z;
+    result.w = a.w;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_mul(quat a, quat b)
+{
+    quat result;
+
+    result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    result.x = a.x * b.w + a.w * b.x + a.y * b.z - a.z * b.y;
+    result.y = a.y * b.w + a.w * b.y + a.z * b.x - a.x * b.z;
+    result.z = a.z * b.w + a.w * b.z + a.x * b.y - a.y * b.x;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_mulf(quat a, float b)
+{
+    quat result;
+
+    result.x = a.x * b;
+    result.y = a.y * b;
+    result.z = a.z * b;
+    result.w = a.w * b;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_mulv3(quat a, v3 b)
+{
+    quat result;
+
+    result.w = -a.x * b.x - a.y * b.y - a.z * b.z;
+    result.x = a.w * b.x + a.y * b.z - a.z * b.y;
+    result.y = a.w * b.y + a.z * b.x - a.x * b.z;
+    result.z = a.w * b.z + a.x * b.y - a.y * b.x;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_sub(quat a, quat b)
+{
+    quat result;
+
+    result.x = a.x - b.x;
+    result.y = a.y - b.y;
+    result.z = a.z - b.z;
+    result.w = a.w - b.w;
+
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_add(quat a, quat b)
+{
+    quat result;
+
+    result.x = a.x + b.x;
+    result.y = a.y + b.y;
+    result.z = a.z + b.z;
+    result.w = a.w + b.w;
+
+    return (result);
+}
+
+VM_API VM_INLINE void vm_quat_to_rotation_matrix_p(m4x4 *VM_RESTRICT out, quat q)
+{
+    float xx = q.x * q.x;
+    float yy = q.y * q.y;
+    float zz = q.z * q.z;
+    float xy = q.x * q.y;
+    float xz = q.x * q.z;
+    float yz = q.y * q.z;
+    float wx = q.w * q.x;
+    float wy = q.w * q.y;
+    float wz = q.w * q.z;
+
+    *out = vm_m4x4_identity;
+
+#ifdef VM_LEFT_HAND_LAYOUT
+    out->e[VM_M4X4_AT(0, 0)] = 1.0f - 2.0f * (yy + zz);
+    out->e[VM_M4X4_AT(0, 1)] = 2.0f * (xy + wz);
+    out->e[VM_M4X4_AT(0, 2)] = 2.0f * (xz - wy);
+
+    out->e[VM_M4X4_AT(1, 0)] = 2.0f * (xy - wz);
+    out->e[VM_M4X4_AT(1, 1)] = 1.0f - 2.0f * (xx + zz);
+    out->e[VM_M4X4_AT(1, 2)] = 2.0f * (yz + wx);
+
+    out->e[VM_M4X4_AT(2, 0)] = 2.0f * (xz + wy);
+    out->e[VM_M4X4_AT(2, 1)] = 2.0f * (yz - wx);
+    out->e[VM_M4X4_AT(2, 2)] = 1.0f - 2.0f * (xx + yy);
+#else
+    out->e[VM_M4X4_AT(0, 0)] = 1.0f - 2.0f * (yy + zz);
+    out->e[VM_M4X4_AT(0, 1)] = 2.0f * (xy - wz);
+    out->e[VM_M4X4_AT(0, 2)] = 2.0f * (xz + wy);
+
+    out->e[VM_M4X4_AT(1, 0)] = 2.0f * (xy + wz);
+    out->e[VM_M4X4_AT(1, 1)] = 1.0f - 2.0f * (xx + zz);
+    out->e[VM_M4X4_AT(1, 2)] = 2.0f * (yz - wx);
+
+    out->e[VM_M4X4_AT(2, 0)] = 2.0f * (xz - wy);
+    out->e[VM_M4X4_AT(2, 1)] = 2.0f * (yz + wx);
+    out->e[VM_M4X4_AT(2, 2)] = 1.0f - 2.0f * (xx + yy);
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_quat_to_rotation_matrix(quat q)
+{
+    m4x4 result;
+    vm_quat_to_rotation_matrix_p(&result, q);
+    return (result);
+}
+
+VM_API VM_INLINE quat vm_quat_look_rotation(v3 from, v3 to)
+{
+    v3 start_dir = vm_v3_normalize(from);
+    v3 end_dir = vm_v3_normalize(to);
+
+    float dot = vm_v3_dot(start_dir, end_dir);
+    v3 axis;
+    float s;
+    float invs;
+    quat q;
+
+    if (dot > 0.9999f)
+    {
+        return vm_quat_rot;
+    }
+
+    if (dot < -0.9999f)
+    {
+        v3 orthogonal = vm_v3_cross(vm_v3_up, start_dir);
+        float length_squared = (orthogonal.x * orthogonal.x) + (orthogonal.y * orthogonal.y) + (orthogonal.z * orthogonal.z);
+        quat q;
+
+        if (length_squared < 1e-6f)
+        {
+            orthogonal = vm_v3_cross(vm_v3_up, start_dir);
+        }
+        orthogonal = vm_v3_normalize(orthogonal);
+
+        q.x = orthogonal.x;
+        q.y = orthogonal.y;
+        q.z = orthogonal.z;
+        q.w = 0.0f;
+        return q;
+    }
+
+    axis = vm_v3_cross(start_dir, end_dir);
+    s = vm_sqrtf((1 + dot) * 2.0f);
+    invs = 1.0f / s;
+
+    q.x = axis.x * invs;
+    q.y = axis.y * invs;
+    q.z = axis.z * invs;
+    q.w = s * 0.5f;
+
+    return (vm_quat_normalize(q));
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_from_to_scaled(v3 start, v3 end, float scale_x, float scale_y)
+{
+    v3 dir = vm_v3_sub(end, start);
+    float dist = vm_v3_length(dir);
+
+    v3 up;
+    quat rot;
+    m4x4 rotation_matrix;
+    m4x4 scale_matrix;
+    v3 midpoint;
+    m4x4 translation_matrix;
+
+    if (dist < 1e-6f)
+    {
+        m4x4 result = vm_m4x4_identity;
+        result.e[VM_M4X4_AT(0, 0)] = 0;
+        result.e[VM_M4X4_AT(1, 1)] = 0;
+        result.e[VM_M4X4_AT(2, 2)] = 0;
+        return result;
+    }
+
+    dir = vm_v3_normalize(dir);
+
+    up = vm_v3(0.0f, 1.0f, 0.0f);
+    rot = vm_quat_look_rotation(up, dir);
+    rotation_matrix = vm_quat_to_rotation_matrix(rot);
+
+    scale_matrix = vm_m4x4_identity;
+    scale_matrix.e[VM_M4X4_AT(0, 0)] = scale_x;
+    scale_matrix.e[VM_M4X4_AT(1, 1)] = dist;
+    scale_matrix.e[VM_M4X4_AT(2, 2)] = scale_y;
+
+    midpoint = vm_v3_mulf(vm_v3_add(start, end), 0.5f);
+    translation_matrix = vm_m4x4_translate(vm_m4x4_identity, midpoint);
+
+    return vm_m4x4_mul(translation_matrix, vm_m4x4_mul(rotation_matrix, scale_matrix));
+}
+
+VM_API VM_INLINE float vm_quat_dot(quat a, quat b)
+{
+    return (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+}
+
+VM_API VM_INLINE v3 vm_v3_rotate(v3 a, quat rotation)
+{
+    quat conjugate = vm_quat_conjugate(rotation);
+    quat w = vm_quat_mulv3(rotation, a);
+    quat rotated = vm_quat_mul(w, conjugate);
+
+    return (vm_v3(rotated.x, rotated.y, rotated.z));
+}
+
+VM_API VM_INLINE v3 vm_quat_forward(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_forward, rotation));
+}
+
+VM_API VM_INLINE v3 vm_quat_back(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_back, rotation));
+}
+
+VM_API VM_INLINE v3 vm_quat_up(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_up, rotation));
+}
+
+VM_API VM_INLINE v3 vm_quat_down(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_down, rotation));
+}
+
+VM_API VM_INLINE v3 vm_quat_left(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_left, rotation));
+}
+
+VM_API VM_INLINE v3 vm_quat_right(quat rotation)
+{
+    return (vm_v3_rotate(vm_v3_right, rotation));
+}
+
+/* #############################################################################
+ * # WIDE VECTOR (AoSoA) FUNCTIONS
+ * #############################################################################
+ *
+ * The wide types hold 4 (v3x4, v4x4, quatx4) or 8 (v3x8, v4x8, quatx8) values
+ * at once where every component is stored in its own SIMD lane register. They
+ * mirror the v3/v4/quat API so per element code can process 4 or 8 elements
+ * per iteration without changing its structure.
+ *
+ * Scalar arguments (e.g. vm_v3x4_mulf) are lane values as well, use
+ * vm_f32x4_set1/vm_f32x8_set1 to pass the same value for all lanes.
+ */
+typedef struct v3x4
+{
+    f32x4 x;
+    f32x4 y;
+    f32x4 z;
+} v3x4;
+
+typedef struct v4x4
+{
+    f32x4 x;
+    f32x4 y;
+    f32x4 z;
+    f32x4 w;
+} v4x4;
+
+typedef v4x4 quatx4;
+
+VM_API VM_INLINE v3x4 vm_v3x4(f32x4 x, f32x4 y, f32x4 z)
+{
+    v3x4 result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+
+    return (result);
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE v3x4 vm_v3x4_splat(v3 a)
+{
+    return (vm_v3x4(vm_f32x4_set1(a.x), vm_f32x4_set1(a.y), vm_f32x4_set1(a.z)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_add(v3x4 a, v3x4 b)
+{
+    return (vm_v3x4(vm_f32x4_add(a.x, b.x), vm_f32x4_add(a.y, b.y), vm_f32x4_add(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_addf(v3x4 a, f32x4 b)
+{
+    return (vm_v3x4(vm_f32x4_add(a.x, b), vm_f32x4_add(a.y, b), vm_f32x4_add(a.z, b)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_sub(v3x4 a, v3x4 b)
+{
+    return (vm_v3x4(vm_f32x4_sub(a.x, b.x), vm_f32x4_sub(a.y, b.y), vm_f32x4_sub(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_subf(v3x4 a, f32x4 b)
+{
+    return (vm_v3x4(vm_f32x4_sub(a.x, b), vm_f32x4_sub(a.y, b), vm_f32x4_sub(a.z, b)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_mul(v3x4 a, v3x4 b)
+{
+    return (vm_v3x4(vm_f32x4_mul(a.x, b.x), vm_f32x4_mul(a.y, b.y), vm_f32x4_mul(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_mulf(v3x4 a, f32x4 b)
+{
+    return (vm_v3x4(vm_f32x4_mul(a.x, b), vm_f32x4_mul(a.y, b), vm_f32x4_mul(a.z, b)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_div(v3x4 a, v3x4 b)
+{
+    return (vm_v3x4(vm_f32x4_div(a.x, b.x), vm_f32x4_div(a.y, b.y), vm_f32x4_div(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_divf(v3x4 a, f32x4 b)
+{
+    return (vm_v3x4(vm_f32x4_div(a.x, b), vm_f32x4_div(a.y, b), vm_f32x4_div(a.z, b)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_cross(v3x4 a, v3x4 b)
+{
+    v3x4 result;
+
+    result.x = vm_f32x4_sub(vm_f32x4_mul(a.y, b.z), vm_f32x4_mul(a.z, b.y));
+    result.y = vm_f32x4_sub(vm_f32x4_mul(a.z, b.x), vm_f32x4_mul(a.x, b.z));
+    result.z = vm_f32x4_sub(vm_f32x4_mul(a.x, b.y), vm_f32x4_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE f32x4 vm_v3x4_dot(v3x4 a, v3x4 b)
+{
+    return (vm_f32x4_madd(a.z, b.z, vm_f32x4_madd(a.y, b.y, vm_f32x4_mul(a.x, b.x))));
+}
+
+VM_API VM_INLINE f32x4 vm_v3x4_length(v3x4 a)
+{
+    return (vm_f32x4_sqrt(vm_v3x4_dot(a, a)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_normalize(v3x4 a)
+{
+    f32x4 length_squared = vm_v3x4_dot(a, a);
+    f32x4 scalar = vm_f32x4_and(vm_f32x4_cmpgt(length_squared, vm_f32x4_set1(0.0f)), vm_f32x4_invsqrt(length_squared));
+
+    return (vm_v3x4_mulf(a, scalar));
+}
+
+/* Per lane t, lanes with t <= 0 return a and lanes with t >= 1 return b like vm_v3_lerp */
+VM_API VM_INLINE v3x4 vm_v3x4_lerp(v3x4 a, v3x4 b, f32x4 t)
+{
+    f32x4 take_a = vm_f32x4_cmple(t, vm_f32x4_set1(0.0f));
+    f32x4 take_b = vm_f32x4_cmpge(t, vm_f32x4_set1(1.0f));
+    v3x4 result = vm_v3x4_add(vm_v3x4_mulf(vm_v3x4_sub(b, a), t), a);
+
+    result.x = vm_f32x4_select(take_a, a.x, vm_f32x4_select(take_b, b.x, result.x));
+    result.y = vm_f32x4_select(take_a, a.y, vm_f32x4_select(take_b, b.y, result.y));
+    result.z = vm_f32x4_select(take_a, a.z, vm_f32x4_select(take_b, b.z, result.z));
+
+    return (result);
+}
+
+VM_API VM_INLINE f32x4 vm_v3x4_distance(v3x4 a, v3x4 b)
+{
+    v3x4 d = vm_v3x4_sub(a, b);
+    return (vm_f32x4_sqrt(vm_v3x4_dot(d, d)));
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_reflect(v3x4 incident, v3x4 normal)
+{
+    f32x4 dot = vm_v3x4_dot(incident, normal);
+    return (vm_v3x4_sub(incident, vm_v3x4_mulf(normal, vm_f32x4_mul(vm_f32x4_set1(2.0f), dot))));
+}
+
+VM_API VM_INLINE v3 vm_v3x4_get(v3x4 a, int lane)
+{
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+
+    vm_f32x4_store(x, a.x);
+    vm_f32x4_store(y, a.y);
+    vm_f32x4_store(z, a.z);
+
+    return (vm_v3(x[lane], y[lane], z[lane]));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4(f32x4 x, f32x4 y, f32x4 z, f32x4 w)
+{
+    v4x4 result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+
+    return (result);
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE v4x4 vm_v4x4_splat(v4 a)
+{
+    return (vm_v4x4(vm_f32x4_set1(a.x), vm_f32x4_set1(a.y), vm_f32x4_set1(a.z), vm_f32x4_set1(a.w)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_add(v4x4 a, v4x4 b)
+{
+    return (vm_v4x4(vm_f32x4_add(a.x, b.x), vm_f32x4_add(a.y, b.y), vm_f32x4_add(a.z, b.z), vm_f32x4_add(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_addf(v4x4 a, f32x4 b)
+{
+    return (vm_v4x4(vm_f32x4_add(a.x, b), vm_f32x4_add(a.y, b), vm_f32x4_add(a.z, b), vm_f32x4_add(a.w, b)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_sub(v4x4 a, v4x4 b)
+{
+    return (vm_v4x4(vm_f32x4_sub(a.x, b.x), vm_f32x4_sub(a.y, b.y), vm_f32x4_sub(a.z, b.z), vm_f32x4_sub(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_subf(v4x4 a, f32x4 b)
+{
+    return (vm_v4x4(vm_f32x4_sub(a.x, b), vm_f32x4_sub(a.y, b), vm_f32x4_sub(a.z, b), vm_f32x4_sub(a.w, b)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_mul(v4x4 a, v4x4 b)
+{
+    return (vm_v4x4(vm_f32x4_mul(a.x, b.x), vm_f32x4_mul(a.y, b.y), vm_f32x4_mul(a.z, b.z), vm_f32x4_mul(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_mulf(v4x4 a, f32x4 b)
+{
+    return (vm_v4x4(vm_f32x4_mul(a.x, b), vm_f32x4_mul(a.y, b), vm_f32x4_mul(a.z, b), vm_f32x4_mul(a.w, b)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_div(v4x4 a, v4x4 b)
+{
+    return (vm_v4x4(vm_f32x4_div(a.x, b.x), vm_f32x4_div(a.y, b.y), vm_f32x4_div(a.z, b.z), vm_f32x4_div(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x4 vm_v4x4_divf(v4x4 a, f32x4 b)
+{
+    return (vm_v4x4(vm_f32x4_div(a.x, b), vm_f32x4_div(a.y, b), vm_f32x4_div(a.z, b), vm_f32x4_div(a.w, b)));
+}
+
+VM_API VM_INLINE f32x4 vm_v4x4_dot(v4x4 a, v4x4 b)
+{
+    return (vm_f32x4_add(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(a.x, b.x), vm_f32x4_mul(a.y, b.y)), vm_f32x4_mul(a.z, b.z)), vm_f32x4_mul(a.w, b.w)));
+}
+
+VM_API VM_INLINE f32x4 vm_v4x4_length(v4x4 a)
+{
+    return (vm_f32x4_sqrt(vm_v4x4_dot(a, a)));
+}
+
+VM_API VM_INLINE v4 vm_v4x4_get(v4x4 a, int lane)
+{
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+    float w[VM_F32X4_WIDTH];
+
+    vm_f32x4_store(x, a.x);
+    vm_f32x4_store(y, a.y);
+    vm_f32x4_store(z, a.z);
+    vm_f32x4_store(w, a.w);
+
+    return (vm_v4(x[lane], y[lane], z[lane], w[lane]));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4(f32x4 x, f32x4 y, f32x4 z, f32x4 w)
+{
+    return (vm_v4x4(x, y, z, w));
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE quatx4 vm_quatx4_splat(quat a)
+{
+    return (vm_v4x4_splat(a));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_add(quatx4 a, quatx4 b)
+{
+    return (vm_v4x4_add(a, b));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_sub(quatx4 a, quatx4 b)
+{
+    return (vm_v4x4_sub(a, b));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_mulf(quatx4 a, f32x4 b)
+{
+    return (vm_v4x4_mulf(a, b));
+}
+
+VM_API VM_INLINE f32x4 vm_quatx4_dot(quatx4 a, quatx4 b)
+{
+    return (vm_v4x4_dot(a, b));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_conjugate(quatx4 a)
+{
+    f32x4 zero = vm_f32x4_set1(0.0f);
+    return (vm_quatx4(vm_f32x4_sub(zero, a.x), vm_f32x4_sub(zero, a.y), vm_f32x4_sub(zero, a.z), a.w));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_normalize(quatx4 a)
+{
+    return (vm_v4x4_mulf(a, vm_f32x4_invsqrt(vm_v4x4_dot(a, a))));
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_mul(quatx4 a, quatx4 b)
+{
+    quatx4 result;
+
+    result.w = vm_f32x4_sub(vm_f32x4_sub(vm_f32x4_sub(vm_f32x4_mul(a.w, b.w), vm_f32x4_mul(a.x, b.x)), vm_f32x4_mul(a.y, b.y)), vm_f32x4_mul(a.z, b.z));
+    result.x = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(a.x, b.w), vm_f32x4_mul(a.w, b.x)), vm_f32x4_mul(a.y, b.z)), vm_f32x4_mul(a.z, b.y));
+    result.y = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(a.y, b.w), vm_f32x4_mul(a.w, b.y)), vm_f32x4_mul(a.z, b.x)), vm_f32x4_mul(a.x, b.z));
+    result.z = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_add(vm_f32x4_mul(a.z, b.w), vm_f32x4_mul(a.w, b.z)), vm_f32x4_mul(a.x, b.y)), vm_f32x4_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_mulv3(quatx4 a, v3x4 b)
+{
+    quatx4 result;
+
+    result.w = vm_f32x4_sub(vm_f32x4_sub(vm_f32x4_sub(vm_f32x4_set1(0.0f), vm_f32x4_mul(a.x, b.x)), vm_f32x4_mul(a.y, b.y)), vm_f32x4_mul(a.z, b.z));
+    result.x = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_mul(a.w, b.x), vm_f32x4_mul(a.y, b.z)), vm_f32x4_mul(a.z, b.y));
+    result.y = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_mul(a.w, b.y), vm_f32x4_mul(a.z, b.x)), vm_f32x4_mul(a.x, b.z));
+    result.z = vm_f32x4_sub(vm_f32x4_add(vm_f32x4_mul(a.w, b.z), vm_f32x4_mul(a.x, b.y)), vm_f32x4_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_rotate(v3x4 a, quatx4 rotation)
+{
+    quatx4 conjugate = vm_quatx4_conjugate(rotation);
+    quatx4 w = vm_quatx4_mulv3(rotation, a);
+    quatx4 rotated = vm_quatx4_mul(w, conjugate);
+
+    return (vm_v3x4(rotated.x, rotated.y, rotated.z));
+}
+
+/* Reads the 4 values a, b, c and d into the lanes 0..3 */
+VM_API VM_INLINE v3x4 vm_v3x4_from(const v3 *a, const v3 *b, const v3 *c, const v3 *d)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps((const float *)a);
+    __m128 r1 = _mm_loadu_ps((const float *)b);
+    __m128 r2 = _mm_loadu_ps((const float *)c);
+    __m128 r3 = _mm_loadu_ps((const float *)d);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    return (vm_v3x4(r0, r1, r2));
+#else
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+
+    x[0] = a->x;
+    x[1] = b->x;
+    x[2] = c->x;
+    x[3] = d->x;
+    y[0] = a->y;
+    y[1] = b->y;
+    y[2] = c->y;
+    y[3] = d->y;
+    z[0] = a->z;
+    z[1] = b->z;
+    z[2] = c->z;
+    z[3] = d->z;
+
+    return (vm_v3x4(vm_f32x4_load(x), vm_f32x4_load(y), vm_f32x4_load(z)));
+#endif
+}
+
+/* Writes the lanes 0..3 to a, b, c and d */
+VM_API VM_INLINE void vm_v3x4_to(v3 *a, v3 *b, v3 *c, v3 *d, v3x4 v)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = v.x;
+    __m128 r1 = v.y;
+    __m128 r2 = v.z;
+    __m128 r3 = _mm_setzero_ps();
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps((float *)a, r0);
+    _mm_storeu_ps((float *)b, r1);
+    _mm_storeu_ps((float *)c, r2);
+    _mm_storeu_ps((float *)d, r3);
+#else
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+
+    vm_f32x4_store(x, v.x);
+    vm_f32x4_store(y, v.y);
+    vm_f32x4_store(z, v.z);
+
+    *a = vm_v3(x[0], y[0], z[0]);
+    *b = vm_v3(x[1], y[1], z[1]);
+    *c = vm_v3(x[2], y[2], z[2]);
+    *d = vm_v3(x[3], y[3], z[3]);
+#endif
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_load(const v3 *src)
+{
+    return (vm_v3x4_from(&src[0], &src[1], &src[2], &src[3]));
+}
+
+VM_API VM_INLINE void vm_v3x4_store(v3 *dst, v3x4 a)
+{
+    vm_v3x4_to(&dst[0], &dst[1], &dst[2], &dst[3], a);
+}
+
+VM_API VM_INLINE v3x4 vm_v3x4_gather(const v3 *src, const int *indices)
+{
+    return (vm_v3x4_from(&src[indices[0]], &src[indices[1]], &src[indices[2]], &src[indices[3]]));
+}
+
+VM_API VM_INLINE void vm_v3x4_scatter(v3 *dst, const int *indices, v3x4 a)
+{
+    vm_v3x4_to(&dst[indices[0]], &dst[indices[1]], &dst[indices[2]], &dst[indices[3]], a);
+}
+
+/* Reads the 4 values a, b, c and d into the lanes 0..3 */
+VM_API VM_INLINE quatx4 vm_quatx4_from(const quat *a, const quat *b, const quat *c, const quat *d)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps((const float *)a);
+    __m128 r1 = _mm_loadu_ps((const float *)b);
+    __m128 r2 = _mm_loadu_ps((const float *)c);
+    __m128 r3 = _mm_loadu_ps((const float *)d);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    return (vm_quatx4(r0, r1, r2, r3));
+#else
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+    float w[VM_F32X4_WIDTH];
+
+    x[0] = a->x;
+    x[1] = b->x;
+    x[2] = c->x;
+    x[3] = d->x;
+    y[0] = a->y;
+    y[1] = b->y;
+    y[2] = c->y;
+    y[3] = d->y;
+    z[0] = a->z;
+    z[1] = b->z;
+    z[2] = c->z;
+    z[3] = d->z;
+    w[0] = a->w;
+    w[1] = b->w;
+    w[2] = c->w;
+    w[3] = d->w;
+
+    return (vm_quatx4(vm_f32x4_load(x), vm_f32x4_load(y), vm_f32x4_load(z), vm_f32x4_load(w)));
+#endif
+}
+
+/* Writes the lanes 0..3 to a, b, c and d */
+VM_API VM_INLINE void vm_quatx4_to(quat *a, quat *b, quat *c, quat *d, quatx4 v)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = v.x;
+    __m128 r1 = v.y;
+    __m128 r2 = v.z;
+    __m128 r3 = v.w;
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps((float *)a, r0);
+    _mm_storeu_ps((float *)b, r1);
+    _mm_storeu_ps((float *)c, r2);
+    _mm_storeu_ps((float *)d, r3);
+#else
+    float x[VM_F32X4_WIDTH];
+    float y[VM_F32X4_WIDTH];
+    float z[VM_F32X4_WIDTH];
+    float w[VM_F32X4_WIDTH];
+
+    vm_f32x4_store(x, v.x);
+    vm_f32x4_store(y, v.y);
+    vm_f32x4_store(z, v.z);
+    vm_f32x4_store(w, v.w);
+
+    *a = vm_quat(x[0], y[0], z[0], w[0]);
+    *b = vm_quat(x[1], y[1], z[1], w[1]);
+    *c = vm_quat(x[2], y[2], z[2], w[2]);
+    *d = vm_quat(x[3], y[3], z[3], w[3]);
+#endif
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_load(const quat *src)
+{
+    return (vm_quatx4_from(&src[0], &src[1], &src[2], &src[3]));
+}
+
+VM_API VM_INLINE void vm_quatx4_store(quat *dst, quatx4 a)
+{
+    vm_quatx4_to(&dst[0], &dst[1], &dst[2], &dst[3], a);
+}
+
+VM_API VM_INLINE quatx4 vm_quatx4_gather(const quat *src, const int *indices)
+{
+    return (vm_quatx4_from(&src[indices[0]], &src[indices[1]], &src[indices[2]], &src[indices[3]]));
+}
+
+VM_API VM_INLINE void vm_quatx4_scatter(quat *dst, const int *indices, quatx4 a)
+{
+    vm_quatx4_to(&dst[indices[0]], &dst[indices[1]], &dst[indices[2]], &dst[indices[3]], a);
+}
+
+typedef struct v3x8
+{
+    f32x8 x;
+    f32x8 y;
+    f32x8 z;
+} v3x8;
+
+typedef struct v4x8
+{
+    f32x8 x;
+    f32x8 y;
+    f32x8 z;
+    f32x8 w;
+} v4x8;
+
+typedef v4x8 quatx8;
+
+VM_API VM_INLINE v3x8 vm_v3x8(f32x8 x, f32x8 y, f32x8 z)
+{
+    v3x8 result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+
+    return (result);
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE v3x8 vm_v3x8_splat(v3 a)
+{
+    return (vm_v3x8(vm_f32x8_set1(a.x), vm_f32x8_set1(a.y), vm_f32x8_set1(a.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_add(v3x8 a, v3x8 b)
+{
+    return (vm_v3x8(vm_f32x8_add(a.x, b.x), vm_f32x8_add(a.y, b.y), vm_f32x8_add(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_addf(v3x8 a, f32x8 b)
+{
+    return (vm_v3x8(vm_f32x8_add(a.x, b), vm_f32x8_add(a.y, b), vm_f32x8_add(a.z, b)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_sub(v3x8 a, v3x8 b)
+{
+    return (vm_v3x8(vm_f32x8_sub(a.x, b.x), vm_f32x8_sub(a.y, b.y), vm_f32x8_sub(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_subf(v3x8 a, f32x8 b)
+{
+    return (vm_v3x8(vm_f32x8_sub(a.x, b), vm_f32x8_sub(a.y, b), vm_f32x8_sub(a.z, b)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_mul(v3x8 a, v3x8 b)
+{
+    return (vm_v3x8(vm_f32x8_mul(a.x, b.x), vm_f32x8_mul(a.y, b.y), vm_f32x8_mul(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_mulf(v3x8 a, f32x8 b)
+{
+    return (vm_v3x8(vm_f32x8_mul(a.x, b), vm_f32x8_mul(a.y, b), vm_f32x8_mul(a.z, b)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_div(v3x8 a, v3x8 b)
+{
+    return (vm_v3x8(vm_f32x8_div(a.x, b.x), vm_f32x8_div(a.y, b.y), vm_f32x8_div(a.z, b.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_divf(v3x8 a, f32x8 b)
+{
+    return (vm_v3x8(vm_f32x8_div(a.x, b), vm_f32x8_div(a.y, b), vm_f32x8_div(a.z, b)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_cross(v3x8 a, v3x8 b)
+{
+    v3x8 result;
+
+    result.x = vm_f32x8_sub(vm_f32x8_mul(a.y, b.z), vm_f32x8_mul(a.z, b.y));
+    result.y = vm_f32x8_sub(vm_f32x8_mul(a.z, b.x), vm_f32x8_mul(a.x, b.z));
+    result.z = vm_f32x8_sub(vm_f32x8_mul(a.x, b.y), vm_f32x8_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE f32x8 vm_v3x8_dot(v3x8 a, v3x8 b)
+{
+    return (vm_f32x8_madd(a.z, b.z, vm_f32x8_madd(a.y, b.y, vm_f32x8_mul(a.x, b.x))));
+}
+
+VM_API VM_INLINE f32x8 vm_v3x8_length(v3x8 a)
+{
+    return (vm_f32x8_sqrt(vm_v3x8_dot(a, a)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_normalize(v3x8 a)
+{
+    f32x8 length_squared = vm_v3x8_dot(a, a);
+    f32x8 scalar = vm_f32x8_and(vm_f32x8_cmpgt(length_squared, vm_f32x8_set1(0.0f)), vm_f32x8_invsqrt(length_squared));
+
+    return (vm_v3x8_mulf(a, scalar));
+}
+
+/* Per lane t, lanes with t <= 0 return a and lanes with t >= 1 return b like vm_v3_lerp */
+VM_API VM_INLINE v3x8 vm_v3x8_lerp(v3x8 a, v3x8 b, f32x8 t)
+{
+    f32x8 take_a = vm_f32x8_cmple(t, vm_f32x8_set1(0.0f));
+    f32x8 take_b = vm_f32x8_cmpge(t, vm_f32x8_set1(1.0f));
+    v3x8 result = vm_v3x8_add(vm_v3x8_mulf(vm_v3x8_sub(b, a), t), a);
+
+    result.x = vm_f32x8_select(take_a, a.x, vm_f32x8_select(take_b, b.x, result.x));
+    result.y = vm_f32x8_select(take_a, a.y, vm_f32x8_select(take_b, b.y, result.y));
+    result.z = vm_f32x8_select(take_a, a.z, vm_f32x8_select(take_b, b.z, result.z));
+
+    return (result);
+}
+
+VM_API VM_INLINE f32x8 vm_v3x8_distance(v3x8 a, v3x8 b)
+{
+    v3x8 d = vm_v3x8_sub(a, b);
+    return (vm_f32x8_sqrt(vm_v3x8_dot(d, d)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_reflect(v3x8 incident, v3x8 normal)
+{
+    f32x8 dot = vm_v3x8_dot(incident, normal);
+    return (vm_v3x8_sub(incident, vm_v3x8_mulf(normal, vm_f32x8_mul(vm_f32x8_set1(2.0f), dot))));
+}
+
+VM_API VM_INLINE v3 vm_v3x8_get(v3x8 a, int lane)
+{
+    float x[VM_F32X8_WIDTH];
+    float y[VM_F32X8_WIDTH];
+    float z[VM_F32X8_WIDTH];
+
+    vm_f32x8_store(x, a.x);
+    vm_f32x8_store(y, a.y);
+    vm_f32x8_store(z, a.z);
+
+    return (vm_v3(x[lane], y[lane], z[lane]));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8(f32x8 x, f32x8 y, f32x8 z, f32x8 w)
+{
+    v4x8 result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+
+    return (result);
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE v4x8 vm_v4x8_splat(v4 a)
+{
+    return (vm_v4x8(vm_f32x8_set1(a.x), vm_f32x8_set1(a.y), vm_f32x8_set1(a.z), vm_f32x8_set1(a.w)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_add(v4x8 a, v4x8 b)
+{
+    return (vm_v4x8(vm_f32x8_add(a.x, b.x), vm_f32x8_add(a.y, b.y), vm_f32x8_add(a.z, b.z), vm_f32x8_add(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_addf(v4x8 a, f32x8 b)
+{
+    return (vm_v4x8(vm_f32x8_add(a.x, b), vm_f32x8_add(a.y, b), vm_f32x8_add(a.z, b), vm_f32x8_add(a.w, b)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_sub(v4x8 a, v4x8 b)
+{
+    return (vm_v4x8(vm_f32x8_sub(a.x, b.x), vm_f32x8_sub(a.y, b.y), vm_f32x8_sub(a.z, b.z), vm_f32x8_sub(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_subf(v4x8 a, f32x8 b)
+{
+    return (vm_v4x8(vm_f32x8_sub(a.x, b), vm_f32x8_sub(a.y, b), vm_f32x8_sub(a.z, b), vm_f32x8_sub(a.w, b)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_mul(v4x8 a, v4x8 b)
+{
+    return (vm_v4x8(vm_f32x8_mul(a.x, b.x), vm_f32x8_mul(a.y, b.y), vm_f32x8_mul(a.z, b.z), vm_f32x8_mul(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_mulf(v4x8 a, f32x8 b)
+{
+    return (vm_v4x8(vm_f32x8_mul(a.x, b), vm_f32x8_mul(a.y, b), vm_f32x8_mul(a.z, b), vm_f32x8_mul(a.w, b)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_div(v4x8 a, v4x8 b)
+{
+    return (vm_v4x8(vm_f32x8_div(a.x, b.x), vm_f32x8_div(a.y, b.y), vm_f32x8_div(a.z, b.z), vm_f32x8_div(a.w, b.w)));
+}
+
+VM_API VM_INLINE v4x8 vm_v4x8_divf(v4x8 a, f32x8 b)
+{
+    return (vm_v4x8(vm_f32x8_div(a.x, b), vm_f32x8_div(a.y, b), vm_f32x8_div(a.z, b), vm_f32x8_div(a.w, b)));
+}
+
+VM_API VM_INLINE f32x8 vm_v4x8_dot(v4x8 a, v4x8 b)
+{
+    return (vm_f32x8_add(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(a.x, b.x), vm_f32x8_mul(a.y, b.y)), vm_f32x8_mul(a.z, b.z)), vm_f32x8_mul(a.w, b.w)));
+}
+
+VM_API VM_INLINE f32x8 vm_v4x8_length(v4x8 a)
+{
+    return (vm_f32x8_sqrt(vm_v4x8_dot(a, a)));
+}
+
+VM_API VM_INLINE v4 vm_v4x8_get(v4x8 a, int lane)
+{
+    float x[VM_F32X8_WIDTH];
+    float y[VM_F32X8_WIDTH];
+    float z[VM_F32X8_WIDTH];
+    float w[VM_F32X8_WIDTH];
+
+    vm_f32x8_store(x, a.x);
+    vm_f32x8_store(y, a.y);
+    vm_f32x8_store(z, a.z);
+    vm_f32x8_store(w, a.w);
+
+    return (vm_v4(x[lane], y[lane], z[lane], w[lane]));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8(f32x8 x, f32x8 y, f32x8 z, f32x8 w)
+{
+    return (vm_v4x8(x, y, z, w));
+}
+
+/* Broadcasts a to all lanes */
+VM_API VM_INLINE quatx8 vm_quatx8_splat(quat a)
+{
+    return (vm_v4x8_splat(a));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_add(quatx8 a, quatx8 b)
+{
+    return (vm_v4x8_add(a, b));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_sub(quatx8 a, quatx8 b)
+{
+    return (vm_v4x8_sub(a, b));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_mulf(quatx8 a, f32x8 b)
+{
+    return (vm_v4x8_mulf(a, b));
+}
+
+VM_API VM_INLINE f32x8 vm_quatx8_dot(quatx8 a, quatx8 b)
+{
+    return (vm_v4x8_dot(a, b));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_conjugate(quatx8 a)
+{
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    return (vm_quatx8(vm_f32x8_sub(zero, a.x), vm_f32x8_sub(zero, a.y), vm_f32x8_sub(zero, a.z), a.w));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_normalize(quatx8 a)
+{
+    return (vm_v4x8_mulf(a, vm_f32x8_invsqrt(vm_v4x8_dot(a, a))));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_mul(quatx8 a, quatx8 b)
+{
+    quatx8 result;
+
+    result.w = vm_f32x8_sub(vm_f32x8_sub(vm_f32x8_sub(vm_f32x8_mul(a.w, b.w), vm_f32x8_mul(a.x, b.x)), vm_f32x8_mul(a.y, b.y)), vm_f32x8_mul(a.z, b.z));
+    result.x = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(a.x, b.w), vm_f32x8_mul(a.w, b.x)), vm_f32x8_mul(a.y, b.z)), vm_f32x8_mul(a.z, b.y));
+    result.y = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(a.y, b.w), vm_f32x8_mul(a.w, b.y)), vm_f32x8_mul(a.z, b.x)), vm_f32x8_mul(a.x, b.z));
+    result.z = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_add(vm_f32x8_mul(a.z, b.w), vm_f32x8_mul(a.w, b.z)), vm_f32x8_mul(a.x, b.y)), vm_f32x8_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_mulv3(quatx8 a, v3x8 b)
+{
+    quatx8 result;
+
+    result.w = vm_f32x8_sub(vm_f32x8_sub(vm_f32x8_sub(vm_f32x8_set1(0.0f), vm_f32x8_mul(a.x, b.x)), vm_f32x8_mul(a.y, b.y)), vm_f32x8_mul(a.z, b.z));
+    result.x = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_mul(a.w, b.x), vm_f32x8_mul(a.y, b.z)), vm_f32x8_mul(a.z, b.y));
+    result.y = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_mul(a.w, b.y), vm_f32x8_mul(a.z, b.x)), vm_f32x8_mul(a.x, b.z));
+    result.z = vm_f32x8_sub(vm_f32x8_add(vm_f32x8_mul(a.w, b.z), vm_f32x8_mul(a.x, b.y)), vm_f32x8_mul(a.y, b.x));
+
+    return (result);
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_rotate(v3x8 a, quatx8 rotation)
+{
+    quatx8 conjugate = vm_quatx8_conjugate(rotation);
+    quatx8 w = vm_quatx8_mulv3(rotation, a);
+    quatx8 rotated = vm_quatx8_mul(w, conjugate);
+
+    return (vm_v3x8(rotated.x, rotated.y, rotated.z));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_load(const v3 *src)
+{
+    v3x4 lo = vm_v3x4_load(src);
+    v3x4 hi = vm_v3x4_load(src + VM_F32X4_WIDTH);
+
+    return (vm_v3x8(vm_f32x8_combine(lo.x, hi.x), vm_f32x8_combine(lo.y, hi.y), vm_f32x8_combine(lo.z, hi.z)));
+}
+
+VM_API VM_INLINE void vm_v3x8_store(v3 *dst, v3x8 a)
+{
+    vm_v3x4_store(dst, vm_v3x4(vm_f32x8_lo(a.x), vm_f32x8_lo(a.y), vm_f32x8_lo(a.z)));
+    vm_v3x4_store(dst + VM_F32X4_WIDTH, vm_v3x4(vm_f32x8_hi(a.x), vm_f32x8_hi(a.y), vm_f32x8_hi(a.z)));
+}
+
+VM_API VM_INLINE v3x8 vm_v3x8_gather(const v3 *src, const int *indices)
+{
+    v3x4 lo = vm_v3x4_gather(src, indices);
+    v3x4 hi = vm_v3x4_gather(src, indices + VM_F32X4_WIDTH);
+
+    return (vm_v3x8(vm_f32x8_combine(lo.x, hi.x), vm_f32x8_combine(lo.y, hi.y), vm_f32x8_combine(lo.z, hi.z)));
+}
+
+VM_API VM_INLINE void vm_v3x8_scatter(v3 *dst, const int *indices, v3x8 a)
+{
+    vm_v3x4_scatter(dst, indices, vm_v3x4(vm_f32x8_lo(a.x), vm_f32x8_lo(a.y), vm_f32x8_lo(a.z)));
+    vm_v3x4_scatter(dst, indices + VM_F32X4_WIDTH, vm_v3x4(vm_f32x8_hi(a.x), vm_f32x8_hi(a.y), vm_f32x8_hi(a.z)));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_load(const quat *src)
+{
+    quatx4 lo = vm_quatx4_load(src);
+    quatx4 hi = vm_quatx4_load(src + VM_F32X4_WIDTH);
+
+    return (vm_quatx8(vm_f32x8_combine(lo.x, hi.x), vm_f32x8_combine(lo.y, hi.y), vm_f32x8_combine(lo.z, hi.z), vm_f32x8_combine(lo.w, hi.w)));
+}
+
+VM_API VM_INLINE void vm_quatx8_store(quat *dst, quatx8 a)
+{
+    vm_quatx4_store(dst, vm_quatx4(vm_f32x8_lo(a.x), vm_f32x8_lo(a.y), vm_f32x8_lo(a.z), vm_f32x8_lo(a.w)));
+    vm_quatx4_store(dst + VM_F32X4_WIDTH, vm_quatx4(vm_f32x8_hi(a.x), vm_f32x8_hi(a.y), vm_f32x8_hi(a.z), vm_f32x8_hi(a.w)));
+}
+
+VM_API VM_INLINE quatx8 vm_quatx8_gather(const quat *src, const int *indices)
+{
+    quatx4 lo = vm_quatx4_gather(src, indices);
+    quatx4 hi = vm_quatx4_gather(src, indices + VM_F32X4_WIDTH);
+
+    return (vm_quatx8(vm_f32x8_combine(lo.x, hi.x), vm_f32x8_combine(lo.y, hi.y), vm_f32x8_combine(lo.z, hi.z), vm_f32x8_combine(lo.w, hi.w)));
+}
+
+VM_API VM_INLINE void vm_quatx8_scatter(quat *dst, const int *indices, quatx8 a)
+{
+    vm_quatx4_scatter(dst, indices, vm_quatx4(vm_f32x8_lo(a.x), vm_f32x8_lo(a.y), vm_f32x8_lo(a.z), vm_f32x8_lo(a.w)));
+    vm_quatx4_scatter(dst, indices + VM_F32X4_WIDTH, vm_quatx4(vm_f32x8_hi(a.x), vm_f32x8_hi(a.y), vm_f32x8_hi(a.z), vm_f32x8_hi(a.w)));
+}
+
+/* #############################################################################
+ * # MATRIX 4x4 BATCH TRANSFORM FUNCTIONS
+ * #############################################################################
+ *
+ * Transforms arrays of points (w = 1), direction vectors (w = 0) and normals
+ * (inverse transpose) by a m4x4. The matrix is read through VM_M4X4_AT so the
+ * same kernels work for column-major and VM_M4X4_ROW_MAJOR_ORDER. The result
+ * is not divided by w, use a projection for perspective transforms.
+ *
+ * The batch functions process 8 (VM_USE_AVX2) or 4 elements per step with the
+ * wide types and finish the remaining elements with the same scalar math.
+ * "in" and "out" may point to the same array.
+ */
+
+/* Returns m * (p, 1) */
+VM_API VM_INLINE v3 vm_m4x4_transform_point(const m4x4 *m, v3 p)
+{
+    const float *e = m->e;
+
+    return (vm_v3(
+        vm_fmaf(p.z, e[VM_M4X4_AT(0, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(0, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(0, 0)], e[VM_M4X4_AT(0, 3)]))),
+        vm_fmaf(p.z, e[VM_M4X4_AT(1, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(1, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(1, 0)], e[VM_M4X4_AT(1, 3)]))),
+        vm_fmaf(p.z, e[VM_M4X4_AT(2, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(2, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(2, 0)], e[VM_M4X4_AT(2, 3)])))));
+}
+
+/* Returns m * (v, 0), the translation is ignored */
+VM_API VM_INLINE v3 vm_m4x4_transform_vector(const m4x4 *m, v3 v)
+{
+    const float *e = m->e;
+
+    return (vm_v3(
+        vm_fmaf(v.z, e[VM_M4X4_AT(0, 2)], vm_fmaf(v.y, e[VM_M4X4_AT(0, 1)], v.x * e[VM_M4X4_AT(0, 0)])),
+        vm_fmaf(v.z, e[VM_M4X4_AT(1, 2)], vm_fmaf(v.y, e[VM_M4X4_AT(1, 1)], v.x * e[VM_M4X4_AT(1, 0)])),
+        vm_fmaf(v.z, e[VM_M4X4_AT(2, 2)], vm_fmaf(v.y, e[VM_M4X4_AT(2, 1)], v.x * e[VM_M4X4_AT(2, 0)]))));
+}
+
+/* Returns the inverse transpose of the upper 3x3 part of m for transforming
+ * normals (the result is not normalized). Returns vm_m4x4_zero if singular. */
+VM_API VM_INLINE m4x4 vm_m4x4_normal_matrix(const m4x4 *m)
+{
+    const float *e = m->e;
+    m4x4 result = vm_m4x4_zero;
+
+    float a = e[VM_M4X4_AT(0, 0)], b = e[VM_M4X4_AT(0, 1)], c = e[VM_M4X4_AT(0, 2)];
+    float d = e[VM_M4X4_AT(1, 0)], f = e[VM_M4X4_AT(1, 1)], g = e[VM_M4X4_AT(1, 2)];
+    float h = e[VM_M4X4_AT(2, 0)], k = e[VM_M4X4_AT(2, 1)], l = e[VM_M4X4_AT(2, 2)];
+
+    /* Cofactors, the cofactor matrix equals det * inverse transpose */
+    float c00 = (f * l) - (g * k);
+    float c01 = (g * h) - (d * l);
+    float c02 = (d * k) - (f * h);
+    float c10 = (c * k) - (b * l);
+    float c11 = (a * l) - (c * h);
+    float c12 = (b * h) - (a * k);
+    float c20 = (b * g) - (c * f);
+    float c21 = (c * d) - (a * g);
+    float c22 = (a * f) - (b * d);
+
+    float det = (a * c00) + (b * c01) + (c * c02);
+    float inv_det;
+
+    if (det == 0.0f)
+    {
+        return (result);
+    }
+
+    inv_det = 1.0f / det;
+
+    result.e[VM_M4X4_AT(0, 0)] = c00 * inv_det;
+    result.e[VM_M4X4_AT(0, 1)] = c01 * inv_det;
+    result.e[VM_M4X4_AT(0, 2)] = c02 * inv_det;
+    result.e[VM_M4X4_AT(1, 0)] = c10 * inv_det;
+    result.e[VM_M4X4_AT(1, 1)] = c11 * inv_det;
+    result.e[VM_M4X4_AT(1, 2)] = c12 * inv_det;
+    result.e[VM_M4X4_AT(2, 0)] = c20 * inv_det;
+    result.e[VM_M4X4_AT(2, 1)] = c21 * inv_det;
+    result.e[VM_M4X4_AT(2, 2)] = c22 * inv_det;
+    result.e[VM_M4X4_AT(3, 3)] = 1.0f;
+
+    return (result);
+}
+
+/* Returns the normal n transformed by the inverse transpose of m (not normalized) */
+VM_API VM_INLINE v3 vm_m4x4_transform_normal(const m4x4 *m, v3 n)
+{
+    m4x4 normal_matrix = vm_m4x4_normal_matrix(m);
+    return (vm_m4x4_transform_vector(&normal_matrix, n));
+}
+
+/* Returns m * (p, 1) for all 4 lanes */
+VM_API VM_INLINE v3x4 vm_v3x4_transform_point(const m4x4 *m, v3x4 p)
+{
+    const float *e = m->e;
+    v3x4 result;
+
+    result.x = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(0, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(0, 3)]))));
+    result.y = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(1, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(1, 3)]))));
+    result.z = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(2, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(2, 3)]))));
+
+    return (result);
+}
+
+/* Returns m * (p, 0) for all 4 lanes */
+VM_API VM_INLINE v3x4 vm_v3x4_transform_vector(const m4x4 *m, v3x4 p)
+{
+    const float *e = m->e;
+    v3x4 result;
+
+    result.x = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x4_mul(p.x, vm_f32x4_set1(e[VM_M4X4_AT(0, 0)]))));
+    result.y = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x4_mul(p.x, vm_f32x4_set1(e[VM_M4X4_AT(1, 0)]))));
+    result.z = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x4_mul(p.x, vm_f32x4_set1(e[VM_M4X4_AT(2, 0)]))));
+
+    return (result);
+}
+
+/* Returns m * (p, 1) for all 8 lanes */
+VM_API VM_INLINE v3x8 vm_v3x8_transform_point(const m4x4 *m, v3x8 p)
+{
+    const float *e = m->e;
+    v3x8 result;
+
+    result.x = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(0, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(0, 3)]))));
+    result.y = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(1, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(1, 3)]))));
+    result.z = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(2, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(2, 3)]))));
+
+    return (result);
+}
+
+/* Returns m * (p, 0) for all 8 lanes */
+VM_API VM_INLINE v3x8 vm_v3x8_transform_vector(const m4x4 *m, v3x8 p)
+{
+    const float *e = m->e;
+    v3x8 result;
+
+    result.x = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x8_mul(p.x, vm_f32x8_set1(e[VM_M4X4_AT(0, 0)]))));
+    result.y = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x8_mul(p.x, vm_f32x8_set1(e[VM_M4X4_AT(1, 0)]))));
+    result.z = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x8_mul(p.x, vm_f32x8_set1(e[VM_M4X4_AT(2, 0)]))));
+
+    return (result);
+}
+
+VM_API VM_INLINE void vm_m4x4_transform_points(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    /* Local copy, the stores to out can not alias it so the broadcasts stay out of the loops */
+    m4x4 matrix = *m;
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= n; i += VM_F32X8_WIDTH)
+    {
+        vm_v3x8_store(&out[i], vm_v3x8_transform_point(&matrix, vm_v3x8_load(&in[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= n; i += VM_F32X4_WIDTH)
+    {
+        vm_v3x4_store(&out[i], vm_v3x4_transform_point(&matrix, vm_v3x4_load(&in[i])));
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = vm_m4x4_transform_point(&matrix, in[i]);
+    }
+}
+
+VM_API VM_INLINE void vm_m4x4_transform_vectors(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    /* Local copy, the stores to out can not alias it so the broadcasts stay out of the loops */
+    m4x4 matrix = *m;
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= n; i += VM_F32X8_WIDTH)
+    {
+        vm_v3x8_store(&out[i], vm_v3x8_transform_vector(&matrix, vm_v3x8_load(&in[i])));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= n; i += VM_F32X4_WIDTH)
+    {
+        vm_v3x4_store(&out[i], vm_v3x4_transform_vector(&matrix, vm_v3x4_load(&in[i])));
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = vm_m4x4_transform_vector(&matrix, in[i]);
+    }
+}
+
+/* Transforms normals by the inverse transpose of m (not normalized) */
+VM_API VM_INLINE void vm_m4x4_transform_normals(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    m4x4 normal_matrix = vm_m4x4_normal_matrix(m);
+    vm_m4x4_transform_vectors(&normal_matrix, in, out, n);
+}
+
+VM_API VM_INLINE void vm_m4x4_transform_points_soa(const m4x4 *m, v3_soa *in, v3_soa *out)
+{
+    m4x4 matrix = *m;
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        v3x8 r = vm_v3x8_transform_point(&matrix, vm_v3x8(vm_f32x8_load(&in->x[i]), vm_f32x8_load(&in->y[i]), vm_f32x8_load(&in->z[i])));
+
+        vm_f32x8_store(&out->x[i], r.x);
+        vm_f32x8_store(&out->y[i], r.y);
+        vm_f32x8_store(&out->z[i], r.z);
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        v3x4 r = vm_v3x4_transform_point(&matrix, vm_v3x4(vm_f32x4_load(&in->x[i]), vm_f32x4_load(&in->y[i]), vm_f32x4_load(&in->z[i])));
+
+        vm_f32x4_store(&out->x[i], r.x);
+        vm_f32x4_store(&out->y[i], r.y);
+        vm_f32x4_store(&out->z[i], r.z);
+    }
+
+    for (; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_m4x4_transform_point(&matrix, vm_v3_soa_get(in, i)));
+    }
+}
+
+VM_API VM_INLINE void vm_m4x4_transform_vectors_soa(const m4x4 *m, v3_soa *in, v3_soa *out)
+{
+    m4x4 matrix = *m;
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= out->count; i += VM_F32X8_WIDTH)
+    {
+        v3x8 r = vm_v3x8_transform_vector(&matrix, vm_v3x8(vm_f32x8_load(&in->x[i]), vm_f32x8_load(&in->y[i]), vm_f32x8_load(&in->z[i])));
+
+        vm_f32x8_store(&out->x[i], r.x);
+        vm_f32x8_store(&out->y[i], r.y);
+        vm_f32x8_store(&out->z[i], r.z);
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= out->count; i += VM_F32X4_WIDTH)
+    {
+        v3x4 r = vm_v3x4_transform_vector(&matrix, vm_v3x4(vm_f32x4_load(&in->x[i]), vm_f32x4_load(&in->y[i]), vm_f32x4_load(&in->z[i])));
+
+        vm_f32x4_store(&out->x[i], r.x);
+        vm_f32x4_store(&out->y[i], r.y);
+        vm_f32x4_store(&out->z[i], r.z);
+    }
+
+    for (; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_m4x4_transform_vector(&matrix, vm_v3_soa_get(in, i)));
+    }
+}
+
+VM_API VM_INLINE void vm_m4x4_transform_normals_soa(const m4x4 *m, v3_soa *in, v3_soa *out)
+{
+    m4x4 normal_matrix = vm_m4x4_normal_matrix(m);
+    vm_m4x4_transform_vectors_soa(&normal_matrix, in, out);
+}
+
+/* #############################################################################
+ * # MATRIX 3x4 (AFFINE) FUNCTIONS
+ * #############################################################################
+ */
+#define VM_M3X4_ELEMENT_COUNT 12
+
+/* A m3x4 is an affine 4x4 matrix without its implicit bottom row (0, 0, 0, 1).
+   It is always stored as three rows (linear part | translation), independent
+   of VM_M4X4_ROW_MAJOR_ORDER, so every row fits into one SSE register. */
+#define VM_M3X4_AT(row, col) ((row) * 4 + (col))
+
+typedef struct m3x4
+{
+    float e[VM_M3X4_ELEMENT_COUNT];
+} m3x4;
+
+static const m3x4 vm_m3x4_zero =
+    {{0.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f}};
+
+static const m3x4 vm_m3x4_identity =
+    {{1.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 1.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, 1.0f, 0.0f}};
+
+/* Drops the bottom row of an affine m4x4 */
+VM_API VM_INLINE void vm_m3x4_from_m4x4_p(m3x4 *VM_RESTRICT out, const m4x4 *m)
+{
+#if defined(VM_USE_SSE) && defined(VM_M4X4_ROW_MAJOR_ORDER)
+    _mm_storeu_ps(&out->e[0], _mm_loadu_ps(&m->e[0]));
+    _mm_storeu_ps(&out->e[4], _mm_loadu_ps(&m->e[4]));
+    _mm_storeu_ps(&out->e[8], _mm_loadu_ps(&m->e[8]));
+#elif defined(VM_USE_SSE)
+    __m128 c0 = _mm_loadu_ps(&m->e[0]);
+    __m128 c1 = _mm_loadu_ps(&m->e[4]);
+    __m128 c2 = _mm_loadu_ps(&m->e[8]);
+    __m128 c3 = _mm_loadu_ps(&m->e[12]);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    _mm_storeu_ps(&out->e[0], c0);
+    _mm_storeu_ps(&out->e[4], c1);
+    _mm_storeu_ps(&out->e[8], c2);
+#else
+    int i;
+    for (i = 0; i < 3; ++i)
+    {
+        out->e[VM_M3X4_AT(i, 0)] = m->e[VM_M4X4_AT(i, 0)];
+        out->e[VM_M3X4_AT(i, 1)] = m->e[VM_M4X4_AT(i, 1)];
+        out->e[VM_M3X4_AT(i, 2)] = m->e[VM_M4X4_AT(i, 2)];
+        out->e[VM_M3X4_AT(i, 3)] = m->e[VM_M4X4_AT(i, 3)];
+    }
+#endif
+}
+
+VM_API VM_INLINE m3x4 vm_m3x4_from_m4x4(m4x4 m)
+{
+    m3x4 result;
+    vm_m3x4_from_m4x4_p(&result, &m);
+    return (result);
+}
+
+/* Appends the bottom row (0, 0, 0, 1) */
+VM_API VM_INLINE void vm_m4x4_from_m3x4_p(m4x4 *VM_RESTRICT out, const m3x4 *m)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps(&m->e[0]);
+    __m128 r1 = _mm_loadu_ps(&m->e[4]);
+    __m128 r2 = _mm_loadu_ps(&m->e[8]);
+    __m128 r3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+#ifndef VM_M4X4_ROW_MAJOR_ORDER
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+#endif
+
+    _mm_storeu_ps(&out->e[0], r0);
+    _mm_storeu_ps(&out->e[4], r1);
+    _mm_storeu_ps(&out->e[8], r2);
+    _mm_storeu_ps(&out->e[12], r3);
+#else
+    int i;
+    for (i = 0; i < 3; ++i)
+    {
+        out->e[VM_M4X4_AT(i, 0)] = m->e[VM_M3X4_AT(i, 0)];
+        out->e[VM_M4X4_AT(i, 1)] = m->e[VM_M3X4_AT(i, 1)];
+        out->e[VM_M4X4_AT(i, 2)] = m->e[VM_M3X4_AT(i, 2)];
+        out->e[VM_M4X4_AT(i, 3)] = m->e[VM_M3X4_AT(i, 3)];
+    }
+    out->e[VM_M4X4_AT(3, 0)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 1)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 2)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 3)] = 1.0f;
+#endif
+}
+
+VM_API VM_INLINE m4x4 vm_m4x4_from_m3x4(m3x4 m)
+{
+    m4x4 result;
+    vm_m4x4_from_m3x4_p(&result, &m);
+    return (result);
+}
+
+/* out = a * b (36 multiplies instead of 64 for the m4x4 product), out must not point to a or b */
+VM_API VM_INLINE void vm_m3x4_mul_p(m3x4 *VM_RESTRICT out, const m3x4 *a, const m3x4 *b)
+{
+#ifdef VM_USE_SSE
+    __m128 b0 = _mm_loadu_ps(&b->e[0]);
+    __m128 b1 = _mm_loadu_ps(&b->e[4]);
+    __m128 b2 = _mm_loadu_ps(&b->e[8]);
+    __m128 w = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        __m128 arow = _mm_loadu_ps(&a->e[VM_M3X4_AT(i, 0)]);
+
+        /* the implicit bottom row of b only adds the translation of a */
+        __m128 sum = _mm_mul_ps(arow, w);
+        sum = vm_f32x4_madd(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(0, 0, 0, 0)), b0, sum);
+        sum = vm_f32x4_madd(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(1, 1, 1, 1)), b1, sum);
+        sum = vm_f32x4_madd(_mm_shuffle_ps(arow, arow, _MM_SHUFFLE(2, 2, 2, 2)), b2, sum);
+
+        _mm_storeu_ps(&out->e[VM_M3X4_AT(i, 0)], sum);
+    }
+#else
+    int i;
+    for (i = 0; i < 3; ++i)
+    {
+        float a0 = a->e[VM_M3X4_AT(i, 0)];
+        float a1 = a->e[VM_M3X4_AT(i, 1)];
+        float a2 = a->e[VM_M3X4_AT(i, 2)];
+
+        out->e[VM_M3X4_AT(i, 0)] = a0 * b->e[VM_M3X4_AT(0, 0)] + a1 * b->e[VM_M3X4_AT(1, 0)] + a2 * b->e[VM_M3X4_AT(2, 0)];
+        out->e[VM_M3X4_AT(i, 1)] = a0 * b->e[VM_M3X4_AT(0, 1)] + a1 * b->e[VM_M3X4_AT(1, 1)] + a2 * b->e[VM_M3X4_AT(2, 1)];
+        out->e[VM_M3X4_AT(i, 2)] = a0 * b->e[VM_M3X4_AT(0, 2)] + a1 * b->e[VM_M3X4_AT(1, 2)] + a2 * b->e[VM_M3X4_AT(2, 2)];
+        out->e[VM_M3X4_AT(i, 3)] = a0 * b->e[VM_M3X4_AT(0, 3)] + a1 * b->e[VM_M3X4_AT(1, 3)] + a2 * b->e[VM_M3X4_AT(2, 3)] + a->e[VM_M3X4_AT(i, 3)];
+    }
+#endif
+}
+
+VM_API VM_INLINE m3x4 vm_m3x4_mul(m3x4 a, m3x4 b)
+{
+    m3x4 result;
+    vm_m3x4_mul_p(&result, &a, &b);
+    return (result);
+}
+
+/* out = inverse of m (vm_m3x4_zero if the linear part is singular), out must not point to m */
+VM_API VM_INLINE void vm_m3x4_inverse_p(m3x4 *VM_RESTRICT out, const m3x4 *m)
+{
+#ifdef VM_USE_SSE
+    __m128 r0 = _mm_loadu_ps(&m->e[0]);
+    __m128 r1 = _mm_loadu_ps(&m->e[4]);
+    __m128 r2 = _mm_loadu_ps(&m->e[8]);
+
+    /* columns of the adjugate of the linear part, the w lanes are 0.0f */
+    __m128 x0 = vm_v3_cross_f32x4(r1, r2);
+    __m128 x1 = vm_v3_cross_f32x4(r2, r0);
+    __m128 x2 = vm_v3_cross_f32x4(r0, r1);
+
+    __m128 d = _mm_mul_ps(r0, x0);
+    __m128 t;
+    __m128 inv_det;
+    float det;
+
+    d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+    det = _mm_cvtss_f32(_mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))));
+
+    if (det == 0.0f)
+    {
+        *out = vm_m3x4_zero;
+        return;
+    }
+
+    inv_det = _mm_set1_ps(1.0f / det);
+    x0 = _mm_mul_ps(x0, inv_det);
+    x1 = _mm_mul_ps(x1, inv_det);
+    x2 = _mm_mul_ps(x2, inv_det);
+
+    /* -inverse(A) * t, transposing puts it into the w lanes of the rows */
+    t = _mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3)), x0);
+    t = vm_f32x4_madd(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3)), x1, t);
+    t = vm_f32x4_madd(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3)), x2, t);
+    t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+    _MM_TRANSPOSE4_PS(x0, x1, x2, t);
+
+    _mm_storeu_ps(&out->e[0], x0);
+    _mm_storeu_ps(&out->e[4], x1);
+    _mm_storeu_ps(&out->e[8], x2);
+#else
+    v3 r0 = vm_v3(m->e[VM_M3X4_AT(0, 0)], m->e[VM_M3X4_AT(0, 1)], m->e[VM_M3X4_AT(0, 2)]);
+    v3 r1 = vm_v3(m->e[VM_M3X4_AT(1, 0)], m->e[VM_M3X4_AT(1, 1)], m->e[VM_M3X4_AT(1, 2)]);
+    v3 r2 = vm_v3(m->e[VM_M3X4_AT(2, 0)], m->e[VM_M3X4_AT(2, 1)], m->e[VM_M3X4_AT(2, 2)]);
+    float tx = m->e[VM_M3X4_AT(0, 3)];
+    float ty = m->e[VM_M3X4_AT(1, 3)];
+    float tz = m->e[VM_M3X4_AT(2, 3)];
+
+    /* columns of the inverse linear part (before dividing by the determinant) */
+    v3 c0 = vm_v3_cross(r1, r2);
+    v3 c1 = vm_v3_cross(r2, r0);
+    v3 c2 = vm_v3_cross(r0, r1);
+
+    float det = vm_v3_dot(r0, c0);
+    float inv_det;
+    int i;
+
+    if (det == 0.0f)
+    {
+        *out = vm_m3x4_zero;
+        return;
+    }
+
+    inv_det = 1.0f / det;
+    c0 = vm_v3_mulf(c0, inv_det);
+    c1 = vm_v3_mulf(c1, inv_det);
+    c2 = vm_v3_mulf(c2, inv_det);
+
+    for (i = 0; i < 3; ++i)
+    {
+        float a0 = vm_v3_data(&c0)[i];
+        float a1 = vm_v3_data(&c1)[i];
+        float a2 = vm_v3_data(&c2)[i];
+
+        out->e[VM_M3X4_AT(i, 0)] = a0;
+        out->e[VM_M3X4_AT(i, 1)] = a1;
+        out->e[VM_M3X4_AT(i, 2)] = a2;
+        out->e[VM_M3X4_AT(i, 3)] = -vm_fmaf(a0, tx, vm_fmaf(a1, ty, a2 * tz));
+    }
+#endif
+}
+
+VM_API VM_INLINE m3x4 vm_m3x4_inverse(m3x4 m)
+{
+    m3x4 result;
+    vm_m3x4_inverse_p(&result, &m);
+    return (result);
+}
+
+VM_API VM_INLINE v3 vm_m3x4_transform_point(const m3x4 *m, v3 p)
+{
+    const float *e = m->e;
+
+    return (vm_v3(
+        vm_fmaf(p.z, e[VM_M3X4_AT(0, 2)], vm_fmaf(p.y, e[VM_M3X4_AT(0, 1)], vm_fmaf(p.x, e[VM_M3X4_AT(0, 0)], e[VM_M3X4_AT(0, 3)]))),
+        vm_fmaf(p.z, e[VM_M3X4_AT(1, 2)], vm_fmaf(p.y, e[VM_M3X4_AT(1, 1)], vm_fmaf(p.x, e[VM_M3X4_AT(1, 0)], e[VM_M3X4_AT(1, 3)]))),
+        vm_fmaf(p.z, e[VM_M3X4_AT(2, 2)], vm_fmaf(p.y, e[VM_M3X4_AT(2, 1)], vm_fmaf(p.x, e[VM_M3X4_AT(2, 0)], e[VM_M3X4_AT(2, 3)])))));
+}
+
+VM_API VM_INLINE v3 vm_m3x4_transform_vector(const m3x4 *m, v3 v)
+{
+    const float *e = m->e;
+
+    return (vm_v3(
+        vm_fmaf(v.z, e[VM_M3X4_AT(0, 2)], vm_fmaf(v.y, e[VM_M3X4_AT(0, 1)], v.x * e[VM_M3X4_AT(0, 0)])),
+        vm_fmaf(v.z, e[VM_M3X4_AT(1, 2)], vm_fmaf(v.y, e[VM_M3X4_AT(1, 1)], v.x * e[VM_M3X4_AT(1, 0)])),
+        vm_fmaf(v.z, e[VM_M3X4_AT(2, 2)], vm_fmaf(v.y, e[VM_M3X4_AT(2, 1)], v.x * e[VM_M3X4_AT(2, 0)]))));
+}
+
+/* Batch versions, the matrix is expanded once and the SIMD m4x4 batch kernels do the work */
+VM_API VM_INLINE void vm_m3x4_transform_points(const m3x4 *m, const v3 *in, v3 *out, int n)
+{
+    m4x4 mat;
+    vm_m4x4_from_m3x4_p(&mat, m);
+    vm_m4x4_transform_points(&mat, in, out, n);
+}
+
+VM_API VM_INLINE void vm_m3x4_transform_vectors(const m3x4 *m, const v3 *in, v3 *out, int n)
+{
+    m4x4 mat;
+    vm_m4x4_from_m3x4_p(&mat, m);
+    vm_m4x4_transform_vectors(&mat, in, out, n);
+}
+
+/* #############################################################################
+ * # AXIS ALIGNED BOUNDING BOX FUNCTIONS
+ * #############################################################################
+ *
+ * An aabb stores the min and max corner. The culling functions take centers
+ * and half extents instead, vm_aabb_center / vm_aabb_extents and vm_aabb_to_soa
+ * convert between both forms.
+ *
+ * vm_aabb_transform uses the absolute value matrix method (Arvo): the new
+ * center is the transformed center and every new half extent is the sum of
+ * |m_ij| * extent_j. This gives the same box as transforming the 8 corners for
+ * any affine matrix with 18 instead of 72 multiplies and no min/max tree.
+ */
+typedef struct aabb
+{
+    v3 min;
+    v3 max;
+
+} aabb;
+
+VM_API VM_INLINE aabb vm_aabb(v3 min, v3 max)
+{
+    aabb result;
+    result.min = min;
+    result.max = max;
+    return (result);
+}
+
+/* Inverted box, merging or expanding it gives the other box or point */
+VM_API VM_INLINE aabb vm_aabb_empty(void)
+{
+    return (vm_aabb(vm_v3f(3.0e38f), vm_v3f(-3.0e38f)));
+}
+
+VM_API VM_INLINE aabb vm_aabb_from_center_extents(v3 center, v3 extents)
+{
+    return (vm_aabb(vm_v3_sub(center, extents), vm_v3_add(center, extents)));
+}
+
+VM_API VM_INLINE v3 vm_aabb_center(aabb a)
+{
+    return (vm_v3_mulf(vm_v3_add(a.min, a.max), 0.5f));
+}
+
+/* Returns the half extents */
+VM_API VM_INLINE v3 vm_aabb_extents(aabb a)
+{
+    return (vm_v3_mulf(vm_v3_sub(a.max, a.min), 0.5f));
+}
+
+VM_API VM_INLINE aabb vm_aabb_merge(aabb a, aabb b)
+{
+#ifdef VM_USE_SSE
+    return (vm_aabb(
+        vm_v3_from_m128(_mm_min_ps(vm_v3_m128(a.min), vm_v3_m128(b.min))),
+        vm_v3_from_m128(_mm_max_ps(vm_v3_m128(a.max), vm_v3_m128(b.max)))));
+#else
+    return (vm_aabb(
+        vm_v3(vm_minf(a.min.x, b.min.x), vm_minf(a.min.y, b.min.y), vm_minf(a.min.z, b.min.z)),
+        vm_v3(vm_maxf(a.max.x, b.max.x), vm_maxf(a.max.y, b.max.y), vm_maxf(a.max.z, b.max.z))));
+#endif
+}
+
+/* Grows the box until it contains point p */
+VM_API VM_INLINE aabb vm_aabb_expand(aabb a, v3 p)
+{
+    return (vm_aabb_merge(a, vm_aabb(p, p)));
+}
+
+VM_API VM_INLINE void vm_aabb_transform_p(aabb *VM_RESTRICT out, const m4x4 *m, const aabb *a)
+{
+#ifdef VM_USE_SSE
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 min = vm_v3_m128(a->min);
+    __m128 max = vm_v3_m128(a->max);
+    __m128 center = _mm_mul_ps(_mm_add_ps(min, max), half);
+    __m128 extents = _mm_mul_ps(_mm_sub_ps(max, min), half);
+    __m128 c0, c1, c2, c3;
+    __m128 new_center, new_extents;
+
+#ifdef VM_M4X4_ROW_MAJOR_ORDER
+    c0 = _mm_loadu_ps(&m->e[0]);
+    c1 = _mm_loadu_ps(&m->e[4]);
+    c2 = _mm_loadu_ps(&m->e[8]);
+    c3 = _mm_loadu_ps(&m->e[12]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+#else
+    c0 = _mm_loadu_ps(&m->e[0]);
+    c1 = _mm_loadu_ps(&m->e[4]);
+    c2 = _mm_loadu_ps(&m->e[8]);
+    c3 = _mm_loadu_ps(&m->e[12]);
+#endif
+
+    /* Columns times the broadcast center / extent components */
+    new_center = vm_f32x4_madd(c0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0)), c3);
+    new_center = vm_f32x4_madd(c1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1)), new_center);
+    new_center = vm_f32x4_madd(c2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2)), new_center);
+
+    new_extents = _mm_mul_ps(_mm_andnot_ps(sign, c0), _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(0, 0, 0, 0)));
+    new_extents = vm_f32x4_madd(_mm_andnot_ps(sign, c1), _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(1, 1, 1, 1)), new_extents);
+    new_extents = vm_f32x4_madd(_mm_andnot_ps(sign, c2), _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(2, 2, 2, 2)), new_extents);
+
+    /* Clear the w lane (bottom row of m) so VM_SIMD_STORAGE keeps it at 0.0f */
+    new_center = _mm_shuffle_ps(new_center, _mm_unpackhi_ps(new_center, zero), _MM_SHUFFLE(1, 0, 1, 0));
+    new_extents = _mm_shuffle_ps(new_extents, _mm_unpackhi_ps(new_extents, zero), _MM_SHUFFLE(1, 0, 1, 0));
+
+    out->min = vm_v3_from_m128(_mm_sub_ps(new_center, new_extents));
+    out->max = vm_v3_from_m128(_mm_add_ps(new_center, new_extents));
+#else
+    const float *e = m->e;
+    v3 center = vm_aabb_center(*a);
+    v3 extents = vm_aabb_extents(*a);
+    float new_center[3];
+    float new_extents[3];
+
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        new_center[i] = vm_fmaf(center.z, e[VM_M4X4_AT(i, 2)], vm_fmaf(center.y, e[VM_M4X4_AT(i, 1)], vm_fmaf(center.x, e[VM_M4X4_AT(i, 0)], e[VM_M4X4_AT(i, 3)])));
+        new_extents[i] = vm_fmaf(extents.z, vm_absf(e[VM_M4X4_AT(i, 2)]), vm_fmaf(extents.y, vm_absf(e[VM_M4X4_AT(i, 1)]), extents.x * vm_absf(e[VM_M4X4_AT(i, 0)])));
+    }
+
+    out->min = vm_v3(new_center[0] - new_extents[0], new_center[1] - new_extents[1], new_center[2] - new_extents[2]);
+    out->max = vm_v3(new_center[0] + new_extents[0], new_center[1] + new_extents[1], new_center[2] + new_extents[2]);
+#endif
+}
+
+VM_API VM_INLINE aabb vm_aabb_transform(m4x4 m, aabb a)
+{
+    aabb result;
+    vm_aabb_transform_p(&result, &m, &a);
+    return (result);
+}
+
+/* Transforms in[i] by its own matrix worlds[i], e.g. the world matrices of a
+   transformation_graph after vm_transformation_graph_update.
+   "in" and "out" may point to the same array. */
+VM_API VM_INLINE void vm_aabb_transform_array(const m4x4 *worlds, const aabb *in, aabb *out, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        aabb box = in[i]; /* out may alias in */
+        vm_aabb_transform_p(&out[i], &worlds[i], &box);
+    }
+}
+
+/* Writes centers->count boxes as centers and half extents for the frustum
+   culling and bvh4 functions */
+VM_API VM_INLINE void vm_aabb_to_soa(const aabb *in, v3_soa *centers, v3_soa *extents)
+{
+    int i;
+
+    for (i = 0; i < centers->count; ++i)
+    {
+        centers->x[i] = (in[i].min.x + in[i].max.x) * 0.5f;
+        centers->y[i] = (in[i].min.y + in[i].max.y) * 0.5f;
+        centers->z[i] = (in[i].min.z + in[i].max.z) * 0.5f;
+        extents->x[i] = (in[i].max.x - in[i].min.x) * 0.5f;
+        extents->y[i] = (in[i].max.y - in[i].min.y) * 0.5f;
+        extents->z[i] = (in[i].max.z - in[i].min.z) * 0.5f;
+    }
+}
+
+/* #############################################################################
+ * # PROJECTION FUNCTIONS
+ * #############################################################################
+ *
+ * Projects points by a projection_view matrix (e.g. vm_m4x4_perspective times
+ * a view matrix) into clip space, sets the clip flags against the OpenGL clip
+ * volume (-w <= x, y, z <= w) and applies the perspective divide. The results
+ * of flagged points (especially behind the camera) should not be used.
+ */
+#define VM_CLIP_LEFT 0x01   /* x < -w */
+#define VM_CLIP_RIGHT 0x02  /* x > w */
+#define VM_CLIP_BOTTOM 0x04 /* y < -w */
+#define VM_CLIP_TOP 0x08    /* y > w */
+#define VM_CLIP_NEAR 0x10   /* z < -w */
+#define VM_CLIP_FAR 0x20    /* z > w */
+
+/* Returns the VM_CLIP_* flags of a clip space position, 0 if it is inside */
+VM_API VM_INLINE unsigned int vm_clip_flags(v4 clip)
+{
+    unsigned int result = 0;
+
+    result |= (clip.x < -clip.w) ? VM_CLIP_LEFT : 0U;
+    result |= (clip.x > clip.w) ? VM_CLIP_RIGHT : 0U;
+    result |= (clip.y < -clip.w) ? VM_CLIP_BOTTOM : 0U;
+    result |= (clip.y > clip.w) ? VM_CLIP_TOP : 0U;
+    result |= (clip.z < -clip.w) ? VM_CLIP_NEAR : 0U;
+    result |= (clip.z > clip.w) ? VM_CLIP_FAR : 0U;
+
+    return (result);
+}
+
+/* Returns m * (p, 1) including w */
+VM_API VM_INLINE v4 vm_m4x4_transform_point_v4(const m4x4 *m, v3 p)
+{
+    const float *e = m->e;
+
+    return (vm_v4(
+        vm_fmaf(p.z, e[VM_M4X4_AT(0, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(0, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(0, 0)], e[VM_M4X4_AT(0, 3)]))),
+        vm_fmaf(p.z, e[VM_M4X4_AT(1, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(1, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(1, 0)], e[VM_M4X4_AT(1, 3)]))),
+        vm_fmaf(p.z, e[VM_M4X4_AT(2, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(2, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(2, 0)], e[VM_M4X4_AT(2, 3)]))),
+        vm_fmaf(p.z, e[VM_M4X4_AT(3, 2)], vm_fmaf(p.y, e[VM_M4X4_AT(3, 1)], vm_fmaf(p.x, e[VM_M4X4_AT(3, 0)], e[VM_M4X4_AT(3, 3)])))));
+}
+
+/* Returns the mapped (ndc * scale + offset) position of p, clip_flags (optional) receives the VM_CLIP_* flags */
+VM_API VM_INLINE v3 vm_m4x4_project_point_mapped(const m4x4 *projection_view, v3 p, v3 scale, v3 offset, unsigned int *clip_flags)
+{
+    v4 clip = vm_m4x4_transform_point_v4(projection_view, p);
+    float w = (clip.w != 0.0f) ? clip.w : 1.0f;
+
+    if (clip_flags)
+    {
+        *clip_flags = vm_clip_flags(clip);
+    }
+
+    return (vm_v3(
+        vm_fmaf(clip.x / w, scale.x, offset.x),
+        vm_fmaf(clip.y / w, scale.y, offset.y),
+        vm_fmaf(clip.z / w, scale.z, offset.z)));
+}
+
+/* Returns the normalized device coordinates (-1..1) of p */
+VM_API VM_INLINE v3 vm_m4x4_project_point(const m4x4 *projection_view, v3 p, unsigned int *clip_flags)
+{
+    return (vm_m4x4_project_point_mapped(projection_view, p, vm_v3_one, vm_v3_zero, clip_flags));
+}
+
+/* Returns the scale and offset that map ndc to a viewport (x, y, width, height).
+ * The screen y axis points down (window coordinates) and z is mapped to 0..1 */
+VM_API VM_INLINE void vm_viewport_mapping(v4 viewport, v3 *scale, v3 *offset)
+{
+    float half_width = viewport.z * 0.5f;
+    float half_height = viewport.w * 0.5f;
+
+    *scale = vm_v3(half_width, -half_height, 0.5f);
+    *offset = vm_v3(viewport.x + half_width, viewport.y + half_height, 0.5f);
+}
+
+/* Returns the screen position of p inside viewport (x, y, width, height) */
+VM_API VM_INLINE v3 vm_m4x4_project_point_viewport(const m4x4 *projection_view, v3 p, v4 viewport, unsigned int *clip_flags)
+{
+    v3 scale;
+    v3 offset;
+
+    vm_viewport_mapping(viewport, &scale, &offset);
+
+    return (vm_m4x4_project_point_mapped(projection_view, p, scale, offset, clip_flags));
+}
+
+/* Lane mask with only the VM_CLIP_* bit flag set, and-ed with a plane compare */
+VM_API VM_INLINE f32x4 vm_clip_flag_f32x4(unsigned int flag)
+{
+    union
+    {
+        float f;
+        unsigned int u;
+    } bit;
+
+    bit.u = flag;
+
+    return (vm_f32x4_set1(bit.f));
+}
+
+VM_API VM_INLINE f32x8 vm_clip_flag_f32x8(unsigned int flag)
+{
+    union
+    {
+        float f;
+        unsigned int u;
+    } bit;
+
+    bit.u = flag;
+
+    return (vm_f32x8_set1(bit.f));
+}
+
+/* Narrows the per lane flag masks of one block to flag bytes */
+VM_API VM_INLINE void vm_clip_flags_store_f32x4(unsigned char *flags, f32x4 bits)
+{
+    union
+    {
+        float f[VM_F32X4_WIDTH];
+        unsigned int u[VM_F32X4_WIDTH];
+    } block;
+
+    int j;
+
+    vm_f32x4_store(block.f, bits);
+
+    for (j = 0; j < VM_F32X4_WIDTH; ++j)
+    {
+        flags[j] = (unsigned char)block.u[j];
+    }
+}
+
+VM_API VM_INLINE void vm_clip_flags_store_f32x8(unsigned char *flags, f32x8 bits)
+{
+    union
+    {
+        float f[VM_F32X8_WIDTH];
+        unsigned int u[VM_F32X8_WIDTH];
+    } block;
+
+    int j;
+
+    vm_f32x8_store(block.f, bits);
+
+    for (j = 0; j < VM_F32X8_WIDTH; ++j)
+    {
+        flags[j] = (unsigned char)block.u[j];
+    }
+}
+
+/* Projects all 4 lanes to ndc * scale + offset, flags (optional) receives the VM_CLIP_* flags of lane i in flags[i] */
+VM_API VM_INLINE v3x4 vm_v3x4_project(const m4x4 *projection_view, v3x4 p, v3 scale, v3 offset, unsigned char *flags)
+{
+    const float *e = projection_view->e;
+    f32x4 zero = vm_f32x4_set1(0.0f);
+    f32x4 x = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(0, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(0, 3)]))));
+    f32x4 y = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(1, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(1, 3)]))));
+    f32x4 z = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(2, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(2, 3)]))));
+    f32x4 w = vm_f32x4_madd(p.z, vm_f32x4_set1(e[VM_M4X4_AT(3, 2)]), vm_f32x4_madd(p.y, vm_f32x4_set1(e[VM_M4X4_AT(3, 1)]), vm_f32x4_madd(p.x, vm_f32x4_set1(e[VM_M4X4_AT(3, 0)]), vm_f32x4_set1(e[VM_M4X4_AT(3, 3)]))));
+    v3x4 result;
+
+    if (flags)
+    {
+        /* Every compare selects its VM_CLIP_* bit, or-ed together per lane */
+        f32x4 neg_w = vm_f32x4_sub(zero, w);
+        f32x4 bits = vm_f32x4_and(vm_f32x4_cmplt(x, neg_w), vm_clip_flag_f32x4(VM_CLIP_LEFT));
+
+        bits = vm_f32x4_or(bits, vm_f32x4_and(vm_f32x4_cmpgt(x, w), vm_clip_flag_f32x4(VM_CLIP_RIGHT)));
+        bits = vm_f32x4_or(bits, vm_f32x4_and(vm_f32x4_cmplt(y, neg_w), vm_clip_flag_f32x4(VM_CLIP_BOTTOM)));
+        bits = vm_f32x4_or(bits, vm_f32x4_and(vm_f32x4_cmpgt(y, w), vm_clip_flag_f32x4(VM_CLIP_TOP)));
+        bits = vm_f32x4_or(bits, vm_f32x4_and(vm_f32x4_cmplt(z, neg_w), vm_clip_flag_f32x4(VM_CLIP_NEAR)));
+        bits = vm_f32x4_or(bits, vm_f32x4_and(vm_f32x4_cmpgt(z, w), vm_clip_flag_f32x4(VM_CLIP_FAR)));
+
+        vm_clip_flags_store_f32x4(flags, bits);
+    }
+
+    /* Same w == 0 guard as vm_m4x4_project_point_mapped */
+    w = vm_f32x4_select(vm_f32x4_cmpeq(w, zero), vm_f32x4_set1(1.0f), w);
+
+    result.x = vm_f32x4_madd(vm_f32x4_div(x, w), vm_f32x4_set1(scale.x), vm_f32x4_set1(offset.x));
+    result.y = vm_f32x4_madd(vm_f32x4_div(y, w), vm_f32x4_set1(scale.y), vm_f32x4_set1(offset.y));
+    result.z = vm_f32x4_madd(vm_f32x4_div(z, w), vm_f32x4_set1(scale.z), vm_f32x4_set1(offset.z));
+
+    return (result);
+}
+
+/* Projects all 8 lanes to ndc * scale + offset, flags (optional) receives the VM_CLIP_* flags of lane i in flags[i] */
+VM_API VM_INLINE v3x8 vm_v3x8_project(const m4x4 *projection_view, v3x8 p, v3 scale, v3 offset, unsigned char *flags)
+{
+    const float *e = projection_view->e;
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    f32x8 x = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(0, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(0, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(0, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(0, 3)]))));
+    f32x8 y = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(1, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(1, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(1, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(1, 3)]))));
+    f32x8 z = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(2, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(2, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(2, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(2, 3)]))));
+    f32x8 w = vm_f32x8_madd(p.z, vm_f32x8_set1(e[VM_M4X4_AT(3, 2)]), vm_f32x8_madd(p.y, vm_f32x8_set1(e[VM_M4X4_AT(3, 1)]), vm_f32x8_madd(p.x, vm_f32x8_set1(e[VM_M4X4_AT(3, 0)]), vm_f32x8_set1(e[VM_M4X4_AT(3, 3)]))));
+    v3x8 result;
+
+    if (flags)
+    {
+        /* Every compare selects its VM_CLIP_* bit, or-ed together per lane */
+        f32x8 neg_w = vm_f32x8_sub(zero, w);
+        f32x8 bits = vm_f32x8_and(vm_f32x8_cmplt(x, neg_w), vm_clip_flag_f32x8(VM_CLIP_LEFT));
+
+        bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmpgt(x, w), vm_clip_flag_f32x8(VM_CLIP_RIGHT)));
+        bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmplt(y, neg_w), vm_clip_flag_f32x8(VM_CLIP_BOTTOM)));
+        bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmpgt(y, w), vm_clip_flag_f32x8(VM_CLIP_TOP)));
+        bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmplt(z, neg_w), vm_clip_flag_f32x8(VM_CLIP_NEAR)));
+        bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmpgt(z, w), vm_clip_flag_f32x8(VM_CLIP_FAR)));
+
+        vm_clip_flags_store_f32x8(flags, bits);
+    }
+
+    /* Same w == 0 guard as vm_m4x4_project_point_mapped */
+    w = vm_f32x8_select(vm_f32x8_cmpeq(w, zero), vm_f32x8_set1(1.0f), w);
+
+    result.x = vm_f32x8_madd(vm_f32x8_div(x, w), vm_f32x8_set1(scale.x), vm_f32x8_set1(offset.x));
+    result.y = vm_f32x8_madd(vm_f32x8_div(y, w), vm_f32x8_set1(scale.y), vm_f32x8_set1(offset.y));
+    result.z = vm_f32x8_madd(vm_f32x8_div(z, w), vm_f32x8_set1(scale.z), vm_f32x8_set1(offset.z));
+
+    return (result);
+}
+
+/* Projects n points to ndc * scale + offset, clip_flags (optional) receives n VM_CLIP_* flag bytes */
+VM_API VM_INLINE void vm_m4x4_project_points_mapped(const m4x4 *projection_view, const v3 *in, v3 *out, unsigned char *clip_flags, int n, v3 scale, v3 offset)
+{
+    m4x4 matrix = *projection_view;
+    int i = 0;
+
+#ifdef VM_USE_AVX2
+    for (; i + VM_F32X8_WIDTH <= n; i += VM_F32X8_WIDTH)
+    {
+        vm_v3x8_store(&out[i], vm_v3x8_project(&matrix, vm_v3x8_load(&in[i]), scale, offset, clip_flags ? &clip_flags[i] : 0));
+    }
+#endif
+
+    for (; i + VM_F32X4_WIDTH <= n; i += VM_F32X4_WIDTH)
+    {
+        vm_v3x4_store(&out[i], vm_v3x4_project(&matrix, vm_v3x4_load(&in[i]), scale, offset, clip_flags ? &clip_flags[i] : 0));
+    }
+
+    for (; i < n; ++i)
+    {
+        unsigned int lane_flags;
+
+        out[i] = vm_m4x4_project_point_mapped(&matrix, in[i], scale, offset, &lane_flags);
+
+        if (clip_flags)
+        {
+            clip_flags[i] = (unsigned char)lane_flags;
+        }
+    }
+}
+
+/* Projects n points to normalized device coordinates (-1..1) */
+VM_API VM_INLINE void vm_m4x4_project_points(const m4x4 *projection_view, const v3 *in, v3 *out, unsigned char *clip_flags, int n)
+{
+    vm_m4x4_project_points_mapped(projection_view, in, out, clip_flags, n, vm_v3_one, vm_v3_zero);
+}
+
+/* Projects n points to screen coordinates inside viewport (x, y, width, height) */
+VM_API VM_INLINE void vm_m4x4_project_points_viewport(const m4x4 *projection_view, const v3 *in, v3 *out, unsigned char *clip_flags, int n, v4 viewport)
+{
+    v3 scale;
+    v3 offset;
+
+    vm_viewport_mapping(viewport, &scale, &offset);
+    vm_m4x4_project_points_mapped(projection_view, in, out, clip_flags, n, scale, offset);
+}
+
+/* #############################################################################
+ * # FRUSTUM PLANE FUNCTIONS
+ * #############################################################################
+ */
+#define VM_FRUSTUM_PLANE_SIZE 6
+
+typedef struct frustum
+{
+
+    v4 leftPlane;
+    v4 rightPlane;
+    v4 bottomPlane;
+    v4 topPlane;
+    v4 nearPlane;
+    v4 farPlane;
+
+} frustum;
+
+VM_API VM_INLINE v4 *vm_frustum_data(frustum *a)
+{
+    return ((v4 *)a);
+}
+
+VM_API VM_INLINE void vm_frustum_extract_planes_p(frustum *VM_RESTRICT out, const m4x4 *projection_view)
+{
+    int i;
+
+    v4 *frustum_data;
+
+    float a30 = projection_view->e[VM_M4X4_AT(3, 0)];
+    float a31 = projection_view->e[VM_M4X4_AT(3, 1)];
+    float a32 = projection_view->e[VM_M4X4_AT(3, 2)];
+    float a33 = projection_view->e[VM_M4X4_AT(3, 3)];
+
+    float e00 = projection_view->e[VM_M4X4_AT(0, 0)];
+    float e01 = projection_view->e[VM_M4X4_AT(0, 1)];
+    float e02 = projection_view->e[VM_M4X4_AT(0, 2)];
+    float e03 = projection_view->e[VM_M4X4_AT(0, 3)];
+
+    float e10 = projection_view->e[VM_M4X4_AT(1, 0)];
+    float e11 = projection_view->e[VM_M4X4_AT(1, 1)];
+    float e12 = projection_view->e[VM_M4X4_AT(1, 2)];
+    float e13 = projection_view->e[VM_M4X4_AT(1, 3)];
+
+    float e20 = projection_view->e[VM_M4X4_AT(2, 0)];
+    float e21 = projection_view->e[VM_M4X4_AT(2, 1)];
+    float e22 = projection_view->e[VM_M4X4_AT(2, 2)];
+    float e23 = projection_view->e[VM_M4X4_AT(2, 3)];
+
+    /* Left plane */
+    out->leftPlane.x = a30 + e00;
+    out->leftPlane.y = a31 + e01;
+    out->leftPlane.z = a32 + e02;
+    out->leftPlane.w = a33 + e03;
+
+    /* Right plane */
+    out->rightPlane.x = a30 - e00;
+    out->rightPlane.y = a31 - e01;
+    out->rightPlane.z = a32 - e02;
+    out->rightPlane.w = a33 - e03;
+
+    /* Bottom plane */
+    out->bottomPlane.x = a30 + e10;
+    out->bottomPlane.y = a31 + e11;
+    out->bottomPlane.z = a32 + e12;
+    out->bottomPlane.w = a33 + e13;
+
+    /* Top plane */
+    out->topPlane.x = a30 - e10;
+    out->topPlane.y = a31 - e11;
+    out->topPlane.z = a32 - e12;
+    out->topPlane.w = a33 - e13;
+
+    /* Near plane */
+    out->nearPlane.x = a30 + e20;
+    out->nearPlane.y = a31 + e21;
+    out->nearPlane.z = a32 + e22;
+    out->nearPlane.w = a33 + e23;
+
+    /* Far plane */
+    out->farPlane.x = a30 - e20;
+    out->farPlane.y = a31 - e21;
+    out->farPlane.z = a32 - e22;
+    out->farPlane.w = a33 - e23;
+
+    frustum_data = vm_frustum_data(out);
+
+    /* Normalize planes */
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        float length_squared = (frustum_data[i].x * frustum_data[i].x) + (frustum_data[i].y * frustum_data[i].y) + (frustum_data[i].z * frustum_data[i].z);
+        float scalar = vm_invsqrt(length_squared);
+
+        frustum_data[i].x = frustum_data[i].x * scalar;
+        frustum_data[i].y = frustum_data[i].y * scalar;
+        frustum_data[i].z = frustum_data[i].z * scalar;
+        frustum_data[i].w = frustum_data[i].w * scalar;
+    }
+}
+
+VM_API VM_INLINE frustum vm_frustum_extract_planes(m4x4 projection_view)
+{
+    frustum result;
+    vm_frustum_extract_planes_p(&result, &projection_view);
+    return (result);
+}
+
+VM_API VM_INLINE int vm_frustum_is_point_in_p(const frustum *f, v3 point)
+{
+    int i;
+    const v4 *frustum_data = (const v4 *)f;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+#ifdef VM_USE_AVX2
+        float distance = vm_fmaf(frustum_data[i].z, point.z, vm_fmaf(frustum_data[i].y, point.y, vm_fmaf(frustum_data[i].x, point.x, frustum_data[i].w)));
+#else
+        float distance = frustum_data[i].x * point.x + frustum_data[i].y * point.y + frustum_data[i].z * point.z + frustum_data[i].w;
+#endif
+
+        if (distance < 0)
+        {
+            return (0); /* Point is outside */
+        }
+    }
+    return (1); /* Point is inside */
+}
+
+VM_API VM_INLINE int vm_frustum_is_point_in(frustum frustum, v3 point)
+{
+    return (vm_frustum_is_point_in_p(&frustum, point));
+}
+
+VM_API VM_INLINE int vm_frustum_is_cube_in_p(const frustum *f, v3 center, v3 dimensions, float epsilon)
+{
+    const v4 *frustum_data = (const v4 *)f;
+
+    /* Calculate the half extents of the object */
+    v3 half_extents = vm_v3_addf(vm_v3_mulf(dimensions, 0.5f), epsilon);
+
+    float subHalfX = center.x - half_extents.x;
+    float addHalfX = center.x + half_extents.x;
+    float subHalfY = center.y - half_extents.y;
+    float addHalfY = center.y + half_extents.y;
+    float subHalfZ = center.z - half_extents.z;
+    float addHalfZ = center.z + half_extents.z;
+
+    int i;
+
+    /* Define the eight corners of the cube in local space */
+    v3 corners[8];
+    corners[0] = vm_v3(subHalfX, subHalfY, subHalfZ);
+    corners[1] = vm_v3(addHalfX, subHalfY, subHalfZ);
+    corners[2] = vm_v3(subHalfX, addHalfY, subHalfZ);
+    corners[3] = vm_v3(addHalfX, addHalfY, subHalfZ);
+    corners[4] = vm_v3(subHalfX, subHalfY, addHalfZ);
+    corners[5] = vm_v3(addHalfX, subHalfY, addHalfZ);
+    corners[6] = vm_v3(subHalfX, addHalfY, addHalfZ);
+    corners[7] = vm_v3(addHalfX, addHalfY, addHalfZ);
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        const v4 *plane = &frustum_data[i];
+
+        /* Check if all corners of the object are on the outside of the plane */
+        int outside = 1;
+        int j;
+        for (j = 0; j < 8; ++j)
+        {
+            /* Compute the distance from the corner to the plane */
+#ifdef VM_USE_AVX2
+            float distance = vm_fmaf(plane->z, corners[j].z, vm_fmaf(plane->y, corners[j].y, vm_fmaf(plane->x, corners[j].x, plane->w)));
+#else
+            float distance = plane->x * corners[j].x + plane->y * corners[j].y + plane->z * corners[j].z + plane->w;
+#endif
+
+            /* If the distance is greater than or equal to zero, the corner is inside or on the plane */
+            if (distance >= 0)
+            {
+                outside = 0; /* At least one corner is inside */
+                break;
+            }
+        }
+
+        /* If all corners are outside this plane, the object is outside the frustum */
+        if (outside)
+        {
+            return (0);
+        }
+    }
+
+    /* If we passed all planes, the object is inside or intersects the frustum */
+    return (1);
+}
+
+VM_API VM_INLINE int vm_frustum_is_cube_in(frustum frustum, v3 center, v3 dimensions, float epsilon)
+{
+    return (vm_frustum_is_cube_in_p(&frustum, center, dimensions, epsilon));
+}
+
+VM_API VM_INLINE int vm_frustum_is_sphere_in_p(const frustum *f, v3 center, float radius)
+{
+    const v4 *frustum_data = (const v4 *)f;
+
+    int i;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        v3 frustum_plane_pos = vm_v3(frustum_data[i].x, frustum_data[i].y, frustum_data[i].z);
+        float distance = vm_v3_dot(frustum_plane_pos, center) + frustum_data[i].w;
+
+        if (distance < -radius)
+        {
+            return (0); /* Completely outside */
+        }
+    }
+
+    return (1); /* Intersects or inside */
+}
+
+VM_API VM_INLINE int vm_frustum_is_sphere_in(frustum frustum, v3 center, float radius)
+{
+    return (vm_frustum_is_sphere_in_p(&frustum, center, radius));
+}
+
+/* Oriented box given by center, half extents and its local axes in world space
+   (the columns of its rotation or rotation * scale matrix). The box reaches
+   r = e.x * |n . axis_x| + e.y * |n . axis_y| + e.z * |n . axis_z| along a
+   plane normal n, so every plane costs one distance and three dot products
+   instead of transforming and testing 8 corners */
+VM_API VM_INLINE int vm_frustum_is_obb_basis_in_p(const frustum *f, v3 center, v3 half_extents, v3 axis_x, v3 axis_y, v3 axis_z)
+{
+    const v4 *frustum_data = (const v4 *)f;
+
+    int i;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        const v4 *plane = &frustum_data[i];
+        float distance = vm_fmaf(plane->z, center.z, vm_fmaf(plane->y, center.y, vm_fmaf(plane->x, center.x, plane->w)));
+        float radius = half_extents.x * vm_absf(plane->x * axis_x.x + plane->y * axis_x.y + plane->z * axis_x.z) +
+                       half_extents.y * vm_absf(plane->x * axis_y.x + plane->y * axis_y.y + plane->z * axis_y.z) +
+                       half_extents.z * vm_absf(plane->x * axis_z.x + plane->y * axis_z.y + plane->z * axis_z.z);
+
+        if (distance < -radius)
+        {
+            return (0); /* Completely outside */
+        }
+    }
+
+    return (1); /* Intersects or inside */
+}
+
+/* Oriented box given by center, half extents and rotation, same test as
+   vm_frustum_is_obb_basis_in_p with the columns of the rotation matrix */
+VM_API VM_INLINE int vm_frustum_is_obb_in_p(const frustum *f, v3 center, v3 half_extents, quat rotation)
+{
+    float xx = rotation.x * rotation.x;
+    float yy = rotation.y * rotation.y;
+    float zz = rotation.z * rotation.z;
+    float xy = rotation.x * rotation.y;
+    float xz = rotation.x * rotation.z;
+    float yz = rotation.y * rotation.z;
+    float wx = rotation.w * rotation.x;
+    float wy = rotation.w * rotation.y;
+    float wz = rotation.w * rotation.z;
+
+#ifdef VM_LEFT_HAND_LAYOUT
+    v3 axis_x = vm_v3(1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy));
+    v3 axis_y = vm_v3(2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx));
+    v3 axis_z = vm_v3(2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy));
+#else
+    v3 axis_x = vm_v3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+    v3 axis_y = vm_v3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+    v3 axis_z = vm_v3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+#endif
+
+    return (vm_frustum_is_obb_basis_in_p(f, center, half_extents, axis_x, axis_y, axis_z));
+}
+
+VM_API VM_INLINE int vm_frustum_is_obb_in(frustum frustum, v3 center, v3 half_extents, quat rotation)
+{
+    return (vm_frustum_is_obb_in_p(&frustum, center, half_extents, rotation));
+}
+
+/* The frustum planes as separate x/y/z/w streams for testing 4 or 8 objects
+   (one per lane) against all planes at once. abs_x/y/z hold |x|/|y|/|z| of
+   the plane normals: the distance of the corner of a box that lies furthest
+   along a normal (the p-vertex) is n . center + w + |n| . extents. */
+typedef struct frustum_simd
+{
+    float x[VM_FRUSTUM_PLANE_SIZE];
+    float y[VM_FRUSTUM_PLANE_SIZE];
+    float z[VM_FRUSTUM_PLANE_SIZE];
+    float w[VM_FRUSTUM_PLANE_SIZE];
+    float abs_x[VM_FRUSTUM_PLANE_SIZE];
+    float abs_y[VM_FRUSTUM_PLANE_SIZE];
+    float abs_z[VM_FRUSTUM_PLANE_SIZE];
+
+} frustum_simd;
+
+VM_API VM_INLINE void vm_frustum_simd_p(frustum_simd *VM_RESTRICT out, const frustum *f)
+{
+    const v4 *frustum_data = (const v4 *)f;
+
+    int i;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        out->x[i] = frustum_data[i].x;
+        out->y[i] = frustum_data[i].y;
+        out->z[i] = frustum_data[i].z;
+        out->w[i] = frustum_data[i].w;
+        out->abs_x[i] = vm_absf(frustum_data[i].x);
+        out->abs_y[i] = vm_absf(frustum_data[i].y);
+        out->abs_z[i] = vm_absf(frustum_data[i].z);
+    }
+}
+
+VM_API VM_INLINE frustum_simd vm_frustum_simd(frustum f)
+{
+    frustum_simd result;
+    vm_frustum_simd_p(&result, &f);
+    return (result);
+}
+
+/* Signed distances of 4 points to plane i */
+VM_API VM_INLINE f32x4 vm_frustum_simd_distance_f32x4(const frustum_simd *f, int i, f32x4 x, f32x4 y, f32x4 z)
+{
+    f32x4 distance = vm_f32x4_madd(vm_f32x4_set1(f->x[i]), x, vm_f32x4_set1(f->w[i]));
+    distance = vm_f32x4_madd(vm_f32x4_set1(f->y[i]), y, distance);
+    return (vm_f32x4_madd(vm_f32x4_set1(f->z[i]), z, distance));
+}
+
+/* Returns a 4 bit mask with bit j set if sphere j intersects or is inside the frustum */
+VM_API VM_INLINE int vm_frustum_simd_spheres_in_f32x4(const frustum_simd *f, f32x4 x, f32x4 y, f32x4 z, f32x4 radius)
+{
+    f32x4 min_distance = vm_frustum_simd_distance_f32x4(f, 0, x, y, z);
+
+    int i;
+
+    /* Outside if any plane distance is below -radius, so only the smallest one matters */
+    for (i = 1; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        min_distance = vm_f32x4_min(min_distance, vm_frustum_simd_distance_f32x4(f, i, x, y, z));
+    }
+
+    return (vm_f32x4_movemask(vm_f32x4_cmpge(vm_f32x4_add(min_distance, radius), vm_f32x4_set1(0.0f))));
+}
+
+/* Signed distances of the p-vertices of 4 boxes to plane i */
+VM_API VM_INLINE f32x4 vm_frustum_simd_box_distance_f32x4(const frustum_simd *f, int i, f32x4 x, f32x4 y, f32x4 z, f32x4 extent_x, f32x4 extent_y, f32x4 extent_z)
+{
+    f32x4 distance = vm_frustum_simd_distance_f32x4(f, i, x, y, z);
+    distance = vm_f32x4_madd(vm_f32x4_set1(f->abs_x[i]), extent_x, distance);
+    distance = vm_f32x4_madd(vm_f32x4_set1(f->abs_y[i]), extent_y, distance);
+    return (vm_f32x4_madd(vm_f32x4_set1(f->abs_z[i]), extent_z, distance));
+}
+
+/* Returns a 4 bit mask with bit j set if box j (center and half extents) intersects or is inside the frustum */
+VM_API VM_INLINE int vm_frustum_simd_aabbs_in_f32x4(const frustum_simd *f, f32x4 x, f32x4 y, f32x4 z, f32x4 extent_x, f32x4 extent_y, f32x4 extent_z)
+{
+    f32x4 min_distance = vm_frustum_simd_box_distance_f32x4(f, 0, x, y, z, extent_x, extent_y, extent_z);
+
+    int i;
+
+    for (i = 1; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        min_distance = vm_f32x4_min(min_distance, vm_frustum_simd_box_distance_f32x4(f, i, x, y, z, extent_x, extent_y, extent_z));
+    }
+
+    return (vm_f32x4_movemask(vm_f32x4_cmpge(min_distance, vm_f32x4_set1(0.0f))));
+}
+
+/* Signed distances of 8 points to plane i */
+VM_API VM_INLINE f32x8 vm_frustum_simd_distance_f32x8(const frustum_simd *f, int i, f32x8 x, f32x8 y, f32x8 z)
+{
+    f32x8 distance = vm_f32x8_madd(vm_f32x8_set1(f->x[i]), x, vm_f32x8_set1(f->w[i]));
+    distance = vm_f32x8_madd(vm_f32x8_set1(f->y[i]), y, distance);
+    return (vm_f32x8_madd(vm_f32x8_set1(f->z[i]), z, distance));
+}
+
+/* Returns a 8 bit mask with bit j set if sphere j intersects or is inside the frustum */
+VM_API VM_INLINE int vm_frustum_simd_spheres_in_f32x8(const frustum_simd *f, f32x8 x, f32x8 y, f32x8 z, f32x8 radius)
+{
+    f32x8 min_distance = vm_frustum_simd_distance_f32x8(f, 0, x, y, z);
+
+    int i;
+
+    for (i = 1; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        min_distance = vm_f32x8_min(min_distance, vm_frustum_simd_distance_f32x8(f, i, x, y, z));
+    }
+
+    return (vm_f32x8_movemask(vm_f32x8_cmpge(vm_f32x8_add(min_distance, radius), vm_f32x8_set1(0.0f))));
+}
+
+/* Signed distances of the p-vertices of 8 boxes to plane i */
+VM_API VM_INLINE f32x8 vm_frustum_simd_box_distance_f32x8(const frustum_simd *f, int i, f32x8 x, f32x8 y, f32x8 z, f32x8 extent_x, f32x8 extent_y, f32x8 extent_z)
+{
+    f32x8 distance = vm_frustum_simd_distance_f32x8(f, i, x, y, z);
+    distance = vm_f32x8_madd(vm_f32x8_set1(f->abs_x[i]), extent_x, distance);
+    distance = vm_f32x8_madd(vm_f32x8_set1(f->abs_y[i]), extent_y, distance);
+    return (vm_f32x8_madd(vm_f32x8_set1(f->abs_z[i]), extent_z, distance));
+}
+
+/* Returns a 8 bit mask with bit j set if box j (center and half extents) intersects or is inside the frustum */
+VM_API VM_INLINE int vm_frustum_simd_aabbs_in_f32x8(const frustum_simd *f, f32x8 x, f32x8 y, f32x8 z, f32x8 extent_x, f32x8 extent_y, f32x8 extent_z)
+{
+    f32x8 min_distance = vm_frustum_simd_box_distance_f32x8(f, 0, x, y, z, extent_x, extent_y, extent_z);
+
+    int i;
+
+    for (i = 1; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        min_distance = vm_f32x8_min(min_distance, vm_frustum_simd_box_distance_f32x8(f, i, x, y, z, extent_x, extent_y, extent_z));
+    }
+
+    return (vm_f32x8_movemask(vm_f32x8_cmpge(min_distance, vm_f32x8_set1(0.0f))));
+}
+
+/* Copies the last count (< 8) elements into a zero padded block of 8 so the
+   remainder of a stream goes through the same kernel */
+VM_API VM_INLINE f32x8 vm_frustum_simd_load_tail(const float *a, int count)
+{
+    float padded[VM_F32X8_WIDTH] = {0};
+
+    int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        padded[i] = a[i];
+    }
+
+    return (vm_f32x8_load(padded));
+}
+
+/* Loads a full block of 8 or the zero padded tail of a stream */
+VM_API VM_INLINE f32x8 vm_frustum_simd_load_n(const float *a, int count)
+{
+    return (count == VM_F32X8_WIDTH ? vm_f32x8_load(a) : vm_frustum_simd_load_tail(a, count));
+}
+
+/* Tests centers->count spheres and writes one bit per sphere into visible
+   (bit i & 7 of visible[i >> 3], (count + 7) / 8 bytes), set if the sphere
+   intersects or is inside the frustum */
+VM_API VM_INLINE void vm_frustum_cull_spheres_mask(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible)
+{
+    int count = centers->count;
+    int i = 0;
+
+    for (; i + VM_F32X8_WIDTH <= count; i += VM_F32X8_WIDTH)
+    {
+        visible[i >> 3] = (unsigned char)vm_frustum_simd_spheres_in_f32x8(
+            f,
+            vm_f32x8_load(&centers->x[i]),
+            vm_f32x8_load(&centers->y[i]),
+            vm_f32x8_load(&centers->z[i]),
+            vm_f32x8_load(&radii[i]));
+    }
+
+    if (i < count)
+    {
+        int rest = count - i;
+
+        visible[i >> 3] = (unsigned char)(vm_frustum_simd_spheres_in_f32x8(
+                                              f,
+                                              vm_frustum_simd_load_tail(&centers->x[i], rest),
+                                              vm_frustum_simd_load_tail(&centers->y[i], rest),
+                                              vm_frustum_simd_load_tail(&centers->z[i], rest),
+                                              vm_frustum_simd_load_tail(&radii[i], rest)) &
+                                          ((1 << rest) - 1));
+    }
+}
+
+/* Tests centers->count boxes given by center and half extents, writes the same
+   bitmask as vm_frustum_cull_spheres_mask */
+VM_API VM_INLINE void vm_frustum_cull_aabbs_mask(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible)
+{
+    int count = centers->count;
+    int i = 0;
+
+    for (; i + VM_F32X8_WIDTH <= count; i += VM_F32X8_WIDTH)
+    {
+        visible[i >> 3] = (unsigned char)vm_frustum_simd_aabbs_in_f32x8(
+            f,
+            vm_f32x8_load(&centers->x[i]),
+            vm_f32x8_load(&centers->y[i]),
+            vm_f32x8_load(&centers->z[i]),
+            vm_f32x8_load(&extents->x[i]),
+            vm_f32x8_load(&extents->y[i]),
+            vm_f32x8_load(&extents->z[i]));
+    }
+
+    if (i < count)
+    {
+        int rest = count - i;
+
+        visible[i >> 3] = (unsigned char)(vm_frustum_simd_aabbs_in_f32x8(
+                                              f,
+                                              vm_frustum_simd_load_tail(&centers->x[i], rest),
+                                              vm_frustum_simd_load_tail(&centers->y[i], rest),
+                                              vm_frustum_simd_load_tail(&centers->z[i], rest),
+                                              vm_frustum_simd_load_tail(&extents->x[i], rest),
+                                              vm_frustum_simd_load_tail(&extents->y[i], rest),
+                                              vm_frustum_simd_load_tail(&extents->z[i], rest)) &
+                                          ((1 << rest) - 1));
+    }
+}
+
+/* Returns a 8 bit mask with bit j set if oriented box j intersects or is inside
+   the frustum. half_axes are 9 streams with the local axes of the boxes already
+   scaled by their half extents: axis_x.x, axis_x.y, axis_x.z, axis_y.x, ... */
+VM_API VM_INLINE int vm_frustum_simd_obbs_in_f32x8(const frustum_simd *f, f32x8 x, f32x8 y, f32x8 z, const f32x8 *half_axes)
+{
+    f32x8 sign = vm_f32x8_set1(-0.0f);
+    f32x8 min_distance = vm_f32x8_set1(0.0f);
+
+    int i;
+    int j;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        f32x8 nx = vm_f32x8_set1(f->x[i]);
+        f32x8 ny = vm_f32x8_set1(f->y[i]);
+        f32x8 nz = vm_f32x8_set1(f->z[i]);
+        f32x8 distance = vm_frustum_simd_distance_f32x8(f, i, x, y, z);
+
+        /* Projected radius: sum of |n . half_axis| */
+        for (j = 0; j < 9; j += 3)
+        {
+            f32x8 projected = vm_f32x8_madd(nz, half_axes[j + 2], vm_f32x8_madd(ny, half_axes[j + 1], vm_f32x8_mul(nx, half_axes[j])));
+            distance = vm_f32x8_add(distance, vm_f32x8_andnot(sign, projected));
+        }
+
+        min_distance = i == 0 ? distance : vm_f32x8_min(min_distance, distance);
+    }
+
+    return (vm_f32x8_movemask(vm_f32x8_cmpge(min_distance, vm_f32x8_set1(0.0f))));
+}
+
+/* Tests centers->count oriented boxes given by center, half extents and their
+   local axes in world space (axes[0..2], the columns of the rotation matrices),
+   writes the same bitmask as vm_frustum_cull_spheres_mask */
+VM_API VM_INLINE void vm_frustum_cull_obbs_mask(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, const v3_soa *axes, unsigned char *visible)
+{
+    f32x8 half_axes[9];
+    int count = centers->count;
+    int i;
+    int j;
+
+    for (i = 0; i < count; i += VM_F32X8_WIDTH)
+    {
+        int rest = count - i < VM_F32X8_WIDTH ? count - i : VM_F32X8_WIDTH;
+        const float *extent[3];
+
+        extent[0] = &extents->x[i];
+        extent[1] = &extents->y[i];
+        extent[2] = &extents->z[i];
+
+        for (j = 0; j < 3; ++j)
+        {
+            f32x8 e = vm_frustum_simd_load_n(extent[j], rest);
+
+            half_axes[j * 3 + 0] = vm_f32x8_mul(e, vm_frustum_simd_load_n(&axes[j].x[i], rest));
+            half_axes[j * 3 + 1] = vm_f32x8_mul(e, vm_frustum_simd_load_n(&axes[j].y[i], rest));
+            half_axes[j * 3 + 2] = vm_f32x8_mul(e, vm_frustum_simd_load_n(&axes[j].z[i], rest));
+        }
+
+        visible[i >> 3] = (unsigned char)(vm_frustum_simd_obbs_in_f32x8(
+                                              f,
+                                              vm_frustum_simd_load_n(&centers->x[i], rest),
+                                              vm_frustum_simd_load_n(&centers->y[i], rest),
+                                              vm_frustum_simd_load_n(&centers->z[i], rest),
+                                              half_axes) &
+                                          ((1 << rest) - 1));
+    }
+}
+
+/* Returns the visible mask of 8 spheres like vm_frustum_simd_spheres_in_f32x8,
+   inside gets the mask of the spheres that are completely inside */
+VM_API VM_INLINE int vm_frustum_simd_spheres_classify_f32x8(const frustum_simd *f, f32x8 x, f32x8 y, f32x8 z, f32x8 radius, int *inside)
+{
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    f32x8 min_distance = vm_frustum_simd_distance_f32x8(f, 0, x, y, z);
+
+    int i;
+
+    for (i = 1; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        min_distance = vm_f32x8_min(min_distance, vm_frustum_simd_distance_f32x8(f, i, x, y, z));
+    }
+
+    *inside = vm_f32x8_movemask(vm_f32x8_cmpge(vm_f32x8_sub(min_distance, radius), zero));
+
+    return (vm_f32x8_movemask(vm_f32x8_cmpge(vm_f32x8_add(min_distance, radius), zero)));
+}
+
+/* Returns the visible mask of 8 boxes like vm_frustum_simd_aabbs_in_f32x8,
+   inside gets the mask of the boxes whose n-vertex (n . c + w - |n| . e) is
+   inside of all planes, i.e. that are completely inside */
+VM_API VM_INLINE int vm_frustum_simd_aabbs_classify_f32x8(const frustum_simd *f, f32x8 x, f32x8 y, f32x8 z, f32x8 extent_x, f32x8 extent_y, f32x8 extent_z, int *inside)
+{
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    f32x8 min_p = zero;
+    f32x8 min_n = zero;
+
+    int i;
+
+    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        f32x8 distance = vm_frustum_simd_distance_f32x8(f, i, x, y, z);
+        f32x8 reach = vm_f32x8_mul(vm_f32x8_set1(f->abs_x[i]), extent_x);
+        reach = vm_f32x8_madd(vm_f32x8_set1(f->abs_y[i]), extent_y, reach);
+        reach = vm_f32x8_madd(vm_f32x8_set1(f->abs_z[i]), extent_z, reach);
+
+        if (i == 0)
+        {
+            min_p = vm_f32x8_add(distance, reach);
+            min_n = vm_f32x8_sub(distance, reach);
+        }
+        else
+        {
+            min_p = vm_f32x8_min(min_p, vm_f32x8_add(distance, reach));
+            min_n = vm_f32x8_min(min_n, vm_f32x8_sub(distance, reach));
+        }
+    }
+
+    *inside = vm_f32x8_movemask(vm_f32x8_cmpge(min_n, zero));
+
+    return (vm_f32x8_movemask(vm_f32x8_cmpge(min_p, zero)));
+}
+
+#ifdef VM_USE_AVX2
+/* For every 8 bit mask the positions of its set bits, one per nibble (lowest first) */
+static const unsigned int vm_frustum_pack_table[256] = {
+    0x00000000u, 0x00000000u, 0x00000001u, 0x00000010u, 0x00000002u, 0x00000020u, 0x00000021u, 0x00000210u,
+    0x00000003u, 0x00000030u, 0x00000031u, 0x00000310u, 0x00000032u, 0x00000320u, 0x00000321u, 0x00003210u,
+    0x00000004u, 0x00000040u, 0x00000041u, 0x00000410u, 0x00000042u, 0x00000420u, 0x00000421u, 0x00004210u,
+    0x00000043u, 0x00000430u, 0x00000431u, 0x00004310u, 0x00000432u, 0x00004320u, 0x00004321u, 0x00043210u,
+    0x00000005u, 0x00000050u, 0x00000051u, 0x00000510u, 0x00000052u, 0x00000520u, 0x00000521u, 0x00005210u,
+    0x00000053u, 0x00000530u, 0x00000531u, 0x00005310u, 0x00000532u, 0x00005320u, 0x00005321u, 0x00053210u,
+    0x00000054u, 0x00000540u, 0x00000541u, 0x00005410u, 0x00000542u, 0x00005420u, 0x00005421u, 0x00054210u,
+    0x00000543u, 0x00005430u, 0x00005431u, 0x00054310u, 0x00005432u, 0x00054320u, 0x00054321u, 0x00543210u,
+    0x00000006u, 0x00000060u, 0x00000061u, 0x00000610u, 0x00000062u, 0x00000620u, 0x00000621u, 0x00006210u,
+    0x00000063u, 0x00000630u, 0x00000631u, 0x00006310u, 0x00000632u, 0x00006320u, 0x00006321u, 0x00063210u,
+    0x00000064u, 0x00000640u, 0x00000641u, 0x00006410u, 0x00000642u, 0x00006420u, 0x00006421u, 0x00064210u,
+    0x00000643u, 0x00006430u, 0x00006431u, 0x00064310u, 0x00006432u, 0x00064320u, 0x00064321u, 0x00643210u,
+    0x00000065u, 0x00000650u, 0x00000651u, 0x00006510u, 0x00000652u, 0x00006520u, 0x00006521u, 0x00065210u,
+    0x00000653u, 0x00006530u, 0x00006531u, 0x00065310u, 0x00006532u, 0x00065320u, 0x00065321u, 0x00653210u,
+    0x00000654u, 0x00006540u, 0x00006541u, 0x00065410u, 0x00006542u, 0x00065420u, 0x00065421u, 0x00654210u,
+    0x00006543u, 0x00065430u, 0x00065431u, 0x00654310u, 0x00065432u, 0x00654320u, 0x00654321u, 0x06543210u,
+    0x00000007u, 0x00000070u, 0x00000071u, 0x00000710u, 0x00000072u, 0x00000720u, 0x00000721u, 0x00007210u,
+    0x00000073u, 0x00000730u, 0x00000731u, 0x00007310u, 0x00000732u, 0x00007320u, 0x00007321u, 0x00073210u,
+    0x00000074u, 0x00000740u, 0x00000741u, 0x00007410u, 0x00000742u, 0x00007420u, 0x00007421u, 0x00074210u,
+    0x00000743u, 0x00007430u, 0x00007431u, 0x00074310u, 0x00007432u, 0x00074320u, 0x00074321u, 0x00743210u,
+    0x00000075u, 0x00000750u, 0x00000751u, 0x00007510u, 0x00000752u, 0x00007520u, 0x00007521u, 0x00075210u,
+    0x00000753u, 0x00007530u, 0x00007531u, 0x00075310u, 0x00007532u, 0x00075320u, 0x00075321u, 0x00753210u,
+    0x00000754u, 0x00007540u, 0x00007541u, 0x00075410u, 0x00007542u, 0x00075420u, 0x00075421u, 0x00754210u,
+    0x00007543u, 0x00075430u, 0x00075431u, 0x00754310u, 0x00075432u, 0x00754320u, 0x00754321u, 0x07543210u,
+    0x00000076u, 0x00000760u, 0x00000761u, 0x00007610u, 0x00000762u, 0x00007620u, 0x00007621u, 0x00076210u,
+    0x00000763u, 0x00007630u, 0x00007631u, 0x00076310u, 0x00007632u, 0x00076320u, 0x00076321u, 0x00763210u,
+    0x00000764u, 0x00007640u, 0x00007641u, 0x00076410u, 0x00007642u, 0x00076420u, 0x00076421u, 0x00764210u,
+    0x00007643u, 0x00076430u, 0x00076431u, 0x00764310u, 0x00076432u, 0x00764320u, 0x00764321u, 0x07643210u,
+    0x00000765u, 0x00007650u, 0x00007651u, 0x00076510u, 0x00007652u, 0x00076520u, 0x00076521u, 0x00765210u,
+    0x00007653u, 0x00076530u, 0x00076531u, 0x00765310u, 0x00076532u, 0x00765320u, 0x00765321u, 0x07653210u,
+    0x00007654u, 0x00076540u, 0x00076541u, 0x00765410u, 0x00076542u, 0x00765420u, 0x00765421u, 0x07654210u,
+    0x00076543u, 0x00765430u, 0x00765431u, 0x07654310u, 0x00765432u, 0x07654320u, 0x07654321u, 0x76543210u};
+#endif
+
+/* Left-packs base + j for every set bit j of the 8 bit mask into out and
+   returns how many were written. Up to 8 entries of out may be touched. */
+VM_API VM_INLINE int vm_frustum_pack_indices(int *out, int base, int mask)
+{
+#ifdef VM_USE_AVX2
+    __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    __m256i lanes = _mm256_srlv_epi32(_mm256_set1_epi32((int)vm_frustum_pack_table[mask]), shifts);
+    __m256i indices = _mm256_add_epi32(_mm256_and_si256(lanes, _mm256_set1_epi32(7)), _mm256_set1_epi32(base));
+
+    int count = mask - ((mask >> 1) & 0x55);
+
+    _mm256_storeu_si256((__m256i *)out, indices);
+
+    /* Bit count of the 8 bit mask */
+    count = (count & 0x33) + ((count >> 2) & 0x33);
+
+    return ((count + (count >> 4)) & 0x0F);
+#else
+    /* Branch free: always write, only advance for visible lanes */
+    int count = 0;
+    int j;
+
+    for (j = 0; j < VM_F32X8_WIDTH; ++j)
+    {
+        out[count] = base + j;
+        count += (mask >> j) & 1;
+    }
+
+    return (count);
+#endif
+}
+
+/* Plane masks for hierarchical culling, bit i stands for plane i in the order
+   of frustum (left, right, bottom, top, near, far) */
+#define VM_FRUSTUM_PLANES_ALL 0x3F
+
+/* Tests a box (center and half extents) against the planes in plane_mask.
+   Returns -1 if it is outside, otherwise the mask of the planes it still
+   crosses: children of a node only have to be tested against that mask and
+   0 means the whole subtree is inside. If last_plane is given (one per
+   object, initialized to 0) the plane that rejected the box last time is
+   tested first and updated on rejection, objects tend to be culled by the
+   same plane frame after frame. */
+VM_API VM_INLINE int vm_frustum_aabb_plane_mask(const frustum_simd *f, v3 center, v3 extents, int plane_mask, unsigned char *last_plane)
+{
+    int result = 0;
+    int plane = last_plane ? (int)*last_plane : 0;
+    int i;
+
+    /* The cached plane first, then the remaining ones in frustum order */
+    for (i = 0; i <= VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        int bit = 1 << plane;
+
+        if (plane_mask & bit)
+        {
+            float distance = vm_fmaf(f->z[plane], center.z, vm_fmaf(f->y[plane], center.y, vm_fmaf(f->x[plane], center.x, f->w[plane])));
+            float reach = f->abs_x[plane] * extents.x + f->abs_y[plane] * extents.y + f->abs_z[plane] * extents.z;
+
+            if (distance + reach < 0.0f)
+            {
+                if (last_plane)
+                {
+                    *last_plane = (unsigned char)plane;
+                }
+
+                return (-1);
+            }
+
+            if (distance - reach < 0.0f)
+            {
+                result |= bit;
+            }
+
+            plane_mask &= ~bit;
+        }
+
+        plane = i;
+    }
+
+    return (result);
+}
+
+/* Same as vm_frustum_aabb_plane_mask for a sphere */
+VM_API VM_INLINE int vm_frustum_sphere_plane_mask(const frustum_simd *f, v3 center, float radius, int plane_mask, unsigned char *last_plane)
+{
+    int result = 0;
+    int plane = last_plane ? (int)*last_plane : 0;
+    int i;
+
+    for (i = 0; i <= VM_FRUSTUM_PLANE_SIZE; ++i)
+    {
+        int bit = 1 << plane;
+
+        if (plane_mask & bit)
+        {
+            float distance = vm_fmaf(f->z[plane], center.z, vm_fmaf(f->y[plane], center.y, vm_fmaf(f->x[plane], center.x, f->w[plane])));
+
+            if (distance < -radius)
+            {
+                if (last_plane)
+                {
+                    *last_plane = (unsigned char)plane;
+                }
+
+                return (-1);
+            }
+
+            if (distance < radius)
+            {
+                result |= bit;
+            }
+
+            plane_mask &= ~bit;
+        }
+
+        plane = i;
+    }
+
+    return (result);
+}
+
+/* Output of the compacting cull functions. inside and intersecting are
+   provided by the caller and need room for the number of tested objects. */
+typedef struct frustum_cull_list
+{
+    int *inside;       /* Indices of the objects completely inside the frustum (ascending) */
+    int *intersecting; /* Indices of the objects crossing at least one plane (ascending) */
+    int inside_count;
+    int intersecting_count;
+
+} frustum_cull_list;
+
+VM_API VM_INLINE frustum_cull_list vm_frustum_cull_list(int *inside, int *intersecting)
+{
+    frustum_cull_list result;
+
+    result.inside = inside;
+    result.intersecting = intersecting;
+    result.inside_count = 0;
+    result.intersecting_count = 0;
+
+    return (result);
+}
+
+/* Appends the classified block of 8 objects starting at base. The packing
+   writes up to 8 entries, near the end of the lists a scratch copy is used. */
+VM_API VM_INLINE void vm_frustum_cull_list_append(frustum_cull_list *list, int base, int visible, int inside, int capacity)
+{
+    int intersecting = visible & ~inside;
+
+    if (list->inside_count + VM_F32X8_WIDTH <= capacity && list->intersecting_count + VM_F32X8_WIDTH <= capacity)
+    {
+        list->inside_count += vm_frustum_pack_indices(&list->inside[list->inside_count], base, inside);
+        list->intersecting_count += vm_frustum_pack_indices(&list->intersecting[list->intersecting_count], base, intersecting);
+    }
+    else
+    {
+        int scratch[VM_F32X8_WIDTH];
+        int count;
+        int j;
+
+        count = vm_frustum_pack_indices(scratch, base, inside);
+        for (j = 0; j < count; ++j)
+        {
+            list->inside[list->inside_count++] = scratch[j];
+        }
+
+        count = vm_frustum_pack_indices(scratch, base, intersecting);
+        for (j = 0; j < count; ++j)
+        {
+            list->intersecting[list->intersecting_count++] = scratch[j];
+        }
+    }
+}
+
+/* Tests centers->count spheres and writes the indices of the visible ones
+   into list, split into completely inside and intersecting. Returns the
+   number of visible spheres. */
+VM_API VM_INLINE int vm_frustum_cull_spheres(const frustum_simd *f, const v3_soa *centers, const float *radii, frustum_cull_list *list)
+{
+    int count = centers->count;
+    int inside;
+    int visible;
+    int i = 0;
+
+    list->inside_count = 0;
+    list->intersecting_count = 0;
+
+    for (; i + VM_F32X8_WIDTH <= count; i += VM_F32X8_WIDTH)
+    {
+        visible = vm_frustum_simd_spheres_classify_f32x8(
+            f,
+            vm_f32x8_load(&centers->x[i]),
+            vm_f32x8_load(&centers->y[i]),
+            vm_f32x8_load(&centers->z[i]),
+            vm_f32x8_load(&radii[i]),
+            &inside);
+
+        vm_frustum_cull_list_append(list, i, visible, inside, count);
+    }
+
+    if (i < count)
+    {
+        int rest = count - i;
+
+        visible = vm_frustum_simd_spheres_classify_f32x8(
+            f,
+            vm_frustum_simd_load_tail(&centers->x[i], rest),
+            vm_frustum_simd_load_tail(&centers->y[i], rest),
+            vm_frustum_simd_load_tail(&centers->z[i], rest),
+            vm_frustum_simd_load_tail(&radii[i], rest),
+            &inside);
+
+        vm_frustum_cull_list_append(list, i, visible & ((1 << rest) - 1), inside & ((1 << rest) - 1), count);
+    }
+
+    return (list->inside_count + list->intersecting_count);
+}
+
+/* Tests centers->count boxes given by center and half extents, same output as vm_frustum_cull_spheres */
+VM_API VM_INLINE int vm_frustum_cull_aabbs(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, frustum_cull_list *list)
+{
+    int count = centers->count;
+    int inside;
+    int visible;
+    int i = 0;
+
+    list->inside_count = 0;
+    list->intersecting_count = 0;
+
+    for (; i + VM_F32X8_WIDTH <= count; i += VM_F32X8_WIDTH)
+    {
+        visible = vm_frustum_simd_aabbs_classify_f32x8(
+            f,
+            vm_f32x8_load(&centers->x[i]),
+            vm_f32x8_load(&centers->y[i]),
+            vm_f32x8_load(&centers->z[i]),
+            vm_f32x8_load(&extents->x[i]),
+            vm_f32x8_load(&extents->y[i]),
+            vm_f32x8_load(&extents->z[i]),
+            &inside);
+
+        vm_frustum_cull_list_append(list, i, visible, inside, count);
+    }
+
+    if (i < count)
+    {
+        int rest = count - i;
+
+        visible = vm_frustum_simd_aabbs_classify_f32x8(
+            f,
+            vm_frustum_simd_load_tail(&centers->x[i], rest),
+            vm_frustum_simd_load_tail(&centers->y[i], rest),
+            vm_frustum_simd_load_tail(&centers->z[i], rest),
+            vm_frustum_simd_load_tail(&extents->x[i], rest),
+            vm_frustum_simd_load_tail(&extents->y[i], rest),
+            vm_frustum_simd_load_tail(&extents->z[i], rest),
+            &inside);
+
+        vm_frustum_cull_list_append(list, i, visible & ((1 << rest) - 1), inside & ((1 << rest) - 1), count);
+    }
+
+    return (list->inside_count + list->intersecting_count);
+}
+
+/* Maximum number of frusta tested in one pass, one bit per frustum in an unsigned int */
+#ifndef VM_FRUSTUM_MULTI_MAX
+#define VM_FRUSTUM_MULTI_MAX 32
+#endif
+
+/* Lane mask with only bit k set, or-ed into the per object masks */
+VM_API VM_INLINE f32x8 vm_frustum_multi_bit(int k)
+{
+    union
+    {
+        float f;
+        unsigned int u;
+    } bit;
+
+    bit.u = 1u << k;
+
+    return (vm_f32x8_set1(bit.f));
+}
+
+/* Writes the first n lanes of the per object frustum masks of one block */
+VM_API VM_INLINE void vm_frustum_multi_store(unsigned int *visible, f32x8 bits, int n)
+{
+    union
+    {
+        float f[VM_F32X8_WIDTH];
+        unsigned int u[VM_F32X8_WIDTH];
+    } block;
+
+    int j;
+
+    vm_f32x8_store(block.f, bits);
+
+    for (j = 0; j < n; ++j)
+    {
+        visible[j] = block.u[j];
+    }
+}
+
+/* Tests centers->count spheres against frustum_count (<= VM_FRUSTUM_MULTI_MAX)
+   frusta (shadow cascades, cube map faces, split screen views) and writes one
+   mask per sphere into visible, bit k set if the sphere intersects or is inside
+   frusta[k]. Every block of 8 spheres is loaded once and tested against all
+   frusta while it is in registers, so memory traffic does not grow with the
+   number of views */
+VM_API VM_INLINE void vm_frustum_cull_spheres_multi(const frustum_simd *frusta, int frustum_count, const v3_soa *centers, const float *radii, unsigned int *visible)
+{
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    int count = centers->count;
+    int i;
+    int k;
+
+    VM_ASSERT(frustum_count >= 0 && frustum_count <= VM_FRUSTUM_MULTI_MAX);
+
+    for (i = 0; i < count; i += VM_F32X8_WIDTH)
+    {
+        int rest = count - i < VM_F32X8_WIDTH ? count - i : VM_F32X8_WIDTH;
+        f32x8 bits = zero;
+        f32x8 x = vm_frustum_simd_load_n(&centers->x[i], rest);
+        f32x8 y = vm_frustum_simd_load_n(&centers->y[i], rest);
+        f32x8 z = vm_frustum_simd_load_n(&centers->z[i], rest);
+        f32x8 radius = vm_frustum_simd_load_n(&radii[i], rest);
+
+        for (k = 0; k < frustum_count; ++k)
+        {
+            const frustum_simd *f = &frusta[k];
+            f32x8 min_distance = vm_frustum_simd_distance_f32x8(f, 0, x, y, z);
+            int p;
+
+            for (p = 1; p < VM_FRUSTUM_PLANE_SIZE; ++p)
+            {
+                min_distance = vm_f32x8_min(min_distance, vm_frustum_simd_distance_f32x8(f, p, x, y, z));
+            }
+
+            /* Same test as vm_frustum_simd_spheres_in_f32x8, kept as a lane mask */
+            bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmpge(vm_f32x8_add(min_distance, radius), zero), vm_frustum_multi_bit(k)));
+        }
+
+        vm_frustum_multi_store(&visible[i], bits, rest);
+    }
+}
+
+/* Tests centers->count boxes given by center and half extents against
+   frustum_count frusta, same output as vm_frustum_cull_spheres_multi */
+VM_API VM_INLINE void vm_frustum_cull_aabbs_multi(const frustum_simd *frusta, int frustum_count, const v3_soa *centers, const v3_soa *extents, unsigned int *visible)
+{
+    f32x8 zero = vm_f32x8_set1(0.0f);
+    int count = centers->count;
+    int i;
+    int k;
+
+    VM_ASSERT(frustum_count >= 0 && frustum_count <= VM_FRUSTUM_MULTI_MAX);
+
+    for (i = 0; i < count; i += VM_F32X8_WIDTH)
+    {
+        int rest = count - i < VM_F32X8_WIDTH ? count - i : VM_F32X8_WIDTH;
+        f32x8 bits = zero;
+        f32x8 x = vm_frustum_simd_load_n(&centers->x[i], rest);
+        f32x8 y = vm_frustum_simd_load_n(&centers->y[i], rest);
+        f32x8 z = vm_frustum_simd_load_n(&centers->z[i], rest);
+        f32x8 extent_x = vm_frustum_simd_load_n(&extents->x[i], rest);
+        f32x8 extent_y = vm_frustum_simd_load_n(&extents->y[i], rest);
+        f32x8 extent_z = vm_frustum_simd_load_n(&extents->z[i], rest);
+
+        for (k = 0; k < frustum_count; ++k)
+        {
+            const frustum_simd *f = &frusta[k];
+            f32x8 min_distance = vm_frustum_simd_box_distance_f32x8(f, 0, x, y, z, extent_x, extent_y, extent_z);
+            int p;
+
+            for (p = 1; p < VM_FRUSTUM_PLANE_SIZE; ++p)
+            {
+                min_distance = vm_f32x8_min(min_distance, vm_frustum_simd_box_distance_f32x8(f, p, x, y, z, extent_x, extent_y, extent_z));
+            }
+
+            bits = vm_f32x8_or(bits, vm_f32x8_and(vm_f32x8_cmpge(min_distance, zero), vm_frustum_multi_bit(k)));
+        }
+
+        vm_frustum_multi_store(&visible[i], bits, rest);
+    }
+}
+
+/* #############################################################################
+ * # MEMORY ARENA FUNCTIONS
+ * #############################################################################
+ */
+/* A bump allocator over caller provided memory, used by the spatial structures
+   below so that vm.h never allocates on its own. Reset it to free everything. */
+typedef struct vm_arena
+{
+    unsigned char *base;
+    vm_uptr capacity;
+    vm_uptr offset;
+
+} vm_arena;
+
+VM_API VM_INLINE vm_arena vm_arena_init(void *memory, vm_uptr capacity)
+{
+    vm_arena result;
+
+    result.base = (unsigned char *)memory;
+    result.capacity = capacity;
+    result.offset = 0;
+
+    return (result);
+}
+
+/* Returns size bytes aligned to align (a power of two) or 0 if the arena is full */
+VM_API VM_INLINE void *vm_arena_alloc(vm_arena *a, vm_uptr size, vm_uptr align)
+{
+    vm_uptr address = (vm_uptr)(a->base + a->offset);
+    vm_uptr padding = (align - (address & (align - 1))) & (align - 1);
+
+    if (a->offset + padding + size > a->capacity)
+    {
+        return (0);
+    }
+
+    a->offset += padding + size;
+
+    return (a->base + a->offset - size);
+}
+
+VM_API VM_INLINE void vm_arena_reset(vm_arena *a)
+{
+    a->offset = 0;
+}
+
+/* #############################################################################
+ * # BOUNDING VOLUME HIERARCHY FUNCTIONS
+ * #############################################################################
+ */
+/* Maximum number of objects per leaf slot */
+#ifndef VM_BVH4_LEAF_SIZE
+#define VM_BVH4_LEAF_SIZE 4
+#endif
+
+/* Number of bins of the SAH split search */
+#ifndef VM_BVH4_BINS
+#define VM_BVH4_BINS 16
+#endif
+
+/* Traversal stack entries, deeper subtrees are reported as intersecting without being tested */
+#ifndef VM_BVH4_STACK_SIZE
+#define VM_BVH4_STACK_SIZE 64
+#endif
+
+/* A node with 4 child slots, the slot boxes are stored as SoA so that all 4 are
+   tested with one f32x4 per plane. Each slot covers the objects
+   indices[first .. first + count) of the hierarchy, slots with count 0 are empty. */
+typedef struct bvh4_node
+{
+    float min_x[4];
+    float min_y[4];
+    float min_z[4];
+    float max_x[4];
+    float max_y[4];
+    float max_z[4];
+    int child[4]; /* Inner node index, -1 for leaf and empty slots */
+    int first[4];
+    int count[4];
+
+} bvh4_node;
+
+/* A 4-wide bounding volume hierarchy over object boxes (SoA centers and half
+   extents). Nodes are stored parent before child, nodes[0] is the root. */
+typedef struct bvh4
+{
+    bvh4_node *nodes;
+    int *indices; /* Object indices, each node slot covers a contiguous range */
+    int node_count;
+    int count;
+
+} bvh4;
+
+/* Splits indices[first .. first + count) in two with a binned surface area
+   heuristic over the box centers and returns the size of the first part */
+VM_API VM_INLINE int vm_bvh4_split(int *indices, const v3_soa *centers, const v3_soa *extents, int first, int count)
+{
+    float bin_min[VM_BVH4_BINS][3];
+    float bin_max[VM_BVH4_BINS][3];
+    int bin_count[VM_BVH4_BINS];
+    float right_area[VM_BVH4_BINS];
+    float center_min[3];
+    float center_max[3];
+    float lo[3];
+    float hi[3];
+    const float *axis_centers;
+    float best_cost = 0.0f;
+    float scale;
+    int best_split = 0;
+    int axis = 0;
+    int left_count;
+    int i;
+    int j;
+    int k;
+
+    center_min[0] = center_max[0] = centers->x[indices[first]];
+    center_min[1] = center_max[1] = centers->y[indices[first]];
+    center_min[2] = center_max[2] = centers->z[indices[first]];
+
+    for (i = first + 1; i < first + count; ++i)
+    {
+        int o = indices[i];
+
+        center_min[0] = vm_minf(center_min[0], centers->x[o]);
+        center_min[1] = vm_minf(center_min[1], centers->y[o]);
+        center_min[2] = vm_minf(center_min[2], centers->z[o]);
+        center_max[0] = vm_maxf(center_max[0], centers->x[o]);
+        center_max[1] = vm_maxf(center_max[1], centers->y[o]);
+        center_max[2] = vm_maxf(center_max[2], centers->z[o]);
+    }
+
+    for (k = 1; k < 3; ++k)
+    {
+        if (center_max[k] - center_min[k] > center_max[axis] - center_min[axis])
+        {
+            axis = k;
+        }
+    }
+
+    /* All centers in one point, any split is as good as another */
+    if (center_max[axis] <= center_min[axis])
+    {
+        return (count / 2);
+    }
+
+    axis_centers = axis == 0 ? centers->x : (axis == 1 ? centers->y : centers->z);
+    scale = ((float)VM_BVH4_BINS * 0.9999f) / (center_max[axis] - center_min[axis]);
+
+    for (j = 0; j < VM_BVH4_BINS; ++j)
+    {
+        bin_count[j] = 0;
+    }
+
+    for (i = first; i < first + count; ++i)
+    {
+        int o = indices[i];
+        int bin = (int)((axis_centers[o] - center_min[axis]) * scale);
+
+        lo[0] = centers->x[o] - extents->x[o];
+        lo[1] = centers->y[o] - extents->y[o];
+        lo[2] = centers->z[o] - extents->z[o];
+        hi[0] = centers->x[o] + extents->x[o];
+        hi[1] = centers->y[o] + extents->y[o];
+        hi[2] = centers->z[o] + extents->z[o];
+
+        for (k = 0; k < 3; ++k)
+        {
+            bin_min[bin][k] = bin_count[bin] ? vm_minf(bin_min[bin][k], lo[k]) : lo[k];
+            bin_max[bin][k] = bin_count[bin] ? vm_maxf(bin_max[bin][k], hi[k]) : hi[k];
+        }
+
+        bin_count[bin]++;
+    }
+
+    /* Sweep from the right: right_area[j] is the surface (halved) of the bins j .. BINS - 1 */
+    {
+        int seen = 0;
+
+        for (j = VM_BVH4_BINS - 1; j > 0; --j)
+        {
+            if (bin_count[j])
+            {
+                for (k = 0; k < 3; ++k)
+                {
+                    lo[k] = seen ? vm_minf(lo[k], bin_min[j][k]) : bin_min[j][k];
+                    hi[k] = seen ? vm_maxf(hi[k], bin_max[j][k]) : bin_max[j][k];
+                }
+
+                seen = 1;
+            }
+
+            right_area[j] = seen ? (hi[0] - lo[0]) * (hi[1] - lo[1]) + (hi[1] - lo[1]) * (hi[2] - lo[2]) + (hi[2] - lo[2]) * (hi[0] - lo[0]) : 0.0f;
+        }
+    }
+
+    /* Sweep from the left and evaluate the cost of splitting in front of bin j */
+    {
+        int left = 0;
+
+        for (j = 1; j < VM_BVH4_BINS; ++j)
+        {
+            int prev = j - 1;
+            float left_area;
+            float cost;
+
+            if (bin_count[prev])
+            {
+                for (k = 0; k < 3; ++k)
+                {
+                    lo[k] = left ? vm_minf(lo[k], bin_min[prev][k]) : bin_min[prev][k];
+                    hi[k] = left ? vm_maxf(hi[k], bin_max[prev][k]) : bin_max[prev][k];
+                }
+
+                left += bin_count[prev];
+            }
+
+            if (left == 0 || left == count)
+            {
+                continue;
+            }
+
+            left_area = (hi[0] - lo[0]) * (hi[1] - lo[1]) + (hi[1] - lo[1]) * (hi[2] - lo[2]) + (hi[2] - lo[2]) * (hi[0] - lo[0]);
+            cost = left_area * (float)left + right_area[j] * (float)(count - left);
+
+            if (best_split == 0 || cost < best_cost)
+            {
+                best_cost = cost;
+                best_split = j;
+            }
+        }
+    }
+
+    /* Partition in place by bin */
+    i = first;
+    j = first + count - 1;
+
+    while (i <= j)
+    {
+        if ((int)((axis_centers[indices[i]] - center_min[axis]) * scale) < best_split)
+        {
+            ++i;
+        }
+        else
+        {
+            int swap = indices[i];
+            indices[i] = indices[j];
+            indices[j] = swap;
+            --j;
+        }
+    }
+
+    left_count = i - first;
+
+    return (left_count);
+}
+
+/* Bounds of the objects indices[first .. first + count) written into slot k of node */
+VM_API VM_INLINE void vm_bvh4_slot_bounds(bvh4_node *node, int k, const int *indices, const v3_soa *centers, const v3_soa *extents, int first, int count)
+{
+    int i;
+
+    node->min_x[k] = node->min_y[k] = node->min_z[k] = 3.0e38f;
+    node->max_x[k] = node->max_y[k] = node->max_z[k] = -3.0e38f;
+
+    for (i = first; i < first + count; ++i)
+    {
+        int o = indices[i];
+
+        node->min_x[k] = vm_minf(node->min_x[k], centers->x[o] - extents->x[o]);
+        node->min_y[k] = vm_minf(node->min_y[k], centers->y[o] - extents->y[o]);
+        node->min_z[k] = vm_minf(node->min_z[k], centers->z[o] - extents->z[o]);
+        node->max_x[k] = vm_maxf(node->max_x[k], centers->x[o] + extents->x[o]);
+        node->max_y[k] = vm_maxf(node->max_y[k], centers->y[o] + extents->y[o]);
+        node->max_z[k] = vm_maxf(node->max_z[k], centers->z[o] + extents->z[o]);
+    }
+}
+
+/* Builds the node for indices[first .. first + count) and its subtree,
+   returns its index or -1 if the arena is full */
+VM_API VM_INLINE int vm_bvh4_build_node(bvh4 *bvh, vm_arena *arena, const v3_soa *centers, const v3_soa *extents, int first, int count)
+{
+    bvh4_node *node = (bvh4_node *)vm_arena_alloc(arena, sizeof(bvh4_node), 16);
+    int part_first[4];
+    int part_count[4];
+    int parts = 1;
+    int index;
+    int k;
+
+    if (!node)
+    {
+        return (-1);
+    }
+
+    /* Nodes are allocated back to back, the first one is the root */
+    if (!bvh->nodes)
+    {
+        bvh->nodes = node;
+    }
+
+    index = (int)(node - bvh->nodes);
+    bvh->node_count = index + 1;
+
+    part_first[0] = first;
+    part_count[0] = count;
+
+    /* Split the largest part until there are 4 or all fit into a leaf */
+    while (parts < 4)
+    {
+        int largest = 0;
+        int left;
+
+        for (k = 1; k < parts; ++k)
+        {
+            if (part_count[k] > part_count[largest])
+            {
+                largest = k;
+            }
+        }
+
+        if (part_count[largest] <= VM_BVH4_LEAF_SIZE)
+        {
+            break;
+        }
+
+        left = vm_bvh4_split(bvh->indices, centers, extents, part_first[largest], part_count[largest]);
+
+        part_first[parts] = part_first[largest] + left;
+        part_count[parts] = part_count[largest] - left;
+        part_count[largest] = left;
+        parts++;
+    }
+
+    for (k = 0; k < 4; ++k)
+    {
+        node->child[k] = -1;
+        node->first[k] = k < parts ? part_first[k] : 0;
+        node->count[k] = k < parts ? part_count[k] : 0;
+
+        /* Empty slots get an inverted box that never passes a plane test */
+        vm_bvh4_slot_bounds(node, k, bvh->indices, centers, extents, node->first[k], node->count[k]);
+    }
+
+    for (k = 0; k < parts; ++k)
+    {
+        if (part_count[k] > VM_BVH4_LEAF_SIZE)
+        {
+            int child = vm_bvh4_build_node(bvh, arena, centers, extents, part_first[k], part_count[k]);
+
+            if (child < 0)
+            {
+                return (-1);
+            }
+
+            node->child[k] = child;
+        }
+    }
+
+    return (index);
+}
+
+/* Upper bound of the arena memory vm_bvh4_build needs for count objects */
+VM_API VM_INLINE vm_uptr vm_bvh4_memory_size(int count)
+{
+    return ((vm_uptr)(count + 1) * (sizeof(int) + sizeof(bvh4_node)) + 16);
+}
+
+/* Builds the hierarchy over centers->count boxes. The index array and the
+   nodes are allocated from arena (see vm_bvh4_memory_size).
+   Returns 0 if the arena is too small. */
+VM_API VM_INLINE int vm_bvh4_build(bvh4 *out, vm_arena *arena, const v3_soa *centers, const v3_soa *extents)
+{
+    int i;
+
+    out->nodes = 0;
+    out->node_count = 0;
+    out->count = centers->count;
+    out->indices = (int *)vm_arena_alloc(arena, (vm_uptr)centers->count * sizeof(int) + sizeof(int), sizeof(int));
+
+    if (!out->indices)
+    {
+        return (0);
+    }
+
+    for (i = 0; i < centers->count; ++i)
+    {
+        out->indices[i] = i;
+    }
+
+    return (vm_bvh4_build_node(out, arena, centers, extents, 0, centers->count) == 0);
+}
+
+/* Recomputes all boxes bottom up after objects moved, keeping the topology.
+   Cheaper than a rebuild but the tree degrades if objects move far. */
+VM_API VM_INLINE void vm_bvh4_refit(bvh4 *bvh, const v3_soa *centers, const v3_soa *extents)
+{
+    int n;
+    int k;
+    int j;
+
+    /* Children are stored after their parents */
+    for (n = bvh->node_count - 1; n >= 0; --n)
+    {
+        bvh4_node *node = &bvh->nodes[n];
+
+        for (k = 0; k < 4; ++k)
+        {
+            const bvh4_node *child;
+
+            if (node->child[k] < 0)
+            {
+                vm_bvh4_slot_bounds(node, k, bvh->indices, centers, extents, node->first[k], node->count[k]);
+                continue;
+            }
+
+            child = &bvh->nodes[node->child[k]];
+
+            node->min_x[k] = child->min_x[0];
+            node->min_y[k] = child->min_y[0];
+            node->min_z[k] = child->min_z[0];
+            node->max_x[k] = child->max_x[0];
+            node->max_y[k] = child->max_y[0];
+            node->max_z[k] = child->max_z[0];
+
+            for (j = 1; j < 4; ++j)
+            {
+                if (child->count[j])
+                {
+                    node->min_x[k] = vm_minf(node->min_x[k], child->min_x[j]);
+                    node->min_y[k] = vm_minf(node->min_y[k], child->min_y[j]);
+                    node->min_z[k] = vm_minf(node->min_z[k], child->min_z[j]);
+                    node->max_x[k] = vm_maxf(node->max_x[k], child->max_x[j]);
+                    node->max_y[k] = vm_maxf(node->max_y[k], child->max_y[j]);
+                    node->max_z[k] = vm_maxf(node->max_z[k], child->max_z[j]);
+                }
+            }
+        }
+    }
+}
+
+/* Appends indices[first .. first + count) to a list */
+VM_API VM_INLINE void vm_bvh4_append(int *list, int *list_count, const int *indices, int first, int count)
+{
+    int i;
+
+    for (i = first; i < first + count; ++i)
+    {
+        list[(*list_count)++] = indices[i];
+    }
+}
+
+/* Culls the hierarchy against the frustum and writes the visible objects
+   into list (inside and intersecting like vm_frustum_cull_aabbs, but not in
+   ascending order). The 4 slot boxes of a node are tested together, only
+   against the planes their parent crosses, and subtrees that are
+   completely inside are accepted without further tests.
+   Returns the number of visible objects. */
+VM_API VM_INLINE int vm_bvh4_cull(const bvh4 *bvh, const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, frustum_cull_list *list)
+{
+    int stack_node[VM_BVH4_STACK_SIZE];
+    int stack_mask[VM_BVH4_STACK_SIZE];
+    int stack_size = 0;
+
+    list->inside_count = 0;
+    list->intersecting_count = 0;
+
+    if (!bvh->node_count)
+    {
+        return (0);
+    }
+
+    stack_node[stack_size] = 0;
+    stack_mask[stack_size] = VM_FRUSTUM_PLANES_ALL;
+    stack_size++;
+
+    while (stack_size > 0)
+    {
+        const bvh4_node *node;
+        f32x4 half = vm_f32x4_set1(0.5f);
+        f32x4 zero = vm_f32x4_set1(0.0f);
+        f32x4 cx, cy, cz, ex, ey, ez;
+        int crossing[VM_FRUSTUM_PLANE_SIZE];
+        int plane_mask;
+        int visible;
+        int k;
+        int p;
+
+        stack_size--;
+        node = &bvh->nodes[stack_node[stack_size]];
+        plane_mask = stack_mask[stack_size];
+
+        cx = vm_f32x4_mul(vm_f32x4_add(vm_f32x4_load(node->min_x), vm_f32x4_load(node->max_x)), half);
+        cy = vm_f32x4_mul(vm_f32x4_add(vm_f32x4_load(node->min_y), vm_f32x4_load(node->max_y)), half);
+        cz = vm_f32x4_mul(vm_f32x4_add(vm_f32x4_load(node->min_z), vm_f32x4_load(node->max_z)), half);
+        ex = vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(node->max_x), vm_f32x4_load(node->min_x)), half);
+        ey = vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(node->max_y), vm_f32x4_load(node->min_y)), half);
+        ez = vm_f32x4_mul(vm_f32x4_sub(vm_f32x4_load(node->max_z), vm_f32x4_load(node->min_z)), half);
+
+        visible = (node->count[0] ? 1 : 0) | (node->count[1] ? 2 : 0) | (node->count[2] ? 4 : 0) | (node->count[3] ? 8 : 0);
+
+        /* p-vertex outside rejects a slot, n-vertex outside means it crosses the plane */
+        for (p = 0; p < VM_FRUSTUM_PLANE_SIZE; ++p)
+        {
+            f32x4 distance;
+            f32x4 reach;
+
+            crossing[p] = 0;
+
+            if (!(plane_mask & (1 << p)))
+            {
+                continue;
+            }
+
+            distance = vm_frustum_simd_distance_f32x4(f, p, cx, cy, cz);
+            reach = vm_f32x4_mul(vm_f32x4_set1(f->abs_x[p]), ex);
+            reach = vm_f32x4_madd(vm_f32x4_set1(f->abs_y[p]), ey, reach);
+            reach = vm_f32x4_madd(vm_f32x4_set1(f->abs_z[p]), ez, reach);
+
+            visible &= ~vm_f32x4_movemask(vm_f32x4_cmplt(vm_f32x4_add(distance, reach), zero));
+            crossing[p] = vm_f32x4_movemask(vm_f32x4_cmplt(vm_f32x4_sub(distance, reach), zero));
+        }
+
+        for (k = 0; k < 4; ++k)
+        {
+            int child_mask = 0;
+
+            if (!(visible & (1 << k)))
+            {
+                continue;
+            }
+
+            for (p = 0; p < VM_FRUSTUM_PLANE_SIZE; ++p)
+            {
+                child_mask |= ((crossing[p] >> k) & 1) << p;
+            }
+
+            if (child_mask == 0)
+            {
+                vm_bvh4_append(list->inside, &list->inside_count, bvh->indices, node->first[k], node->count[k]);
+            }
+            else if (node->child[k] >= 0)
+            {
+                if (stack_size < VM_BVH4_STACK_SIZE)
+                {
+                    stack_node[stack_size] = node->child[k];
+                    stack_mask[stack_size] = child_mask;
+                    stack_size++;
+                }
+                else
+                {
+                    vm_bvh4_append(list->intersecting, &list->intersecting_count, bvh->indices, node->first[k], node->count[k]);
+                }
+            }
+            else
+            {
+                int i;
+
+                for (i = node->first[k]; i < node->first[k] + node->count[k]; ++i)
+                {
+                    int o = bvh->indices[i];
+                    int mask = vm_frustum_aabb_plane_mask(f, vm_v3(centers->x[o], centers->y[o], centers->z[o]), vm_v3(extents->x[o], extents->y[o], extents->z[o]), child_mask, 0);
+
+                    if (mask == 0)
+                    {
+                        list->inside[list->inside_count++] = o;
+                    }
+                    else if (mask > 0)
+                    {
+                        list->intersecting[list->intersecting_count++] = o;
+                    }
+                }
+            }
+        }
+    }
+
+    return (list->inside_count + list->intersecting_count);
+}
+
+/* #############################################################################
+ * # SPATIAL INDEX FUNCTIONS
+ * #############################################################################
+ */
+/* Object storage shared by spatial_grid and loose_octree. Objects are
+   identified by the caller's index (0 .. capacity - 1) and linked into
+   per cell lists, so insert, move and remove are O(1) and never allocate. */
+typedef struct spatial_objects
+{
+    v3 *centers;
+    v3 *extents; /* Half extents */
+    int *cell;   /* Cell (grid) or node (octree) of each object, -1 if not inserted */
+    int *next;
+    int *prev;
+    int capacity;
+
+} spatial_objects;
+
+VM_API VM_INLINE int vm_spatial_objects_init(spatial_objects *out, vm_arena *arena, int capacity)
+{
+    int i;
+
+    out->centers = (v3 *)vm_arena_alloc(arena, (vm_uptr)capacity * sizeof(v3), 16);
+    out->extents = (v3 *)vm_arena_alloc(arena, (vm_uptr)capacity * sizeof(v3), 16);
+    out->cell = (int *)vm_arena_alloc(arena, (vm_uptr)capacity * sizeof(int), sizeof(int));
+    out->next = (int *)vm_arena_alloc(arena, (vm_uptr)capacity * sizeof(int), sizeof(int));
+    out->prev = (int *)vm_arena_alloc(arena, (vm_uptr)capacity * sizeof(int), sizeof(int));
+    out->capacity = capacity;
+
+    if (!out->centers || !out->extents || !out->cell || !out->next || !out->prev)
+    {
+        return (0);
+    }
+
+    for (i = 0; i < capacity; ++i)
+    {
+        out->cell[i] = -1;
+    }
+
+    return (1);
+}
+
+VM_API VM_INLINE void vm_spatial_objects_link(spatial_objects *o, int *head, int id, int cell)
+{
+    o->cell[id] = cell;
+    o->prev[id] = -1;
+    o->next[id] = head[cell];
+
+    if (head[cell] >= 0)
+    {
+        o->prev[head[cell]] = id;
+    }
+
+    head[cell] = id;
+}
+
+VM_API VM_INLINE void vm_spatial_objects_unlink(spatial_objects *o, int *head, int id)
+{
+    int cell = o->cell[id];
+
+    if (cell < 0)
+    {
+        return; /* Not inserted */
+    }
+
+    if (o->prev[id] >= 0)
+    {
+        o->next[o->prev[id]] = o->next[id];
+    }
+    else
+    {
+        head[cell] = o->next[id];
+    }
+
+    if (o->next[id] >= 0)
+    {
+        o->prev[o->next[id]] = o->prev[id];
+    }
+
+    o->cell[id] = -1;
+}
+
+#define VM_SPATIAL_QUERY_AABB 0
+#define VM_SPATIAL_QUERY_SPHERE 1
+#define VM_SPATIAL_QUERY_FRUSTUM 2
+
+/* A range query shape: a box (center and half extents), a sphere or a frustum */
+typedef struct spatial_query
+{
+    int type;
+    v3 center;
+    v3 extents;
+    float radius;
+    const frustum_simd *frustum;
+
+} spatial_query;
+
+VM_API VM_INLINE spatial_query vm_spatial_query_aabb(v3 center, v3 extents)
+{
+    spatial_query result;
+
+    result.type = VM_SPATIAL_QUERY_AABB;
+    result.center = center;
+    result.extents = extents;
+    result.radius = 0.0f;
+    result.frustum = 0;
+
+    return (result);
+}
+
+VM_API VM_INLINE spatial_query vm_spatial_query_sphere(v3 center, float radius)
+{
+    spatial_query result;
+
+    result.type = VM_SPATIAL_QUERY_SPHERE;
+    result.center = center;
+    result.extents = vm_v3_zero;
+    result.radius = radius;
+    result.frustum = 0;
+
+    return (result);
+}
+
+VM_API VM_INLINE spatial_query vm_spatial_query_frustum(const frustum_simd *f)
+{
+    spatial_query result;
+
+    result.type = VM_SPATIAL_QUERY_FRUSTUM;
+    result.center = vm_v3_zero;
+    result.extents = vm_v3_zero;
+    result.radius = 0.0f;
+    result.frustum = f;
+
+    return (result);
+}
+
+/* Tests a box against the query. Returns -1 if they do not overlap, otherwise
+   the frustum planes the box still crosses (see vm_frustum_aabb_plane_mask),
+   for boxes and spheres VM_FRUSTUM_PLANES_ALL */
+VM_API VM_INLINE int vm_spatial_query_test(const spatial_query *q, v3 center, v3 extents, int plane_mask)
+{
+    if (q->type == VM_SPATIAL_QUERY_FRUSTUM)
+    {
+        return (plane_mask ? vm_frustum_aabb_plane_mask(q->frustum, center, extents, plane_mask, 0) : 0);
+    }
+
+    if (q->type == VM_SPATIAL_QUERY_SPHERE)
+    {
+        /* Squared distance from the sphere center to the box */
+        float dx = vm_maxf(vm_absf(q->center.x - center.x) - extents.x, 0.0f);
+        float dy = vm_maxf(vm_absf(q->center.y - center.y) - extents.y, 0.0f);
+        float dz = vm_maxf(vm_absf(q->center.z - center.z) - extents.z, 0.0f);
+
+        return ((dx * dx + dy * dy + dz * dz <= q->radius * q->radius) ? VM_FRUSTUM_PLANES_ALL : -1);
+    }
+
+    return ((vm_absf(q->center.x - center.x) <= q->extents.x + extents.x &&
+             vm_absf(q->center.y - center.y) <= q->extents.y + extents.y &&
+             vm_absf(q->center.z - center.z) <= q->extents.z + extents.z)
+                ? VM_FRUSTUM_PLANES_ALL
+                : -1);
+}
+
+/* Appends the objects of one cell list that overlap the query, returns the new count */
+VM_API VM_INLINE int vm_spatial_query_cell(const spatial_query *q, const spatial_objects *o, int id, int plane_mask, int *out, int count)
+{
+    for (; id >= 0; id = o->next[id])
+    {
+        if (vm_spatial_query_test(q, o->centers[id], o->extents[id], plane_mask) >= 0)
+        {
+            out[count++] = id;
+        }
+    }
+
+    return (count);
+}
+
+/* A uniform grid of dim_x * dim_y * dim_z cells starting at origin. Objects are
+   stored in the cell of their center (positions outside are clamped to the
+   border cells), queries widen their range by the largest extents inserted
+   so far. Best for many similar sized, fast moving objects. */
+typedef struct spatial_grid
+{
+    spatial_objects objects;
+    int *head; /* First object per cell, -1 if empty */
+    v3 origin;
+    float cell_size;
+    int dim_x;
+    int dim_y;
+    int dim_z;
+    v3 max_extents;
+
+} spatial_grid;
+
+VM_API VM_INLINE int vm_spatial_grid_init(spatial_grid *out, vm_arena *arena, v3 origin, float cell_size, int dim_x, int dim_y, int dim_z, int capacity)
+{
+    int cells = dim_x * dim_y * dim_z;
+    int i;
+
+    out->origin = origin;
+    out->cell_size = cell_size;
+    out->dim_x = dim_x;
+    out->dim_y = dim_y;
+    out->dim_z = dim_z;
+    out->max_extents = vm_v3_zero;
+    out->head = (int *)vm_arena_alloc(arena, (vm_uptr)cells * sizeof(int), sizeof(int));
+
+    if (!out->head || !vm_spatial_objects_init(&out->objects, arena, capacity))
+    {
+        return (0);
+    }
+
+    for (i = 0; i < cells; ++i)
+    {
+        out->head[i] = -1;
+    }
+
+    return (1);
+}
+
+/* Cell coordinate of p along one axis, clamped to the grid */
+VM_API VM_INLINE int vm_spatial_grid_coord(float p, float origin, float cell_size, int dim)
+{
+    float cell = (p - origin) / cell_size;
+
+    return (cell < 0.0f ? 0 : (cell >= (float)dim ? dim - 1 : (int)cell));
+}
+
+VM_API VM_INLINE int vm_spatial_grid_cell(const spatial_grid *g, v3 p)
+{
+    int x = vm_spatial_grid_coord(p.x, g->origin.x, g->cell_size, g->dim_x);
+    int y = vm_spatial_grid_coord(p.y, g->origin.y, g->cell_size, g->dim_y);
+    int z = vm_spatial_grid_coord(p.z, g->origin.z, g->cell_size, g->dim_z);
+
+    return ((z * g->dim_y + y) * g->dim_x + x);
+}
+
+/* The object must not be inserted already (checked with VM_DEBUG) */
+VM_API VM_INLINE void vm_spatial_grid_insert(spatial_grid *g, int id, v3 center, v3 extents)
+{
+    VM_ASSERT(g->objects.cell[id] < 0);
+
+    g->objects.centers[id] = center;
+    g->objects.extents[id] = extents;
+    g->max_extents = vm_v3(vm_maxf(g->max_extents.x, extents.x), vm_maxf(g->max_extents.y, extents.y), vm_maxf(g->max_extents.z, extents.z));
+
+    vm_spatial_objects_link(&g->objects, g->head, id, vm_spatial_grid_cell(g, center));
+}
+
+/* Does nothing if the object is not inserted */
+VM_API VM_INLINE void vm_spatial_grid_remove(spatial_grid *g, int id)
+{
+    vm_spatial_objects_unlink(&g->objects, g->head, id);
+}
+
+/* Updates the bounds of an inserted object, relinks it only if it changed cells.
+   Removed objects have to go through vm_spatial_grid_insert again (checked with VM_DEBUG). */
+VM_API VM_INLINE void vm_spatial_grid_move(spatial_grid *g, int id, v3 center, v3 extents)
+{
+    int cell = vm_spatial_grid_cell(g, center);
+
+    VM_ASSERT(g->objects.cell[id] >= 0);
+
+    if (cell != g->objects.cell[id])
+    {
+        vm_spatial_objects_unlink(&g->objects, g->head, id);
+        vm_spatial_objects_link(&g->objects, g->head, id, cell);
+    }
+
+    g->objects.centers[id] = center;
+    g->objects.extents[id] = extents;
+    g->max_extents = vm_v3(vm_maxf(g->max_extents.x, extents.x), vm_maxf(g->max_extents.y, extents.y), vm_maxf(g->max_extents.z, extents.z));
+}
+
+/* Writes the objects overlapping the query into out (room for capacity entries), returns their number */
+VM_API VM_INLINE int vm_spatial_grid_query(const spatial_grid *g, const spatial_query *q, int *out)
+{
+    v3 lo = q->center;
+    v3 hi = q->center;
+    int count = 0;
+    int x, y, z;
+    int x0, y0, z0, x1, y1, z1;
+
+    /* Cell range of the query bounds widened by the largest object */
+    if (q->type == VM_SPATIAL_QUERY_AABB || q->type == VM_SPATIAL_QUERY_SPHERE)
+    {
+        v3 reach = q->type == VM_SPATIAL_QUERY_AABB ? q->extents : vm_v3(q->radius, q->radius, q->radius);
+        reach = vm_v3_add(reach, g->max_extents);
+        lo = vm_v3_sub(q->center, reach);
+        hi = vm_v3_add(q->center, reach);
+    }
+
+    x0 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? 0 : vm_spatial_grid_coord(lo.x, g->origin.x, g->cell_size, g->dim_x);
+    y0 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? 0 : vm_spatial_grid_coord(lo.y, g->origin.y, g->cell_size, g->dim_y);
+    z0 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? 0 : vm_spatial_grid_coord(lo.z, g->origin.z, g->cell_size, g->dim_z);
+    x1 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? g->dim_x - 1 : vm_spatial_grid_coord(hi.x, g->origin.x, g->cell_size, g->dim_x);
+    y1 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? g->dim_y - 1 : vm_spatial_grid_coord(hi.y, g->origin.y, g->cell_size, g->dim_y);
+    z1 = q->type == VM_SPATIAL_QUERY_FRUSTUM ? g->dim_z - 1 : vm_spatial_grid_coord(hi.z, g->origin.z, g->cell_size, g->dim_z);
+
+    for (z = z0; z <= z1; ++z)
+    {
+        for (y = y0; y <= y1; ++y)
+        {
+            for (x = x0; x <= x1; ++x)
+            {
+                int head = g->head[(z * g->dim_y + y) * g->dim_x + x];
+                int plane_mask = VM_FRUSTUM_PLANES_ALL;
+
+                if (head < 0)
+                {
+                    continue;
+                }
+
+                /* Frustum queries test the (widened) cell box first, border cells reach out to "infinity" */
+                if (q->type == VM_SPATIAL_QUERY_FRUSTUM)
+                {
+                    float half = 0.5f * g->cell_size;
+                    v3 center = vm_v3(g->origin.x + ((float)x + 0.5f) * g->cell_size, g->origin.y + ((float)y + 0.5f) * g->cell_size, g->origin.z + ((float)z + 0.5f) * g->cell_size);
+                    v3 extents = vm_v3_add(vm_v3(half, half, half), g->max_extents);
+
+                    if (x == 0 || x == g->dim_x - 1 || y == 0 || y == g->dim_y - 1 || z == 0 || z == g->dim_z - 1)
+                    {
+                        center = vm_v3_zero;
+                        extents = vm_v3(1.0e30f, 1.0e30f, 1.0e30f);
+                    }
+
+                    plane_mask = vm_spatial_query_test(q, center, extents, VM_FRUSTUM_PLANES_ALL);
+
+                    if (plane_mask < 0)
+                    {
+                        continue;
+                    }
+                }
+
+                count = vm_spatial_query_cell(q, &g->objects, head, plane_mask, out, count);
+            }
+        }
+    }
+
+    return (count);
+}
+
+/* A loose octree with a fixed number of levels around center. Nodes are
+   stored implicitly per level and their bounds are twice the size of their
+   cell, so an object is stored in the deepest level whose cell is at least
+   as large as the object, in the cell containing its center: O(1) insert,
+   move and remove without splitting nodes. Objects larger than the root or
+   outside of it are kept in the root. Best for objects of very different sizes. */
+typedef struct loose_octree
+{
+    spatial_objects objects;
+    int *head;  /* First object per node, -1 if empty */
+    int *count; /* Objects in the node and all its descendants, empty subtrees are skipped */
+    v3 center;
+    float half_size;
+    int depth; /* Number of levels (1 .. 10), level l has 8^l nodes */
+
+} loose_octree;
+
+/* Index of the first node of level l: (8^l - 1) / 7 */
+VM_API VM_INLINE int vm_loose_octree_level_first(int level)
+{
+    return (((1 << (3 * level)) - 1) / 7);
+}
+
+VM_API VM_INLINE int vm_loose_octree_init(loose_octree *out, vm_arena *arena, v3 center, float half_size, int depth, int capacity)
+{
+    int nodes = vm_loose_octree_level_first(depth);
+    int i;
+
+    out->center = center;
+    out->half_size = half_size;
+    out->depth = depth;
+    out->head = (int *)vm_arena_alloc(arena, (vm_uptr)nodes * sizeof(int), sizeof(int));
+    out->count = (int *)vm_arena_alloc(arena, (vm_uptr)nodes * sizeof(int), sizeof(int));
+
+    if (!out->head || !out->count || !vm_spatial_objects_init(&out->objects, arena, capacity))
+    {
+        return (0);
+    }
+
+    for (i = 0; i < nodes; ++i)
+    {
+        out->head[i] = -1;
+        out->count[i] = 0;
+    }
+
+    return (1);
+}
+
+/* Node of an object: the level follows from its size, the cell from its center */
+VM_API VM_INLINE int vm_loose_octree_node(const loose_octree *o, v3 center, v3 extents, int *level_out)
+{
+    float size = vm_maxf(extents.x, vm_maxf(extents.y, extents.z));
+    float cell_half = o->half_size;
+    v3 local = vm_v3_sub(center, o->center);
+    int level = 0;
+    int n;
+
+    if (vm_absf(local.x) > o->half_size || vm_absf(local.y) > o->half_size || vm_absf(local.z) > o->half_size)
+    {
+        *level_out = 0;
+        return (0);
+    }
+
+    while (level + 1 < o->depth && size <= cell_half * 0.5f)
+    {
+        cell_half *= 0.5f;
+        level++;
+    }
+
+    *level_out = level;
+    n = 1 << level;
+
+    return (vm_loose_octree_level_first(level) +
+            (vm_spatial_grid_coord(local.z, -o->half_size, 2.0f * cell_half, n) * n +
+             vm_spatial_grid_coord(local.y, -o->half_size, 2.0f * cell_half, n)) *
+                n +
+            vm_spatial_grid_coord(local.x, -o->half_size, 2.0f * cell_half, n));
+}
+
+/* Adds delta to the subtree counts of a node and all its ancestors */
+VM_API VM_INLINE void vm_loose_octree_count(loose_octree *o, int node, int level, int delta)
+{
+    int local = node - vm_loose_octree_level_first(level);
+    int n = 1 << level;
+    int x = local % n;
+    int y = (local / n) % n;
+    int z = local / (n * n);
+
+    for (; level >= 0; --level)
+    {
+        n = 1 << level;
+        o->count[vm_loose_octree_level_first(level) + (z * n + y) * n + x] += delta;
+        x >>= 1;
+        y >>= 1;
+        z >>= 1;
+    }
+}
+
+/* The object must not be inserted already (checked with VM_DEBUG) */
+VM_API VM_INLINE void vm_loose_octree_insert(loose_octree *o, int id, v3 center, v3 extents)
+{
+    int level;
+    int node = vm_loose_octree_node(o, center, extents, &level);
+
+    VM_ASSERT(o->objects.cell[id] < 0);
+
+    o->objects.centers[id] = center;
+    o->objects.extents[id] = extents;
+
+    vm_spatial_objects_link(&o->objects, o->head, id, node);
+    vm_loose_octree_count(o, node, level, 1);
+}
+
+/* Does nothing if the object is not inserted */
+VM_API VM_INLINE void vm_loose_octree_remove(loose_octree *o, int id)
+{
+    int node = o->objects.cell[id];
+    int level = 0;
+
+    if (node < 0)
+    {
+        return; /* Not inserted */
+    }
+
+    while (level + 1 < o->depth && node >= vm_loose_octree_level_first(level + 1))
+    {
+        level++;
+    }
+
+    vm_spatial_objects_unlink(&o->objects, o->head, id);
+    vm_loose_octree_count(o, node, level, -1);
+}
+
+/* Updates the bounds of an inserted object, relinks it only if it changed nodes.
+   Removed objects have to go through vm_loose_octree_insert again (checked with VM_DEBUG). */
+VM_API VM_INLINE void vm_loose_octree_move(loose_octree *o, int id, v3 center, v3 extents)
+{
+    int level;
+    int node = vm_loose_octree_node(o, center, extents, &level);
+
+    VM_ASSERT(o->objects.cell[id] >= 0);
+
+    if (node != o->objects.cell[id])
+    {
+        vm_loose_octree_remove(o, id);
+        vm_spatial_objects_link(&o->objects, o->head, id, node);
+        vm_loose_octree_count(o, node, level, 1);
+    }
+
+    o->objects.centers[id] = center;
+    o->objects.extents[id] = extents;
+}
+
+/* Visits node (level, x, y, z) and its non empty children */
+VM_API VM_INLINE int vm_loose_octree_query_node(const loose_octree *o, const spatial_query *q, int level, int x, int y, int z, int plane_mask, int *out, int count)
+{
+    int n = 1 << level;
+    int node = vm_loose_octree_level_first(level) + (z * n + y) * n + x;
+    int child;
+
+    if (!o->count[node])
+    {
+        return (count);
+    }
+
+    /* The root holds the objects outside of it and is always visited */
+    if (level > 0)
+    {
+        float cell_half = o->half_size / (float)n;
+        v3 center = vm_v3(o->center.x - o->half_size + ((float)x * 2.0f + 1.0f) * cell_half,
+                          o->center.y - o->half_size + ((float)y * 2.0f + 1.0f) * cell_half,
+                          o->center.z - o->half_size + ((float)z * 2.0f + 1.0f) * cell_half);
+
+        plane_mask = vm_spatial_query_test(q, center, vm_v3(2.0f * cell_half, 2.0f * cell_half, 2.0f * cell_half), plane_mask);
+
+        if (plane_mask < 0)
+        {
+            return (count);
+        }
+    }
+
+    count = vm_spatial_query_cell(q, &o->objects, o->head[node], plane_mask, out, count);
+
+    if (level + 1 < o->depth)
+    {
+        for (child = 0; child < 8; ++child)
+        {
+            count = vm_loose_octree_query_node(o, q, level + 1, 2 * x + (child & 1), 2 * y + ((child >> 1) & 1), 2 * z + (child >> 2), plane_mask, out, count);
+        }
+    }
+
+    return (count);
+}
+
+/* Writes the objects overlapping the query into out (room for capacity entries), returns their number */
+VM_API VM_INLINE int vm_loose_octree_query(const loose_octree *o, const spatial_query *q, int *out)
+{
+    return (vm_loose_octree_query_node(o, q, 0, 0, 0, 0, VM_FRUSTUM_PLANES_ALL, out, 0));
+}
+
+/* #############################################################################
+ * # TRANSFORMATION FUNCTIONS
+ * #############################################################################
+ */
+typedef struct transformation
+{
+    v3 position;
+    quat rotation;
+    v3 scale;
+
+    struct transformation *parent;
+
+} transformation;
+
+VM_API VM_INLINE transformation vm_transformation_init(void)
+{
+    transformation result = {0};
+    result.position = vm_v3_zero;
+    result.rotation = vm_quat_rot;
+    result.scale = vm_v3_one;
+    return (result);
+}
+
+/* Composes translation * rotation * scale directly: the rotation columns are
+   scaled and the position becomes the translation column (no matrix multiplies) */
+VM_API VM_INLINE void vm_m4x4_from_trs_p(m4x4 *VM_RESTRICT out, v3 position, quat rotation, v3 scale)
+{
+    float xx = rotation.x * rotation.x;
+    float yy = rotation.y * rotation.y;
+    float zz = rotation.z * rotation.z;
+    float xy = rotation.x * rotation.y;
+    float xz = rotation.x * rotation.z;
+    float yz = rotation.y * rotation.z;
+    float wx = rotation.w * rotation.x;
+    float wy = rotation.w * rotation.y;
+    float wz = rotation.w * rotation.z;
 
-    result.x = a.x * scalar;
-    result.y = a.y * scalar;
-    result.z = a.z * scalar;
-    result.w = a.w * scalar;
+    out->e[VM_M4X4_AT(0, 0)] = (1.0f - 2.0f * (yy + zz)) * scale.x;
+    out->e[VM_M4X4_AT(1, 1)] = (1.0f - 2.0f * (xx + zz)) * scale.y;
+    out->e[VM_M4X4_AT(2, 2)] = (1.0f - 2.0f * (xx + yy)) * scale.z;
+
+#ifdef VM_LEFT_HAND_LAYOUT
+    out->e[VM_M4X4_AT(0, 1)] = 2.0f * (xy + wz) * scale.y;
+    out->e[VM_M4X4_AT(0, 2)] = 2.0f * (xz - wy) * scale.z;
+    out->e[VM_M4X4_AT(1, 0)] = 2.0f * (xy - wz) * scale.x;
+    out->e[VM_M4X4_AT(1, 2)] = 2.0f * (yz + wx) * scale.z;
+    out->e[VM_M4X4_AT(2, 0)] = 2.0f * (xz + wy) * scale.x;
+    out->e[VM_M4X4_AT(2, 1)] = 2.0f * (yz - wx) * scale.y;
+#else
+    out->e[VM_M4X4_AT(0, 1)] = 2.0f * (xy - wz) * scale.y;
+    out->e[VM_M4X4_AT(0, 2)] = 2.0f * (xz + wy) * scale.z;
+    out->e[VM_M4X4_AT(1, 0)] = 2.0f * (xy + wz) * scale.x;
+    out->e[VM_M4X4_AT(1, 2)] = 2.0f * (yz - wx) * scale.z;
+    out->e[VM_M4X4_AT(2, 0)] = 2.0f * (xz - wy) * scale.x;
+    out->e[VM_M4X4_AT(2, 1)] = 2.0f * (yz + wx) * scale.y;
+#endif
+
+    out->e[VM_M4X4_AT(0, 3)] = position.x;
+    out->e[VM_M4X4_AT(1, 3)] = position.y;
+    out->e[VM_M4X4_AT(2, 3)] = position.z;
+
+    out->e[VM_M4X4_AT(3, 0)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 1)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 2)] = 0.0f;
+    out->e[VM_M4X4_AT(3, 3)] = 1.0f;
+}
 
+VM_API VM_INLINE m4x4 vm_m4x4_from_trs(v3 position, quat rotation, v3 scale)
+{
+    m4x4 result;
+    vm_m4x4_from_trs_p(&result, position, rotation, scale);
     return (result);
 }
 
-VM_API VM_INLINE quat vm_quat_conjugate(quat a)
+/* Matrix of t itself (translation * rotation * scale), the parent is ignored */
+VM_API VM_INLINE void vm_transformation_local_matrix_p(m4x4 *VM_RESTRICT out, const transformation *t)
 {
-    quat result;
+    vm_m4x4_from_trs_p(out, t->position, t->rotation, t->scale);
+}
 
-    result.x = -a.x;
-    result.y = -a.y;
-    result.z = -a.z;
-    result.w = a.w;
+/* Local matrices of n transformations (parents are ignored) */
+VM_API VM_INLINE void vm_m4x4_from_trs_array(const transformation *in, m4x4 *out, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        vm_m4x4_from_trs_p(&out[i], in[i].position, in[i].rotation, in[i].scale);
+    }
+}
 
+/* World matrix of t, walks up the parent chain on every call (see transformation_graph for many nodes) */
+VM_API VM_INLINE void vm_transformation_matrix_p(m4x4 *VM_RESTRICT out, const transformation *t)
+{
+    if (t->parent)
+    {
+        m4x4 parent_matrix;
+        m4x4 local_matrix;
+
+        vm_transformation_matrix_p(&parent_matrix, t->parent);
+        vm_transformation_local_matrix_p(&local_matrix, t);
+        vm_m4x4_mul_p(out, &parent_matrix, &local_matrix);
+    }
+    else
+    {
+        vm_transformation_local_matrix_p(out, t);
+    }
+}
+
+VM_API VM_INLINE m4x4 vm_transformation_matrix(transformation *t)
+{
+    m4x4 result;
+    vm_transformation_matrix_p(&result, t);
     return (result);
 }
 
-VM_API VM_INLINE quat vm_quat_mul(quat a, quat b)
+VM_API VM_INLINE void vm_tranformation_rotate(transformation *t, v3 axis, float angle)
 {
-    quat result;
+    t->rotation = vm_quat_rotate(axis, angle);
+}
 
-    result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
-    result.x = a.x * b.w + a.w * b.x + a.y * b.z - a.z * b.y;
-    result.y = a.y * b.w + a.w * b.y + a.z * b.x - a.x * b.z;
-    result.z = a.z * b.w + a.w * b.z + a.x * b.y - a.y * b.x;
+VM_API VM_INLINE v3 vm_transformation_forward(transformation *t)
+{
+    return vm_v3_rotate(vm_v3_forward, t->rotation);
+}
+
+VM_API VM_INLINE v3 vm_transformation_right(transformation *t)
+{
+    return vm_v3_rotate(vm_v3_right, t->rotation);
+}
+
+VM_API VM_INLINE v3 vm_transformation_up(transformation *t)
+{
+    return vm_v3_rotate(vm_v3_up, t->rotation);
+}
+
+/* #############################################################################
+ * # TRANSFORMATION GRAPH FUNCTIONS
+ * #############################################################################
+ */
+/* A flat transformation hierarchy. The nodes live in caller provided arrays and
+   every parent is stored before its children (parents[i] < i), so all world
+   matrices are computed in a single linear pass where each parent's world
+   matrix is already final when its children read it. */
+typedef struct transformation_graph
+{
+    transformation *locals; /* Local transformation per node (the parent pointer is not used) */
+    int *parents;           /* Parent index per node, -1 for root nodes */
+    m4x4 *worlds;           /* World matrix per node, written by vm_transformation_graph_update */
+    int count;
+    int capacity;
+
+    /* Optional change tracking, see vm_transformation_graph_enable_tracking */
+    unsigned char *dirty; /* Per node: local transformation changed since the last update */
+    int *changed;         /* Indices of the world matrices written by the last update */
+    int changed_count;
+    int dirty_first; /* Smallest dirty index or -1 if nothing is dirty */
+
+    m4x4 *inverse_worlds; /* Optional cached world to local matrices, see vm_transformation_graph_enable_inverse_cache */
+
+} transformation_graph;
+
+VM_API VM_INLINE transformation_graph vm_transformation_graph_init(transformation *locals, int *parents, m4x4 *worlds, int capacity)
+{
+    transformation_graph result;
+
+    result.locals = locals;
+    result.parents = parents;
+    result.worlds = worlds;
+    result.count = 0;
+    result.capacity = capacity;
+    result.dirty = 0;
+    result.changed = 0;
+    result.changed_count = 0;
+    result.dirty_first = -1;
+    result.inverse_worlds = 0;
+
+    return (result);
+}
+
+/* Marks a node as changed, its world matrix and the ones of all its
+   descendants are recomputed by the next vm_transformation_graph_update */
+VM_API VM_INLINE void vm_transformation_graph_mark_dirty(transformation_graph *g, int index)
+{
+    if (!g->dirty)
+    {
+        return;
+    }
+
+    g->dirty[index] = 1;
+
+    if (g->dirty_first < 0 || index < g->dirty_first)
+    {
+        g->dirty_first = index;
+    }
+}
+
+/* Enables change tracking. dirty and changed need room for capacity entries.
+   Afterwards vm_transformation_graph_update only recomputes the dirty nodes and
+   their descendants and lists the written world matrices in changed.
+   Local transformations have to be modified through
+   vm_transformation_graph_set_local (or followed by
+   vm_transformation_graph_mark_dirty) to be picked up. */
+VM_API VM_INLINE void vm_transformation_graph_enable_tracking(transformation_graph *g, unsigned char *dirty, int *changed)
+{
+    int i;
+
+    g->dirty = dirty;
+    g->changed = changed;
+    g->changed_count = 0;
+    g->dirty_first = -1;
+
+    /* Nothing is known about the current world matrices, start fully dirty */
+    for (i = 0; i < g->count; ++i)
+    {
+        vm_transformation_graph_mark_dirty(g, i);
+    }
+}
+
+/* Keeps the inverse of every world matrix in inverse_worlds (capacity entries).
+   They are recomputed together with the world matrices (with change tracking
+   only for dirty nodes) and are valid after the next vm_transformation_graph_update. */
+VM_API VM_INLINE void vm_transformation_graph_enable_inverse_cache(transformation_graph *g, m4x4 *inverse_worlds)
+{
+    int i;
+
+    g->inverse_worlds = inverse_worlds;
+
+    for (i = 0; i < g->count; ++i)
+    {
+        vm_transformation_graph_mark_dirty(g, i);
+    }
+}
+
+/* Replaces the local transformation of a node and marks it dirty */
+VM_API VM_INLINE void vm_transformation_graph_set_local(transformation_graph *g, int index, transformation local)
+{
+    local.parent = 0;
+    g->locals[index] = local;
+
+    vm_transformation_graph_mark_dirty(g, index);
+}
+
+/* Returns the number of world matrices written by the last
+   vm_transformation_graph_update and their indices in ascending order
+   (e.g. for partial GPU uploads). Requires change tracking. */
+VM_API VM_INLINE int vm_transformation_graph_changed(const transformation_graph *g, const int **indices)
+{
+    *indices = g->changed;
+
+    return (g->changed_count);
+}
+
+/* Appends a node and returns its index, parent has to be an existing node or -1.
+   Returns -1 if the graph is full or the parent is invalid. */
+VM_API VM_INLINE int vm_transformation_graph_add(transformation_graph *g, transformation local, int parent)
+{
+    int index = g->count;
+
+    if (index >= g->capacity || parent < -1 || parent >= index)
+    {
+        return (-1);
+    }
+
+    local.parent = 0;
+
+    g->locals[index] = local;
+    g->parents[index] = parent;
+    g->worlds[index] = vm_m4x4_identity;
+    g->count = index + 1;
+
+    vm_transformation_graph_mark_dirty(g, index);
+
+    return (index);
+}
+
+/* Computes the world matrices of the nodes [first, first + n), the world
+   matrices of their parents have to be up to date already */
+VM_API VM_INLINE void vm_transformation_graph_update_range(transformation_graph *g, int first, int n)
+{
+    const transformation *locals = g->locals;
+    const int *parents = g->parents;
+    m4x4 *worlds = g->worlds;
+    int i;
+
+    for (i = first; i < first + n; ++i)
+    {
+        int parent = parents[i];
+
+        if (parent < 0)
+        {
+            vm_transformation_local_matrix_p(&worlds[i], &locals[i]);
+        }
+        else
+        {
+            m4x4 local;
+            vm_transformation_local_matrix_p(&local, &locals[i]);
+            vm_m4x4_mul_p(&worlds[i], &worlds[parent], &local);
+        }
+
+        /* Translation, rotation and (non uniform) scale chains stay affine */
+        if (g->inverse_worlds)
+        {
+            vm_m4x4_inverse_affine_p(&g->inverse_worlds[i], &worlds[i]);
+        }
+    }
+}
+
+/* Computes all world matrices in one pass (one local matrix and at most one multiply per node).
+   With change tracking only the dirty nodes and their descendants are recomputed. */
+VM_API VM_INLINE void vm_transformation_graph_update(transformation_graph *g)
+{
+    const int *parents = g->parents;
+    unsigned char *dirty = g->dirty;
+    int *changed = g->changed;
+    int changed_count = 0;
+    int i;
+
+    if (!dirty)
+    {
+        vm_transformation_graph_update_range(g, 0, g->count);
+        return;
+    }
+
+    /* Parents come first, so a dirty flag propagates down the whole subtree in
+       the same pass. Nodes before the first dirty one are skipped entirely. */
+    if (g->dirty_first >= 0)
+    {
+        for (i = g->dirty_first; i < g->count; ++i)
+        {
+            int parent = parents[i];
+
+            if (dirty[i] || (parent >= 0 && dirty[parent]))
+            {
+                dirty[i] = 1;
+                changed[changed_count++] = i;
+                vm_transformation_graph_update_range(g, i, 1);
+            }
+        }
+
+        for (i = 0; i < changed_count; ++i)
+        {
+            dirty[changed[i]] = 0;
+        }
+    }
+
+    g->changed_count = changed_count;
+    g->dirty_first = -1;
+}
+
+/* Transforms a world space point into the space of node index (e.g. for picking or IK).
+   Requires vm_transformation_graph_enable_inverse_cache and an up to date graph. */
+VM_API VM_INLINE v3 vm_transformation_graph_point_to_local(const transformation_graph *g, int index, v3 p)
+{
+    VM_ASSERT(g->inverse_worlds);
+
+    return (vm_m4x4_transform_point(&g->inverse_worlds[index], p));
+}
+
+/* Transforms a point in the space of node index into world space */
+VM_API VM_INLINE v3 vm_transformation_graph_point_to_world(const transformation_graph *g, int index, v3 p)
+{
+    return (vm_m4x4_transform_point(&g->worlds[index], p));
+}
+
+/* Nodes per work chunk of vm_transformation_graph_update_level. Every worker
+   gets whole chunks counted from the start of the level, so levels with at
+   most this many nodes are updated by worker 0 alone. The chunks are
+   positions in levels->order, not node indices: with VM_ALIGN_64 worlds each
+   m4x4 has its own cache line, but the dirty flags written by different
+   workers can still share one. */
+#ifndef VM_TRANSFORMATION_GRAPH_CHUNK
+#define VM_TRANSFORMATION_GRAPH_CHUNK 64
+#endif
+
+/* Nodes of a transformation_graph grouped by depth. Nodes of the same level
+   do not depend on each other and can be updated in parallel. */
+typedef struct transformation_graph_levels
+{
+    int *order; /* Node indices sorted by depth (ascending index within a level) */
+    int *first; /* Level l is order[first[l]] .. order[first[l + 1] - 1] */
+    int count;  /* Number of levels */
+
+} transformation_graph_levels;
+
+/* Groups the nodes by depth with a counting sort. depths and order need
+   g->count entries, first needs max_levels + 1. Has to be rebuilt after
+   nodes were added. Returns 0 if the graph is deeper than max_levels. */
+VM_API VM_INLINE int vm_transformation_graph_build_levels(const transformation_graph *g, transformation_graph_levels *levels, int *depths, int *order, int *first, int max_levels)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i <= max_levels; ++i)
+    {
+        first[i] = 0;
+    }
+
+    for (i = 0; i < g->count; ++i)
+    {
+        int parent = g->parents[i];
+        int depth = parent < 0 ? 0 : depths[parent] + 1;
+
+        if (depth >= max_levels)
+        {
+            return (0);
+        }
+
+        depths[i] = depth;
+        first[depth + 1]++;
+
+        if (depth + 1 > count)
+        {
+            count = depth + 1;
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        first[i + 1] += first[i];
+    }
+
+    /* first[l] is used as the insert position of level l and ends up at the start of level l + 1 */
+    for (i = 0; i < g->count; ++i)
+    {
+        order[first[depths[i]]++] = i;
+    }
+
+    for (i = count; i > 0; --i)
+    {
+        first[i] = first[i - 1];
+    }
+
+    first[0] = 0;
+
+    levels->order = order;
+    levels->first = first;
+    levels->count = count;
+
+    return (1);
+}
+
+/* Computes the part of one level that belongs to worker (0 .. worker_count - 1).
+   All levels before it have to be finished by every worker. Honors change
+   tracking, vm_transformation_graph_update_finish collects the changed list. */
+VM_API VM_INLINE void vm_transformation_graph_update_level(transformation_graph *g, const transformation_graph_levels *levels, int level, int worker, int worker_count)
+{
+    const int *parents = g->parents;
+    unsigned char *dirty = g->dirty;
+    int begin = levels->first[level];
+    int end = levels->first[level + 1];
+    int per_worker = (end - begin + worker_count - 1) / worker_count;
+    int from;
+    int to;
+    int k;
+
+    /* Round the share up to whole chunks, the split points are relative to begin */
+    per_worker = (per_worker + VM_TRANSFORMATION_GRAPH_CHUNK - 1) / VM_TRANSFORMATION_GRAPH_CHUNK * VM_TRANSFORMATION_GRAPH_CHUNK;
+
+    from = vm_mini(begin + worker * per_worker, end);
+    to = vm_mini(begin + (worker + 1) * per_worker, end);
+
+    for (k = from; k < to; ++k)
+    {
+        int i = levels->order[k];
+
+        if (!dirty)
+        {
+            vm_transformation_graph_update_range(g, i, 1);
+        }
+        else if (dirty[i] || (parents[i] >= 0 && dirty[parents[i]]))
+        {
+            dirty[i] = 1;
+            vm_transformation_graph_update_range(g, i, 1);
+        }
+    }
+}
+
+/* Collects the changed list and clears the dirty flags after all levels were
+   updated with vm_transformation_graph_update_level (single threaded) */
+VM_API VM_INLINE void vm_transformation_graph_update_finish(transformation_graph *g)
+{
+    int changed_count = 0;
+    int i;
+
+    if (!g->dirty)
+    {
+        return;
+    }
+
+    for (i = g->dirty_first < 0 ? g->count : g->dirty_first; i < g->count; ++i)
+    {
+        if (g->dirty[i])
+        {
+            g->dirty[i] = 0;
+            g->changed[changed_count++] = i;
+        }
+    }
+
+    g->changed_count = changed_count;
+    g->dirty_first = -1;
+}
+
+/* Called by every worker after each level, has to block until all
+   worker_count workers arrived (e.g. pthread_barrier_wait) */
+typedef void (*vm_barrier_function)(void *user);
+
+/* Entry point for each of worker_count threads (worker = 0 .. worker_count - 1).
+   Updates the graph level by level and waits at the barrier after every
+   level. Worker 0 finishes the change tracking after the last barrier, so the
+   results are complete once all workers returned. */
+VM_API VM_INLINE void vm_transformation_graph_update_worker(transformation_graph *g, const transformation_graph_levels *levels, int worker, int worker_count, vm_barrier_function barrier, void *user)
+{
+    int level;
+
+    for (level = 0; level < levels->count; ++level)
+    {
+        vm_transformation_graph_update_level(g, levels, level, worker, worker_count);
+        barrier(user);
+    }
+
+    if (worker == 0)
+    {
+        vm_transformation_graph_update_finish(g);
+    }
+}
+
+/* #############################################################################
+ * # RIGID BODY FUNCTIONS
+ * #############################################################################
+ */
+typedef struct rigid_body
+{
+    v3 position;        /* World-space position of the body's origin (usually center of mass) */
+    v3 velocity;        /* Linear velocity of the center of mass (in m/s) */
+    v3 force;           /* Accumulated force to apply this frame (reset after integration) */
+    v3 torque;          /* Accumulated torque to apply this frame (reset after integration) */
+    v3 angularVelocity; /* Angular velocity in world space (radians/sec) */
+    float mass;         /* Total mass of the body (in kilograms) */
+    float inertia;      /* Scalar rotational inertia (resistance to rotation) */
+    quat orientation;   /* Current rotation of the body as a quaternion */
+
+} rigid_body;
+
+VM_API VM_INLINE rigid_body vm_rigid_body_init(v3 position, quat orientation, float mass, float inertia)
+{
+    rigid_body result;
+
+    result.position = position;
+    result.orientation = orientation;
+    result.mass = mass;
+    result.inertia = inertia;
+    result.velocity = vm_v3_zero;
+    result.angularVelocity = vm_v3_zero;
+    result.force = vm_v3_zero;
+    result.torque = vm_v3_zero;
 
     return (result);
 }
 
-VM_API VM_INLINE quat vm_quat_mulf(quat a, float b)
+VM_API VM_INLINE v3 vm_rigid_body_forward(rigid_body *rb)
 {
-    quat result;
+    return vm_quat_forward(rb->orientation);
+}
 
-    result.x = a.x * b;
-    result.y = a.y * b;
-    result.z = a.z * b;
-    result.w = a.w * b;
+VM_API VM_INLINE v3 vm_rigid_body_right(rigid_body *rb)
+{
+    return vm_quat_right(rb->orientation);
+}
 
-    return (result);
+VM_API VM_INLINE v3 vm_rigid_body_up(rigid_body *rb)
+{
+    return vm_quat_up(rb->orientation);
 }
 
-VM_API VM_INLINE quat vm_quat_mulv3(quat a, v3 b)
+VM_API VM_INLINE v3 vm_rigid_body_point_velocity(rigid_body *rb, v3 worldPoint)
 {
-    quat result;
+    v3 r = vm_v3_sub(worldPoint, rb->position);
+    v3 rotational = vm_v3_cross(rb->angularVelocity, r);
+    return vm_v3_add(rb->velocity, rotational);
+}
 
-    result.w = -a.x * b.x - a.y * b.y - a.z * b.z;
-    result.x = a.w * b.x + a.y * b.z - a.z * b.y;
-    result.y = a.w * b.y + a.z * b.x - a.x * b.z;
-    result.z = a.w * b.z + a.x * b.y - a.y * b.x;
+VM_API VM_INLINE void vm_rigid_body_apply_force_at_position(rigid_body *rb, v3 force, v3 position)
+{
+    v3 r = vm_v3_sub(position, rb->position);
 
-    return (result);
+    rb->force = vm_v3_add(rb->force, force);
+    rb->torque = vm_v3_add(rb->torque, vm_v3_cross(r, force));
 }
 
-VM_API VM_INLINE quat vm_quat_sub(quat a, quat b)
+VM_API VM_INLINE void vm_rigid_body_integrate(rigid_body *rb, float dt)
 {
-    quat result;
+    float invMass = rb->mass > 0.0f ? (1.0f / rb->mass) : 0.0f;
+    float invInertia = rb->inertia > 0.0f ? (1.0f / rb->inertia) : 0.0f;
 
-    result.x = a.x - b.x;
-    result.y = a.y - b.y;
-    result.z = a.z - b.z;
-    result.w = a.w - b.w;
+    v3 acceleration = vm_v3_mulf(rb->force, invMass);
+    v3 angularAcceleration;
+    float angle;
 
-    return (result);
-}
+    rb->velocity = vm_v3_add(rb->velocity, vm_v3_mulf(acceleration, dt));
+    rb->position = vm_v3_add(rb->position, vm_v3_mulf(rb->velocity, dt));
 
-VM_API VM_INLINE quat vm_quat_add(quat a, quat b)
-{
-    quat result;
+    angularAcceleration = vm_v3_mulf(rb->torque, invInertia);
+    rb->angularVelocity = vm_v3_add(rb->angularVelocity, vm_v3_mulf(angularAcceleration, dt));
 
-    result.x = a.x + b.x;
-    result.y = a.y + b.y;
-    result.z = a.z + b.z;
-    result.w = a.w + b.w;
+    angle = vm_v3_length(rb->angularVelocity) * dt;
 
-    return (result);
-}
+    if (angle > 0.0001f)
+    {
+        v3 axis = vm_v3_normalize(rb->angularVelocity);
+        quat dq = vm_quat_rotate(axis, angle);
+        rb->orientation = vm_quat_normalize(vm_quat_mul(dq, rb->orientation));
+    }
 
-VM_API VM_INLINE m4x4 vm_quat_to_rotation_matrix(quat q)
-{
-    float xx = q.x * q.x;
-    float yy = q.y * q.y;
-    float zz = q.z * q.z;
-    float xy = q.x * q.y;
-    float xz = q.x * q.z;
-    float yz = q.y * q.z;
-    float wx = q.w * q.x;
-    float wy = q.w * q.y;
-    float wz = q.w * q.z;
+    rb->force = vm_v3_zero;
+    rb->torque = vm_v3_zero;
+}
 
-    m4x4 result = vm_m4x4_identity;
+/* #############################################################################
+ * # RUNTIME DISPATCH FUNCTIONS
+ * #############################################################################
+ *
+ * Define VM_USE_DISPATCH to ship a single binary for different x86 CPUs. The
+ * CPU is probed with cpuid (no C standard library needed) and vm_dispatch is
+ * filled with the best scalar, SSE4.1, AVX2 or AVX-512 batch kernels. The
+ * kernels are compiled with per function target attributes, so the rest of
+ * the program does not need to be built with -mavx2 and friends.
+ *
+ * Call vm_dispatch_init() once at startup. vm_dispatch_set() allows to force a
+ * specific level (e.g. for testing). Like the rest of vm.h the table is static
+ * so every translation unit has to initialize its own copy.
+ */
+#if defined(VM_USE_DISPATCH) && !((defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))) && !(defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#undef VM_USE_DISPATCH
+#endif
 
-#ifdef VM_LEFT_HAND_LAYOUT
-    result.e[VM_M4X4_AT(0, 0)] = 1.0f - 2.0f * (yy + zz);
-    result.e[VM_M4X4_AT(0, 1)] = 2.0f * (xy + wz);
-    result.e[VM_M4X4_AT(0, 2)] = 2.0f * (xz - wy);
+#ifdef VM_USE_DISPATCH
 
-    result.e[VM_M4X4_AT(1, 0)] = 2.0f * (xy - wz);
-    result.e[VM_M4X4_AT(1, 1)] = 1.0f - 2.0f * (xx + zz);
-    result.e[VM_M4X4_AT(1, 2)] = 2.0f * (yz + wx);
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#define VM_TARGET(isa)
+#else
+#include <immintrin.h>
+#define VM_TARGET(isa) __attribute__((target(isa)))
+#endif
 
-    result.e[VM_M4X4_AT(2, 0)] = 2.0f * (xz + wy);
-    result.e[VM_M4X4_AT(2, 1)] = 2.0f * (yz - wx);
-    result.e[VM_M4X4_AT(2, 2)] = 1.0f - 2.0f * (xx + yy);
+/* GCC fuses separate multiplies and adds into FMA instructions (-ffp-contract=fast
+   outside of ISO C modes). Kernels whose results have to be bit identical across
+   all levels turn this off. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define VM_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
 #else
-    result.e[VM_M4X4_AT(0, 0)] = 1.0f - 2.0f * (yy + zz);
-    result.e[VM_M4X4_AT(0, 1)] = 2.0f * (xy - wz);
-    result.e[VM_M4X4_AT(0, 2)] = 2.0f * (xz + wy);
+#define VM_NO_FP_CONTRACT
+#endif
+
+#define VM_CPU_SSE41 (1 << 0)
+#define VM_CPU_AVX2 (1 << 1)   /* AVX2 + FMA with OS support for YMM registers */
+#define VM_CPU_AVX512 (1 << 2) /* AVX-512F with OS support for ZMM registers */
 
-    result.e[VM_M4X4_AT(1, 0)] = 2.0f * (xy + wz);
-    result.e[VM_M4X4_AT(1, 1)] = 1.0f - 2.0f * (xx + zz);
-    result.e[VM_M4X4_AT(1, 2)] = 2.0f * (yz - wx);
+#define VM_DISPATCH_SCALAR 0
+#define VM_DISPATCH_SSE41 1
+#define VM_DISPATCH_AVX2 2
+#define VM_DISPATCH_AVX512 3
 
-    result.e[VM_M4X4_AT(2, 0)] = 2.0f * (xz - wy);
-    result.e[VM_M4X4_AT(2, 1)] = 2.0f * (yz + wx);
-    result.e[VM_M4X4_AT(2, 2)] = 1.0f - 2.0f * (xx + yy);
+VM_API VM_INLINE void vm_cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    regs[0] = (unsigned int)r[0];
+    regs[1] = (unsigned int)r[1];
+    regs[2] = (unsigned int)r[2];
+    regs[3] = (unsigned int)r[3];
+#else
+    __asm__ __volatile__("cpuid"
+                         : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+                         : "a"(leaf), "c"(subleaf));
 #endif
+}
 
-    return (result);
+/* Returns the OS enabled register state (XCR0), only valid if OSXSAVE is set */
+VM_API VM_INLINE unsigned int vm_xgetbv(void)
+{
+#ifdef _MSC_VER
+    return ((unsigned int)_xgetbv(0));
+#else
+    unsigned int lo;
+    unsigned int hi;
+    __asm__ __volatile__("xgetbv"
+                         : "=a"(lo), "=d"(hi)
+                         : "c"(0));
+    (void)hi;
+    return (lo);
+#endif
 }
 
-VM_API VM_INLINE quat vm_quat_look_rotation(v3 from, v3 to)
+/* Returns a combination of VM_CPU_* flags */
+VM_API VM_INLINE int vm_cpu_features(void)
 {
-    v3 start_dir = vm_v3_normalize(from);
-    v3 end_dir = vm_v3_normalize(to);
+    unsigned int regs[4];
+    unsigned int max_leaf;
+    unsigned int xcr0 = 0;
+    int result = 0;
 
-    float dot = vm_v3_dot(start_dir, end_dir);
-    v3 axis;
-    float s;
-    float invs;
-    quat q;
+    vm_cpuid(0, 0, regs);
+    max_leaf = regs[0];
 
-    if (dot > 0.9999f)
+    if (max_leaf < 1)
     {
-        return vm_quat_rot;
+        return (0);
     }
 
-    if (dot < -0.9999f)
+    vm_cpuid(1, 0, regs);
+
+    if (regs[2] & (1U << 19))
     {
-        v3 orthogonal = vm_v3_cross(vm_v3_up, start_dir);
-        float length_squared = (orthogonal.x * orthogonal.x) + (orthogonal.y * orthogonal.y) + (orthogonal.z * orthogonal.z);
-        quat q;
+        result |= VM_CPU_SSE41;
+    }
 
-        if (length_squared < 1e-6f)
+    /* OSXSAVE: the OS saves the extended registers on context switches */
+    if (regs[2] & (1U << 27))
+    {
+        xcr0 = vm_xgetbv();
+    }
+
+    if (max_leaf >= 7)
+    {
+        unsigned int avx_fma = (regs[2] & (1U << 28)) && (regs[2] & (1U << 12));
+
+        vm_cpuid(7, 0, regs);
+
+        if (avx_fma && (regs[1] & (1U << 5)) && (xcr0 & 0x6U) == 0x6U)
         {
-            orthogonal = vm_v3_cross(vm_v3_up, start_dir);
+            result |= VM_CPU_AVX2;
         }
-        orthogonal = vm_v3_normalize(orthogonal);
 
-        q.x = orthogonal.x;
-        q.y = orthogonal.y;
-        q.z = orthogonal.z;
-        q.w = 0.0f;
-        return q;
+        if ((result & VM_CPU_AVX2) && (regs[1] & (1U << 16)) && (xcr0 & 0xE6U) == 0xE6U)
+        {
+            result |= VM_CPU_AVX512;
+        }
     }
 
-    axis = vm_v3_cross(start_dir, end_dir);
-    s = vm_sqrtf((1 + dot) * 2.0f);
-    invs = 1.0f / s;
-
-    q.x = axis.x * invs;
-    q.y = axis.y * invs;
-    q.z = axis.z * invs;
-    q.w = s * 0.5f;
-
-    return (vm_quat_normalize(q));
+    return (result);
 }
 
-VM_API VM_INLINE m4x4 vm_m4x4_from_to_scaled(v3 start, v3 end, float scale_x, float scale_y)
+/* Returns the best VM_DISPATCH_* level supported by this CPU */
+VM_API VM_INLINE int vm_dispatch_best_level(void)
 {
-    v3 dir = vm_v3_sub(end, start);
-    float dist = vm_v3_length(dir);
-
-    v3 up;
-    quat rot;
-    m4x4 rotation_matrix;
-    m4x4 scale_matrix;
-    v3 midpoint;
-    m4x4 translation_matrix;
+    int features = vm_cpu_features();
 
-    if (dist < 1e-6f)
+    if (features & VM_CPU_AVX512)
     {
-        m4x4 result = vm_m4x4_identity;
-        result.e[VM_M4X4_AT(0, 0)] = 0;
-        result.e[VM_M4X4_AT(1, 1)] = 0;
-        result.e[VM_M4X4_AT(2, 2)] = 0;
-        return result;
+        return (VM_DISPATCH_AVX512);
     }
-
-    dir = vm_v3_normalize(dir);
-
-    up = vm_v3(0.0f, 1.0f, 0.0f);
-    rot = vm_quat_look_rotation(up, dir);
-    rotation_matrix = vm_quat_to_rotation_matrix(rot);
-
-    scale_matrix = vm_m4x4_identity;
-    scale_matrix.e[VM_M4X4_AT(0, 0)] = scale_x;
-    scale_matrix.e[VM_M4X4_AT(1, 1)] = dist;
-    scale_matrix.e[VM_M4X4_AT(2, 2)] = scale_y;
-
-    midpoint = vm_v3_mulf(vm_v3_add(start, end), 0.5f);
-    translation_matrix = vm_m4x4_translate(vm_m4x4_identity, midpoint);
-
-    return vm_m4x4_mul(translation_matrix, vm_m4x4_mul(rotation_matrix, scale_matrix));
+    if (features & VM_CPU_AVX2)
+    {
+        return (VM_DISPATCH_AVX2);
+    }
+    if (features & VM_CPU_SSE41)
+    {
+        return (VM_DISPATCH_SSE41);
+    }
+    return (VM_DISPATCH_SCALAR);
 }
 
-VM_API VM_INLINE float vm_quat_dot(quat a, quat b)
+/* Returns the remaining elements of a stream starting at index */
+VM_API VM_INLINE v3_soa vm_v3_soa_tail(const v3_soa *a, int index)
 {
-    return (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+    return (vm_v3_soa(a->x + index, a->y + index, a->z + index, a->count - index));
 }
 
-VM_API VM_INLINE v3 vm_v3_rotate(v3 a, quat rotation)
+/* normalize: out = a / |a| (zero length stays zero) */
+VM_API VM_INLINE void vm_v3_soa_normalize_scalar(v3_soa *out, v3_soa *a)
 {
-    v3 result;
-
-    quat conjugate = vm_quat_conjugate(rotation);
-    quat w = vm_quat_mulv3(rotation, a);
-    quat rotated = vm_quat_mul(w, conjugate);
-
-    result.x = rotated.x;
-    result.y = rotated.y;
-    result.z = rotated.z;
+    int i;
 
-    return (result);
+    for (i = 0; i < out->count; ++i)
+    {
+        vm_v3_soa_set(out, i, vm_v3_normalize(vm_v3_soa_get(a, i)));
+    }
 }
 
-VM_API VM_INLINE v3 vm_quat_forward(quat rotation)
+VM_TARGET("sse4.1")
+VM_API VM_INLINE void vm_v3_soa_normalize_sse41(v3_soa *out, v3_soa *a)
 {
-    return (vm_v3_rotate(vm_v3_forward, rotation));
-}
+    __m128 zero = _mm_setzero_ps();
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 three_halfs = _mm_set1_ps(1.5f);
+    v3_soa out_tail;
+    v3_soa a_tail;
+    int i = 0;
 
-VM_API VM_INLINE v3 vm_quat_back(quat rotation)
-{
-    return (vm_v3_rotate(vm_v3_back, rotation));
+    for (; i + 4 <= out->count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&a->x[i]);
+        __m128 y = _mm_loadu_ps(&a->y[i]);
+        __m128 z = _mm_loadu_ps(&a->z[i]);
+        __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 r = _mm_rsqrt_ps(length_squared);
+        __m128 scalar = _mm_mul_ps(r, _mm_sub_ps(three_halfs, _mm_mul_ps(_mm_mul_ps(length_squared, half), _mm_mul_ps(r, r))));
+
+        scalar = _mm_blendv_ps(zero, scalar, _mm_cmpgt_ps(length_squared, zero));
+
+        _mm_storeu_ps(&out->x[i], _mm_mul_ps(x, scalar));
+        _mm_storeu_ps(&out->y[i], _mm_mul_ps(y, scalar));
+        _mm_storeu_ps(&out->z[i], _mm_mul_ps(z, scalar));
+    }
+
+    out_tail = vm_v3_soa_tail(out, i);
+    a_tail = vm_v3_soa_tail(a, i);
+    vm_v3_soa_normalize_scalar(&out_tail, &a_tail);
 }
 
-VM_API VM_INLINE v3 vm_quat_up(quat rotation)
+VM_TARGET("avx2,fma")
+VM_API VM_INLINE void vm_v3_soa_normalize_avx2(v3_soa *out, v3_soa *a)
 {
-    return (vm_v3_rotate(vm_v3_up, rotation));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 three_halfs = _mm256_set1_ps(1.5f);
+    v3_soa out_tail;
+    v3_soa a_tail;
+    int i = 0;
+
+    for (; i + 8 <= out->count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&a->x[i]);
+        __m256 y = _mm256_loadu_ps(&a->y[i]);
+        __m256 z = _mm256_loadu_ps(&a->z[i]);
+        __m256 length_squared = _mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x)));
+        __m256 r = _mm256_rsqrt_ps(length_squared);
+        __m256 scalar = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(length_squared, half), _mm256_mul_ps(r, r), three_halfs));
+
+        scalar = _mm256_blendv_ps(zero, scalar, _mm256_cmp_ps(length_squared, zero, _CMP_GT_OQ));
+
+        _mm256_storeu_ps(&out->x[i], _mm256_mul_ps(x, scalar));
+        _mm256_storeu_ps(&out->y[i], _mm256_mul_ps(y, scalar));
+        _mm256_storeu_ps(&out->z[i], _mm256_mul_ps(z, scalar));
+    }
+
+    out_tail = vm_v3_soa_tail(out, i);
+    a_tail = vm_v3_soa_tail(a, i);
+    vm_v3_soa_normalize_scalar(&out_tail, &a_tail);
 }
 
-VM_API VM_INLINE v3 vm_quat_down(quat rotation)
+VM_TARGET("avx512f")
+VM_API VM_INLINE void vm_v3_soa_normalize_avx512(v3_soa *out, v3_soa *a)
 {
-    return (vm_v3_rotate(vm_v3_down, rotation));
+    __m512 zero = _mm512_setzero_ps();
+    __m512 half = _mm512_set1_ps(0.5f);
+    __m512 three_halfs = _mm512_set1_ps(1.5f);
+    v3_soa out_tail;
+    v3_soa a_tail;
+    int i = 0;
+
+    for (; i + 16 <= out->count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(&a->x[i]);
+        __m512 y = _mm512_loadu_ps(&a->y[i]);
+        __m512 z = _mm512_loadu_ps(&a->z[i]);
+        __m512 length_squared = _mm512_fmadd_ps(z, z, _mm512_fmadd_ps(y, y, _mm512_mul_ps(x, x)));
+        __mmask16 non_zero = _mm512_cmp_ps_mask(length_squared, zero, _CMP_GT_OQ);
+        __m512 r = _mm512_maskz_rsqrt14_ps(non_zero, length_squared);
+        __m512 scalar = _mm512_maskz_mul_ps(non_zero, r, _mm512_fnmadd_ps(_mm512_mul_ps(length_squared, half), _mm512_mul_ps(r, r), three_halfs));
+
+        _mm512_storeu_ps(&out->x[i], _mm512_mul_ps(x, scalar));
+        _mm512_storeu_ps(&out->y[i], _mm512_mul_ps(y, scalar));
+        _mm512_storeu_ps(&out->z[i], _mm512_mul_ps(z, scalar));
+    }
+
+    out_tail = vm_v3_soa_tail(out, i);
+    a_tail = vm_v3_soa_tail(a, i);
+    vm_v3_soa_normalize_scalar(&out_tail, &a_tail);
 }
 
-VM_API VM_INLINE v3 vm_quat_left(quat rotation)
+/* integrate: position += velocity * dt (explicit euler step like vm_rigid_body_integrate) */
+VM_API VM_INLINE void vm_v3_soa_integrate_scalar(v3_soa *position, v3_soa *velocity, float dt)
 {
-    return (vm_v3_rotate(vm_v3_left, rotation));
+    int i;
+
+    for (i = 0; i < position->count; ++i)
+    {
+        position->x[i] += velocity->x[i] * dt;
+        position->y[i] += velocity->y[i] * dt;
+        position->z[i] += velocity->z[i] * dt;
+    }
 }
 
-VM_API VM_INLINE v3 vm_quat_right(quat rotation)
+VM_TARGET("sse4.1")
+VM_API VM_INLINE void vm_v3_soa_integrate_sse41(v3_soa *position, v3_soa *velocity, float dt)
 {
-    return (vm_v3_rotate(vm_v3_right, rotation));
-}
+    __m128 dt_vec = _mm_set1_ps(dt);
+    v3_soa position_tail;
+    v3_soa velocity_tail;
+    int i = 0;
 
-/* #############################################################################
- * # FRUSTUM PLANE FUNCTIONS
- * #############################################################################
- */
-#define VM_FRUSTUM_PLANE_SIZE 6
+    for (; i + 4 <= position->count; i += 4)
+    {
+        _mm_storeu_ps(&position->x[i], _mm_add_ps(_mm_loadu_ps(&position->x[i]), _mm_mul_ps(_mm_loadu_ps(&velocity->x[i]), dt_vec)));
+        _mm_storeu_ps(&position->y[i], _mm_add_ps(_mm_loadu_ps(&position->y[i]), _mm_mul_ps(_mm_loadu_ps(&velocity->y[i]), dt_vec)));
+        _mm_storeu_ps(&position->z[i], _mm_add_ps(_mm_loadu_ps(&position->z[i]), _mm_mul_ps(_mm_loadu_ps(&velocity->z[i]), dt_vec)));
+    }
 
-typedef struct frustum
+    position_tail = vm_v3_soa_tail(position, i);
+    velocity_tail = vm_v3_soa_tail(velocity, i);
+    vm_v3_soa_integrate_scalar(&position_tail, &velocity_tail, dt);
+}
+
+VM_TARGET("avx2,fma")
+VM_API VM_INLINE void vm_v3_soa_integrate_avx2(v3_soa *position, v3_soa *velocity, float dt)
 {
+    __m256 dt_vec = _mm256_set1_ps(dt);
+    v3_soa position_tail;
+    v3_soa velocity_tail;
+    int i = 0;
 
-    v4 leftPlane;
-    v4 rightPlane;
-    v4 bottomPlane;
-    v4 topPlane;
-    v4 nearPlane;
-    v4 farPlane;
+    for (; i + 8 <= position->count; i += 8)
+    {
+        _mm256_storeu_ps(&position->x[i], _mm256_fmadd_ps(_mm256_loadu_ps(&velocity->x[i]), dt_vec, _mm256_loadu_ps(&position->x[i])));
+        _mm256_storeu_ps(&position->y[i], _mm256_fmadd_ps(_mm256_loadu_ps(&velocity->y[i]), dt_vec, _mm256_loadu_ps(&position->y[i])));
+        _mm256_storeu_ps(&position->z[i], _mm256_fmadd_ps(_mm256_loadu_ps(&velocity->z[i]), dt_vec, _mm256_loadu_ps(&position->z[i])));
+    }
 
-} frustum;
+    position_tail = vm_v3_soa_tail(position, i);
+    velocity_tail = vm_v3_soa_tail(velocity, i);
+    vm_v3_soa_integrate_scalar(&position_tail, &velocity_tail, dt);
+}
 
-VM_API VM_INLINE v4 *vm_frustum_data(frustum *a)
+VM_TARGET("avx512f")
+VM_API VM_INLINE void vm_v3_soa_integrate_avx512(v3_soa *position, v3_soa *velocity, float dt)
 {
-    return ((v4 *)a);
+    __m512 dt_vec = _mm512_set1_ps(dt);
+    v3_soa position_tail;
+    v3_soa velocity_tail;
+    int i = 0;
+
+    for (; i + 16 <= position->count; i += 16)
+    {
+        _mm512_storeu_ps(&position->x[i], _mm512_fmadd_ps(_mm512_loadu_ps(&velocity->x[i]), dt_vec, _mm512_loadu_ps(&position->x[i])));
+        _mm512_storeu_ps(&position->y[i], _mm512_fmadd_ps(_mm512_loadu_ps(&velocity->y[i]), dt_vec, _mm512_loadu_ps(&position->y[i])));
+        _mm512_storeu_ps(&position->z[i], _mm512_fmadd_ps(_mm512_loadu_ps(&velocity->z[i]), dt_vec, _mm512_loadu_ps(&position->z[i])));
+    }
+
+    position_tail = vm_v3_soa_tail(position, i);
+    velocity_tail = vm_v3_soa_tail(velocity, i);
+    vm_v3_soa_integrate_scalar(&position_tail, &velocity_tail, dt);
 }
 
-VM_API VM_INLINE frustum vm_frustum_extract_planes(m4x4 projection_view)
+/* transform points: out = m * (in, 1), one v3 (16 bytes) per 128 bit lane */
+VM_API VM_INLINE void vm_m4x4_transform_points_scalar(const m4x4 *m, const v3 *in, v3 *out, int n)
 {
     int i;
 
-    frustum result;
-    v4 *frustum_data;
-
-    float a30 = projection_view.e[VM_M4X4_AT(3, 0)];
-    float a31 = projection_view.e[VM_M4X4_AT(3, 1)];
-    float a32 = projection_view.e[VM_M4X4_AT(3, 2)];
-    float a33 = projection_view.e[VM_M4X4_AT(3, 3)];
+    for (i = 0; i < n; ++i)
+    {
+        out[i] = vm_m4x4_transform_point(m, in[i]);
+    }
+}
 
-    float e00 = projection_view.e[VM_M4X4_AT(0, 0)];
-    float e01 = projection_view.e[VM_M4X4_AT(0, 1)];
-    float e02 = projection_view.e[VM_M4X4_AT(0, 2)];
-    float e03 = projection_view.e[VM_M4X4_AT(0, 3)];
+VM_TARGET("sse4.1")
+VM_API VM_INLINE void vm_m4x4_transform_points_sse41(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    const float *e = m->e;
+    /* Matrix columns with a zero w lane, the w lane of the output stays 0.0f */
+    __m128 c0 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 0)], e[VM_M4X4_AT(1, 0)], e[VM_M4X4_AT(0, 0)]);
+    __m128 c1 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 1)], e[VM_M4X4_AT(1, 1)], e[VM_M4X4_AT(0, 1)]);
+    __m128 c2 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 2)], e[VM_M4X4_AT(1, 2)], e[VM_M4X4_AT(0, 2)]);
+    __m128 c3 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 3)], e[VM_M4X4_AT(1, 3)], e[VM_M4X4_AT(0, 3)]);
+    int i;
 
-    float e10 = projection_view.e[VM_M4X4_AT(1, 0)];
-    float e11 = projection_view.e[VM_M4X4_AT(1, 1)];
-    float e12 = projection_view.e[VM_M4X4_AT(1, 2)];
-    float e13 = projection_view.e[VM_M4X4_AT(1, 3)];
+    for (i = 0; i < n; ++i)
+    {
+        __m128 p = _mm_loadu_ps((const float *)&in[i]);
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), c0), c3);
 
-    float e20 = projection_view.e[VM_M4X4_AT(2, 0)];
-    float e21 = projection_view.e[VM_M4X4_AT(2, 1)];
-    float e22 = projection_view.e[VM_M4X4_AT(2, 2)];
-    float e23 = projection_view.e[VM_M4X4_AT(2, 3)];
+        r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), c1), r);
+        r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), c2), r);
 
-    /* Left plane */
-    result.leftPlane.x = a30 + e00;
-    result.leftPlane.y = a31 + e01;
-    result.leftPlane.z = a32 + e02;
-    result.leftPlane.w = a33 + e03;
+        _mm_storeu_ps((float *)&out[i], r);
+    }
+}
 
-    /* Right plane */
-    result.rightPlane.x = a30 - e00;
-    result.rightPlane.y = a31 - e01;
-    result.rightPlane.z = a32 - e02;
-    result.rightPlane.w = a33 - e03;
+VM_TARGET("avx2,fma")
+VM_API VM_INLINE void vm_m4x4_transform_points_avx2(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    const float *e = m->e;
+    /* Matrix columns with a zero w lane, the w lane of the output stays 0.0f */
+    __m128 c0 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 0)], e[VM_M4X4_AT(1, 0)], e[VM_M4X4_AT(0, 0)]);
+    __m128 c1 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 1)], e[VM_M4X4_AT(1, 1)], e[VM_M4X4_AT(0, 1)]);
+    __m128 c2 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 2)], e[VM_M4X4_AT(1, 2)], e[VM_M4X4_AT(0, 2)]);
+    __m128 c3 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 3)], e[VM_M4X4_AT(1, 3)], e[VM_M4X4_AT(0, 3)]);
+    __m256 c0_2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+    __m256 c1_2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+    __m256 c2_2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+    __m256 c3_2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+    int i = 0;
 
-    /* Bottom plane */
-    result.bottomPlane.x = a30 + e10;
-    result.bottomPlane.y = a31 + e11;
-    result.bottomPlane.z = a32 + e12;
-    result.bottomPlane.w = a33 + e13;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m256 p = _mm256_loadu_ps((const float *)&in[i]);
+        __m256 r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x00), c0_2, c3_2);
 
-    /* Top plane */
-    result.topPlane.x = a30 - e10;
-    result.topPlane.y = a31 - e11;
-    result.topPlane.z = a32 - e12;
-    result.topPlane.w = a33 - e13;
+        r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x55), c1_2, r);
+        r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0xAA), c2_2, r);
 
-    /* Near plane */
-    result.nearPlane.x = a30 + e20;
-    result.nearPlane.y = a31 + e21;
-    result.nearPlane.z = a32 + e22;
-    result.nearPlane.w = a33 + e23;
+        _mm256_storeu_ps((float *)&out[i], r);
+    }
 
-    /* Far plane */
-    result.farPlane.x = a30 - e20;
-    result.farPlane.y = a31 - e21;
-    result.farPlane.z = a32 - e22;
-    result.farPlane.w = a33 - e23;
+    vm_m4x4_transform_points_scalar(m, in + i, out + i, n - i);
+}
 
-    frustum_data = vm_frustum_data(&result);
+VM_TARGET("avx512f")
+VM_API VM_INLINE void vm_m4x4_transform_points_avx512(const m4x4 *m, const v3 *in, v3 *out, int n)
+{
+    const float *e = m->e;
+    /* Matrix columns with a zero w lane, the w lane of the output stays 0.0f */
+    __m128 c0 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 0)], e[VM_M4X4_AT(1, 0)], e[VM_M4X4_AT(0, 0)]);
+    __m128 c1 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 1)], e[VM_M4X4_AT(1, 1)], e[VM_M4X4_AT(0, 1)]);
+    __m128 c2 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 2)], e[VM_M4X4_AT(1, 2)], e[VM_M4X4_AT(0, 2)]);
+    __m128 c3 = _mm_set_ps(0.0f, e[VM_M4X4_AT(2, 3)], e[VM_M4X4_AT(1, 3)], e[VM_M4X4_AT(0, 3)]);
+    /* The maskz forms avoid the _mm512_undefined_ps() warnings of some GCC versions */
+    __m512 c0_4 = _mm512_maskz_broadcast_f32x4(0xFFFF, c0);
+    __m512 c1_4 = _mm512_maskz_broadcast_f32x4(0xFFFF, c1);
+    __m512 c2_4 = _mm512_maskz_broadcast_f32x4(0xFFFF, c2);
+    __m512 c3_4 = _mm512_maskz_broadcast_f32x4(0xFFFF, c3);
+    int i = 0;
 
-    /* Normalize planes */
-    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    for (; i + 4 <= n; i += 4)
     {
-        float length_squared = (frustum_data[i].x * frustum_data[i].x) + (frustum_data[i].y * frustum_data[i].y) + (frustum_data[i].z * frustum_data[i].z);
-        float scalar = vm_invsqrt(length_squared);
+        __m512 p = _mm512_loadu_ps((const float *)&in[i]);
+        __m512 r = _mm512_fmadd_ps(_mm512_maskz_permute_ps(0xFFFF, p, 0x00), c0_4, c3_4);
 
-        frustum_data[i].x = frustum_data[i].x * scalar;
-        frustum_data[i].y = frustum_data[i].y * scalar;
-        frustum_data[i].z = frustum_data[i].z * scalar;
-        frustum_data[i].w = frustum_data[i].w * scalar;
+        r = _mm512_fmadd_ps(_mm512_maskz_permute_ps(0xFFFF, p, 0x55), c1_4, r);
+        r = _mm512_fmadd_ps(_mm512_maskz_permute_ps(0xFFFF, p, 0xAA), c2_4, r);
+
+        _mm512_storeu_ps((float *)&out[i], r);
     }
 
-    return (result);
+    vm_m4x4_transform_points_scalar(m, in + i, out + i, n - i);
 }
 
-VM_API VM_INLINE int vm_frustum_is_point_in(frustum frustum, v3 point)
+/* frustum cull spheres: bit i & 7 of visible[i >> 3] is set if sphere i
+   intersects or is inside the frustum (same layout as vm_frustum_cull_spheres_mask).
+   No level uses FMA, so all of them return the same mask for objects touching a
+   plane. The compile time vm_frustum_cull_*_mask functions fuse with VM_USE_AVX2. */
+VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_spheres_scalar(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible)
 {
     int i;
-    v4 *frustum_data = vm_frustum_data(&frustum);
-    v4 pointTarget = vm_v4(point.x, point.y, point.z, 1.0f);
+    int j;
 
-    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    for (i = 0; i < centers->count; ++i)
     {
-        if (vm_v4_dot(frustum_data[i], pointTarget) < 0)
+        float min_distance = 0.0f;
+
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
         {
-            return (0); /* Point is outside */
+            float distance = f->x[j] * centers->x[i] + f->w[j];
+            distance = f->y[j] * centers->y[i] + distance;
+            distance = f->z[j] * centers->z[i] + distance;
+
+            min_distance = (j == 0 || distance < min_distance) ? distance : min_distance;
+        }
+
+        if ((i & 7) == 0)
+        {
+            visible[i >> 3] = 0;
+        }
+
+        if (min_distance + radii[i] >= 0.0f)
+        {
+            visible[i >> 3] = (unsigned char)(visible[i >> 3] | (1 << (i & 7)));
         }
     }
-    return (1); /* Point is inside */
 }
 
-VM_API VM_INLINE int vm_frustum_is_cube_in(frustum frustum, v3 center, v3 dimensions, float epsilon)
+VM_TARGET("sse4.1") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_spheres_sse41(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible)
 {
-    v4 *frustum_data = vm_frustum_data(&frustum);
-
-    /* Calculate the half extents of the object */
-    v3 half_extents = vm_v3_addf(vm_v3_mulf(dimensions, 0.5f), epsilon);
-
-    float subHalfX = center.x - half_extents.x;
-    float addHalfX = center.x + half_extents.x;
-    float subHalfY = center.y - half_extents.y;
-    float addHalfY = center.y + half_extents.y;
-    float subHalfZ = center.z - half_extents.z;
-    float addHalfZ = center.z + half_extents.z;
-
-    int i;
-
-    /* Define the eight corners of the cube in local space */
-    v3 corners[8];
-    corners[0] = vm_v3(subHalfX, subHalfY, subHalfZ);
-    corners[1] = vm_v3(addHalfX, subHalfY, subHalfZ);
-    corners[2] = vm_v3(subHalfX, addHalfY, subHalfZ);
-    corners[3] = vm_v3(addHalfX, addHalfY, subHalfZ);
-    corners[4] = vm_v3(subHalfX, subHalfY, addHalfZ);
-    corners[5] = vm_v3(addHalfX, subHalfY, addHalfZ);
-    corners[6] = vm_v3(subHalfX, addHalfY, addHalfZ);
-    corners[7] = vm_v3(addHalfX, addHalfY, addHalfZ);
+    __m128 zero = _mm_setzero_ps();
+    v3_soa centers_tail;
+    int i = 0;
+    int j;
 
-    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    /* Two groups of 4 per output byte */
+    for (; i + 8 <= centers->count; i += 8)
     {
-        const v4 *plane = &frustum_data[i];
+        int mask = 0;
+        int k;
 
-        /* Check if all corners of the object are on the outside of the plane */
-        int outside = 1;
-        int j;
-        for (j = 0; j < 8; ++j)
+        for (k = 0; k < 8; k += 4)
         {
-            /* Compute the distance from the corner to the plane */
-            float distance = plane->x * corners[j].x + plane->y * corners[j].y + plane->z * corners[j].z + plane->w;
+            __m128 x = _mm_loadu_ps(&centers->x[i + k]);
+            __m128 y = _mm_loadu_ps(&centers->y[i + k]);
+            __m128 z = _mm_loadu_ps(&centers->z[i + k]);
+            __m128 min_distance = zero;
 
-            /* If the distance is greater than or equal to zero, the corner is inside or on the plane */
-            if (distance >= 0)
+            for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
             {
-                outside = 0; /* At least one corner is inside */
-                break;
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->x[j]), x), _mm_set1_ps(f->w[j]));
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->y[j]), y), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->z[j]), z), distance);
+
+                min_distance = (j == 0) ? distance : _mm_min_ps(min_distance, distance);
             }
-        }
 
-        /* If all corners are outside this plane, the object is outside the frustum */
-        if (outside)
-        {
-            return (0);
+            mask |= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(min_distance, _mm_loadu_ps(&radii[i + k])), zero)) << k;
         }
+
+        visible[i >> 3] = (unsigned char)mask;
     }
 
-    /* If we passed all planes, the object is inside or intersects the frustum */
-    return (1);
+    centers_tail = vm_v3_soa_tail(centers, i);
+    vm_frustum_cull_spheres_scalar(f, &centers_tail, radii + i, visible + (i >> 3));
 }
 
-VM_API VM_INLINE int vm_frustum_is_sphere_in(frustum frustum, v3 center, float radius)
+VM_TARGET("avx2,fma") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_spheres_avx2(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible)
 {
-    v4 *frustum_data = vm_frustum_data(&frustum);
-
-    int i;
+    __m256 zero = _mm256_setzero_ps();
+    v3_soa centers_tail;
+    int i = 0;
+    int j;
 
-    for (i = 0; i < VM_FRUSTUM_PLANE_SIZE; ++i)
+    for (; i + 8 <= centers->count; i += 8)
     {
-        v3 frustum_plane_pos = vm_v3(frustum_data[i].x, frustum_data[i].y, frustum_data[i].z);
-        float distance = vm_v3_dot(frustum_plane_pos, center) + frustum_data[i].w;
+        __m256 x = _mm256_loadu_ps(&centers->x[i]);
+        __m256 y = _mm256_loadu_ps(&centers->y[i]);
+        __m256 z = _mm256_loadu_ps(&centers->z[i]);
+        __m256 min_distance = zero;
 
-        if (distance < -radius)
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
         {
-            return (0); /* Completely outside */
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->x[j]), x), _mm256_set1_ps(f->w[j]));
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->y[j]), y), distance);
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->z[j]), z), distance);
+
+            min_distance = (j == 0) ? distance : _mm256_min_ps(min_distance, distance);
         }
+
+        visible[i >> 3] = (unsigned char)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(min_distance, _mm256_loadu_ps(&radii[i])), zero, _CMP_GE_OQ));
     }
 
-    return (1); /* Intersects or inside */
+    centers_tail = vm_v3_soa_tail(centers, i);
+    vm_frustum_cull_spheres_scalar(f, &centers_tail, radii + i, visible + (i >> 3));
 }
 
-/* #############################################################################
- * # TRANSFORMATION FUNCTIONS
- * #############################################################################
- */
-typedef struct transformation
+VM_TARGET("avx512f") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_spheres_avx512(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible)
 {
-    v3 position;
-    quat rotation;
-    v3 scale;
-
-    struct transformation *parent;
+    __m512 zero = _mm512_setzero_ps();
+    v3_soa centers_tail;
+    int i = 0;
+    int j;
 
-} transformation;
+    /* One 16 bit mask per two output bytes */
+    for (; i + 16 <= centers->count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(&centers->x[i]);
+        __m512 y = _mm512_loadu_ps(&centers->y[i]);
+        __m512 z = _mm512_loadu_ps(&centers->z[i]);
+        __m512 min_distance = zero;
+        __mmask16 mask;
 
-VM_API VM_INLINE transformation vm_transformation_init(void)
-{
-    transformation result = {0};
-    result.position = vm_v3_zero;
-    result.rotation = vm_quat_rot;
-    result.scale = vm_v3_one;
-    return (result);
-}
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+        {
+            __m512 distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->x[j]), x), _mm512_set1_ps(f->w[j]));
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->y[j]), y), distance);
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->z[j]), z), distance);
 
-VM_API VM_INLINE m4x4 vm_transformation_matrix(transformation *t)
-{
-    m4x4 translation_matrix = vm_m4x4_translate(vm_m4x4_identity, t->position);
-    m4x4 rotation_matrix = vm_quat_to_rotation_matrix(t->rotation);
-    m4x4 scale_matrix = vm_m4x4_identity;
-    m4x4 parent_matrix = t->parent ? vm_transformation_matrix(t->parent) : vm_m4x4_identity;
+            /* maskz form, see vm_m4x4_transform_points_avx512 */
+            min_distance = (j == 0) ? distance : _mm512_maskz_min_ps(0xFFFF, min_distance, distance);
+        }
 
-    scale_matrix.e[VM_M4X4_AT(0, 0)] = t->scale.x;
-    scale_matrix.e[VM_M4X4_AT(1, 1)] = t->scale.y;
-    scale_matrix.e[VM_M4X4_AT(2, 2)] = t->scale.z;
+        mask = _mm512_cmp_ps_mask(_mm512_add_ps(min_distance, _mm512_loadu_ps(&radii[i])), zero, _CMP_GE_OQ);
+        visible[i >> 3] = (unsigned char)(mask & 0xFF);
+        visible[(i >> 3) + 1] = (unsigned char)(mask >> 8);
+    }
 
-    return (vm_m4x4_mul(parent_matrix, vm_m4x4_mul(translation_matrix, vm_m4x4_mul(rotation_matrix, scale_matrix))));
+    centers_tail = vm_v3_soa_tail(centers, i);
+    vm_frustum_cull_spheres_scalar(f, &centers_tail, radii + i, visible + (i >> 3));
 }
 
-VM_API VM_INLINE void vm_tranformation_rotate(transformation *t, v3 axis, float angle)
+/* frustum cull aabbs: boxes given by center and half extents, same layout as vm_frustum_cull_aabbs_mask */
+VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_aabbs_scalar(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible)
 {
-    t->rotation = vm_quat_rotate(axis, angle);
-}
+    int i;
+    int j;
 
-VM_API VM_INLINE v3 vm_transformation_forward(transformation *t)
-{
-    return vm_v3_rotate(vm_v3_forward, t->rotation);
-}
+    for (i = 0; i < centers->count; ++i)
+    {
+        float min_distance = 0.0f;
 
-VM_API VM_INLINE v3 vm_transformation_right(transformation *t)
-{
-    return vm_v3_rotate(vm_v3_right, t->rotation);
-}
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+        {
+            /* Distance of the p-vertex */
+            float distance = f->x[j] * centers->x[i] + f->w[j];
+            distance = f->y[j] * centers->y[i] + distance;
+            distance = f->z[j] * centers->z[i] + distance;
+            distance = f->abs_x[j] * extents->x[i] + distance;
+            distance = f->abs_y[j] * extents->y[i] + distance;
+            distance = f->abs_z[j] * extents->z[i] + distance;
+
+            min_distance = (j == 0 || distance < min_distance) ? distance : min_distance;
+        }
 
-VM_API VM_INLINE v3 vm_transformation_up(transformation *t)
-{
-    return vm_v3_rotate(vm_v3_up, t->rotation);
+        if ((i & 7) == 0)
+        {
+            visible[i >> 3] = 0;
+        }
+
+        if (min_distance >= 0.0f)
+        {
+            visible[i >> 3] = (unsigned char)(visible[i >> 3] | (1 << (i & 7)));
+        }
+    }
 }
 
-/* #############################################################################
- * # RIGID BODY FUNCTIONS
- * #############################################################################
- */
-typedef struct rigid_body
+VM_TARGET("sse4.1") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_aabbs_sse41(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible)
 {
-    v3 position;        /* World-space position of the body's origin (usually center of mass) */
-    v3 velocity;        /* Linear velocity of the center of mass (in m/s) */
-    v3 force;           /* Accumulated force to apply this frame (reset after integration) */
-    v3 torque;          /* Accumulated torque to apply this frame (reset after integration) */
-    v3 angularVelocity; /* Angular velocity in world space (radians/sec) */
-    float mass;         /* Total mass of the body (in kilograms) */
-    float inertia;      /* Scalar rotational inertia (resistance to rotation) */
-    quat orientation;   /* Current rotation of the body as a quaternion */
+    __m128 zero = _mm_setzero_ps();
+    v3_soa centers_tail;
+    v3_soa extents_tail;
+    int i = 0;
+    int j;
 
-} rigid_body;
+    /* Two groups of 4 per output byte */
+    for (; i + 8 <= centers->count; i += 8)
+    {
+        int mask = 0;
+        int k;
 
-VM_API VM_INLINE rigid_body vm_rigid_body_init(v3 position, quat orientation, float mass, float inertia)
-{
-    rigid_body result;
+        for (k = 0; k < 8; k += 4)
+        {
+            __m128 x = _mm_loadu_ps(&centers->x[i + k]);
+            __m128 y = _mm_loadu_ps(&centers->y[i + k]);
+            __m128 z = _mm_loadu_ps(&centers->z[i + k]);
+            __m128 extent_x = _mm_loadu_ps(&extents->x[i + k]);
+            __m128 extent_y = _mm_loadu_ps(&extents->y[i + k]);
+            __m128 extent_z = _mm_loadu_ps(&extents->z[i + k]);
+            __m128 min_distance = zero;
+
+            for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->x[j]), x), _mm_set1_ps(f->w[j]));
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->y[j]), y), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->z[j]), z), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->abs_x[j]), extent_x), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->abs_y[j]), extent_y), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f->abs_z[j]), extent_z), distance);
+
+                min_distance = (j == 0) ? distance : _mm_min_ps(min_distance, distance);
+            }
 
-    result.position = position;
-    result.orientation = orientation;
-    result.mass = mass;
-    result.inertia = inertia;
-    result.velocity = vm_v3_zero;
-    result.angularVelocity = vm_v3_zero;
-    result.force = vm_v3_zero;
-    result.torque = vm_v3_zero;
+            mask |= _mm_movemask_ps(_mm_cmpge_ps(min_distance, zero)) << k;
+        }
 
-    return (result);
-}
+        visible[i >> 3] = (unsigned char)mask;
+    }
 
-VM_API VM_INLINE v3 vm_rigid_body_forward(rigid_body *rb)
-{
-    return vm_quat_forward(rb->orientation);
+    centers_tail = vm_v3_soa_tail(centers, i);
+    extents_tail = vm_v3_soa_tail(extents, i);
+    vm_frustum_cull_aabbs_scalar(f, &centers_tail, &extents_tail, visible + (i >> 3));
 }
 
-VM_API VM_INLINE v3 vm_rigid_body_right(rigid_body *rb)
+VM_TARGET("avx2,fma") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_aabbs_avx2(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible)
 {
-    return vm_quat_right(rb->orientation);
-}
+    __m256 zero = _mm256_setzero_ps();
+    v3_soa centers_tail;
+    v3_soa extents_tail;
+    int i = 0;
+    int j;
 
-VM_API VM_INLINE v3 vm_rigid_body_up(rigid_body *rb)
-{
-    return vm_quat_up(rb->orientation);
-}
+    for (; i + 8 <= centers->count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&centers->x[i]);
+        __m256 y = _mm256_loadu_ps(&centers->y[i]);
+        __m256 z = _mm256_loadu_ps(&centers->z[i]);
+        __m256 extent_x = _mm256_loadu_ps(&extents->x[i]);
+        __m256 extent_y = _mm256_loadu_ps(&extents->y[i]);
+        __m256 extent_z = _mm256_loadu_ps(&extents->z[i]);
+        __m256 min_distance = zero;
+
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->x[j]), x), _mm256_set1_ps(f->w[j]));
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->y[j]), y), distance);
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->z[j]), z), distance);
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->abs_x[j]), extent_x), distance);
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->abs_y[j]), extent_y), distance);
+            distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f->abs_z[j]), extent_z), distance);
+
+            min_distance = (j == 0) ? distance : _mm256_min_ps(min_distance, distance);
+        }
 
-VM_API VM_INLINE v3 vm_rigid_body_point_velocity(rigid_body *rb, v3 worldPoint)
-{
-    v3 r = vm_v3_sub(worldPoint, rb->position);
-    v3 rotational = vm_v3_cross(rb->angularVelocity, r);
-    return vm_v3_add(rb->velocity, rotational);
+        visible[i >> 3] = (unsigned char)_mm256_movemask_ps(_mm256_cmp_ps(min_distance, zero, _CMP_GE_OQ));
+    }
+
+    centers_tail = vm_v3_soa_tail(centers, i);
+    extents_tail = vm_v3_soa_tail(extents, i);
+    vm_frustum_cull_aabbs_scalar(f, &centers_tail, &extents_tail, visible + (i >> 3));
 }
 
-VM_API VM_INLINE void vm_rigid_body_apply_force_at_position(rigid_body *rb, v3 force, v3 position)
+VM_TARGET("avx512f") VM_NO_FP_CONTRACT
+VM_API VM_INLINE void vm_frustum_cull_aabbs_avx512(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible)
 {
-    v3 r = vm_v3_sub(position, rb->position);
+    __m512 zero = _mm512_setzero_ps();
+    v3_soa centers_tail;
+    v3_soa extents_tail;
+    int i = 0;
+    int j;
 
-    rb->force = vm_v3_add(rb->force, force);
-    rb->torque = vm_v3_add(rb->torque, vm_v3_cross(r, force));
+    /* One 16 bit mask per two output bytes */
+    for (; i + 16 <= centers->count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(&centers->x[i]);
+        __m512 y = _mm512_loadu_ps(&centers->y[i]);
+        __m512 z = _mm512_loadu_ps(&centers->z[i]);
+        __m512 extent_x = _mm512_loadu_ps(&extents->x[i]);
+        __m512 extent_y = _mm512_loadu_ps(&extents->y[i]);
+        __m512 extent_z = _mm512_loadu_ps(&extents->z[i]);
+        __m512 min_distance = zero;
+        __mmask16 mask;
+
+        for (j = 0; j < VM_FRUSTUM_PLANE_SIZE; ++j)
+        {
+            __m512 distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->x[j]), x), _mm512_set1_ps(f->w[j]));
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->y[j]), y), distance);
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->z[j]), z), distance);
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->abs_x[j]), extent_x), distance);
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->abs_y[j]), extent_y), distance);
+            distance = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(f->abs_z[j]), extent_z), distance);
+
+            /* maskz form, see vm_m4x4_transform_points_avx512 */
+            min_distance = (j == 0) ? distance : _mm512_maskz_min_ps(0xFFFF, min_distance, distance);
+        }
+
+        mask = _mm512_cmp_ps_mask(min_distance, zero, _CMP_GE_OQ);
+        visible[i >> 3] = (unsigned char)(mask & 0xFF);
+        visible[(i >> 3) + 1] = (unsigned char)(mask >> 8);
+    }
+
+    centers_tail = vm_v3_soa_tail(centers, i);
+    extents_tail = vm_v3_soa_tail(extents, i);
+    vm_frustum_cull_aabbs_scalar(f, &centers_tail, &extents_tail, visible + (i >> 3));
 }
 
-VM_API VM_INLINE void vm_rigid_body_integrate(rigid_body *rb, float dt)
+typedef struct vm_dispatch_table
 {
-    float invMass = rb->mass > 0.0f ? (1.0f / rb->mass) : 0.0f;
-    float invInertia = rb->inertia > 0.0f ? (1.0f / rb->inertia) : 0.0f;
+    int level; /* VM_DISPATCH_* */
 
-    v3 acceleration = vm_v3_mulf(rb->force, invMass);
-    v3 angularAcceleration;
-    float angle;
+    void (*v3_soa_normalize)(v3_soa *out, v3_soa *a);
+    void (*v3_soa_integrate)(v3_soa *position, v3_soa *velocity, float dt);
+    void (*m4x4_transform_points)(const m4x4 *m, const v3 *in, v3 *out, int n);
+    void (*frustum_cull_spheres)(const frustum_simd *f, const v3_soa *centers, const float *radii, unsigned char *visible);
+    void (*frustum_cull_aabbs)(const frustum_simd *f, const v3_soa *centers, const v3_soa *extents, unsigned char *visible);
 
-    rb->velocity = vm_v3_add(rb->velocity, vm_v3_mulf(acceleration, dt));
-    rb->position = vm_v3_add(rb->position, vm_v3_mulf(rb->velocity, dt));
+} vm_dispatch_table;
 
-    angularAcceleration = vm_v3_mulf(rb->torque, invInertia);
-    rb->angularVelocity = vm_v3_add(rb->angularVelocity, vm_v3_mulf(angularAcceleration, dt));
+/* Starts with the scalar kernels so calls before vm_dispatch_init() are valid */
+static vm_dispatch_table vm_dispatch = {
+    VM_DISPATCH_SCALAR,
+    vm_v3_soa_normalize_scalar,
+    vm_v3_soa_integrate_scalar,
+    vm_m4x4_transform_points_scalar,
+    vm_frustum_cull_spheres_scalar,
+    vm_frustum_cull_aabbs_scalar};
 
-    angle = vm_v3_length(rb->angularVelocity) * dt;
+/* Selects the kernels of a VM_DISPATCH_* level, returns 0 (and keeps the current table) if the CPU does not support it */
+VM_API VM_INLINE int vm_dispatch_set(int level)
+{
+    if (level < VM_DISPATCH_SCALAR || level > vm_dispatch_best_level())
+    {
+        return (0);
+    }
 
-    if (angle > 0.0001f)
+    vm_dispatch.level = level;
+
+    switch (level)
     {
-        v3 axis = vm_v3_normalize(rb->angularVelocity);
-        quat dq = vm_quat_rotate(axis, angle);
-        rb->orientation = vm_quat_normalize(vm_quat_mul(dq, rb->orientation));
+    case VM_DISPATCH_AVX512:
+        vm_dispatch.v3_soa_normalize = vm_v3_soa_normalize_avx512;
+        vm_dispatch.v3_soa_integrate = vm_v3_soa_integrate_avx512;
+        vm_dispatch.m4x4_transform_points = vm_m4x4_transform_points_avx512;
+        vm_dispatch.frustum_cull_spheres = vm_frustum_cull_spheres_avx512;
+        vm_dispatch.frustum_cull_aabbs = vm_frustum_cull_aabbs_avx512;
+        break;
+    case VM_DISPATCH_AVX2:
+        vm_dispatch.v3_soa_normalize = vm_v3_soa_normalize_avx2;
+        vm_dispatch.v3_soa_integrate = vm_v3_soa_integrate_avx2;
+        vm_dispatch.m4x4_transform_points = vm_m4x4_transform_points_avx2;
+        vm_dispatch.frustum_cull_spheres = vm_frustum_cull_spheres_avx2;
+        vm_dispatch.frustum_cull_aabbs = vm_frustum_cull_aabbs_avx2;
+        break;
+    case VM_DISPATCH_SSE41:
+        vm_dispatch.v3_soa_normalize = vm_v3_soa_normalize_sse41;
+        vm_dispatch.v3_soa_integrate = vm_v3_soa_integrate_sse41;
+        vm_dispatch.m4x4_transform_points = vm_m4x4_transform_points_sse41;
+        vm_dispatch.frustum_cull_spheres = vm_frustum_cull_spheres_sse41;
+        vm_dispatch.frustum_cull_aabbs = vm_frustum_cull_aabbs_sse41;
+        break;
+    default:
+        vm_dispatch.v3_soa_normalize = vm_v3_soa_normalize_scalar;
+        vm_dispatch.v3_soa_integrate = vm_v3_soa_integrate_scalar;
+        vm_dispatch.m4x4_transform_points = vm_m4x4_transform_points_scalar;
+        vm_dispatch.frustum_cull_spheres = vm_frustum_cull_spheres_scalar;
+        vm_dispatch.frustum_cull_aabbs = vm_frustum_cull_aabbs_scalar;
+        break;
     }
 
-    rb->force = vm_v3_zero;
-    rb->torque = vm_v3_zero;
+    return (1);
 }
 
+/* Probes the CPU and selects the best kernels, returns the selected VM_DISPATCH_* level */
+VM_API VM_INLINE int vm_dispatch_init(void)
+{
+    int level = vm_dispatch_best_level();
+    vm_dispatch_set(level);
+    return (level);
+}
+
+#endif /* VM_USE_DISPATCH */
+
 #endif /* VM_H */
 
 /*